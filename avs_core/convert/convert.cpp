@@ -623,31 +623,19 @@ AddAlphaPlane::AddAlphaPlane(PClip _child, PClip _alphaClip, float _mask_f, bool
 PVideoFrame AddAlphaPlane::GetFrame(int n, IScriptEnvironment* env)
 {
   PVideoFrame src = child->GetFrame(n, env);
-  PVideoFrame dst = env->NewVideoFrameP(vi, &src);
   if(vi.IsPlanar())
   {
     int planes_y[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
     int planes_r[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
     int *planes = (vi.IsYUV() || vi.IsYUVA()) ? planes_y : planes_r;
-    // copy existing 3 planes
-    for (int p = 0; p < 3; ++p) {
-      const int plane = planes[p];
-      env->BitBlt(dst->GetWritePtr(plane), dst->GetPitch(plane), src->GetReadPtr(plane),
-           src->GetPitch(plane), src->GetRowSize(plane), src->GetHeight(plane));
-    }
-  } else {
-    // Packed RGB, already converted to RGB32 or RGB64
-    env->BitBlt(dst->GetWritePtr(), dst->GetPitch(), src->GetReadPtr(),
-      src->GetPitch(), src->GetRowSize(), src->GetHeight());
-  }
-
-  if (vi.IsPlanarRGBA() || vi.IsYUVA()) {
-    if (alphaClip) {
-      PVideoFrame srcAlpha = alphaClip->GetFrame(n, env);
-      env->BitBlt(dst->GetWritePtr(PLANAR_A), dst->GetPitch(PLANAR_A), srcAlpha->GetReadPtr(PLANAR_Y),
-        srcAlpha->GetPitch(PLANAR_Y), srcAlpha->GetRowSize(PLANAR_Y), srcAlpha->GetHeight(PLANAR_Y));
-    }
-    else {
+    // existing 3 planes and the alpha clip are shared, not copied
+    PVideoFrame frames[4] = { src, src, src, nullptr };
+    const int src_planes[4] = { planes[0], planes[1], planes[2], PLANAR_Y };
+    if (alphaClip)
+      frames[3] = alphaClip->GetFrame(n, env);
+    PVideoFrame dst = env->NewVideoFrameFromPlanes(vi, frames, src_planes, &src);
+
+    if (!alphaClip) {
       // default constant
       const int rowsizeA = dst->GetRowSize(PLANAR_A);
       const int dst_pitchA = dst->GetPitch(PLANAR_A);
@@ -669,6 +657,12 @@ PVideoFrame AddAlphaPlane::GetFrame(int n, IScriptEnvironment* env)
     }
     return dst;
   }
+
+  // Packed RGB, already converted to RGB32 or RGB64
+  PVideoFrame dst = env->NewVideoFrameP(vi, &src);
+  env->BitBlt(dst->GetWritePtr(), dst->GetPitch(), src->GetReadPtr(),
+    src->GetPitch(), src->GetRowSize(), src->GetHeight());
+
   // RGB32 and RGB64
 
   BYTE* pf = dst->GetWritePtr();
@@ -53,7 +53,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -79,7 +80,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
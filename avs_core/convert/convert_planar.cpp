@@ -1466,49 +1466,50 @@ ConvertToPlanarGeneric::ConvertToPlanarGeneric(
 
 PVideoFrame __stdcall ConvertToPlanarGeneric::GetFrame(int n, IScriptEnvironment* env) {
   PVideoFrame src = child->GetFrame(n, env);
-  PVideoFrame dst = env->NewVideoFrameP(vi, &src);
+
+  // Luma and alpha of the source and the resized chroma are shared, not copied.
+  // New planes only for the filled chroma or alpha.
+  PVideoFrame frames[4] = { src, nullptr, nullptr, nullptr };
+  const int planes[4] = { PLANAR_Y, PLANAR_Y, PLANAR_Y, PLANAR_A };
+  if (!Yinput) {
+    frames[1] = Usource->GetFrame(n, env);
+    frames[2] = Vsource->GetFrame(n, env);
+  }
+  if (src->GetPitch(PLANAR_A) != 0)
+    frames[3] = src;
+
+  PVideoFrame dst = env->NewVideoFrameFromPlanes(vi, frames, planes, &src);
 
   auto props = env->getFramePropsRW(dst);
   update_ChromaLocation(props, ChromaLocation_Out, env);
 
-  env->BitBlt(dst->GetWritePtr(PLANAR_Y), dst->GetPitch(PLANAR_Y), src->GetReadPtr(PLANAR_Y), src->GetPitch(PLANAR_Y),
-              src->GetRowSize(PLANAR_Y_ALIGNED), src->GetHeight(PLANAR_Y));
-
   // alpha. if pitch is zero -> no alpha channel
-  const int rowsizeA = dst->GetRowSize(PLANAR_A);
   const int dst_pitchA = dst->GetPitch(PLANAR_A);
-  BYTE* dstp_a = (dst_pitchA == 0) ? nullptr : dst->GetWritePtr(PLANAR_A);
-  const int heightA = dst->GetHeight(PLANAR_A);
-
-  if (dst_pitchA != 0)
-  {
-    if (src->GetPitch(PLANAR_A) != 0)
-      env->BitBlt(dstp_a, dst_pitchA, src->GetReadPtr(PLANAR_A), src->GetPitch(PLANAR_A),
-        src->GetRowSize(PLANAR_A_ALIGNED), src->GetHeight(PLANAR_A));
-    else {
-      // e.g. ConvertToYUVA() case from Alpha-less formats
-      switch (vi.ComponentSize())
-      {
-      case 1:
-        fill_plane<BYTE>(dstp_a, heightA, rowsizeA, dst_pitchA, 255);
-        break;
-      case 2:
-        fill_plane<uint16_t>(dstp_a, heightA, rowsizeA, dst_pitchA, (1 << vi.BitsPerComponent()) - 1);
-        break;
-      case 4:
-        fill_plane<float>(dstp_a, heightA, rowsizeA, dst_pitchA, 1.0f);
-        break;
-      }
+  if (dst_pitchA != 0 && !frames[3]) {
+    // e.g. ConvertToYUVA() case from Alpha-less formats
+    BYTE* dstp_a = dst->GetWritePtr(PLANAR_A);
+    const int rowsizeA = dst->GetRowSize(PLANAR_A);
+    const int heightA = dst->GetHeight(PLANAR_A);
+    switch (vi.ComponentSize())
+    {
+    case 1:
+      fill_plane<BYTE>(dstp_a, heightA, rowsizeA, dst_pitchA, 255);
+      break;
+    case 2:
+      fill_plane<uint16_t>(dstp_a, heightA, rowsizeA, dst_pitchA, (1 << vi.BitsPerComponent()) - 1);
+      break;
+    case 4:
+      fill_plane<float>(dstp_a, heightA, rowsizeA, dst_pitchA, 1.0f);
+      break;
     }
   }
 
-  BYTE* dstp_u = dst->GetWritePtr(PLANAR_U);
-  BYTE* dstp_v = dst->GetWritePtr(PLANAR_V);
-  const int height = dst->GetHeight(PLANAR_U);
-  const int rowsizeUV = dst->GetRowSize(PLANAR_U);
-  const int dst_pitch = dst->GetPitch(PLANAR_U);
-
   if (Yinput) {
+    BYTE* dstp_u = dst->GetWritePtr(PLANAR_U);
+    BYTE* dstp_v = dst->GetWritePtr(PLANAR_V);
+    const int height = dst->GetHeight(PLANAR_U);
+    const int rowsizeUV = dst->GetRowSize(PLANAR_U);
+    const int dst_pitch = dst->GetPitch(PLANAR_U);
     switch (vi.ComponentSize())
     {
       case 1:
@@ -1522,11 +1523,6 @@ PVideoFrame __stdcall ConvertToPlanarGeneric::GetFrame(int n, IScriptEnvironment
         fill_chroma<float>(dstp_u, dstp_v, height, rowsizeUV, dst_pitch, half);
         break;
     }
-  } else {
-    src = Usource->GetFrame(n, env);
-    env->BitBlt(dstp_u, dst_pitch, src->GetReadPtr(PLANAR_Y), src->GetPitch(PLANAR_Y), src->GetRowSize(PLANAR_Y_ALIGNED), height);
-    src = Vsource->GetFrame(n, env);
-    env->BitBlt(dstp_v, dst_pitch, src->GetReadPtr(PLANAR_Y), src->GetPitch(PLANAR_Y), src->GetRowSize(PLANAR_Y_ALIGNED), height);
   }
 
   return dst;
@@ -58,7 +58,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n,IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -84,7 +85,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -105,7 +107,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -119,7 +122,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -140,7 +144,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -158,7 +163,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -184,7 +190,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n,IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -204,7 +211,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n,IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -1,18 +1,33 @@
 #include "BufferPool.h"
-#include <map>
 #include <avisynth.h>
 #include <avs/alignment.h>
 #include <avs/minmax.h>
 #include "InternalEnvironment.h"
+#ifdef AVS_LINUX
+#include <sys/mman.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #define BUFFER_GUARD_VALUE  0x55555555
 
+#if defined(AVS_LINUX) && defined(MADV_HUGEPAGE)
+// Large pooled buffers live long and are swept every frame,
+// back them with transparent huge pages to save TLB misses
+#define BUFFER_HUGE_PAGES
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+#endif
+
 struct BufferPool::BufferDesc
 {
   void* ptr;
-  size_t size;
   size_t alignment;
-  bool in_use;
+  int size_class;
+  BufferPool* owner;
+  BufferDesc* prev;         // AllBuffers list of the owner
+  BufferDesc* next;
+  BufferDesc* next_remote;  // RemoteFrees list of the owner
 };
 
 
@@ -41,6 +56,41 @@ static inline void* GetRealPtr(void* ptr)
   return ((void**)ptr)[-2];
 }
 
+static inline int FloorLog2(size_t n)
+{
+#if defined(__GNUC__)
+  return (int)(sizeof(unsigned long long) * 8 - 1) - __builtin_clzll((unsigned long long)n);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanReverse64(&index, n);
+  return (int)index;
+#else
+  int r = 0;
+  while (n >>= 1)
+    ++r;
+  return r;
+#endif
+}
+
+// Class 0 is [1..64] bytes, then each (2^p, 2^(p+1)] range is split into four classes
+int BufferPool::SizeClass(size_t nBytes)
+{
+  if (nBytes <= ((size_t)1 << MIN_CLASS_SHIFT))
+    return 0;
+  const int p = FloorLog2(nBytes - 1);
+  const int sub = (int)(((nBytes - 1) >> (p - 2)) & 3);
+  return 1 + (p - MIN_CLASS_SHIFT) * 4 + sub;
+}
+
+size_t BufferPool::ClassSize(int size_class)
+{
+  if (size_class == 0)
+    return (size_t)1 << MIN_CLASS_SHIFT;
+  const int p = MIN_CLASS_SHIFT + (size_class - 1) / 4;
+  const int sub = (size_class - 1) % 4;
+  return ((size_t)1 << p) + ((size_t)(sub + 1) << (p - 2));
+}
+
 void* BufferPool::PrivateAlloc(size_t nBytes, size_t alignment, void* user)
 {
   /* Number of extra data fields to allocate.
@@ -60,9 +110,22 @@ void* BufferPool::PrivateAlloc(size_t nBytes, size_t alignment, void* user)
   size_t offset = NUM_EXTRA_FIELDS * sizeof(void*) + alignment - 1;
   nBytes += offset;
 
-  void *orig = malloc(nBytes);
-  if (orig == NULL)
-    return NULL;
+  void *orig;
+#ifdef BUFFER_HUGE_PAGES
+  if (user != NULL && nBytes >= HUGE_PAGE_SIZE)
+  {
+    nBytes = AlignNumber(nBytes, HUGE_PAGE_SIZE);
+    if (posix_memalign(&orig, HUGE_PAGE_SIZE, nBytes) != 0)
+      return NULL;
+    madvise(orig, nBytes, MADV_HUGEPAGE); // only a hint, failure is harmless
+  }
+  else
+#endif
+  {
+    orig = malloc(nBytes);
+    if (orig == NULL)
+      return NULL;
+  }
 
   void **aligned = (void**)(((uintptr_t)orig + (uintptr_t)offset) & (~(uintptr_t)(alignment-1)));
   aligned[-5] = (void*)BUFFER_GUARD_VALUE;
@@ -82,68 +145,119 @@ void BufferPool::PrivateFree(void* buffer)
   free(GetRealPtr(buffer));
 }
 
+// Called by the owner thread only
+void BufferPool::Release(BufferDesc* desc)
+{
+  std::vector<BufferDesc*>& free_list = FreeLists[desc->size_class];
+  const size_t size = ClassSize(desc->size_class);
+
+  // Keep at least one free buffer of each class, even a large one,
+  // otherwise a filter with big scratch buffers would allocate on every frame
+  if (free_list.size() < MAX_FREE_PER_CLASS
+    && (free_list.empty() || RetainedBytes + size <= MAX_RETAINED_BYTES))
+  {
+    free_list.push_back(desc);
+    RetainedBytes += size;
+    Stats->retained_bytes += size;
+    return;
+  }
+
+  if (desc->prev != NULL)
+    desc->prev->next = desc->next;
+  else
+    AllBuffers = desc->next;
+  if (desc->next != NULL)
+    desc->next->prev = desc->prev;
+
+  PrivateFree(desc->ptr);
+  delete desc;
+}
+
+void BufferPool::CollectRemoteFrees()
+{
+  BufferDesc* desc = RemoteFrees.exchange(NULL);
+  while (desc != NULL)
+  {
+    BufferDesc* next = desc->next_remote;
+    Release(desc);
+    desc = next;
+  }
+}
+
 
-BufferPool::BufferPool(InternalEnvironment* env) :
-  Env(env)
+BufferPool::BufferPool(InternalEnvironment* env, BufferPoolStats* stats) :
+  Env(env),
+  Stats(stats),
+  AllBuffers(NULL),
+  RetainedBytes(0),
+  RemoteFrees(NULL)
 {
 }
 
 BufferPool::~BufferPool()
 {
-  const MapType::iterator end_it = Map.end();
-  for (
-    MapType::iterator it = Map.begin();
-    it != end_it;
-    ++it)
+  CollectRemoteFrees();
+  Stats->retained_bytes -= RetainedBytes;
+
+  BufferDesc* desc = AllBuffers;
+  while (desc != NULL)
   {
-      BufferDesc* desc = it->second;
-      PrivateFree(desc->ptr);
-      delete desc;
+    BufferDesc* next = desc->next;
+    PrivateFree(desc->ptr);
+    delete desc;
+    desc = next;
   }
 }
 
 void* BufferPool::Allocate(size_t nBytes, size_t alignment, bool pool)
 {
-  if (pool)
-  {
-    // First, check if we can return a buffer from the pool
-    const MapType::iterator end_it = Map.end();
-    for (
-      MapType::iterator it = Map.lower_bound(nBytes);
-      it != end_it;
-      ++it)
-    {
-      BufferDesc* desc = it->second;
-      if ( !desc->in_use
-        && (desc->alignment >= alignment)
-      )
-      {
-        desc->in_use = true;
-        return desc->ptr;
-      }
-    }
+  if (!pool || nBytes > ((size_t)1 << (MAX_CLASS_SHIFT + 1)))
+    return PrivateAlloc(nBytes, alignment, NULL);
 
-    // None found, allocate new one
-    BufferDesc* desc = new BufferDesc();
+  const int size_class = SizeClass(nBytes);
+  std::vector<BufferDesc*>& free_list = FreeLists[size_class];
 
-    void* ptr = PrivateAlloc(nBytes, alignment, reinterpret_cast<void*>(desc));
-    if (ptr == NULL)
+  if (free_list.empty() && RemoteFrees.load(std::memory_order_relaxed) != NULL)
+    CollectRemoteFrees();
+
+  // First, check if we can return a buffer from the pool. Most recently
+  // freed first, alignment nearly always matches on the first try.
+  for (size_t i = free_list.size(); i-- > 0; )
+  {
+    BufferDesc* desc = free_list[i];
+    if (desc->alignment >= alignment)
     {
-      delete desc;
-      return NULL;
+      free_list.erase(free_list.begin() + i);
+      const size_t size = ClassSize(size_class);
+      RetainedBytes -= size;
+      Stats->retained_bytes -= size;
+      ++Stats->hits;
+      return desc->ptr;
     }
-
-    desc->alignment = alignment;
-    desc->in_use = true;
-    desc->ptr = ptr;
-    desc->size = nBytes;
-    Map.emplace(nBytes, desc);
-    return ptr;
   }
-  else
+
+  // None found, allocate new one with the full size of the class
+  ++Stats->misses;
+  BufferDesc* desc = new BufferDesc();
+
+  void* ptr = PrivateAlloc(ClassSize(size_class), alignment, reinterpret_cast<void*>(desc));
+  if (ptr == NULL)
   {
-    return PrivateAlloc(nBytes, alignment, NULL);
+    delete desc;
+    return NULL;
   }
+
+  desc->ptr = ptr;
+  desc->alignment = alignment;
+  desc->size_class = size_class;
+  desc->owner = this;
+  desc->prev = NULL;
+  desc->next = AllBuffers;
+  desc->next_remote = NULL;
+  if (AllBuffers != NULL)
+    AllBuffers->prev = desc;
+  AllBuffers = desc;
+  return ptr;
 }
 
 void BufferPool::Free(void* ptr)
@@ -156,12 +270,20 @@ void BufferPool::Free(void* ptr)
 
   BufferDesc* data = reinterpret_cast<BufferDesc*>(GetUserData(ptr));
 
-  if (data != NULL)
+  if (data == NULL)
+  {
+    PrivateFree(ptr);
+  }
+  else if (data->owner == this)
   { // Getting into this branch means this buffer is pooled
-    data->in_use = false;
+    Release(data);
   }
   else
-  {
-    PrivateFree(ptr);
+  { // Pooled by another thread, give it back to its owner
+    BufferPool* owner = data->owner;
+    BufferDesc* head = owner->RemoteFrees.load(std::memory_order_relaxed);
+    do {
+      data->next_remote = head;
+    } while (!owner->RemoteFrees.compare_exchange_weak(head, data, std::memory_order_release, std::memory_order_relaxed));
   }
 }
@@ -1,27 +1,67 @@
 #ifndef _AVS_BUFFERPOOL_H
 #define _AVS_BUFFERPOOL_H
 
-#include <map>
+#include <atomic>
+#include <vector>
 #include <avs/types.h>
 
 class InternalEnvironment;
 
+// Counters shared by all BufferPools of a script environment,
+// queried through GetEnvProperty (AEP_BUFFERPOOL_xxx)
+struct BufferPoolStats
+{
+  std::atomic<uint64_t> hits;           // pooled request served from a free buffer
+  std::atomic<uint64_t> misses;         // pooled request which had to allocate
+  std::atomic<int64_t> retained_bytes;  // free buffers kept for reuse
+
+  BufferPoolStats() : hits(0), misses(0), retained_bytes(0) { }
+};
+
+// Per-thread pool of temporary buffers (env->Allocate with AVS_POOLED_ALLOC).
+//
+// Requests are rounded up to size classes, four per power of two, and each
+// class keeps a small LIFO stack of free buffers, so a filter asking for its
+// scanline buffers every frame gets the same (cache warm) memory back without
+// searching. Only a limited amount of free memory is retained, the rest is
+// given back to the system.
+// A buffer may be freed by another thread than the one which allocated it.
+// Such buffers are handed back to their owner pool through a lock-free list
+// and are collected by the owner on its next allocation.
 class BufferPool
 {
 private:
 
   struct BufferDesc;
-  typedef std::multimap<size_t, BufferDesc*> MapType;
+
+  enum {
+    MIN_CLASS_SHIFT = 6,      // smallest class: 64 bytes
+    MAX_CLASS_SHIFT = 30,     // larger requests are not pooled
+    NUM_CLASSES = 1 + (MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1) * 4,
+    MAX_FREE_PER_CLASS = 8
+  };
+
+  static const size_t MAX_RETAINED_BYTES = 64 * 1024 * 1024;
 
   InternalEnvironment* Env;
-  MapType Map;
+  BufferPoolStats* Stats;
+
+  std::vector<BufferDesc*> FreeLists[NUM_CLASSES];
+  BufferDesc* AllBuffers;   // doubly linked list of every pooled buffer owned
+  size_t RetainedBytes;
+  std::atomic<BufferDesc*> RemoteFrees;
+
+  static int SizeClass(size_t nBytes);
+  static size_t ClassSize(int size_class);
 
   void* PrivateAlloc(size_t nBytes, size_t alignment, void* user);
   void PrivateFree(void* buffer);
+  void Release(BufferDesc* desc);
+  void CollectRemoteFrees();
 
 public:
 
-  BufferPool(InternalEnvironment* env);
+  BufferPool(InternalEnvironment* env, BufferPoolStats* stats);
   ~BufferPool();
 
   void* Allocate(size_t nBytes, size_t alignment, bool pool);
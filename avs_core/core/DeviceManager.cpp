@@ -1,5 +1,6 @@
 
 #include "DeviceManager.h"
+#include "FrameRegistry.h"
 #include "internal.h"
 #include "InternalEnvironment.h"
 #include <avs/minmax.h>
@@ -140,6 +141,19 @@ size_t GetFrameTail(const PVideoFrame& vf)
   return min(tail, vf->GetFrameBuffer()->GetDataSize() + (int)GetFrameHead(vf));
 }
 
+Device::Device(AvsDeviceType type, int id, int index, InternalEnvironment* env) :
+  env(env),
+  device_type(type),
+  device_id(id),
+  device_index(index),
+  memory_max(0),
+  memory_used(0),
+  free_thresh(0),
+  free_list(new FrameBufferFreeList())
+{ }
+
+Device::~Device() { }
+
 class CPUDevice : public Device {
 public:
   CPUDevice(InternalEnvironment* env)
@@ -686,7 +700,7 @@ public:
     workerExceptionPresent(false)
   {
     if (numThreads > 0 && prefetchFrames > 0) {
-      threadPool = env->NewThreadPool(numThreads);
+      threadPool = env->NewThreadPool(numThreads, THREADPOOL_SCHED_FIFO);
       videoCache = std::shared_ptr<CacheType>(new CacheType(prefetchFrames - 1, CACHE_NO_RESIZE));
     }
     else {
@@ -847,7 +861,8 @@ class CUDAFrameTransferEngine : public FrameTransferEngine
 
   PVideoFrame GetFrameImmediate(int n, InternalEnvironment* env)
   {
-    PVideoFrame src = child.GetFrame(n, env);
+    // the transfer copies the frame buffer as a whole
+    PVideoFrame src = env->GetSingleBufferFrame(child.GetFrame(n, env));
     PVideoFrame dst = env->GetOnDeviceFrame(src, downstreamDevice);
     TransferFrameData(dst, src, false, env);
 
@@ -871,7 +886,7 @@ class CUDAFrameTransferEngine : public FrameTransferEngine
         env->propDeleteKey(mapv, key);
 
         for (int index = 0; index < numElements; index++) {
-          PVideoFrame src = frameset[index];
+          PVideoFrame src = env->GetSingleBufferFrame(frameset[index]);
           PVideoFrame dst = env->GetOnDeviceFrame(src, downstreamDevice);
           TransferFrameData(dst, src, false, env);
           env->propSetFrame(mapv, key, dst, AVSPropAppendMode::PROPAPPENDMODE_APPEND);
@@ -897,7 +912,7 @@ class CUDAFrameTransferEngine : public FrameTransferEngine
 
   QueueItem SetupTransfer(int n, CacheType::handle& cacheHandle, InternalEnvironment* env)
   {
-    QueueItem item = { (size_t)n, child.GetFrame(n, env), cacheHandle, nullptr, nullptr };
+    QueueItem item = { (size_t)n, env->GetSingleBufferFrame(child.GetFrame(n, env)), cacheHandle, nullptr, nullptr };
     cacheHandle.first->value = env->GetOnDeviceFrame(item.src, downstreamDevice);
     CUDA_CHECK(cudaEventCreate(&item.completeEvent));
 
@@ -929,7 +944,7 @@ class CUDAFrameTransferEngine : public FrameTransferEngine
         env->propDeleteKey(mapv, key);
 
         for (int index = 0; index < numElements; index++) {
-          PVideoFrame src = frameset[index];
+          PVideoFrame src = env->GetSingleBufferFrame(frameset[index]);
           PVideoFrame dst = env->GetOnDeviceFrame(src, downstreamDevice);
           TransferFrameData(dst, src, true, env);
           env->propSetFrame(mapv, key, dst, AVSPropAppendMode::PROPAPPENDMODE_APPEND);
@@ -6,6 +6,7 @@
 #include <memory>
 
 class InternalEnvironment;
+class FrameBufferFreeList;
 enum DeviceOpt: int; // forward enum w/o underlying types are MS specific
 
 struct DeviceCompleteCallbackData {
@@ -27,17 +28,11 @@ public:
 
     int  free_thresh;
 
-    Device(AvsDeviceType type, int id, int index, InternalEnvironment* env) :
-      env(env),
-      device_type(type),
-      device_id(id),
-      device_index(index),
-      memory_max(0),
-      memory_used(0),
-      free_thresh(0)
-    { }
-
-    virtual ~Device() { }
+    // free frame buffers of this device, see FrameRegistry.h
+    std::unique_ptr<FrameBufferFreeList> free_list;
+
+    Device(AvsDeviceType type, int id, int index, InternalEnvironment* env);
+    virtual ~Device();
 
     virtual int SetMemoryMax(int mem) = 0;
     virtual BYTE* Allocate(size_t sz, int margin) = 0;
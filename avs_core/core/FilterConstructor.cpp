@@ -1,5 +1,13 @@
 #include "FilterConstructor.h"
 #include "avisynth.h"
+#include "InternalEnvironment.h"
+#include <avisynth_c.h>
+
+// set by SingleBufferFrames::ApplyScope
+static thread_local struct {
+  const Function* func;
+  std::vector<SingleBufferFrames*>* wrappers;
+} tls_apply = { nullptr, nullptr };
 
 FilterConstructor::FilterConstructor(IScriptEnvironment2 * env,
   IScriptEnvironment_Avs25* env25,
@@ -27,6 +35,8 @@ AVSValue FilterConstructor::InstantiateFilter() const
   // Calls the plugin's instance creator, which is usually Filter_Create(AVSValue args, void *user_data, IScriptEnvironment *env)
   // or create_c_filter
   AVSValue funcArgs;
+  const bool wrapFrames = SingleBufferFrames::IsNeededFor(Func);
+  std::vector<SingleBufferFrames*> wrappers;
 
   // isPluginAvs25 and isPluginPreV11C cannot accept long and double types in
   // their parameters passed to them.
@@ -42,18 +52,27 @@ AVSValue FilterConstructor::InstantiateFilter() const
       else if (CtorArgs[i].GetType() == AvsValueType::VALUE_TYPE_DOUBLE) // double -> float
         funcArgs_temp[i] = CtorArgs[i].AsFloatf();
       else
-        funcArgs_temp[i] = CtorArgs[i];
+        funcArgs_temp[i] = SingleBufferFrames::WrapArgs(CtorArgs[i]);
     }
     funcArgs = AVSValue(funcArgs_temp.data(), (int)funcArgs_temp.size());
   }
+  else if (wrapFrames) {
+    funcArgs = SingleBufferFrames::WrapArgs(AVSValue(CtorArgs.data(), (int)CtorArgs.size()), &wrappers);
+  }
   else {
     funcArgs = AVSValue(CtorArgs.data(), (int)CtorArgs.size());
   }
 
-  AVSValue retval = Func->apply(funcArgs, Func->user_data, 
-    Func->isPluginAvs25 ? (IScriptEnvironment *)Env25 : 
-    Func->isPluginPreV11C ? (IScriptEnvironment*)EnvPreV11C : 
-    Env);
+  AVSValue retval;
+  {
+    SingleBufferFrames::ApplyScope scope(Func, wrapFrames ? &wrappers : nullptr);
+    retval = Func->apply(funcArgs, Func->user_data,
+      Func->isPluginAvs25 ? (IScriptEnvironment *)Env25 :
+      Func->isPluginPreV11C ? (IScriptEnvironment*)EnvPreV11C :
+      Env);
+  }
+  if (wrapFrames)
+    SingleBufferFrames::CheckResult(Func, retval, wrappers);
   // pass back proper ScriptEnvironment, because a 2.5 plugin e.g. GRunT can back-Invoke ScriptClip
   if (Func->isPluginAvs25)
   {
@@ -87,3 +106,77 @@ AVSValue FilterConstructor::InstantiateFilter() const
   }
   return retval;
 }
+
+
+PVideoFrame __stdcall SingleBufferFrames::GetFrame(int n, IScriptEnvironment* env)
+{
+  if (passthrough.load(std::memory_order_relaxed))
+    return child->GetFrame(n, env);
+  return GetAndRevealCamouflagedEnv(env)->GetSingleBufferFrame(child->GetFrame(n, env));
+}
+
+int __stdcall SingleBufferFrames::SetCacheHints(int cachehints, int frame_range)
+{
+  if (cachehints == CACHE_GET_MTMODE)
+    return MT_NICE_FILTER;
+  return child->SetCacheHints(cachehints, frame_range);
+}
+
+bool SingleBufferFrames::IsNeededFor(const Function* func)
+{
+  // core filters, script functions and functions added by clients are not wrapped
+  return func->dll_path != nullptr || func->isPluginAvs25 || func->isPluginPreV11C;
+}
+
+AVSValue SingleBufferFrames::WrapArgs(const AVSValue& args, std::vector<SingleBufferFrames*>* wrappers)
+{
+  if (args.IsClip() && args.AsClip()->GetVideoInfo().HasVideo()) {
+    SingleBufferFrames* wrapper = new SingleBufferFrames(args.AsClip());
+    if (wrappers)
+      wrappers->push_back(wrapper);
+    return wrapper;
+  }
+  if (!args.IsArray())
+    return args;
+  std::vector<AVSValue> elements(args.ArraySize());
+  for (int i = 0; i < args.ArraySize(); i++)
+    elements[i] = WrapArgs(args[i], wrappers);
+  return AVSValue(elements.data(), (int)elements.size());
+}
+
+void SingleBufferFrames::CheckResult(const Function* func, const AVSValue& result, const std::vector<SingleBufferFrames*>& wrappers)
+{
+  // The C interface has no v12 frame features, C plugins always get single buffer frames.
+  // GetVersion of a C++ filter is the interface version of the header it was built with.
+  if (func->isPluginAvs25 || func->isPluginPreV11C || func->apply == create_c_video_filter)
+    return;
+  if (!result.IsClip() || result.AsClip()->GetVersion() < 12)
+    return;
+  for (auto wrapper : wrappers)
+    wrapper->passthrough.store(true, std::memory_order_relaxed);
+}
+
+AVSValue SingleBufferFrames::WrapInvokeResult(const AVSValue& result, bool for_host)
+{
+  // Core and script functions know v12 frames, they are not wrapped for.
+  // Outside of any function it is the host (or a GetFrame) calling.
+  if (tls_apply.func == nullptr)
+    return for_host ? WrapArgs(result) : result;
+  if (!IsNeededFor(tls_apply.func))
+    return result;
+  return WrapArgs(result, tls_apply.wrappers);
+}
+
+SingleBufferFrames::ApplyScope::ApplyScope(const Function* func, std::vector<SingleBufferFrames*>* wrappers) :
+  prev_func(tls_apply.func),
+  prev_wrappers(tls_apply.wrappers)
+{
+  tls_apply.func = func;
+  tls_apply.wrappers = wrappers;
+}
+
+SingleBufferFrames::ApplyScope::~ApplyScope()
+{
+  tls_apply.func = prev_func;
+  tls_apply.wrappers = prev_wrappers;
+}
@@ -3,6 +3,7 @@
 
 #include "internal.h"
 #include <vector>
+#include <atomic>
 
 class FilterConstructor
 {
@@ -37,4 +38,42 @@ public:
   }
 };
 
+// AVS 2.5 plugins find the planes of a frame from its frame buffer ("baked code"), and
+// plugins built for an interface before v12 may not expect planes in different buffers
+// or negative pitch either. Frames with planes shared from other frames
+// (NewVideoFrameFromPlanes) or with negative pitch (FlipVertical) are copied into a
+// single buffer for them. The interface version of a C++ plugin is only known from its
+// filter, so the frames are passed through once that turned out to be a v12 one.
+// The same goes for clips a plugin function gets back from Invoke, and for clips handed
+// to hosts which created the environment with an interface version before v12.
+class SingleBufferFrames : public GenericVideoFilter
+{
+  std::atomic<bool> passthrough;
+
+public:
+  SingleBufferFrames(PClip _child) : GenericVideoFilter(_child), passthrough(false) {}
+  PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
+  int __stdcall SetCacheHints(int cachehints, int frame_range) override;
+
+  // plugin functions whose clip arguments are wrapped
+  static bool IsNeededFor(const Function* func);
+  // clips in the argument list, also inside arrays; the new wrappers are added to 'wrappers'
+  static AVSValue WrapArgs(const AVSValue& args, std::vector<SingleBufferFrames*>* wrappers = nullptr);
+  // lets the frames through if func made a v12 C++ filter out of the wrapped arguments
+  static void CheckResult(const Function* func, const AVSValue& result, const std::vector<SingleBufferFrames*>& wrappers);
+  // result of an Invoke through the interface; called by a plugin function it is wrapped
+  // and added to the wrappers of that function, else only if 'for_host' is set
+  static AVSValue WrapInvokeResult(const AVSValue& result, bool for_host);
+
+  // the function whose apply runs on this thread, Invoke results are wrapped for plugin functions
+  class ApplyScope
+  {
+    const Function* const prev_func;
+    std::vector<SingleBufferFrames*>* const prev_wrappers;
+  public:
+    ApplyScope(const Function* func, std::vector<SingleBufferFrames*>* wrappers);
+    ~ApplyScope();
+  };
+};
+
 #endif  // _AVS_FILTER_CONSTRUCTOR_H
@@ -2,6 +2,7 @@
 #include "FilterGraph.h"
 #include "DeviceManager.h"
 #include "InternalEnvironment.h"
+#include "Profiler.h"
 
 #ifdef AVS_WINDOWS
   #include <avs/win.h>
@@ -37,6 +38,8 @@ FilterGraphNode::FilterGraphNode(PClip child, const char* name,
   , child(child)
   , name(name)
   , memory(new GraphMemoryNode())
+  , profiler(nullptr)
+  , profile_id(-1)
 {
   if (last_.Defined()) {
     std::vector<AVSValue> argstmp;
@@ -60,6 +63,11 @@ FilterGraphNode::FilterGraphNode(PClip child, const char* name,
   }
 
   Env->ManageCache(MC_RegisterGraphNode, this);
+
+  profiler = GetAndRevealCamouflagedEnv(env)->GetProfiler();
+  if (profiler != nullptr) {
+    profile_id = profiler->RegisterNode(name);
+  }
 }
 
 FilterGraphNode::~FilterGraphNode()
@@ -84,6 +92,10 @@ PVideoFrame __stdcall FilterGraphNode::GetFrame(int n, IScriptEnvironment* env_)
   InternalEnvironment* env = GetAndRevealCamouflagedEnv(env_);
 
   ScopedGraphNode scope(env->GetCurrentGraphNode(), this);
+  if (profile_id >= 0) {
+    ProfilerScope profile(profiler, profile_id, n, env);
+    return child->GetFrame(n, env);
+  }
   return child->GetFrame(n, env);
 }
 
@@ -539,8 +551,22 @@ static AVSValue __cdecl SetGraphAnalysis(AVSValue args, void* user_data, IScript
   return AVSValue();
 }
 
+static AVSValue __cdecl SetProfiler(AVSValue args, void* user_data, IScriptEnvironment* env_) {
+  InternalEnvironment* env = GetAndRevealCamouflagedEnv(env_);
+  std::string path = GetFullPathNameWrap(args[0].AsString());
+  // fail now rather than after the whole encode
+  FILE* fp = fopen(path.c_str(), "a");
+  if (fp == nullptr) {
+    env->ThrowError("SetProfiler: cannot open file '%s' for writing", path.c_str());
+  }
+  fclose(fp);
+  env->SetProfiler(path.c_str());
+  return AVSValue();
+}
+
 extern const AVSFunction FilterGraph_filters[] = {
   { "SetGraphAnalysis", BUILTIN_FUNC_PREFIX, "b", SetGraphAnalysis, nullptr },
+  { "SetProfiler", BUILTIN_FUNC_PREFIX, "s", SetProfiler, nullptr },
   { "DumpFilterGraph", BUILTIN_FUNC_PREFIX, "c[outfile]s[mode]i[nframes]i[repeat]b", DumpFilterGraph, nullptr },
   { 0 }
 };
@@ -8,6 +8,7 @@
 #include <mutex>
 
 class FilterGraph;
+class Profiler;
 
 class Device;
 // no DeviceManager classic avs+
@@ -60,6 +61,9 @@ class FilterGraphNode : public IClip
 
   PGraphMemoryNode memory;
 
+  Profiler* profiler;
+  int profile_id; // -1 if not profiled
+
   friend FilterGraph;
 public:
   FilterGraphNode(PClip child, const char* name, const AVSValue& last,
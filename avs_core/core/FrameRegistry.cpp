@@ -0,0 +1,117 @@
+#include "FrameRegistry.h"
+#include <functional>
+#include <thread>
+#include <algorithm>
+#ifdef AVS_WINDOWS
+#include <avs/win.h>
+#else
+#include <avs/posix.h>
+#endif
+
+FrameBufferFreeList::FrameBufferFreeList() :
+  hits(0),
+  misses(0),
+  steals(0)
+{ }
+
+int FrameBufferFreeList::CurrentShard()
+{
+  return (int)(std::hash<std::thread::id>()(std::this_thread::get_id()) % NUM_SHARDS);
+}
+
+bool FrameBufferFreeList::Claim(VFBStorage* vfb)
+{
+  return InterlockedCompareExchange(&vfb->refcount, 1, 0) == 0;
+}
+
+void FrameBufferFreeList::Push(VFBStorage* vfb)
+{
+  const int shard = CurrentShard();
+  int expected = -1;
+  // already listed: the old entry is still good
+  if (!vfb->free_shard.compare_exchange_strong(expected, shard))
+    return;
+
+  Shard& s = shards[shard];
+  std::lock_guard<std::mutex> lock(s.mutex);
+  s.lists[vfb->GetDataSize()].push_back(vfb);
+}
+
+VFBStorage* FrameBufferFreeList::PopFromShard(int shard, size_t vfb_size)
+{
+  Shard& s = shards[shard];
+  std::lock_guard<std::mutex> lock(s.mutex);
+  auto it = s.lists.find(vfb_size);
+  if (it == s.lists.end())
+    return nullptr;
+
+  std::vector<VFBStorage*>& list = it->second;
+  while (!list.empty())
+  {
+    VFBStorage* vfb = list.back();
+    list.pop_back();
+    // Claim under the shard lock, before free_shard is reset: a deleter which
+    // claimed the buffer first still sees it listed, and waits in Remove for
+    // this lock, so the buffer cannot be deleted while we hold the pointer.
+    // It is not touched after free_shard is reset.
+    // A buffer still in use (pushed but not yet released, or revived by the
+    // registry scan) is dropped, it will be pushed again on its next release.
+    const bool claimed = Claim(vfb);
+    vfb->free_shard = -1;
+    if (claimed)
+      return vfb;
+  }
+  return nullptr;
+}
+
+VFBStorage* FrameBufferFreeList::Pop(size_t vfb_size)
+{
+  const int own = CurrentShard();
+  VFBStorage* vfb = PopFromShard(own, vfb_size);
+  if (vfb != nullptr) {
+    ++hits;
+    return vfb;
+  }
+
+  for (int i = 1; i < NUM_SHARDS; ++i)
+  {
+    vfb = PopFromShard((own + i) % NUM_SHARDS, vfb_size);
+    if (vfb != nullptr) {
+      ++hits;
+      ++steals;
+      return vfb;
+    }
+  }
+
+  ++misses;
+  return nullptr;
+}
+
+void FrameBufferFreeList::Remove(VFBStorage* vfb)
+{
+  // -1: not listed, or a popper is done with it (see PopFromShard)
+  const int shard = vfb->free_shard;
+  if (shard < 0)
+    return;
+
+  Shard& s = shards[shard];
+  std::lock_guard<std::mutex> lock(s.mutex);
+  auto it = s.lists.find(vfb->GetDataSize());
+  if (it != s.lists.end()) {
+    std::vector<VFBStorage*>& list = it->second;
+    list.erase(std::remove(list.begin(), list.end(), vfb), list.end());
+  }
+  vfb->free_shard = -1;
+}
+
+void FrameBufferFreeList::Clear()
+{
+  for (auto& s : shards)
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    for (auto& it : s.lists)
+      for (VFBStorage* vfb : it.second)
+        vfb->free_shard = -1;
+    s.lists.clear();
+  }
+}
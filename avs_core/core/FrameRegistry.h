@@ -0,0 +1,141 @@
+#ifndef _AVS_FRAMEREGISTRY_H
+#define _AVS_FRAMEREGISTRY_H
+
+#include <avisynth.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "FilterGraph.h"
+#include "Profiler.h"
+
+class Device;
+
+struct DebugTimestampedFrame
+{
+  VideoFrame* frame;
+
+#ifdef _DEBUG
+  std::chrono::time_point<std::chrono::high_resolution_clock> timestamp;
+#endif
+
+  DebugTimestampedFrame(VideoFrame* _frame)
+    : frame(_frame)
+#ifdef _DEBUG
+    , timestamp(std::chrono::high_resolution_clock::now())
+#endif
+  {}
+};
+
+typedef std::vector<DebugTimestampedFrame> VideoFrameArrayType;
+
+class VFBStorage : public VideoFrameBuffer {
+public:
+  int free_count;
+  int margin;
+  PGraphMemoryNode memory_node;
+
+  // Frame objects (the original one and Subframes) living on this buffer.
+  // Points into the ScriptEnvironment frame registry.
+  VideoFrameArrayType* frames;
+
+  // Index of the FrameBufferFreeList shard holding this buffer, -1 if none
+  std::atomic<int> free_shard;
+
+  VFBStorage()
+    : VideoFrameBuffer(),
+    free_count(0),
+    margin(0),
+    frames(nullptr),
+    free_shard(-1)
+  { }
+
+  VFBStorage(int size, int margin, Device* device)
+    : VideoFrameBuffer(size, margin, device),
+    free_count(0),
+    margin(margin),
+    frames(nullptr),
+    free_shard(-1)
+  { }
+
+  void Attach(FilterGraphNode* node) {
+    if (memory_node) {
+      memory_node->OnFree(data_size, device);
+      memory_node = nullptr;
+    }
+    if (node != nullptr) {
+      memory_node = node->GetMemoryNode();
+      memory_node->OnAllocate(data_size, device);
+      Profiler::OnFrameAllocate(data_size);
+    }
+  }
+
+  ~VFBStorage() {
+    if (memory_node) {
+      memory_node->OnFree(data_size, device);
+      memory_node = nullptr;
+    }
+#ifdef _DEBUG
+    if (data && device->device_type == DEV_TYPE_CPU) {
+      // check buffer overrun
+      int *pInt = (int *)(data + margin + data_size);
+      if (pInt[0] != 0xDEADBEEF ||
+        pInt[1] != 0xDEADBEEF ||
+        pInt[2] != 0xDEADBEEF ||
+        pInt[3] != 0xDEADBEEF)
+      {
+        printf("Buffer overrun!!!\n");
+      }
+    }
+#endif
+  }
+};
+
+// Free frame buffers of one device, sharded by the releasing thread.
+//
+// A buffer is put here by VideoFrame::Release just before the last frame
+// referencing it goes away, so GetNewFrame can pick up a buffer of the same
+// size without taking the memory mutex and scanning the whole registry.
+// Buffers freed by other ways (e.g. by baked code of Avisynth 2.5 plugins) are
+// not listed, they are still found by the registry scan.
+//
+// An entry is only a hint: a buffer is owned by whoever moves its refcount
+// from 0 to 1 (see Claim). Buffers may only be deleted after they were claimed
+// and removed from the list.
+class FrameBufferFreeList
+{
+public:
+  enum { NUM_SHARDS = 16 };
+
+  FrameBufferFreeList();
+
+  // vfb is still referenced exactly once by the caller
+  void Push(VFBStorage* vfb);
+  // Returns a claimed buffer of exactly vfb_size bytes or nullptr.
+  VFBStorage* Pop(size_t vfb_size);
+  // Forget a buffer which is going to be deleted. It must be claimed already.
+  void Remove(VFBStorage* vfb);
+  void Clear();
+
+  // Sets the refcount of a free buffer to 1. False if it was not free.
+  static bool Claim(VFBStorage* vfb);
+
+  // Counters are reset only at environment creation
+  std::atomic<uint64_t> hits;   // GetNewFrame served from the free list
+  std::atomic<uint64_t> misses; // fell back to the registry scan
+  std::atomic<uint64_t> steals; // served from another thread's shard
+
+private:
+  struct alignas(64) Shard
+  {
+    std::mutex mutex;
+    std::unordered_map<size_t, std::vector<VFBStorage*>> lists;
+  };
+  Shard shards[NUM_SHARDS];
+
+  static int CurrentShard();
+  VFBStorage* PopFromShard(int shard, size_t vfb_size);
+};
+
+#endif  // _AVS_FRAMEREGISTRY_H
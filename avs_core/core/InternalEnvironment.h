@@ -63,8 +63,10 @@ public:
 
 class Device;
 class ThreadPool;
+enum ThreadPoolScheduler : int;
 class ConcurrentVarStringFrame;
 class FilterGraphNode;
+class Profiler;
 
 class ScopedCounter {
 	int& counter;
@@ -202,6 +204,9 @@ public:
   virtual int __stdcall propGetDataTypeHint(const AVSMap* map, const char* key, int index, int* error) = 0; /* returns AVSPropDataTypeHint */
   virtual int __stdcall propSetDataH(AVSMap* map, const char* key, const char* d, int length, int type, int append) = 0;
 
+  // V12
+  virtual PVideoFrame __stdcall NewVideoFrameFromPlanes(const VideoInfo& vi, const PVideoFrame* src_frames, const int* src_planes, const PVideoFrame* prop_src) = 0;
+
   // IScriptEnvironment2
   virtual bool __stdcall LoadPlugin(const char* filePath, bool throwOnError, AVSValue *result) = 0;
   virtual void __stdcall AddAutoloadDir(const char* dirPath, bool toFront) = 0;
@@ -284,6 +289,8 @@ public:
   virtual IScriptEnvironment_AvsPreV11C* __stdcall GetEnvPreV11C() final { return static_cast<IScriptEnvironment_AvsPreV11C*>(this); }
 
   virtual void __stdcall SetGraphAnalysis(bool enable) = 0;
+  virtual void __stdcall SetProfiler(const char* path) = 0;
+  virtual Profiler* __stdcall GetProfiler() = 0;
 
   virtual Device* __stdcall SetCurrentDevice(Device* device) = 0;
   virtual Device* __stdcall GetCurrentDevice() const = 0;
@@ -291,6 +298,10 @@ public:
   virtual PVideoFrame __stdcall NewVideoFrameOnDevice(const VideoInfo& vi, int align, Device* device) = 0;
   virtual PVideoFrame __stdcall NewVideoFrameOnDevice(const VideoInfo& vi, int align, Device* device, const PVideoFrame *prop_src) = 0;
   virtual PVideoFrame __stdcall GetOnDeviceFrame(const PVideoFrame& src, Device* device) = 0;
+  // copy of a frame with shared planes, having all planes in its own buffer
+  virtual PVideoFrame __stdcall GetSingleBufferFrame(const PVideoFrame& src) = 0;
+  // drops the filters kept from runtime Invokes on all threads, called when a runtime script goes away
+  virtual void __stdcall ClearRuntimeInvokeMemos() = 0;
 
   using INeoEnv::SetMemoryMax;
   using INeoEnv::Invoke;
@@ -300,7 +311,7 @@ public:
   // Nekopanda: support multiple prefetcher //
   // to allow thread to submit with their env
   virtual void __stdcall ParallelJob(ThreadWorkerFuncPtr jobFunc, void* jobData, IJobCompletion* completion, InternalEnvironment *env) = 0;
-  virtual ThreadPool* __stdcall NewThreadPool(size_t nThreads) = 0;
+  virtual ThreadPool* __stdcall NewThreadPool(size_t nThreads, ThreadPoolScheduler scheduler) = 0;
   virtual void __stdcall AddRef() = 0;
   virtual void __stdcall Release() = 0;
 
@@ -50,6 +50,8 @@ private:
     V value;
     size_t locks;      // the number of threads waiting on this entry. used to prevent eviction when readers are waiting on it
     size_t ghosted;    // the number of times this entry has entered the ghost list
+    double cost;       // production time of value in seconds per MB
+    double priority;   // GreedyDual-Size priority, entries with the lowest one are evicted first
     std::condition_variable ready_cond;
     enum LruEntryState state;
 
@@ -64,6 +66,8 @@ private:
       value = v;
       locks = 0;
       ghosted = 0;
+      cost = 0;
+      priority = 0;
       state = LRU_ENTRY_EMPTY;
     }
 
@@ -86,12 +90,29 @@ private:
   ObjectPool<entry_type> EntryPool;
   mutable std::mutex mutex;
 
+  // GreedyDual-Size: an entry gets priority = inflation + cost when it is
+  // stored or hit, and inflation is raised to the priority of each evicted
+  // entry. Cheap frames age out first, expensive ones survive a few more
+  // rounds, and when all costs are zero this is plain LRU.
+  double inflation;
+
+  // running averages of committed values, for ranking whole caches
+  double avg_seconds;
+  double avg_bytes;
+
+  static double MainPriorityEvent(const typename CacheType::Entry& entry, void* userData)
+  {
+    return entry.value->priority;
+  }
+
   static bool MainEvictEvent(CacheType* cache, const typename CacheType::Entry& entry, void* userData)
   {
     if (entry.value->locks > 0)
       return false;
 
     LruCache* me = reinterpret_cast<LruCache*>(userData);
+    if (me->inflation < entry.value->priority)
+      me->inflation = entry.value->priority;
 
     bool ghost_found;
     auto *g = me->Ghosts.lookup(entry.key, &ghost_found);
@@ -117,8 +138,12 @@ public:
     GHOSTS_MIN_CAPACITY(50),
     mode(mode),
     MainCache(capacity, &MainEvictEvent, reinterpret_cast<void*>(this)),
-    Ghosts(GHOSTS_MIN_CAPACITY, typename GhostCacheType::EvictEventType(), reinterpret_cast<void*>(this))
+    Ghosts(GHOSTS_MIN_CAPACITY, typename GhostCacheType::EvictEventType(), reinterpret_cast<void*>(this)),
+    inflation(0),
+    avg_seconds(0),
+    avg_bytes(0)
   {
+    MainCache.set_priority(&MainPriorityEvent);
   }
 
   size_type size() const
@@ -150,6 +175,15 @@ public:
     MainCache.set_limits(min, max);
   }
 
+  // Average production time (seconds) and size (bytes) of the committed values
+  void cost_stats(double* seconds, double* bytes) const
+  {
+    std::unique_lock<std::mutex> global_lock(mutex);
+
+    *seconds = avg_seconds;
+    *bytes = avg_bytes;
+  }
+
   LruLookupResult lookup(const K& key, handle *hndl, bool block_for_completion, V& foundItem, bool* suppressCaching = nullptr)
   {
     bool suppress = (suppressCaching != nullptr) && *suppressCaching;
@@ -191,11 +225,24 @@ public:
       }
       // copy and return entry->value before releasing lock
       foundItem = entry->value;
+      entry->priority = inflation + entry->cost;
       --(entry->locks);
       return LRU_LOOKUP_FOUND_AND_READY;
     }
     else if (suppress == false)
     {
+      // The new slot is already in MainCache. Fill and lock it before the
+      // resize below, whose trim must not see a stale entry pointer there.
+      entry_ptr entry = NULL;
+      if (entryp != NULL)
+      {
+        entry = EntryPool.Construct(key);
+        entry->locks = 1;
+        entry->priority = inflation;
+        entry->value = NULL;
+        *entryp = entry;
+      }
+
       // ghost: self-tuning caching algorithm
       bool ghost_found;
       auto *g = Ghosts.lookup(key, &ghost_found);
@@ -246,14 +293,10 @@ public:
         //assert(0); LOL maybe it can...
       }
 
-      if (entryp != NULL)
+      if (entry != NULL)
       {
-        *entryp = EntryPool.Construct(key);
-        entry_ptr entry = *entryp;
         *hndl = handle(entry, this->shared_from_this());
-        entry->locks = 1;
         entry->ghosted = g->ghosted;
-        entry->value = NULL;
         return LRU_LOOKUP_NOT_FOUND;
       }
       else
@@ -269,17 +312,37 @@ public:
   }
 
   void commit_value(handle *hndl)
+  {
+    commit_value(hndl, 0, 0);
+  }
+
+  // seconds: time it took to produce the value, bytes: its size
+  void commit_value(handle *hndl, double seconds, size_t bytes)
   {
     std::unique_lock<std::mutex> global_lock(mutex);
 
     // mark data as ready
     entry_ptr e = hndl->first;
     e->state = LRU_ENTRY_AVAILABLE;
+    if (bytes != 0)
+    {
+      e->cost = seconds * (1024.0 * 1024.0) / bytes;
+      if (avg_bytes == 0) {
+        avg_seconds = seconds;
+        avg_bytes = (double)bytes;
+      }
+      else {
+        avg_seconds += (seconds - avg_seconds) * 0.125;
+        avg_bytes += ((double)bytes - avg_bytes) * 0.125;
+      }
+    }
+    e->priority = inflation + e->cost;
     --(e->locks);
 
-    // notify waiters
-    global_lock.unlock();
+    // notify waiters. Still under the lock: once it is released, the entry
+    // may be evicted and its condition variable destroyed by another thread.
     e->ready_cond.notify_all();
+    global_lock.unlock();
 
     hndl->second.reset();
   }
@@ -302,8 +365,8 @@ public:
       e->state = LRU_ENTRY_ROLLED_BACK;
 
       // notify one waiter
-      global_lock.unlock();
       e->ready_cond.notify_one();
+      global_lock.unlock();
     }
 
     hndl->second.reset();
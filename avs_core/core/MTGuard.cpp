@@ -300,7 +300,6 @@ bool __stdcall MTGuard::GetParity(int n)
 
 int __stdcall MTGuard::SetCacheHints(int cachehints, int frame_range)
 {
-  AVS_UNUSED(frame_range);
   if (CACHE_GET_MTMODE == cachehints) {
     return MT_NICE_FILTER;
   }
@@ -315,6 +314,10 @@ int __stdcall MTGuard::SetCacheHints(int cachehints, int frame_range)
   if (CACHE_GET_DEV_TYPE == cachehints || CACHE_GET_CHILD_DEV_TYPE == cachehints) {
     return (ChildFilters[0].filter->GetVersion() >= 5) ? ChildFilters[0].filter->SetCacheHints(cachehints, 0) : 0;
   }
+  // frame dependencies are the same for every instance
+  if (CACHE_GET_FRAME_DEPENDENCIES == cachehints) {
+    return (ChildFilters[0].filter->GetVersion() >= 5) ? ChildFilters[0].filter->SetCacheHints(cachehints, frame_range) : 0;
+  }
 
   return 0;
 }
@@ -1,6 +1,9 @@
 #include "PluginManager.h"
 #include <avisynth.h>
 #include <unordered_set>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
 #include <avisynth_c.h>
 #include "strings.h"
 #include "InternalEnvironment.h"
@@ -19,6 +22,7 @@
 #endif
 #include "parser/script.h"
 #include "parser/expression.h" // TODO we only need FunctionInstance from here
+#include "parser/tokenizer.h"
 
 typedef const char* (__stdcall *AvisynthPluginInit3Func)(IScriptEnvironment* env, const AVS_Linkage* const vectors);
 typedef const char* (__stdcall *AvisynthPluginInit2Func)(IScriptEnvironment_Avs25* env);
@@ -489,6 +493,15 @@ bool AVSFunction::ArgNameMatch(const char* param_types, size_t args_names_count,
 */
 
 
+// A function as registered by a plugin, as much as needed to register it again
+struct PluginFunction
+{
+  std::string Name;
+  std::string Params;
+  bool isAvs25;
+  bool isPreV11C;
+};
+
 struct PluginFile
 {
   std::string FilePath;             // Fully qualified, canonical file path
@@ -497,13 +510,17 @@ struct PluginFile
   bool isPluginAvs25;
   bool isPluginPreV11C;
   bool isPluginC; // we register it, but it won't be used
+  bool isLazy;    // functions registered from the manifest, Library is not loaded yet
+  bool isManifestSafe; // Functions below tell everything the plugin registered
+  std::vector<PluginFunction> Functions; // registered during autoload, for the manifest
 
   PluginFile(const std::string &filePath);
 };
 
 PluginFile::PluginFile(const std::string &filePath) :
   FilePath(GetFullPathNameWrap(filePath)), BaseName(), Library(NULL),
-  isPluginAvs25(false), isPluginPreV11C(false), isPluginC(false)
+  isPluginAvs25(false), isPluginPreV11C(false), isPluginC(false),
+  isLazy(false), isManifestSafe(true)
 {
   // Turn all '\' into '/'
   replace(FilePath, '\\', '/');
@@ -536,6 +553,251 @@ PluginFile::PluginFile(const std::string &filePath) :
   }
 }
 
+/*
+---------------------------------------------------------------------------------
+---------------------------------------------------------------------------------
+                                 PluginManifest
+---------------------------------------------------------------------------------
+---------------------------------------------------------------------------------
+*/
+
+// Autoloading has to load every binary plugin and run its init function, only to
+// learn the names of the functions it has. The manifest remembers them for each
+// plugin, together with the modification time and size of the file, so unchanged
+// plugins are registered from the manifest and their binary is only loaded when
+// one of their functions is used for the first time.
+// Same for .avsi scripts which contain nothing but function definitions: they are
+// known by the hash of their content, and parsed when one of their functions is used.
+//
+// Text file, one record per line, fields separated by tabs:
+//   AVSPLUGINMANIFEST <format> <AviSynth version> <CPU flags>
+//   plugin <mtime> <size> <1: plugin, 0: not a plugin> <path>
+//   script <content hash> <size> <1: definitions only, 0: import at autoload> <path>
+//   function <isAvs25> <isPreV11C> <name> <parameter string>
+// A manifest with a different header (other AviSynth build or CPU) is ignored.
+
+static const char PluginManifestFormat[] = "AVSPLUGINMANIFEST\t1";
+
+struct PluginManifestEntry
+{
+  bool isScript;
+  long long stamp; // plugin: modification time, script: content hash
+  unsigned long long size;
+  bool lazy;       // functions are registered from the manifest
+  std::vector<PluginFunction> Functions;
+};
+
+typedef std::map<std::string, PluginManifestEntry> PluginManifest;
+
+// AVS_PLUGIN_MANIFEST overrides the location, set it to an empty string to disable the manifest
+static std::string GetPluginManifestPath()
+{
+  const char* path = std::getenv("AVS_PLUGIN_MANIFEST");
+  if (path != NULL)
+    return path;
+#ifdef AVS_WINDOWS
+  const char* dir = std::getenv("LOCALAPPDATA");
+  if (dir == NULL || *dir == 0)
+    return std::string();
+  return concat(dir, "/AviSynth+/plugins.manifest");
+#else
+  const char* dir = std::getenv("XDG_CACHE_HOME");
+  if (dir != NULL && *dir != 0)
+    return concat(dir, "/avisynth/plugins.manifest");
+  dir = std::getenv("HOME");
+  if (dir == NULL || *dir == 0)
+    return std::string();
+  return concat(dir, "/.cache/avisynth/plugins.manifest");
+#endif
+}
+
+static std::string GetPluginManifestHeader(int cpuFlags)
+{
+  std::ostringstream header;
+  header << PluginManifestFormat << '\t' << AVS_FULLVERSION << '\t' << cpuFlags;
+  return header.str();
+}
+
+static void SplitManifestLine(const std::string& line, std::vector<std::string>& fields, size_t maxFields)
+{
+  // the last field takes the rest of the line
+  fields.clear();
+  size_t pos = 0;
+  while (fields.size() + 1 < maxFields) {
+    size_t tab = line.find('\t', pos);
+    if (tab == std::string::npos)
+      break;
+    fields.push_back(line.substr(pos, tab - pos));
+    pos = tab + 1;
+  }
+  fields.push_back(line.substr(pos));
+}
+
+static bool ReadPluginManifest(const std::string& path, const std::string& header, PluginManifest& manifest)
+{
+  std::ifstream file(fs::path(path), std::ios::binary);
+  if (!file)
+    return false;
+
+  std::string line;
+  if (!std::getline(file, line) || line != header)
+    return false;
+
+  std::vector<std::string> fields;
+  PluginManifestEntry* entry = NULL;
+  try {
+    while (std::getline(file, line)) {
+      if (line.compare(0, 7, "plugin\t") == 0 || line.compare(0, 7, "script\t") == 0) {
+        SplitManifestLine(line, fields, 5);
+        if (fields.size() != 5 || fields[4].empty())
+          throw std::invalid_argument("plugin");
+        entry = &manifest[fields[4]];
+        entry->isScript = fields[0] == "script";
+        entry->stamp = std::stoll(fields[1]);
+        entry->size = std::stoull(fields[2]);
+        entry->lazy = fields[3] == "1";
+        entry->Functions.clear();
+      }
+      else if (line.compare(0, 9, "function\t") == 0) {
+        SplitManifestLine(line, fields, 5);
+        if (fields.size() != 5 || entry == NULL || fields[3].empty() || !IsValidParameterString(fields[4].c_str()))
+          throw std::invalid_argument("function");
+        entry->Functions.push_back(PluginFunction{ fields[3], fields[4], fields[1] == "1", fields[2] == "1" });
+      }
+      else if (!line.empty())
+        throw std::invalid_argument("record");
+    }
+  }
+  catch (const std::exception&) {
+    // damaged, start over
+    manifest.clear();
+    return false;
+  }
+  return true;
+}
+
+static bool IsManifestField(const std::string& s)
+{
+  return s.find_first_of("\t\r\n") == std::string::npos;
+}
+
+static void WritePluginManifest(const std::string& path, const std::string& header, const PluginManifest& manifest)
+{
+  std::error_code ec;
+  fs::path target(path);
+  if (target.has_parent_path())
+    fs::create_directories(target.parent_path(), ec);
+
+  // Other processes may read or write it meanwhile: write a new file and move it in place
+#ifdef AVS_WINDOWS
+  const std::string temp = path + ".tmp" + std::to_string(GetCurrentProcessId());
+#else
+  const std::string temp = path + ".tmp" + std::to_string(getpid());
+#endif
+  {
+    std::ofstream file(fs::path(temp), std::ios::binary | std::ios::trunc);
+    if (!file)
+      return;
+    file << header << '\n';
+    for (const auto& it : manifest) {
+      const PluginManifestEntry& entry = it.second;
+      // forget plugins which are gone
+      if (!fs::exists(fs::path(it.first), ec))
+        continue;
+      file << (entry.isScript ? "script\t" : "plugin\t") << entry.stamp << '\t' << entry.size << '\t' << (entry.lazy ? 1 : 0) << '\t' << it.first << '\n';
+      for (const PluginFunction& func : entry.Functions)
+        file << "function\t" << (func.isAvs25 ? 1 : 0) << '\t' << (func.isPreV11C ? 1 : 0) << '\t' << func.Name << '\t' << func.Params << '\n';
+    }
+    if (!file.flush()) {
+      file.close();
+      fs::remove(fs::path(temp), ec);
+      return;
+    }
+  }
+  fs::rename(fs::path(temp), target, ec);
+  if (ec)
+    fs::remove(fs::path(temp), ec);
+}
+
+static bool ReadScriptFile(const std::string& path, std::string& code)
+{
+  std::ifstream file(fs::path(path), std::ios::binary);
+  if (!file)
+    return false;
+  std::ostringstream content;
+  content << file.rdbuf();
+  code = content.str();
+  return !file.bad();
+}
+
+// 64 bit FNV-1a
+static long long HashScript(const std::string& code)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : code) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return (long long)hash;
+}
+
+// True if the script has only legacy function definitions ("function name(...) {...}")
+// on its top level. Importing it does nothing else than adding the functions, so it
+// can be postponed until one of them is used.
+static bool IsDefinitionsOnlyScript(const std::string& code, IScriptEnvironment* env)
+{
+  try {
+    Tokenizer tokenizer(code.c_str(), env);
+    for (;;) {
+      while (tokenizer.IsNewline())
+        tokenizer.NextToken();
+      if (tokenizer.IsEOF())
+        return true;
+
+      // function name(...) {
+      if (!tokenizer.IsIdentifier("function"))
+        return false;
+      tokenizer.NextToken();
+      if (!tokenizer.IsIdentifier())
+        return false;
+      while (!tokenizer.IsOperator('{')) {
+        if (tokenizer.IsEOF())
+          return false;
+        tokenizer.NextToken();
+      }
+
+      // body
+      int depth = 0;
+      do {
+        if (tokenizer.IsOperator('{'))
+          depth++;
+        else if (tokenizer.IsOperator('}'))
+          depth--;
+        else if (tokenizer.IsEOF())
+          return false;
+        tokenizer.NextToken();
+      } while (depth > 0);
+
+      if (!tokenizer.IsNewline() && !tokenizer.IsEOF())
+        return false;
+    }
+  }
+  catch (const AvisynthError&) {
+    return false;
+  }
+}
+
+// Placeholder of a function of a plugin or script which is not loaded yet. Lookups
+// replace it by the real function (see LoadLazyPlugin), it is never called.
+// user_data is NULL for plugin functions and the saved path for script functions.
+static AVSValue __cdecl LazyPluginStub(AVSValue args, void* user_data, IScriptEnvironment* env)
+{
+  AVS_UNUSED(args);
+  AVS_UNUSED(user_data);
+  env->ThrowError("Plugin function called before its plugin was loaded (internal error)");
+  return AVSValue();
+}
+
 /*
 ---------------------------------------------------------------------------------
 ---------------------------------------------------------------------------------
@@ -544,8 +806,11 @@ PluginFile::PluginFile(const std::string &filePath) :
 ---------------------------------------------------------------------------------
 */
 
+static std::atomic<uint64_t> plugin_manager_instances(0);
+
 PluginManager::PluginManager(InternalEnvironment* env) :
-  Env(env), PluginInLoad(NULL), AutoloadExecuted(false), Autoloading(false)
+  Env(env), PluginInLoad(NULL), ImportInLoad(NULL), PluginInitsRunning(0), UpdatingExports(false), AutoloadExecuted(false), Autoloading(false), ExportsDeferred(false),
+  InstanceId(++plugin_manager_instances), Generation(1), TableGeneration(0)
 {
   env->SetGlobalVar("$PluginFunctions$", AVSValue(""));
 }
@@ -560,6 +825,7 @@ void PluginManager::ClearAutoloadDirs()
 
 void PluginManager::AddAutoloadDir(const std::string &dirPath, bool toFront)
 {
+  PluginInitSideEffect();
   if (AutoloadExecuted)
     Env->ThrowError("Cannot modify directory list after the autoload procedure has already executed.");
 
@@ -662,6 +928,13 @@ void PluginManager::AutoloadPlugins()
   AutoloadExecuted = true;
   Autoloading = true;
 
+  const std::string manifestPath = GetPluginManifestPath();
+  const std::string manifestHeader = GetPluginManifestHeader(Env->GetCPUFlags());
+  PluginManifest manifest;
+  bool manifestChanged = false;
+  if (!manifestPath.empty())
+    manifestChanged = !ReadPluginManifest(manifestPath, manifestHeader, manifest);
+
   // Load binary plugins
   for (const std::string& dir : AutoloadDirs)
   {
@@ -676,44 +949,97 @@ void PluginManager::AutoloadPlugins()
 #else
     const char* binaryFilter = ".dll";
 #endif
-    for (auto& file : fs::directory_iterator(dir, fs::directory_options::skip_permission_denied | fs::directory_options::follow_directory_symlink, ec))
-    {
-      const bool extensionsMatch =
+    ExportsDeferred = true;
+    try {
+      for (auto& file : fs::directory_iterator(dir, fs::directory_options::skip_permission_denied | fs::directory_options::follow_directory_symlink, ec))
+      {
+        const bool extensionsMatch =
 #ifdef AVS_POSIX
-      file.path().extension() == binaryFilter; // case sensitive
+          file.path().extension() == binaryFilter; // case sensitive
 #else
-      streqi(file.path().extension().generic_string().c_str(), binaryFilter);  // case insensitive
+          streqi(file.path().extension().generic_string().c_str(), binaryFilter);  // case insensitive
 #endif
 
-      if (extensionsMatch)
-      {
-        PluginFile p(concat(dir, file.path().filename().generic_string()));
-
-        // Search for loaded plugins with the same base name.
-        bool same_found = false;
-        for (size_t i = 0; i < AutoLoadedPlugins.size(); ++i)
+        if (extensionsMatch)
         {
+          PluginFile p(concat(dir, file.path().filename().generic_string()));
+
+          // Search for loaded plugins with the same base name.
+          bool same_found = false;
+          for (const std::vector<PluginFile>* list : { &AutoLoadedPlugins, &LazyPlugins })
+          {
+            for (size_t i = 0; i < list->size(); ++i)
+            {
 #ifdef AVS_POSIX
-          if (AutoLoadedPlugins[i].BaseName == p.BaseName) // case insentitive
+              if ((*list)[i].BaseName == p.BaseName) // case insentitive
 #else
-          if (streqi(AutoLoadedPlugins[i].BaseName.c_str(), p.BaseName.c_str()))
+              if (streqi((*list)[i].BaseName.c_str(), p.BaseName.c_str()))
 #endif
+              {
+                // Prevent loading a plugin with a basename that is
+                // already loaded (from another autoload folder).
+                same_found = true;
+                break;
+              }
+            }
+          }
+
+          if (same_found)
+            continue;
+
+          std::error_code ec_stat;
+          const long long mtime = (long long)file.last_write_time(ec_stat).time_since_epoch().count();
+          const unsigned long long size = ec_stat ? 0 : (unsigned long long)file.file_size(ec_stat);
+          const bool cacheable = !manifestPath.empty() && !ec_stat && IsManifestField(p.FilePath);
+
+          if (cacheable)
           {
-            // Prevent loading a plugin with a basename that is
-            // already loaded (from another autoload folder).
-            same_found = true;
-            break;
+            // Unchanged since it was recorded: register its functions, load it on first use
+            auto entry = manifest.find(p.FilePath);
+            if (entry != manifest.end() && !entry->second.isScript && entry->second.stamp == mtime && entry->second.size == size)
+            {
+              if (entry->second.lazy)
+              {
+                LazyPlugins.push_back(p);
+                PluginFile& lazy = LazyPlugins.back();
+                lazy.isLazy = true;
+                PluginInLoad = &lazy;
+                try {
+                  for (const PluginFunction& func : entry->second.Functions)
+                    AddFunction(func.Name.c_str(), func.Params.c_str(), LazyPluginStub, NULL, NULL, func.isAvs25, func.isPreV11C);
+                }
+                catch (...) {
+                  PluginInLoad = NULL;
+                  throw;
+                }
+                PluginInLoad = NULL;
+              }
+              continue;
+            }
           }
-        }
 
-        if (same_found)
-          continue;
+          // Try to load plugin
+          AVSValue dummy;
+          const bool loaded = LoadPlugin(p, false, &dummy);
 
-        // Try to load plugin
-        AVSValue dummy;
-        LoadPlugin(p, false, &dummy);
+          if (cacheable && p.isManifestSafe)
+          {
+            PluginManifestEntry& entry = manifest[p.FilePath];
+            entry.isScript = false;
+            entry.stamp = mtime;
+            entry.size = size;
+            entry.lazy = loaded;
+            entry.Functions = p.Functions;
+            manifestChanged = true;
+          }
+        }
       }
     }
+    catch (...) {
+      FlushFunctionExports();
+      throw;
+    }
+    FlushFunctionExports();
 
     const char* scriptFilter = ".avsi";
     for (auto& file : fs::directory_iterator(dir, fs::directory_options::skip_permission_denied | fs::directory_options::follow_directory_symlink, ec)) // and not recursive_directory_iterator
@@ -751,14 +1077,193 @@ void PluginManager::AutoloadPlugins()
         if (same_found)
           continue;
 
+        std::string code;
+        const bool cacheable = !manifestPath.empty() && IsManifestField(p.FilePath) && ReadScriptFile(p.FilePath, code);
+        const long long hash = cacheable ? HashScript(code) : 0;
+        bool record = false;
+        bool definitionsOnly = false;
+
+        if (cacheable)
+        {
+          auto entry = manifest.find(p.FilePath);
+          if (entry != manifest.end() && entry->second.isScript && entry->second.stamp == hash && entry->second.size == code.size())
+          {
+            // Unchanged and has only function definitions: register them, import it on first use
+            if (entry->second.lazy)
+            {
+              const char* savedPath = Env->SaveString(p.FilePath.c_str());
+              ExportsDeferred = true;
+              for (const PluginFunction& func : entry->second.Functions)
+                AddFunction(func.Name.c_str(), func.Params.c_str(), LazyPluginStub, (void*)savedPath, "$UserFunctions$", false, false);
+              LazyImports.push_back(p);
+              AutoLoadedImports.push_back(p);
+              continue;
+            }
+          }
+          else
+          {
+            record = true;
+            definitionsOnly = IsDefinitionsOnlyScript(code, Env);
+          }
+        }
+
         // Try to load script
-        Env->Invoke("Import", p.FilePath.c_str()); // FIXME: utf8?
+        FlushFunctionExports();
+        ImportInLoad = &p;
+        try {
+          Env->Invoke("Import", p.FilePath.c_str()); // FIXME: utf8?
+        }
+        catch (...) {
+          ImportInLoad = NULL;
+          throw;
+        }
+        ImportInLoad = NULL;
         AutoLoadedImports.push_back(p);
+
+        if (record && p.isManifestSafe)
+        {
+          PluginManifestEntry& entry = manifest[p.FilePath];
+          entry.isScript = true;
+          entry.stamp = hash;
+          entry.size = code.size();
+          entry.lazy = definitionsOnly;
+          entry.Functions.clear();
+          if (definitionsOnly)
+            entry.Functions = p.Functions;
+          manifestChanged = true;
+        }
       }
     }
+    FlushFunctionExports();
   }
 
   Autoloading = false;
+
+  if (manifestChanged)
+    WritePluginManifest(manifestPath, manifestHeader, manifest);
+}
+
+bool PluginManager::IsLazyFunction(const AVSFunction* func) const
+{
+  return func->apply == &LazyPluginStub;
+}
+
+void PluginManager::LoadLazyPlugin(const AVSFunction* func)
+{
+  if (func->user_data != NULL)
+  {
+    LoadLazyScript((const char*)func->user_data);
+    return;
+  }
+
+  auto it = LazyPlugins.begin();
+  while (it != LazyPlugins.end() && !streqi(it->FilePath.c_str(), func->dll_path))
+    ++it;
+  if (it == LazyPlugins.end())
+    return; // already loaded by another thread
+
+  PluginFile plugin = *it;
+  LazyPlugins.erase(it);
+
+  // Load it as autoloading would have done. Its functions take the places of
+  // the stubs, stubs of functions which it does not register anymore are removed.
+  const bool wasAutoloading = Autoloading;
+  Autoloading = true;
+  try {
+    AVSValue dummy;
+    LoadPlugin(plugin, true, &dummy);
+  }
+  catch (...) {
+    Autoloading = wasAutoloading;
+    RetireLazyStubs(plugin.FilePath);
+    throw;
+  }
+  Autoloading = wasAutoloading;
+  RetireLazyStubs(plugin.FilePath);
+}
+
+void PluginManager::LoadLazyScript(const char* filePath)
+{
+  auto it = LazyImports.begin();
+  while (it != LazyImports.end() && !streqi(it->FilePath.c_str(), filePath))
+    ++it;
+  if (it == LazyImports.end())
+    return; // already imported by another thread
+
+  PluginFile script = *it;
+  LazyImports.erase(it);
+  script.isLazy = true;
+
+  // The script has only function definitions, parsing it registers them. No Import: this
+  // may run for a runtime script on a Prefetch thread, while Import would change the
+  // process-wide working directory and the $ScriptName$ & co. globals under other threads.
+  // Neither matters for function definitions, the bodies run later in the caller's context.
+  const bool wasAutoloading = Autoloading;
+  PluginFile* prevImportInLoad = ImportInLoad;
+  Autoloading = true;
+  ImportInLoad = &script;
+  try {
+    std::string code;
+    if (!ReadScriptFile(script.FilePath, code))
+      Env->ThrowError("Import: couldn't open \"%s\"", script.FilePath.c_str());
+    AVSValue eval_args[] = { code.c_str(), script.FilePath.c_str() };
+    Env->Invoke("Eval", AVSValue(eval_args, 2));
+  }
+  catch (...) {
+    Autoloading = wasAutoloading;
+    ImportInLoad = prevImportInLoad;
+    RetireLazyStubs(script.FilePath);
+    throw;
+  }
+  Autoloading = wasAutoloading;
+  ImportInLoad = prevImportInLoad;
+  RetireLazyStubs(script.FilePath);
+}
+
+// Stubs of plugin functions have the plugin path in dll_path, stubs of script functions the script path in user_data
+static bool IsLazyStubOf(const AVSFunction* func, const std::string& filePath)
+{
+  if (func->apply != &LazyPluginStub)
+    return false;
+  const char* path = func->user_data != NULL ? (const char*)func->user_data : func->dll_path;
+  return streqi(path, filePath.c_str());
+}
+
+bool PluginManager::ReplaceLazyStub(FunctionList& list, const AVSFunction* func, const std::string& filePath)
+{
+  for (auto& f : list)
+  {
+    if (IsLazyStubOf(f, filePath) && !strcmp(f->param_types, func->param_types))
+    {
+      RetiredFunctions.push_back(f);
+      f = func;
+      return true;
+    }
+  }
+  return false;
+}
+
+void PluginManager::RetireLazyStubs(const std::string& filePath)
+{
+  for (auto it = AutoloadedFunctions.begin(); it != AutoloadedFunctions.end(); )
+  {
+    FunctionList& list = it->second;
+    for (auto f = list.begin(); f != list.end(); )
+    {
+      if (IsLazyStubOf(*f, filePath))
+      {
+        RetiredFunctions.push_back(*f);
+        f = list.erase(f);
+      }
+      else
+        ++f;
+    }
+    if (list.empty())
+      it = AutoloadedFunctions.erase(it);
+    else
+      ++it;
+  }
+  Generation.fetch_add(1, std::memory_order_release);
 }
 
 PluginManager::~PluginManager()
@@ -777,6 +1282,8 @@ PluginManager::~PluginManager()
       for (const auto& func : funcList)
         function_set.insert(func);
   }
+  for (const auto& func : RetiredFunctions)
+    function_set.insert(func);
   for (const auto& func : function_set)
   {
       delete func;
@@ -806,13 +1313,27 @@ void PluginManager::UpdateFunctionExports(const char* funcName, const char* func
   if (exportVar == NULL)
     exportVar = "$PluginFunctions$";
 
+  // not a side effect of the plugin being loaded, see PluginInitSideEffect
+  UpdatingExports = true;
+
   // Update $PluginFunctions$
-  const char *oldFnList = Env->GetVarString(exportVar, "");
-  std::string FnList(oldFnList);
-  if (FnList.size() > 0)    // if the list is not empty...
-    FnList.push_back(' ');  // ...add a delimiting whitespace
-  FnList.append(funcName);
-  Env->SetGlobalVar(exportVar, AVSValue( Env->SaveString(FnList.c_str(), (int)FnList.size()) ));
+  if (ExportsDeferred)
+  {
+    // each update would save a copy of the whole list
+    std::string& FnList = DeferredExports[exportVar];
+    if (FnList.size() > 0)
+      FnList.push_back(' ');
+    FnList.append(funcName);
+  }
+  else
+  {
+    const char *oldFnList = Env->GetVarString(exportVar, "");
+    std::string FnList(oldFnList);
+    if (FnList.size() > 0)    // if the list is not empty...
+      FnList.push_back(' ');  // ...add a delimiting whitespace
+    FnList.append(funcName);
+    Env->SetGlobalVar(exportVar, AVSValue( Env->SaveString(FnList.c_str(), (int)FnList.size()) ));
+  }
 
   // Update $Plugin!...!Param$
   std::string param_id;
@@ -821,6 +1342,22 @@ void PluginManager::UpdateFunctionExports(const char* funcName, const char* func
   param_id.append(funcName);
   param_id.append("!Param$");
   Env->SetGlobalVar(Env->SaveString(param_id.c_str(), (int)param_id.size()), AVSValue(Env->SaveString(funcParams)));
+  UpdatingExports = false;
+}
+
+void PluginManager::FlushFunctionExports()
+{
+  ExportsDeferred = false;
+  for (const auto& it : DeferredExports)
+  {
+    const char* exportVar = Env->SaveString(it.first.c_str(), (int)it.first.size());
+    std::string FnList(Env->GetVarString(exportVar, ""));
+    if (FnList.size() > 0)
+      FnList.push_back(' ');
+    FnList.append(it.second);
+    Env->SetGlobalVar(exportVar, AVSValue( Env->SaveString(FnList.c_str(), (int)FnList.size()) ));
+  }
+  DeferredExports.clear();
 }
 
 bool PluginManager::LoadPlugin(const char* path, bool throwOnError, AVSValue *result)
@@ -972,16 +1509,49 @@ const AVSFunction* PluginManager::Lookup(const FunctionMap& map, const char* sea
     return NULL;
 }
 
-const AVSFunction* PluginManager::Lookup(const char* search_name, const AVSValue* args, size_t num_args,
+// The function table of the PluginManager with instance id 'owner' last used
+// on this thread. Holding a reference here keeps the lookups free of atomic
+// reference counting on the shared table.
+static thread_local struct {
+  uint64_t owner;
+  uint64_t generation;
+  std::shared_ptr<const FunctionTable> table;
+} tls_function_table = { 0, 0, nullptr };
+
+const FunctionTable* PluginManager::GetFunctionTable() const
+{
+  if (tls_function_table.owner != InstanceId
+    || tls_function_table.generation != Generation.load(std::memory_order_acquire))
+    return nullptr;
+  return tls_function_table.table.get();
+}
+
+const FunctionTable* PluginManager::UpdateFunctionTable()
+{
+  const uint64_t generation = Generation.load(std::memory_order_acquire);
+  if (TableGeneration != generation) {
+    auto table = std::make_shared<FunctionTable>();
+    table->ExternalFunctions = ExternalFunctions;
+    table->AutoloadedFunctions = AutoloadedFunctions;
+    Table = std::move(table);
+    TableGeneration = generation;
+  }
+  tls_function_table.owner = InstanceId;
+  tls_function_table.generation = TableGeneration;
+  tls_function_table.table = Table;
+  return Table.get();
+}
+
+const AVSFunction* PluginManager::Lookup(const FunctionTable& table, const char* search_name, const AVSValue* args, size_t num_args,
                     bool strict, size_t args_names_count, const char* const* arg_names) const
 {
   /* Lookup in non-autoloaded functions first, so that they take priority */
-  const AVSFunction* func = Lookup(ExternalFunctions, search_name, args, num_args, strict, args_names_count, arg_names);
+  const AVSFunction* func = Lookup(table.ExternalFunctions, search_name, args, num_args, strict, args_names_count, arg_names);
   if (func != NULL)
     return func;
 
   /* If not found, look amongst the autoloaded */
-  return Lookup(AutoloadedFunctions, search_name, args, num_args, strict, args_names_count, arg_names);
+  return Lookup(table.AutoloadedFunctions, search_name, args, num_args, strict, args_names_count, arg_names);
 }
 
 bool PluginManager::FunctionExists(const char* name) const
@@ -990,6 +1560,12 @@ bool PluginManager::FunctionExists(const char* name) const
     return autoloaded || (ExternalFunctions.find(name) != ExternalFunctions.end());
 }
 
+void PluginManager::PluginInitSideEffect()
+{
+  if (PluginInLoad != NULL && !UpdatingExports)
+    PluginInLoad->isManifestSafe = false;
+}
+
 // A minor helper function
 static bool FunctionListHasDll(const FunctionList &list, const char *dll_path)
 {
@@ -1054,6 +1630,33 @@ void PluginManager::AddFunction(const char* name, const char* params, IScriptEnv
     );
   }
 
+  // plugin or autoloaded script being loaded
+  PluginFile* fileInLoad = PluginInLoad != NULL ? PluginInLoad : ImportInLoad;
+
+  if (fileInLoad != NULL && Autoloading && apply != &LazyPluginStub)
+  {
+    // remember for the manifest; stubs are registered with the export variable of the kind
+    const bool exportVarOk = PluginInLoad != NULL ? exportVar == NULL : (exportVar != NULL && !strcmp(exportVar, "$UserFunctions$"));
+    if (!exportVarOk || !IsManifestField(name) || !IsManifestField(params))
+      fileInLoad->isManifestSafe = false;
+    fileInLoad->Functions.push_back(PluginFunction{ name, params, newFunc->isPluginAvs25, newFunc->isPluginPreV11C });
+  }
+
+  // A plugin or script loaded on first use takes the places of its stubs from the
+  // manifest, its functions are already listed in the exports.
+  if (fileInLoad != NULL && fileInLoad->isLazy)
+  {
+    const auto& it = functions.find(newFunc->name);
+    if (functions.end() != it && ReplaceLazyStub(it->second, newFunc, fileInLoad->FilePath))
+    {
+      const auto& canon_it = NULL != newFunc->canon_name ? functions.find(newFunc->canon_name) : functions.end();
+      if (functions.end() != canon_it)
+        ReplaceLazyStub(canon_it->second, newFunc, fileInLoad->FilePath);
+      Generation.fetch_add(1, std::memory_order_release);
+      return;
+    }
+  }
+
   // Warn user if a function with the same name is already registered by another plugin
   {
       const auto &it = functions.find(newFunc->name);
@@ -1065,6 +1668,7 @@ void PluginManager::AddFunction(const char* name, const char* params, IScriptEnv
   }
 
   functions[newFunc->name].push_back(newFunc);
+  Generation.fetch_add(1, std::memory_order_release);
   UpdateFunctionExports(newFunc->name, newFunc->param_types, exportVar);
 
   if (NULL != newFunc->canon_name)
@@ -1092,6 +1696,26 @@ std::string PluginManager::PluginLoading() const
         return PluginInLoad->BaseName;
 }
 
+// PluginInLoad while the init function of the plugin runs. The counter lets SetVar
+// & co. check without the plugin lock whether they may be called from an init.
+class PluginInitScope
+{
+  PluginFile*& InLoad;
+  std::atomic<int>& InitsRunning;
+public:
+  PluginInitScope(PluginFile*& inLoad, std::atomic<int>& initsRunning, PluginFile* plugin) :
+    InLoad(inLoad), InitsRunning(initsRunning)
+  {
+    InLoad = plugin;
+    ++InitsRunning;
+  }
+  ~PluginInitScope()
+  {
+    --InitsRunning;
+    InLoad = NULL;
+  }
+};
+
 // 0: success
 // 1: no AvisynthPluginInit3Func
 // 2: Avisynth exception
@@ -1117,7 +1741,7 @@ int PluginManager::TryAsAvs26(PluginFile &plugin, AVSValue *result, std::string
     return 1; // not found
   else
   {
-    PluginInLoad = &plugin;
+    PluginInitScope initScope(PluginInLoad, PluginInitsRunning, &plugin);
     // a bad plugin can kill everything if it uses e.g. an old IScriptEnvironment2
     try {
       *result = AvisynthPluginInit3(Env, AVS_linkage);
@@ -1134,7 +1758,6 @@ int PluginManager::TryAsAvs26(PluginFile &plugin, AVSValue *result, std::string
       avsexception_message = "Unknown exception";
       success = 3;
     }
-    PluginInLoad = NULL;
   }
 
   return success;
@@ -1159,7 +1782,7 @@ bool PluginManager::TryAsAvs25(PluginFile &plugin, AVSValue *result)
     return false;
   else
   {
-    PluginInLoad = &plugin;
+    PluginInitScope initScope(PluginInLoad, PluginInitsRunning, &plugin);
     // in case of a crash in init2
     try {
       // Pass the 2.5 variant IScriptEnvironment, which has different Invoke
@@ -1174,7 +1797,6 @@ bool PluginManager::TryAsAvs25(PluginFile &plugin, AVSValue *result)
     {
       success = false;
     }
-    PluginInLoad = NULL;
   }
 
   return success;
@@ -1202,7 +1824,7 @@ bool PluginManager::TryAsAvsPreV11C(PluginFile& plugin, AVSValue* result)
     return false;
   else
   {
-    PluginInLoad = &plugin;
+    PluginInitScope initScope(PluginInLoad, PluginInitsRunning, &plugin);
     // set before AddFunction callbacks happen from the AvisynthCPluginInit called below
     plugin.isPluginPreV11C = true; // no array deep copy/free when NEW_AVSVALUE
     {
@@ -1266,7 +1888,6 @@ bool PluginManager::TryAsAvsPreV11C(PluginFile& plugin, AVSValue* result)
 
       *result = AVSValue(s);
     }
-    PluginInLoad = NULL;
   }
 
   return true;
@@ -1296,7 +1917,7 @@ bool PluginManager::TryAsAvsC(PluginFile& plugin, AVSValue* result)
     return false;
   else
   {
-    PluginInLoad = &plugin;
+    PluginInitScope initScope(PluginInLoad, PluginInitsRunning, &plugin);
     // set before AddFunction callbacks happen from the AvisynthCPluginInit called below
     plugin.isPluginC = true; // no array deep copy/free when NEW_AVSVALUE, but 64 bit data capable
     {
@@ -1358,7 +1979,6 @@ bool PluginManager::TryAsAvsC(PluginFile& plugin, AVSValue* result)
 
       * result = AVSValue(s);
     }
-    PluginInLoad = NULL;
   }
 
   return true;
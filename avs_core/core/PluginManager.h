@@ -4,6 +4,9 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 #include "internal.h"
 
 class InternalEnvironment;
@@ -23,25 +26,60 @@ struct StdStriComparer
 
 typedef std::vector<const AVSFunction*> FunctionList;
 typedef std::map<std::string,FunctionList,StdStriComparer> FunctionMap;
+
+// Read-only copy of the plugin function maps, for lookups without locking
+struct FunctionTable
+{
+  FunctionMap ExternalFunctions;
+  FunctionMap AutoloadedFunctions;
+};
+
 class PluginManager
 {
 private:
   InternalEnvironment *Env;
   PluginFile *PluginInLoad;
+  PluginFile *ImportInLoad;                   // autoloaded avsi script being imported
+  std::atomic<int> PluginInitsRunning;        // plugin init functions on the stack, see PluginInitScope
+  bool UpdatingExports;                       // the core sets the export variables, not the plugin
   std::vector<std::string> AutoloadDirs;
   std::vector<PluginFile> AutoLoadedImports;
   std::vector<PluginFile> AutoLoadedPlugins;
   std::vector<PluginFile> LoadedPlugins;
+  std::vector<PluginFile> LazyPlugins;        // autoloaded from the manifest, binary not loaded yet
+  std::vector<PluginFile> LazyImports;        // avsi scripts autoloaded from the manifest, not imported yet
   FunctionMap ExternalFunctions;
   FunctionMap AutoloadedFunctions;
   bool AutoloadExecuted;
   bool Autoloading;
 
+  // While the binary plugins are autoloaded, the function names are collected
+  // here per export variable and the variables are set once at the end.
+  bool ExportsDeferred;
+  std::map<std::string, std::string> DeferredExports;
+
+  // Snapshot of the maps above, made again on the first lookup after a function
+  // was added. Table and TableGeneration are guarded by the plugin lock; threads
+  // keep their own reference to the current table (see GetFunctionTable).
+  const uint64_t InstanceId;
+  std::atomic<uint64_t> Generation;
+  std::shared_ptr<const FunctionTable> Table;
+  uint64_t TableGeneration;
+
+  // Stubs of lazy plugins which were replaced by the real functions. Tables made
+  // before may still refer to them, they are deleted with the PluginManager.
+  std::vector<const AVSFunction*> RetiredFunctions;
+
   int TryAsAvs26(PluginFile &plugin, AVSValue *result, std::string& avsexception_message);
   bool TryAsAvs25(PluginFile &plugin, AVSValue *result);
   bool TryAsAvsPreV11C(PluginFile& plugin, AVSValue* result);
   bool TryAsAvsC(PluginFile &plugin, AVSValue *result);
 
+  bool ReplaceLazyStub(FunctionList& list, const AVSFunction* func, const std::string& filePath);
+  void RetireLazyStubs(const std::string& filePath);
+  void LoadLazyScript(const char* filePath);
+  void FlushFunctionExports();
+
   const AVSFunction* Lookup(const FunctionMap& map,
     const char* search_name,
     const AVSValue* args,
@@ -68,12 +106,28 @@ public:
   std::string ListAutoloadDirs();
 
   bool FunctionExists(const char* name) const;
+  // Lock free: false if no plugin init function is running
+  bool IsPluginInitRunning() const { return PluginInitsRunning.load(std::memory_order_relaxed) != 0; }
+  // Called when a plugin init may have done something that its manifest entry cannot
+  // repeat (set a variable, asked whether a function exists, added an autoload dir).
+  // Such a plugin is always loaded for real.
+  void PluginInitSideEffect();
+  // Functions of autoloaded plugins and scripts which are known from the manifest only.
+  // LoadLazyPlugin loads the plugin or imports the script and replaces them by the real ones.
+  bool IsLazyFunction(const AVSFunction* func) const;
+  void LoadLazyPlugin(const AVSFunction* func);
   std::string PluginLoading() const;    // Returns the basename of the plugin DLL that is currently being loaded, or NULL if no plugin is being loaded
   void AutoloadPlugins();
   void AddFunction(const char* name, const char* params, IScriptEnvironment::ApplyFunc apply, void* user_data, const char *exportVar,
     bool isCalledFromAvs25Interface,
     bool isCalledFromPreV11CInterface);
-  const AVSFunction* Lookup(const char* search_name,
+  // Current function table, or nullptr if this thread has no up to date one.
+  // Lock free; if nullptr, call UpdateFunctionTable under the plugin lock.
+  // The table stays valid until the next call of these on the same thread.
+  const FunctionTable* GetFunctionTable() const;
+  const FunctionTable* UpdateFunctionTable();
+  const AVSFunction* Lookup(const FunctionTable& table,
+    const char* search_name,
     const AVSValue* args,
     size_t num_args,
     bool strict,
@@ -3,6 +3,7 @@
 #include <vector>
 #include <mutex>
 #include <atomic>
+#include <algorithm>
 #ifdef INTEL_INTRINSICS
 #include <mmintrin.h>
 #endif
@@ -10,6 +11,7 @@
 #include "ThreadPool.h"
 #include "ObjectPool.h"
 #include "LruCache.h"
+#include "cache.h"
 #include "InternalEnvironment.h"
 #include "internal.h"
 
@@ -18,6 +20,7 @@ struct PrefetcherJobParams
   int frame;
   Prefetcher* prefetcher;
   LruCache<size_t, PVideoFrame>::handle cache_handle;
+  PClip dependency; // if set, frame of this upstream cache is computed instead
 };
 
 struct PrefetcherPimpl
@@ -54,6 +57,14 @@ struct PrefetcherPimpl
   // The frame number that GetFrame() has been called with the last time
   int LastRequestedFrame;
 
+  // False if the child is too old to be asked CACHE_GET_FRAME_DEPENDENCIES
+  bool HasDependencies;
+
+  // Ring of the last upstream frames queued, so that the overlapping
+  // dependencies of consecutive frames are not queued again
+  std::vector<std::pair<IClip*, int>> RecentDependencies;
+  size_t RecentDependencyPos;
+
   std::shared_ptr<LruCache<size_t, PVideoFrame> > VideoCache;
   std::atomic<int> running_workers;
   std::mutex worker_exception_mutex;
@@ -61,7 +72,7 @@ struct PrefetcherPimpl
   bool worker_exception_present;
   InternalEnvironment *EnvI;
 
-  PrefetcherPimpl(const PClip& _child, int _nThreads, int _nPrefetchFrames, IScriptEnvironment2 *env2) :
+  PrefetcherPimpl(const PClip& _child, int _nThreads, int _nPrefetchFrames, ThreadPoolScheduler _scheduler, IScriptEnvironment2 *env2) :
     child(_child),
     vi(_child->GetVideoInfo()),
     nThreads(_nThreads),
@@ -73,19 +84,25 @@ struct PrefetcherPimpl
     Pattern(1),
     IsLocked(false),
     LastRequestedFrame(0),
+    HasDependencies(_child->GetVersion() >= 5),
+    RecentDependencies(_nPrefetchFrames * 4 + 64, std::pair<IClip*, int>(nullptr, -1)),
+    RecentDependencyPos(0),
     VideoCache(NULL),
     running_workers(0),
     worker_exception_present(0),
     EnvI(static_cast<InternalEnvironment*>(env2))
   {
-		thread_pool = EnvI->NewThreadPool(nThreads);
+		thread_pool = EnvI->NewThreadPool(nThreads, _scheduler);
   }
 
   ~PrefetcherPimpl()
   {
 		for (void* data : thread_pool->Finish()) {
 			PrefetcherJobParams *ptr = (PrefetcherJobParams*)data;
-			VideoCache->rollback(&ptr->cache_handle);
+			if (ptr->dependency)
+				JobParamsPool.Destruct(ptr);
+			else
+				VideoCache->rollback(&ptr->cache_handle);
 		}
   }
 };
@@ -100,12 +117,25 @@ AVSValue Prefetcher::ThreadWorker(IScriptEnvironment2* env, void* data)
   Prefetcher *prefetcher = ptr->prefetcher;
   int n = ptr->frame;
   LruCache<size_t, PVideoFrame>::handle cache_handle = ptr->cache_handle;
+  PClip dependency = ptr->dependency;
 
   {
     std::lock_guard<std::mutex> lock(prefetcher->_pimpl->params_pool_mutex);
     prefetcher->_pimpl->JobParamsPool.Destruct(ptr);
   }
 
+  if (dependency)
+  {
+    // Only warms the upstream cache. Errors are reported when the
+    // frame which needs this one asks for it.
+    try
+    {
+      dependency->GetFrame(n, env);
+    }
+    catch (...) { }
+    return AVSValue();
+  }
+
   try
   {
     cache_handle.first->value = prefetcher->_pimpl->child->GetFrame(n, env);
@@ -131,10 +161,10 @@ AVSValue Prefetcher::ThreadWorker(IScriptEnvironment2* env, void* data)
   return AVSValue();
 }
 
-Prefetcher::Prefetcher(const PClip& _child, int _nThreads, int _nPrefetchFrames, IScriptEnvironment *env) :
+Prefetcher::Prefetcher(const PClip& _child, int _nThreads, int _nPrefetchFrames, int _scheduler, IScriptEnvironment *env) :
   _pimpl(NULL)
 {
-  _pimpl = new PrefetcherPimpl(_child, _nThreads, _nPrefetchFrames, static_cast<IScriptEnvironment2*>(env));
+  _pimpl = new PrefetcherPimpl(_child, _nThreads, _nPrefetchFrames, (ThreadPoolScheduler)_scheduler, static_cast<IScriptEnvironment2*>(env));
   _pimpl->VideoCache = std::make_shared<LruCache<size_t, PVideoFrame> >(_pimpl->nPrefetchFrames*2, CACHE_NO_RESIZE);
 }
 
@@ -158,6 +188,37 @@ size_t Prefetcher::NumPrefetchThreads() const
   return _pimpl->nThreads;
 }
 
+void Prefetcher::ScheduleDependencies(int n, InternalEnvironment* env)
+{
+  if (!_pimpl->HasDependencies)
+    return;
+
+  // Asked for every frame: the answer may depend on n (Trim, ConditionalFilter),
+  // and the query itself is cheap next to rendering the frame
+  FrameDependencyCollector collector;
+  if (_pimpl->child->SetCacheHints(CACHE_GET_FRAME_DEPENDENCIES, n) == 0)
+    return;
+
+  for (const auto& d : collector.frames)
+  {
+    const std::pair<IClip*, int> key((IClip*)(void*)d.cache, d.n);
+    if (std::find(_pimpl->RecentDependencies.begin(), _pimpl->RecentDependencies.end(), key) != _pimpl->RecentDependencies.end())
+      continue;
+    _pimpl->RecentDependencies[_pimpl->RecentDependencyPos] = key;
+    _pimpl->RecentDependencyPos = (_pimpl->RecentDependencyPos + 1) % _pimpl->RecentDependencies.size();
+
+    PrefetcherJobParams *p = NULL;
+    {
+      std::lock_guard<std::mutex> lock(_pimpl->params_pool_mutex);
+      p = _pimpl->JobParamsPool.Construct();
+    }
+    p->frame = d.n;
+    p->prefetcher = this;
+    p->dependency = d.cache;
+    _pimpl->thread_pool->QueueJob(ThreadWorker, p, env, NULL);
+  }
+}
+
 int __stdcall Prefetcher::SchedulePrefetch(int current_n, int prefetch_start, InternalEnvironment* env)
 {
   int n = prefetch_start;
@@ -181,6 +242,9 @@ int __stdcall Prefetcher::SchedulePrefetch(int current_n, int prefetch_start, In
         p->frame = n;
         p->prefetcher = this;
         p->cache_handle = cache_handle;
+        // source frames first, they are computed in parallel instead of one
+        // after the other inside the job of n
+        ScheduleDependencies(n, env);
         ++_pimpl->running_workers;
         _pimpl->thread_pool->QueueJob(ThreadWorker, p, env, NULL);
         break;
@@ -291,6 +355,7 @@ PVideoFrame __stdcall Prefetcher::GetFrame(int n, IScriptEnvironment* env_)
     {
       try
       {
+        ScheduleDependencies(n, IEnv);
         result = _pimpl->child->GetFrame(n, env); // P.F. fill result before Commit!
         cache_handle.first->value = result;
         // cache_handle.first->value = _pimpl->child->GetFrame(n, env); // P.F. before Commit!
@@ -370,9 +435,18 @@ AVSValue Prefetcher::Create(AVSValue args, void*, IScriptEnvironment* env)
   int PrefetchThreads = args[1].AsInt((int)envi->GetEnvProperty(AEP_PHYSICAL_CPUS)+1);
   int PrefetchFrames = args[2].AsInt(PrefetchThreads * 2);
 
+  const char* scheduler_name = args[3].AsString("fifo");
+  int scheduler = THREADPOOL_SCHED_FIFO;
+  if (!lstrcmpi(scheduler_name, "fifo"))
+    scheduler = THREADPOOL_SCHED_FIFO;
+  else if (!lstrcmpi(scheduler_name, "workstealing"))
+    scheduler = THREADPOOL_SCHED_WORKSTEALING;
+  else
+    env->ThrowError("Prefetch: scheduler must be \"fifo\" or \"workstealing\"");
+
   if (PrefetchThreads > 0 && PrefetchFrames > 0)
   {
-    return new Prefetcher(child, PrefetchThreads, PrefetchFrames, env);
+    return new Prefetcher(child, PrefetchThreads, PrefetchFrames, scheduler, env);
   }
   else
     return child;
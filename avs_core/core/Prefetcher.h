@@ -13,8 +13,9 @@ private:
   PrefetcherPimpl * _pimpl;
 
   static AVSValue ThreadWorker(IScriptEnvironment2* env, void* data);
+  void ScheduleDependencies(int n, InternalEnvironment* env);
   int __stdcall SchedulePrefetch(int current_n, int prefetch_start, InternalEnvironment* env);
-  Prefetcher(const PClip& _child, int _nThreads, int _nPrefetchFrames, IScriptEnvironment *env);
+  Prefetcher(const PClip& _child, int _nThreads, int _nPrefetchFrames, int _scheduler, IScriptEnvironment *env);
 
 public:
   ~Prefetcher();
@@ -0,0 +1,241 @@
+#include "Profiler.h"
+#include "InternalEnvironment.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+static std::atomic<uint64_t> profiler_instances(0);
+
+// the innermost profiled GetFrame running on this thread
+static thread_local ProfilerScope* tls_scope = nullptr;
+
+// buffer of this thread in the profiler with instance id 'owner'
+static thread_local struct {
+  uint64_t owner;
+  void* buffer;
+} tls_buffer = { 0, nullptr };
+
+Profiler::Profiler(const char* path) :
+  instance_id(++profiler_instances),
+  t0(std::chrono::steady_clock::now()),
+  path(path),
+  num_events(0)
+{
+}
+
+void Profiler::SetPath(const char* _path)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  path = _path;
+}
+
+int Profiler::RegisterNode(const char* name)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  names.push_back(name);
+  return (int)names.size() - 1;
+}
+
+int64_t Profiler::Now() const
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer(InternalEnvironment* env)
+{
+  if (tls_buffer.owner == instance_id)
+    return static_cast<ThreadBuffer*>(tls_buffer.buffer);
+
+  ThreadBuffer* buffer = new ThreadBuffer();
+  buffer->thread_id = (int)env->GetEnvProperty(AEP_THREAD_ID);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffers.emplace_back(buffer);
+  }
+  tls_buffer.owner = instance_id;
+  tls_buffer.buffer = buffer;
+  return buffer;
+}
+
+void Profiler::OnCacheLookup(bool hit)
+{
+  ProfilerScope* scope = tls_scope;
+  // only the first cache under the node counts
+  if (scope != nullptr && scope->cache == CACHE_UNKNOWN)
+    scope->cache = hit ? CACHE_HIT : CACHE_MISS;
+}
+
+void Profiler::OnFrameAllocate(size_t bytes)
+{
+  ProfilerScope* scope = tls_scope;
+  if (scope != nullptr)
+    scope->alloc_bytes += bytes;
+}
+
+void Profiler::Record(const ProfilerScope& scope, int64_t end_ns)
+{
+  ThreadBuffer* buffer = scope.buffer;
+  const int64_t wall_ns = end_ns - scope.start_ns;
+  const int64_t self_ns = wall_ns - scope.child_ns;
+
+  if ((size_t)scope.node_id >= buffer->totals.size())
+    buffer->totals.resize(scope.node_id + 1, NodeTotals());
+  NodeTotals& t = buffer->totals[scope.node_id];
+  t.calls++;
+  t.hits += scope.cache == CACHE_HIT;
+  t.misses += scope.cache == CACHE_MISS;
+  t.wall_ns += wall_ns;
+  t.self_ns += self_ns;
+  t.alloc_bytes += scope.alloc_bytes;
+
+  if (num_events.fetch_add(1, std::memory_order_relaxed) < MAX_TRACE_EVENTS)
+  {
+    Event e = { scope.node_id, scope.n, scope.cache, scope.start_ns, wall_ns, self_ns, scope.alloc_bytes };
+    buffer->events.push_back(e);
+  }
+}
+
+ProfilerScope::ProfilerScope(Profiler* profiler, int node_id, int n, InternalEnvironment* env) :
+  profiler(profiler),
+  buffer(profiler->GetThreadBuffer(env)),
+  parent(tls_scope),
+  node_id(node_id),
+  n(n),
+  cache(Profiler::CACHE_UNKNOWN),
+  start_ns(0),
+  child_ns(0),
+  alloc_bytes(0)
+{
+  tls_scope = this;
+  start_ns = profiler->Now();
+}
+
+ProfilerScope::~ProfilerScope()
+{
+  const int64_t end_ns = profiler->Now();
+  tls_scope = parent;
+  if (parent != nullptr)
+    parent->child_ns += end_ns - start_ns;
+  profiler->Record(*this, end_ns);
+}
+
+static std::string JsonEscape(const std::string& s)
+{
+  std::string ret;
+  ret.reserve(s.size());
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      ret += '\\';
+      ret += c;
+    }
+    else if ((unsigned char)c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+      ret += buf;
+    }
+    else
+      ret += c;
+  }
+  return ret;
+}
+
+static const char* CacheResultName(int cache)
+{
+  return cache == Profiler::CACHE_HIT ? "hit" : cache == Profiler::CACHE_MISS ? "miss" : "none";
+}
+
+bool Profiler::Write(std::string* error)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // trace.json -> trace.txt
+  std::string flatpath = path;
+  const size_t dot = flatpath.find_last_of('.');
+  const size_t slash = flatpath.find_last_of("/\\");
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+    flatpath.erase(dot);
+  flatpath += ".txt";
+
+  FILE* fp = fopen(path.c_str(), "w");
+  if (fp == nullptr) {
+    *error = "Could not open profiler output file " + path;
+    return false;
+  }
+
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first = true;
+  std::vector<int> thread_ids;
+  for (auto& buffer : buffers)
+  {
+    if (std::find(thread_ids.begin(), thread_ids.end(), buffer->thread_id) == thread_ids.end()) {
+      thread_ids.push_back(buffer->thread_id);
+      fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+        first ? "" : ",\n", buffer->thread_id, buffer->thread_id == 0 ? "main" : "worker", buffer->thread_id);
+      first = false;
+    }
+    for (const Event& e : buffer->events)
+    {
+      fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+        "\"args\":{\"frame\":%d,\"node\":%d,\"self_us\":%.3f,\"cache\":\"%s\",\"alloc_kb\":%.1f}}",
+        JsonEscape(names[e.node_id]).c_str(), CacheResultName(e.cache), buffer->thread_id,
+        e.start_ns / 1000.0, e.wall_ns / 1000.0, e.n, e.node_id, e.self_ns / 1000.0, CacheResultName(e.cache), e.alloc_bytes / 1024.0);
+    }
+  }
+  fprintf(fp, "\n]}\n");
+  fclose(fp);
+
+  // flat profile, summed over threads
+  std::vector<NodeTotals> totals(names.size(), NodeTotals());
+  for (auto& buffer : buffers)
+  {
+    for (size_t i = 0; i < buffer->totals.size(); ++i)
+    {
+      const NodeTotals& t = buffer->totals[i];
+      totals[i].calls += t.calls;
+      totals[i].hits += t.hits;
+      totals[i].misses += t.misses;
+      totals[i].wall_ns += t.wall_ns;
+      totals[i].self_ns += t.self_ns;
+      totals[i].alloc_bytes += t.alloc_bytes;
+    }
+  }
+
+  std::vector<int> order;
+  uint64_t all_calls = 0;
+  int64_t all_self_ns = 0;
+  for (int i = 0; i < (int)totals.size(); ++i)
+  {
+    if (totals[i].calls == 0)
+      continue;
+    order.push_back(i);
+    all_calls += totals[i].calls;
+    all_self_ns += totals[i].self_ns;
+  }
+  std::stable_sort(order.begin(), order.end(),
+    [&totals](int a, int b) { return totals[a].self_ns > totals[b].self_ns; });
+
+  fp = fopen(flatpath.c_str(), "w");
+  if (fp == nullptr) {
+    *error = "Could not open profiler output file " + flatpath;
+    return false;
+  }
+
+  fprintf(fp, "GetFrame profile: %" PRIu64 " calls on %d threads, %.3f s self time in total",
+    all_calls, (int)thread_ids.size(), all_self_ns / 1e9);
+  if (num_events > MAX_TRACE_EVENTS)
+    fprintf(fp, " (trace truncated to the first %d calls)", (int)MAX_TRACE_EVENTS);
+  fprintf(fp, "\n\n");
+  fprintf(fp, "%12s %7s %12s %10s %10s %10s %12s %12s %6s  %s\n",
+    "self ms", "self %", "total ms", "calls", "hits", "misses", "self ms/call", "alloc MB", "node", "filter");
+  for (int i : order)
+  {
+    const NodeTotals& t = totals[i];
+    fprintf(fp, "%12.3f %6.2f%% %12.3f %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %12.3f %12.3f %6d  %s\n",
+      t.self_ns / 1e6, all_self_ns > 0 ? 100.0 * t.self_ns / all_self_ns : 0.0, t.wall_ns / 1e6,
+      t.calls, t.hits, t.misses, t.self_ns / 1e6 / t.calls, t.alloc_bytes / (1024.0 * 1024.0), i, names[i].c_str());
+  }
+  fclose(fp);
+  return true;
+}
@@ -0,0 +1,111 @@
+#ifndef _AVS_PROFILER_H
+#define _AVS_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class InternalEnvironment;
+class ProfilerScope;
+
+// Per-filter GetFrame profiler, switched on by the SetProfiler(path) script function.
+//
+// Every FilterGraphNode created while profiling is on is registered here.
+// Its GetFrame calls are timed: wall time, and self time which excludes the
+// nested FilterGraphNode calls. The Cache under the node reports whether the
+// frame was a hit or a miss, and the bytes of the video frames allocated by
+// the node itself (see GraphMemoryNode) are added up. Data is collected in per-thread buffers without
+// locking. When the environment is destroyed, the profiler writes a Chrome
+// trace_event JSON (chrome://tracing, ui.perfetto.dev) and a flat profile
+// sorted by self time.
+class Profiler
+{
+public:
+  enum CacheResult { CACHE_UNKNOWN = 0, CACHE_HIT, CACHE_MISS };
+
+  Profiler(const char* path);
+
+  void SetPath(const char* path);
+  // Returns the id of the new node
+  int RegisterNode(const char* name);
+
+  // Called by Cache::GetFrame, marks the innermost profiled GetFrame of this thread
+  static void OnCacheLookup(bool hit);
+  // Called when a frame buffer is attached to the current graph node
+  static void OnFrameAllocate(size_t bytes);
+
+  // Trace goes to path, flat profile to path with .txt extension.
+  // Returns false and fills error if a file could not be written.
+  bool Write(std::string* error);
+
+private:
+  friend class ProfilerScope;
+
+  // Trace events beyond this are dropped (~50 MB), totals are kept counting
+  enum { MAX_TRACE_EVENTS = 1000000 };
+
+  struct Event {
+    int node_id;
+    int n;
+    int cache;
+    int64_t start_ns;
+    int64_t wall_ns;
+    int64_t self_ns;
+    uint64_t alloc_bytes;
+  };
+
+  struct NodeTotals {
+    uint64_t calls;
+    uint64_t hits;
+    uint64_t misses;
+    int64_t wall_ns;
+    int64_t self_ns;
+    uint64_t alloc_bytes;
+  };
+
+  struct ThreadBuffer {
+    int thread_id;
+    std::vector<Event> events;
+    std::vector<NodeTotals> totals;
+  };
+
+  const uint64_t instance_id;
+  const std::chrono::steady_clock::time_point t0;
+
+  std::mutex mutex;
+  std::string path;
+  std::vector<std::string> names;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::atomic<size_t> num_events;
+
+  int64_t Now() const;
+  ThreadBuffer* GetThreadBuffer(InternalEnvironment* env);
+  void Record(const ProfilerScope& scope, int64_t end_ns);
+};
+
+// Times one FilterGraphNode::GetFrame call
+class ProfilerScope
+{
+public:
+  ProfilerScope(Profiler* profiler, int node_id, int n, InternalEnvironment* env);
+  ~ProfilerScope();
+
+private:
+  friend class Profiler;
+
+  Profiler* profiler;
+  Profiler::ThreadBuffer* buffer;
+  ProfilerScope* parent;
+  int node_id;
+  int n;
+  int cache;
+  int64_t start_ns;
+  int64_t child_ns;
+  uint64_t alloc_bytes;
+};
+
+#endif  // _AVS_PROFILER_H
@@ -2,6 +2,8 @@
 #define AVS_SIMPLELRUCACHE_H
 
 #include <list>
+#include <vector>
+#include <algorithm>
 #include <functional>
 #include <limits>
 #include <avs/minmax.h>
@@ -25,6 +27,7 @@ public:
   typedef typename std::list<Entry>::iterator entry_type;
 
   typedef std::function<bool(SimpleLruCache*, const Entry&, void*)> EvictEventType;
+  typedef std::function<double(const Entry&, void*)> PriorityEventType;
 
 private:
   size_t MinCapacity;
@@ -36,6 +39,7 @@ private:
 
   void* EventUserData;
   const EvictEventType EvictEvent;
+  PriorityEventType PriorityEvent;
 
 public:
   SimpleLruCache(size_t capacity, const EvictEventType&& evict, void* evData) :
@@ -69,6 +73,14 @@ public:
     *max = MaxCapacity;
   }
 
+  // When set, trim() evicts the entries with the lowest priority first
+  // instead of the least recently used ones. Equal priorities are still
+  // evicted in LRU order.
+  void set_priority(const PriorityEventType& priority)
+  {
+    PriorityEvent = priority;
+  }
+
   void set_limits(size_t min, size_t max)
   {
     MinCapacity = min;
@@ -147,7 +159,33 @@ public:
 
   void trim()
   {
-    if (Cache.size() > RealCapacity)
+    if (Cache.size() > RealCapacity && PriorityEvent)
+    {
+      size_t nItemsToDelete = Cache.size() - RealCapacity;
+
+      // least recently used first, stable sort keeps this order for ties
+      std::vector<std::pair<double, entry_type>> candidates;
+      candidates.reserve(Cache.size());
+      for (entry_type it = Cache.end(); it != Cache.begin(); )
+      {
+        --it;
+        candidates.emplace_back(PriorityEvent(*it, EventUserData), it);
+      }
+      std::stable_sort(candidates.begin(), candidates.end(),
+        [](const std::pair<double, entry_type>& a, const std::pair<double, entry_type>& b) { return a.first < b.first; });
+
+      for (auto& candidate : candidates)
+      {
+        if (nItemsToDelete == 0)
+          break;
+        if (EvictEvent == NULL || EvictEvent(this, *candidate.second, EventUserData))
+        {
+          Pool.splice(Pool.begin(), Cache, candidate.second);
+          --nItemsToDelete;
+        }
+      }
+    }
+    else if (Cache.size() > RealCapacity)
     {
       size_t nItemsToDelete = Cache.size() - RealCapacity;
       auto it = --Cache.end();
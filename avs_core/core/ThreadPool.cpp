@@ -12,24 +12,67 @@ struct ThreadPoolGenericItemData
 };
 
 #include "mpmc_bounded_queue.h"
+#include "work_stealing_queue.h"
 typedef mpmc_bounded_queue<ThreadPoolGenericItemData> MessageQueue;
+typedef work_stealing_queue<ThreadPoolGenericItemData> StealingQueue;
 
 class ThreadPoolPimpl
 {
 public:
+  const ThreadPoolScheduler Scheduler;
+  const size_t StartId;
   std::vector<std::thread> Threads;
+  // Only the queue belonging to Scheduler is used
   MessageQueue MsgQueue;
+  StealingQueue StealQueue;
   std::mutex Mutex;
   std::condition_variable FinishCond;
   size_t NumRunning;
 
-  ThreadPoolPimpl(size_t nThreads) :
+  ThreadPoolPimpl(size_t nThreads, size_t nStartId, ThreadPoolScheduler scheduler) :
+    Scheduler(scheduler),
+    StartId(nStartId),
     Threads(),
-    MsgQueue(nThreads * 6)
+    MsgQueue(scheduler == THREADPOOL_SCHED_FIFO ? nThreads * 6 : 1),
+    StealQueue(scheduler == THREADPOOL_SCHED_WORKSTEALING ? nThreads : 1)
   {}
+
+  bool PopJob(ThreadPoolGenericItemData* data, size_t worker_index)
+  {
+    if (Scheduler == THREADPOOL_SCHED_WORKSTEALING)
+      return StealQueue.pop(data, worker_index);
+    return MsgQueue.pop_back(data);
+  }
+
+  bool PushJob(ThreadPoolGenericItemData&& data, InternalEnvironment* env)
+  {
+    if (Scheduler == THREADPOOL_SCHED_WORKSTEALING) {
+      // A job queued by one of our own workers goes to its own deque.
+      // Everybody else's jobs are spread over the workers.
+      const size_t thread_id = (size_t)env->GetThreadId();
+      const size_t producer_index = thread_id >= StartId ? thread_id - StartId : StealQueue.num_workers();
+      return StealQueue.push(std::move(data), producer_index);
+    }
+    return MsgQueue.push_front(std::move(data));
+  }
+
+  void FinishQueue()
+  {
+    if (Scheduler == THREADPOOL_SCHED_WORKSTEALING)
+      StealQueue.finish();
+    else
+      MsgQueue.finish();
+  }
+
+  bool PopRemain(ThreadPoolGenericItemData* data)
+  {
+    if (Scheduler == THREADPOOL_SCHED_WORKSTEALING)
+      return StealQueue.pop_remain(data);
+    return MsgQueue.pop_remain(data);
+  }
 };
 
-void ThreadPool::ThreadFunc(size_t thread_id, ThreadPoolPimpl * const _pimpl, InternalEnvironment* env)
+void ThreadPool::ThreadFunc(size_t thread_id, size_t worker_index, ThreadPoolPimpl * const _pimpl, InternalEnvironment* env)
 {
   auto EnvTLS = env->NewThreadScriptEnvironment((int)thread_id);
   PInternalEnvironment holder = PInternalEnvironment(EnvTLS);
@@ -37,7 +80,7 @@ void ThreadPool::ThreadFunc(size_t thread_id, ThreadPoolPimpl * const _pimpl, In
   while (true)
   {
     ThreadPoolGenericItemData data;
-    if (_pimpl->MsgQueue.pop_back(&data) == false) {
+    if (_pimpl->PopJob(&data, worker_index) == false) {
       // threadpool is canceled
       std::unique_lock<std::mutex> lock(_pimpl->Mutex);
       if (--_pimpl->NumRunning == 0) {
@@ -79,8 +122,8 @@ void ThreadPool::ThreadFunc(size_t thread_id, ThreadPoolPimpl * const _pimpl, In
   } //while
 }
 
-ThreadPool::ThreadPool(size_t nThreads, size_t nStartId, InternalEnvironment* env) :
-  _pimpl(new ThreadPoolPimpl(nThreads))
+ThreadPool::ThreadPool(size_t nThreads, size_t nStartId, InternalEnvironment* env, ThreadPoolScheduler scheduler) :
+  _pimpl(new ThreadPoolPimpl(nThreads, nStartId, scheduler))
 {
   _pimpl->Threads.reserve(nThreads);
 
@@ -89,7 +132,7 @@ ThreadPool::ThreadPool(size_t nThreads, size_t nStartId, InternalEnvironment* en
   // i is used as the thread id. Skip id zero because that is reserved for the main thread.
   // CUDA: thread id is controled by caller
   for (size_t i = 0; i < nThreads; ++i)
-    _pimpl->Threads.emplace_back(ThreadFunc, i + nStartId, _pimpl, env);
+    _pimpl->Threads.emplace_back(ThreadFunc, i + nStartId, i, _pimpl, env);
 
   _pimpl->NumRunning = nThreads;
 }
@@ -106,7 +149,7 @@ void ThreadPool::QueueJob(ThreadWorkerFuncPtr clb, void* params, InternalEnviron
   else
     itemData.Promise = NULL;
 
-  if (_pimpl->MsgQueue.push_front(std::move(itemData)) == false) {
+  if (_pimpl->PushJob(std::move(itemData), env) == false) {
     throw AvisynthError("Threadpool is cancelled");
   }
 }
@@ -116,18 +159,23 @@ size_t ThreadPool::NumThreads() const
   return _pimpl->Threads.size();
 }
 
+ThreadPoolScheduler ThreadPool::Scheduler() const
+{
+  return _pimpl->Scheduler;
+}
+
 std::vector<void*> ThreadPool::Finish()
 {
   std::unique_lock<std::mutex> lock(_pimpl->Mutex);
   if (_pimpl->NumRunning > 0) {
-    _pimpl->MsgQueue.finish();
+    _pimpl->FinishQueue();
     while (_pimpl->NumRunning > 0)
     {
       _pimpl->FinishCond.wait(lock);
     }
     std::vector<void*> ret;
     ThreadPoolGenericItemData item;
-    while (_pimpl->MsgQueue.pop_remain(&item)) {
+    while (_pimpl->PopRemain(&item)) {
       ret.push_back(item.Params);
     }
     return ret;
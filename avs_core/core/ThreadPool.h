@@ -101,19 +101,27 @@ public:
   }
 };
 
+// How the jobs are handed out to the worker threads
+enum ThreadPoolScheduler : int
+{
+  THREADPOOL_SCHED_FIFO = 0,      // one shared bounded queue
+  THREADPOOL_SCHED_WORKSTEALING,  // one deque per worker, idle workers steal
+};
+
 class ThreadPoolPimpl;
 class ThreadPool
 {
 private:
   ThreadPoolPimpl* const _pimpl;
 
-  static void ThreadFunc(size_t thread_id, ThreadPoolPimpl* const _pimpl, InternalEnvironment* env);
+  static void ThreadFunc(size_t thread_id, size_t worker_index, ThreadPoolPimpl* const _pimpl, InternalEnvironment* env);
 public:
-  ThreadPool(size_t nThreads, size_t nStartId, InternalEnvironment* env);
+  ThreadPool(size_t nThreads, size_t nStartId, InternalEnvironment* env, ThreadPoolScheduler scheduler = THREADPOOL_SCHED_FIFO);
   ~ThreadPool();
 
   void QueueJob(ThreadWorkerFuncPtr clb, void* params, InternalEnvironment* env, JobCompletion* tc);
   size_t NumThreads() const;
+  ThreadPoolScheduler Scheduler() const;
 
   std::vector<void*> Finish();
   void Join();
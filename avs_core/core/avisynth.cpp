@@ -45,8 +45,10 @@
 #include "FilterConstructor.h"
 #include "PluginManager.h"
 #include "MappedList.h"
+#include "FrameRegistry.h"
 #include <chrono>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -90,6 +92,7 @@
 #include <limits>
 
 #include "FilterGraph.h"
+#include "Profiler.h"
 #include "DeviceManager.h"
 #include "AVSMap.h"
 
@@ -426,7 +429,8 @@ VideoFrame::VideoFrame(VideoFrameBuffer* _vfb, AVSMap* avsmap, int _offset, int
   offsetU(_offset), offsetV(_offset), pitchUV(0), row_sizeUV(0), heightUV(0),  // PitchUV=0 so this doesn't take up additional space
   offsetA(0), pitchA(0), row_sizeA(0),
   pixel_type(_pixel_type),
-  properties(avsmap)
+  properties(avsmap),
+  plane_vfb()
 {
   InterlockedIncrement(&vfb->refcount);
 }
@@ -437,7 +441,8 @@ VideoFrame::VideoFrame(VideoFrameBuffer* _vfb, AVSMap* avsmap, int _offset, int
   offsetU(_offsetU), offsetV(_offsetV), pitchUV(_pitchUV), row_sizeUV(_row_sizeUV), heightUV(_heightUV),
   offsetA(0), pitchA(0), row_sizeA(0),
   pixel_type(_pixel_type),
-  properties(avsmap)
+  properties(avsmap),
+  plane_vfb()
 {
   InterlockedIncrement(&vfb->refcount);
 }
@@ -448,7 +453,8 @@ VideoFrame::VideoFrame(VideoFrameBuffer* _vfb, AVSMap* avsmap, int _offset, int
   offsetU(_offsetU), offsetV(_offsetV), pitchUV(_pitchUV), row_sizeUV(_row_sizeUV), heightUV(_heightUV),
   offsetA(_offsetA), pitchA(_pitch), row_sizeA(_row_size),
   pixel_type(_pixel_type),
-  properties(avsmap)
+  properties(avsmap),
+  plane_vfb()
 {
   InterlockedIncrement(&vfb->refcount);
 }
@@ -464,7 +470,7 @@ VideoFrame* VideoFrame::Subframe(int rel_offset, int new_pitch, int new_row_size
   else
     new_pixel_type = pixel_type;
 
-  return new VideoFrame(vfb, new AVSMap(), offset + rel_offset, new_pitch, new_row_size, new_height,
+  return new VideoFrame(GetPlaneFrameBuffer(DEFAULT_PLANE), new AVSMap(), offset + rel_offset, new_pitch, new_row_size, new_height,
     new_pixel_type);
 }
 
@@ -483,9 +489,11 @@ VideoFrame* VideoFrame::Subframe(int rel_offset, int new_pitch, int new_row_size
   else
     new_pixel_type = pixel_type;
 
-  return new VideoFrame(vfb, new AVSMap(), offset + rel_offset, new_pitch, new_row_size, new_height,
+  VideoFrame* subframe = new VideoFrame(vfb, new AVSMap(), offset + rel_offset, new_pitch, new_row_size, new_height,
     rel_offsetU + offsetU, rel_offsetV + offsetV, new_pitchUV, new_row_sizeUV, new_heightUV,
     new_pixel_type);
+  InheritSharedPlanes(subframe, 3);
+  return subframe;
 }
 
 // alpha support
@@ -496,10 +504,12 @@ VideoFrame* VideoFrame::Subframe(int rel_offset, int new_pitch, int new_row_size
   const int new_row_sizeUV = !row_size ? 0 : MulDiv(new_row_size, row_sizeUV, row_size);
   const int new_heightUV   = !height   ? 0 : MulDiv(new_height,   heightUV,   height);
 
-  return new VideoFrame(vfb, new AVSMap(), offset + rel_offset, new_pitch, new_row_size, new_height,
+  VideoFrame* subframe = new VideoFrame(vfb, new AVSMap(), offset + rel_offset, new_pitch, new_row_size, new_height,
     offsetU + rel_offsetU, offsetV + rel_offsetV, new_pitchUV, new_row_sizeUV, new_heightUV,
     offsetA + rel_offsetA,
     pixel_type);
+  InheritSharedPlanes(subframe, 4);
+  return subframe;
 }
 
 VideoFrameBuffer::VideoFrameBuffer() :
@@ -750,6 +760,7 @@ namespace std
 #include "ScriptEnvironmentTLS.h"
 
 class ThreadScriptEnvironment;
+struct RuntimeInvokeMemo;
 
 // order is not important, unlike in IScriptEnvironment variants.
 class ScriptEnvironment {
@@ -774,6 +785,7 @@ public:
   PVideoFrame NewPlanarVideoFrame(int row_size, int height, int row_sizeUV, int heightUV, int align, bool U_first, int pixel_type, Device* device);
 
   bool MakeWritable(PVideoFrame* pvf);
+  PVideoFrame CopyVideoFrame(const PVideoFrame& vf);
   void BitBlt(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, int row_size, int height);
   void AtExit(IScriptEnvironment::ShutdownFunc function, void* user_data);
   PVideoFrame Subframe(PVideoFrame src, int rel_offset, int new_pitch, int new_row_size, int new_height);
@@ -829,6 +841,14 @@ public:
 
   bool MakePropertyWritable(PVideoFrame* pvf); // V9
 
+  PVideoFrame NewVideoFrameFromPlanes(const VideoInfo& vi, const PVideoFrame* src_frames, const int* src_planes, const PVideoFrame* prop_src); // V12
+  PVideoFrame GetSingleBufferFrame(const PVideoFrame& src);
+
+  // memos of the runtime Invokes of the threads
+  void RegisterInvokeMemo(RuntimeInvokeMemo* memo);
+  void UnregisterInvokeMemo(RuntimeInvokeMemo* memo);
+  void ClearRuntimeInvokeMemos();
+
   /* IScriptEnvironment2 */
   bool LoadPlugin(const char* filePath, bool throwOnError, AVSValue *result);
   void AddAutoloadDir(const char* dirPath, bool toFront);
@@ -836,7 +856,9 @@ public:
   void AutoloadPlugins();
   void AddFunction(const char* name, const char* params, INeoEnv::ApplyFunc apply, void* user_data, const char *exportVar);
   bool InternalFunctionExists(const char* name);
+  void PluginInitSideEffect();
   void AdjustMemoryConsumption(size_t amount, bool minus);
+  BufferPoolStats* GetBufferPoolStats() { return &buffer_pool_stats; }
   void SetFilterMTMode(const char* filter, MtMode mode, bool force);
   void SetFilterMTMode(const char* filter, MtMode mode, MtWeight weight);
   MtMode GetFilterMTMode(const Function* filter, bool* is_forced) const;
@@ -864,8 +886,10 @@ public:
 
   PVideoFrame GetOnDeviceFrame(const PVideoFrame& src, Device* device);
   void ParallelJob(ThreadWorkerFuncPtr jobFunc, void* jobData, IJobCompletion* completion, InternalEnvironment *env);
-  ThreadPool* NewThreadPool(size_t nThreads);
+  ThreadPool* NewThreadPool(size_t nThreads, ThreadPoolScheduler scheduler);
   void SetGraphAnalysis(bool enable) { graphAnalysisEnable = enable; }
+  void SetProfiler(const char* path);
+  Profiler* GetProfiler() { return profiler.get(); }
 
   char* ListAutoloadDirs();
 
@@ -884,6 +908,10 @@ public:
 
   ThreadScriptEnvironment* GetMainThreadEnv() { return threadEnv.get(); }
 
+  // interface version the host created the environment with
+  int GetHostInterfaceVersion() const { return HostInterfaceVersion; }
+  void SetHostInterfaceVersion(int version) { HostInterfaceVersion = version; }
+
 private:
   typedef IScriptEnvironment::NotFound NotFound;
   typedef IScriptEnvironment::ApplyFunc ApplyFunc;
@@ -893,6 +921,9 @@ private:
   // AtExiter has functions which
   // rely on StringDump elements.
   ConcurrentVarStringFrame top_frame;
+  BufferPoolStats buffer_pool_stats; // must outlive the per-thread BufferPools
+  std::mutex invoke_memos_mutex;
+  std::vector<RuntimeInvokeMemo*> invoke_memos; // must outlive the threads' ThreadScriptEnvironments
   std::unique_ptr<ThreadScriptEnvironment> threadEnv;
   std::mutex string_mutex;
 
@@ -903,6 +934,7 @@ private:
   std::recursive_mutex plugin_mutex;
 
   long EnvCount; // for ThreadScriptEnvironment leak detection
+  int HostInterfaceVersion;
 
   void VThrowError(const char* fmt, va_list va);
 
@@ -919,73 +951,6 @@ private:
   long hrfromcoinit;
   uint32_t coinitThreadId;
 
-  struct DebugTimestampedFrame
-  {
-    VideoFrame* frame;
-
-#ifdef _DEBUG
-    std::chrono::time_point<std::chrono::high_resolution_clock> timestamp;
-#endif
-
-    DebugTimestampedFrame(VideoFrame* _frame)
-      : frame(_frame)
-#ifdef _DEBUG
-      , timestamp(std::chrono::high_resolution_clock::now())
-#endif
-    {}
-  };
-
-  class VFBStorage : public VideoFrameBuffer {
-  public:
-    int free_count;
-    int margin;
-    PGraphMemoryNode memory_node;
-
-    VFBStorage()
-      : VideoFrameBuffer(),
-      free_count(0),
-      margin(0)
-    { }
-
-    VFBStorage(int size, int margin, Device* device)
-      : VideoFrameBuffer(size, margin, device),
-      free_count(0),
-      margin(margin)
-    { }
-
-    void Attach(FilterGraphNode* node) {
-      if (memory_node) {
-        memory_node->OnFree(data_size, device);
-        memory_node = nullptr;
-      }
-      if (node != nullptr) {
-        memory_node = node->GetMemoryNode();
-        memory_node->OnAllocate(data_size, device);
-      }
-    }
-
-    ~VFBStorage() {
-      if (memory_node) {
-        memory_node->OnFree(data_size, device);
-        memory_node = nullptr;
-      }
-#ifdef _DEBUG
-      if (data && device->device_type == DEV_TYPE_CPU) {
-        // check buffer overrun
-        int *pInt = (int *)(data + margin + data_size);
-        if (pInt[0] != 0xDEADBEEF ||
-          pInt[1] != 0xDEADBEEF ||
-          pInt[2] != 0xDEADBEEF ||
-          pInt[3] != 0xDEADBEEF)
-        {
-          printf("Buffer overrun!!!\n");
-        }
-      }
-#endif
-    }
-  };
-
-  typedef std::vector<DebugTimestampedFrame> VideoFrameArrayType;
   typedef std::map<VideoFrameBuffer *, VideoFrameArrayType> FrameBufferRegistryType;
   typedef std::map<size_t, FrameBufferRegistryType> FrameRegistryType2; // post r1825 P.F.
   typedef mapped_list<Cache*> CacheRegistryType;
@@ -1001,7 +966,16 @@ private:
   Cache* FrontCache;
   VideoFrame* GetNewFrame(size_t vfb_size, size_t margin, Device* device);
   VideoFrame* GetFrameFromRegistry(size_t vfb_size, Device* device);
-  void ShrinkCache(Device* device);
+  VideoFrame* GetFrameFromFreeList(size_t vfb_size, Device* device);
+  VideoFrame* RecycleFrameBuffer(VFBStorage* vfb);
+  struct CacheCost {
+    Cache* cache;
+    int size;
+    double seconds_per_mb;
+    size_t frame_bytes;
+  };
+  std::vector<CacheCost> ShrinkableCaches(Device* device);
+  void ShrinkCache(Device* device, size_t vfb_size);
   VideoFrame* AllocateFrame(size_t vfb_size, size_t margin, Device* device);
   std::recursive_mutex memory_mutex;
   std::recursive_mutex invoke_mutex; // 3.7.2
@@ -1067,6 +1041,7 @@ private:
 
   // filter graph
   bool graphAnalysisEnable;
+  std::unique_ptr<Profiler> profiler;
 
   typedef std::vector<FilterGraphNode*> GraphNodeRegistryType;
   GraphNodeRegistryType GraphNodeRegistry;
@@ -1232,6 +1207,148 @@ InternalEnvironment* GetAndRevealCamouflagedEnv(IScriptEnvironment* env) {
 *  Per thread data
 * ---------------------------------------------------------------------------------
 */
+// Filters made by runtime Invoke calls (from GetFrame) of one thread.
+// Runtime scripts tend to make the same filters with the same arguments on
+// each frame; those are reused instead of constructed again. Each thread has
+// its own memo, so an instance is never shared by two threads, whatever the
+// MT mode of the filter is.
+// A filter is kept only when a call with the same arguments was seen recently
+// (hashes in 'seen'), so calls which differ on each frame, e.g. with the frame
+// number in an argument, do not hold on to their instances.
+// The entries hold their argument and result clips. The memos of all threads are
+// cleared when a runtime script filter goes away (ScriptEnvironment::ClearRuntimeInvokeMemos),
+// so they do not keep the chains of an unloaded script alive.
+struct RuntimeInvokeMemo
+{
+  enum { MAX_ENTRIES = 16, MAX_SEEN = 64 };
+
+  struct Entry {
+    const Function* func;
+    uint64_t hash;
+    AVSValue args;
+    AVSValue result;
+  };
+  std::vector<Entry> entries; // least recently used first
+  std::vector<uint64_t> seen;
+  size_t seen_next = 0;
+  // the main thread's memo is used by every thread of the host, and any thread may clear it
+  std::mutex mutex;
+
+  static uint64_t Mix(uint64_t h, uint64_t v)
+  {
+    return (h ^ v) * 0x100000001b3ull; // FNV-1a step, 64 bit words
+  }
+
+  static uint64_t HashValue(uint64_t h, const AVSValue& v)
+  {
+    h = Mix(h, (uint64_t)v.GetType());
+    switch (v.GetType()) {
+    case VALUE_TYPE_BOOL: return Mix(h, v.AsBool());
+    case VALUE_TYPE_INT:
+    case VALUE_TYPE_LONG: return Mix(h, (uint64_t)v.AsLong());
+    case VALUE_TYPE_FLOAT:
+    case VALUE_TYPE_DOUBLE: {
+      const double d = v.AsFloat();
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      return Mix(h, bits);
+    }
+    case VALUE_TYPE_STRING:
+      for (const char* p = v.AsString(); *p; ++p)
+        h = Mix(h, (unsigned char)*p);
+      return h;
+    case VALUE_TYPE_CLIP: return Mix(h, (uint64_t)(uintptr_t)(void*)v.AsClip());
+    case VALUE_TYPE_FUNCTION: return Mix(h, (uint64_t)(uintptr_t)(void*)v.AsFunction());
+    case VALUE_TYPE_ARRAY:
+      for (int i = 0; i < v.ArraySize(); ++i)
+        h = HashValue(h, v[i]);
+      return h;
+    default:
+      return h;
+    }
+  }
+
+  static uint64_t Hash(const Function* func, const AVSValue& args)
+  {
+    return HashValue(Mix(0xcbf29ce484222325ull, (uint64_t)(uintptr_t)func), args);
+  }
+
+  static bool SameValue(const AVSValue& a, const AVSValue& b)
+  {
+    if (a.GetType() != b.GetType())
+      return false;
+    switch (a.GetType()) {
+    case VALUE_TYPE_UNDEFINED: return true;
+    case VALUE_TYPE_BOOL: return a.AsBool() == b.AsBool();
+    case VALUE_TYPE_INT:
+    case VALUE_TYPE_LONG: return a.AsLong() == b.AsLong();
+    case VALUE_TYPE_FLOAT:
+    case VALUE_TYPE_DOUBLE: return a.AsFloat() == b.AsFloat();
+    case VALUE_TYPE_STRING: return strcmp(a.AsString(), b.AsString()) == 0;
+    case VALUE_TYPE_CLIP: return (void*)a.AsClip() == (void*)b.AsClip();
+    case VALUE_TYPE_FUNCTION: return (void*)a.AsFunction() == (void*)b.AsFunction();
+    case VALUE_TYPE_ARRAY:
+      if (a.ArraySize() != b.ArraySize())
+        return false;
+      for (int i = 0; i < a.ArraySize(); ++i)
+        if (!SameValue(a[i], b[i]))
+          return false;
+      return true;
+    }
+    return false;
+  }
+
+  // No clip is released while the mutex is held, see TakeEntries
+  bool Find(const Function* func, uint64_t hash, const AVSValue& args, AVSValue* result)
+  {
+    AVSValue found;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (size_t i = entries.size(); i-- > 0; ) {
+        if (entries[i].hash == hash && entries[i].func == func && SameValue(entries[i].args, args)) {
+          found = entries[i].result;
+          std::rotate(entries.begin() + i, entries.begin() + i + 1, entries.end());
+          break;
+        }
+      }
+    }
+    if (!found.Defined())
+      return false;
+    *result = found;
+    return true;
+  }
+
+  // Called after a miss; keeps the new filter if the call is a repeated one
+  void Add(const Function* func, uint64_t hash, const AVSValue& args, const AVSValue& result)
+  {
+    std::vector<Entry> evicted; // released after the mutex
+    std::lock_guard<std::mutex> lock(mutex);
+    if (std::find(seen.begin(), seen.end(), hash) == seen.end()) {
+      if (seen.size() < MAX_SEEN)
+        seen.push_back(hash);
+      else
+        seen[seen_next++ % MAX_SEEN] = hash;
+      return;
+    }
+    if (entries.size() >= MAX_ENTRIES) {
+      evicted.push_back(std::move(entries.front()));
+      entries.erase(entries.begin());
+    }
+    entries.push_back(Entry{ func, hash, args, result });
+  }
+
+  // The entries are moved out to be released by the caller, outside of any lock:
+  // releasing the clips may destroy another runtime script filter, which clears again.
+  std::vector<Entry> TakeEntries()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Entry> taken;
+    taken.swap(entries);
+    seen.clear();
+    return taken;
+  }
+};
+
 struct ScriptEnvironmentTLS
 {
   const int thread_id;
@@ -1253,10 +1370,12 @@ struct ScriptEnvironmentTLS
   FilterGraphNode* currentGraphNode;
   volatile long refcount;
 
-  ScriptEnvironmentTLS(int thread_id, InternalEnvironment* core)
+  RuntimeInvokeMemo invoke_memo;
+
+  ScriptEnvironmentTLS(int thread_id, InternalEnvironment* core, BufferPoolStats* pool_stats)
     : thread_id(thread_id)
     , var_table(core->GetTopFrame())
-    , buffer_pool(core)
+    , buffer_pool(core, pool_stats)
     , currentDevice(NULL)
     , closing(false)
     , supressCaching(false)
@@ -1293,7 +1412,7 @@ public:
   ThreadScriptEnvironment(int thread_id, ScriptEnvironment* core, ScriptEnvironmentTLS* coreTLS)
     : core(core)
     , coreTLS(coreTLS)
-    , myTLS(thread_id, this)
+    , myTLS(thread_id, this, core->GetBufferPoolStats())
   {
     if (coreTLS == nullptr) {
       // when this is main thread TLS
@@ -1314,10 +1433,12 @@ public:
       }
 #endif
     }
+    core->RegisterInvokeMemo(&myTLS.invoke_memo);
     core->IncEnvCount(); // for leak detection
   }
 
   ~ThreadScriptEnvironment() {
+    core->UnregisterInvokeMemo(&myTLS.invoke_memo);
     core->DecEnvCount(); // for leak detection
   }
 
@@ -1345,12 +1466,14 @@ public:
   bool __stdcall SetVar(const char* name, const AVSValue& val)
   {
     if (DISPATCH(closing)) return true;  // We easily risk  being inside the critical section below, while deleting variables.
+    core->PluginInitSideEffect();
     return DISPATCH(var_table).Set(name, val);
   }
 
   bool __stdcall SetGlobalVar(const char* name, const AVSValue& val)
   {
     if (DISPATCH(closing)) return true;  // We easily risk  being inside the critical section below, while deleting variables.
+    core->PluginInitSideEffect();
     return DISPATCH(var_table).SetGlobal(name, val);
   }
 
@@ -1675,6 +1798,11 @@ public:
   {
     return core->propSetDataH(map, key, d, length, type, append);
   }
+
+  PVideoFrame __stdcall NewVideoFrameFromPlanes(const VideoInfo& vi, const PVideoFrame* src_frames, const int* src_planes, const PVideoFrame* prop_src)
+  {
+    return core->NewVideoFrameFromPlanes(vi, src_frames, src_planes, prop_src);
+  }
   int __stdcall propSetClip(AVSMap* map, const char* key, PClip& clip, int append)
   {
     return core->propSetClip(map, key, clip, append);
@@ -1739,6 +1867,13 @@ public:
     return core->FunctionExists(name);
   }
 
+  // Plugin functions and hosts older than v12 may not expect v12 frames from an Invoke.
+  // A host calls from outside of GetFrame, a runtime Invoke's caller is not known.
+  AVSValue WrapInvokeResult(const AVSValue& result) {
+    return SingleBufferFrames::WrapInvokeResult(result,
+      !IsRuntime() && core->GetHostInterfaceVersion() < 12);
+  }
+
   bool IsRuntime() {
     // When invoked from GetFrame/GetAudio, skip all cache and mt mecanism
     bool is_runtime = true;
@@ -1764,7 +1899,7 @@ public:
     {
       throw NotFound();
     }
-    return result;
+    return WrapInvokeResult(result);
   }
 
   // thrower Invoke, IScriptEnvironment_Avs25
@@ -1790,7 +1925,8 @@ public:
     else if (result.GetType() == AvsValueType::VALUE_TYPE_DOUBLE) // real 64 bit double
       result = result.AsFloatf();
 
-    return result;
+    // frames with planes in a single buffer, like in 2.5
+    return SingleBufferFrames::WrapArgs(result);
   }
 
   // thrower Invoke, IScriptEnvironment_AvsPreV11C
@@ -1819,14 +1955,18 @@ public:
     else if (result.GetType() == AvsValueType::VALUE_TYPE_DOUBLE) // real 64 bit double
       result = result.AsFloatf(); // to 32 bit float
 
-    return result;
+    // nor about v12 frames
+    return SingleBufferFrames::WrapArgs(result);
   }
 
   //  no-throw Invoke, IScriptEnvironment, Ex-IS2
   bool __stdcall InvokeTry(AVSValue* result,
     const char* name, const AVSValue& args, const char* const* arg_names)
   {
-    return core->Invoke_(result, AVSValue(), name, nullptr, args, arg_names, this, IsRuntime());
+    if (!core->Invoke_(result, AVSValue(), name, nullptr, args, arg_names, this, IsRuntime()))
+      return false;
+    *result = WrapInvokeResult(*result);
+    return true;
   }
 
   // thrower Invoke + implicit last, since IS V8
@@ -1840,15 +1980,18 @@ public:
     {
       throw NotFound();
     }
-    return result;
+    return WrapInvokeResult(result);
   }
 
   // no-throw Invoke + implicit last, Ex-INeo
   bool __stdcall Invoke2Try(AVSValue* result, const AVSValue& implicit_last,
     const char* name, const AVSValue args, const char* const* arg_names)
   {
-    return core->Invoke_(result, implicit_last,
-      name, nullptr, args, arg_names, this, IsRuntime());
+    if (!core->Invoke_(result, implicit_last,
+      name, nullptr, args, arg_names, this, IsRuntime()))
+      return false;
+    *result = WrapInvokeResult(*result);
+    return true;
   }
 
   // thrower Invoke + implicit last + PFunction
@@ -1861,22 +2004,28 @@ public:
     {
       throw NotFound();
     }
-    return result;
+    return WrapInvokeResult(result);
   }
 
   // no-throw Invoke + implicit last + PFunction
   bool __stdcall Invoke3Try(AVSValue *result, const AVSValue& implicit_last,
     const PFunction& func, const AVSValue args, const char* const* arg_names)
   {
-    return core->Invoke_(result, implicit_last,
-      func->GetLegacyName(), func->GetDefinition(), args, arg_names, this, IsRuntime());
+    if (!core->Invoke_(result, implicit_last,
+      func->GetLegacyName(), func->GetDefinition(), args, arg_names, this, IsRuntime()))
+      return false;
+    *result = WrapInvokeResult(*result);
+    return true;
   }
 
   // King of all Invoke versions: no-throw Invoke + implicit last + funtion name + function definition
   bool __stdcall Invoke_(AVSValue *result, const AVSValue& implicit_last,
     const char* name, const Function *f, const AVSValue& args, const char* const* arg_names)
   {
-    return core->Invoke_(result, implicit_last, name, f, args, arg_names, this, IsRuntime());
+    if (!core->Invoke_(result, implicit_last, name, f, args, arg_names, this, IsRuntime()))
+      return false;
+    *result = WrapInvokeResult(*result);
+    return true;
   }
 
   bool __stdcall MakeWritable(PVideoFrame* pvf)
@@ -2107,6 +2256,16 @@ public:
     core->SetGraphAnalysis(enable);
   }
 
+  void __stdcall SetProfiler(const char* path)
+  {
+    core->SetProfiler(path);
+  }
+
+  Profiler* __stdcall GetProfiler()
+  {
+    return core->GetProfiler();
+  }
+
   int __stdcall SetMemoryMax(AvsDeviceType type, int index, int mem)
   {
     return core->SetMemoryMax(type, index, mem);
@@ -2182,10 +2341,20 @@ public:
     return core->GetOnDeviceFrame(src, device);
   }
 
+  PVideoFrame __stdcall GetSingleBufferFrame(const PVideoFrame& src)
+  {
+    return core->GetSingleBufferFrame(src);
+  }
 
-  ThreadPool* __stdcall NewThreadPool(size_t nThreads)
+  void __stdcall ClearRuntimeInvokeMemos()
   {
-    return core->NewThreadPool(nThreads);
+    core->ClearRuntimeInvokeMemos();
+  }
+
+
+  ThreadPool* __stdcall NewThreadPool(size_t nThreads, ThreadPoolScheduler scheduler)
+  {
+    return core->NewThreadPool(nThreads, scheduler);
   }
 
 
@@ -2427,6 +2596,7 @@ ScriptEnvironment::ScriptEnvironment()
   thread_pool(NULL),
   plugin_manager(NULL),
   EnvCount(0),
+  HostInterfaceVersion(AVISYNTH_INTERFACE_VERSION),
   PlanarChromaAlignmentState(true),   // Change to "true" for 2.5.7
   hrfromcoinit(E_FAIL), coinitThreadId(0),
   Devices(),
@@ -2601,6 +2771,7 @@ ScriptEnvironment::~ScriptEnvironment() {
   delete thread_pool;
 
   tls->var_table.Clear();
+  tls->invoke_memo.TakeEntries();
   top_frame.Clear();
 
   // There can be a circular reference between the Prefetcher and the
@@ -2615,6 +2786,13 @@ ScriptEnvironment::~ScriptEnvironment() {
   }
   ThreadPoolRegistry.clear();
 
+  // no more GetFrame calls from here
+  if (profiler) {
+    std::string error;
+    if (!profiler->Write(&error))
+      LogMsg(LOGLEVEL_WARNING, "%s", error.c_str());
+  }
+
   // delete ThreadScriptEnvironment
   threadEnv = nullptr;
 
@@ -2641,6 +2819,9 @@ ScriptEnvironment::~ScriptEnvironment() {
   // ListFrameRegistry(0,10000000000000ull, true, device); // list all
 #endif
   // and deleting the frame buffer from FrameRegistry2 as well
+  for (AvsDeviceType type : { DEV_TYPE_CPU, DEV_TYPE_CUDA })
+    for (int i = 0; i < Devices->GetNumDevices(type); ++i)
+      Devices->GetDevice(type, i)->free_list->Clear();
   bool somethingLeaks = false;
   for (auto &it: FrameRegistry2)
   {
@@ -3136,6 +3317,26 @@ size_t  ScriptEnvironment::GetEnvProperty(AvsEnvProperty prop)
     return AVISYNTH_INTERFACE_VERSION;
   case AEP_INTERFACE_BUGFIX:
     return AVISYNTHPLUS_INTERFACE_BUGFIX_VERSION;
+  case AEP_FRAMEPOOL_HITS:
+  case AEP_FRAMEPOOL_MISSES:
+  case AEP_FRAMEPOOL_STEALS:
+  {
+    uint64_t sum = 0;
+    for (AvsDeviceType type : { DEV_TYPE_CPU, DEV_TYPE_CUDA }) {
+      for (int i = 0; i < Devices->GetNumDevices(type); ++i) {
+        const FrameBufferFreeList* free_list = Devices->GetDevice(type, i)->free_list.get();
+        sum += prop == AEP_FRAMEPOOL_HITS ? free_list->hits.load() :
+          prop == AEP_FRAMEPOOL_MISSES ? free_list->misses.load() : free_list->steals.load();
+      }
+    }
+    return (size_t)sum;
+  }
+  case AEP_BUFFERPOOL_HITS:
+    return (size_t)buffer_pool_stats.hits.load();
+  case AEP_BUFFERPOOL_MISSES:
+    return (size_t)buffer_pool_stats.misses.load();
+  case AEP_BUFFERPOOL_RETAINED:
+    return (size_t)buffer_pool_stats.retained_bytes.load();
   default:
     this->ThrowError("Invalid property request.");
     return std::numeric_limits<size_t>::max();
@@ -3161,6 +3362,16 @@ void ScriptEnvironment::AddAutoloadDir(const char* dirPath, bool toFront)
   plugin_manager->AddAutoloadDir(dirPath, toFront);
 }
 
+// A plugin init setting variables cannot be replayed from the manifest
+void ScriptEnvironment::PluginInitSideEffect()
+{
+  // lock free in the usual case, when no plugin is being loaded
+  if (plugin_manager == nullptr || !plugin_manager->IsPluginInitRunning())
+    return;
+  std::unique_lock<std::recursive_mutex> env_lock(plugin_mutex);
+  plugin_manager->PluginInitSideEffect();
+}
+
 void ScriptEnvironment::ClearAutoloadDirs()
 {
   std::unique_lock<std::recursive_mutex> env_lock(plugin_mutex);
@@ -3255,7 +3466,9 @@ VideoFrame* ScriptEnvironment::AllocateFrame(size_t vfb_size, size_t margin, Dev
 
   // automatically inserts keys if they not exist!
   // no locking here, calling method have done it already
-  FrameRegistry2[vfb_size][vfb].push_back(DebugTimestampedFrame(new_frame));
+  VideoFrameArrayType& frames = FrameRegistry2[vfb_size][vfb];
+  frames.push_back(DebugTimestampedFrame(new_frame));
+  vfb->frames = &frames;
 
   //_RPT1(0, "ScriptEnvironment::AllocateFrame %zu frame=%p vfb=%p %" PRIu64 "\n", vfb_size, newFrame, newFrame->vfb, memory_used);
 
@@ -3387,76 +3600,18 @@ VideoFrame* ScriptEnvironment::GetFrameFromRegistry(size_t vfb_size, Device* dev
     for (auto &it2: it->second)
     {
       VFBStorage *vfb = static_cast<VFBStorage*>(it2.first); // same for all map content, the key is vfb pointer
-      if (device == vfb->device && 0 == vfb->refcount) // vfb device and refcount check
+      // vfb device and refcount check. Claiming sets refcount 0->1 atomically,
+      // another thread may take the same buffer from the free list at the same time.
+      if (device == vfb->device && FrameBufferFreeList::Claim(vfb))
       {
-        size_t videoFrameListSize = it2.second.size();
-        // size is more than one if SubFrame was used to create a new frame
-        VideoFrame *frame_found;
-        bool found = false;
-        for (VideoFrameArrayType::iterator it3 = it2.second.begin(), end_it3 = it2.second.end();
-          it3 != end_it3;
-          /* ++it3 not here, because of the delete */)
-        {
-          VideoFrame *frame = it3->frame;
-
-          // sanity check if its refcount is zero
-          // because when a vfb is free (refcount==0) then all its parent frames should also be free
-          assert(0 == frame->refcount);
-
-          // refcount == 0 implies that 'properties' was deleted and nullified
-          // Cannot assume this: assert(nullptr == frame->properties);
-          // An Avisynth 2.5 filter ("baked code" in ancient avisynth.h)
-          // can set VideoFrame's reference count to zero
-          // but it won't delete extra frame data such as .properties
-          if (frame->properties != nullptr) {
-            delete frame->properties;
-            frame->properties = nullptr;
-          }
-
-          if (!found)
-          {
-            InterlockedIncrement(&(frame->vfb->refcount)); // same as &(vfb->refcount)
-            vfb->free_count = 0; // reset free count
-            vfb->Attach(threadEnv->GetCurrentGraphNode());
-#ifdef _DEBUG
-            char buf[256];
-            t_end = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> elapsed_seconds = t_end - t_start;
-            snprintf(buf, 255, "ScriptEnvironment::GetNewFrame NEW METHOD EXACT hit! VideoFrameListSize=%7zu GotSize=%7zu FrReg.Size=%6zu vfb=%p frame=%p SeekTime:%f\n", videoFrameListSize, vfb_size, FrameRegistry2.size(), vfb, frame, elapsed_seconds.count());
-            _RPT0(0, buf);
-            _RPT5(0, "                                          frame %p RowSize=%d Height=%d Pitch=%d Offset=%d\n", frame, frame->GetRowSize(), frame->GetHeight(), frame->GetPitch(), frame->GetOffset());
-#endif
-            frame->properties = new AVSMap();
-            // only 1 frame in list -> no delete
-            if (videoFrameListSize <= 1)
-            {
-              _RPT1(0, "ScriptEnvironment::GetNewFrame returning frame. VideoFrameListSize was 1\n", videoFrameListSize);
 #ifdef _DEBUG
-              it3->timestamp = std::chrono::high_resolution_clock::now(); // refresh timestamp!
+        char buf[256];
+        t_end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed_seconds = t_end - t_start;
+        snprintf(buf, 255, "ScriptEnvironment::GetNewFrame NEW METHOD EXACT hit! VideoFrameListSize=%7zu GotSize=%7zu FrReg.Size=%6zu vfb=%p SeekTime:%f\n", it2.second.size(), vfb_size, FrameRegistry2.size(), vfb, elapsed_seconds.count());
+        _RPT0(0, buf);
 #endif
-              return frame; // return immediately
-            }
-            // more than X: just registered the frame found, and erase all other frames from list plus delete frame objects also
-            frame_found = frame;
-            found = true;
-            ++it3;
-          }
-          else {
-            // if the first frame to this vfb was already found, then we free all others and delete it from the list
-            // Benefit: no 4-5k frame list count per a single vfb.
-            //_RPT4(0, "ScriptEnvironment::GetNewFrame Delete one frame %p RowSize=%d Height=%d Pitch=%d Offset=%d\n", frame, frame->GetRowSize(), frame->GetHeight(), frame->GetPitch(), frame->GetOffset());
-            delete frame;
-            ++it3;
-          }
-        } // for it3
-        if (found)
-        {
-          _RPT1(0, "ScriptEnvironment::GetNewFrame returning frame_found. clearing frames. List count: it2->second.size(): %7zu \n", it2.second.size());
-          it2.second.clear();
-          it2.second.reserve(16); // initial capacity set to 16, avoid reallocation when 1st, 2nd, etc.. elements pushed later (possible speedup)
-          it2.second.push_back(DebugTimestampedFrame(frame_found)); // keep only the first
-          return frame_found;
-        }
+        return RecycleFrameBuffer(vfb);
       }
     } // for it2
   } // for it
@@ -3470,10 +3625,68 @@ VideoFrame* ScriptEnvironment::GetFrameFromRegistry(size_t vfb_size, Device* dev
   return NULL;
 }
 
-VideoFrame* ScriptEnvironment::GetNewFrame(size_t vfb_size, size_t margin, Device* device)
+// vfb is already claimed (refcount is 1) by the caller
+VideoFrame* ScriptEnvironment::RecycleFrameBuffer(VFBStorage* vfb)
 {
-  std::unique_lock<std::recursive_mutex> env_lock(memory_mutex);
+  // size is more than one if SubFrame was used to create a new frame
+  VideoFrameArrayType& frames = *vfb->frames;
+  const size_t videoFrameListSize = frames.size();
+  VideoFrame* frame_found = frames.front().frame;
+
+  for (auto& it3 : frames)
+  {
+    VideoFrame *frame = it3.frame;
+
+    // sanity check if its refcount is zero
+    // because when a vfb is free (refcount==0) then all its parent frames should also be free
+    assert(0 == frame->refcount);
+
+    // refcount == 0 implies that 'properties' was deleted and nullified
+    // Cannot assume this: assert(nullptr == frame->properties);
+    // An Avisynth 2.5 filter ("baked code" in ancient avisynth.h)
+    // can set VideoFrame's reference count to zero
+    // but it won't delete extra frame data such as .properties
+    if (frame->properties != nullptr) {
+      delete frame->properties;
+      frame->properties = nullptr;
+    }
+
+    // Keep only the first frame, free all others.
+    // Benefit: no 4-5k frame list count per a single vfb.
+    if (frame != frame_found)
+      delete frame;
+  }
+
+  vfb->free_count = 0; // reset free count
+  vfb->Attach(threadEnv->GetCurrentGraphNode());
+  frame_found->properties = new AVSMap();
 
+  if (videoFrameListSize <= 1)
+  {
+#ifdef _DEBUG
+    frames.front().timestamp = std::chrono::high_resolution_clock::now(); // refresh timestamp!
+#endif
+    return frame_found;
+  }
+
+  _RPT1(0, "ScriptEnvironment::GetNewFrame returning frame_found. clearing frames. List count: %7zu \n", videoFrameListSize);
+  frames.clear();
+  frames.reserve(16); // initial capacity set to 16, avoid reallocation when 1st, 2nd, etc.. elements pushed later (possible speedup)
+  frames.push_back(DebugTimestampedFrame(frame_found)); // keep only the first
+  return frame_found;
+}
+
+// Lock-free (w.r.t. memory_mutex) reuse of an exactly sized buffer released by VideoFrame::Release
+VideoFrame* ScriptEnvironment::GetFrameFromFreeList(size_t vfb_size, Device* device)
+{
+  VFBStorage* vfb = device->free_list->Pop(vfb_size);
+  if (vfb == nullptr)
+    return nullptr;
+  return RecycleFrameBuffer(vfb);
+}
+
+VideoFrame* ScriptEnvironment::GetNewFrame(size_t vfb_size, size_t margin, Device* device)
+{
   // prevent fragmentation of vfb buffer list many different small-sized vfb's
   if (vfb_size < 64) vfb_size = 64;
   else if (vfb_size < 256) vfb_size = 256;
@@ -3482,11 +3695,25 @@ VideoFrame* ScriptEnvironment::GetNewFrame(size_t vfb_size, size_t margin, Devic
   else if (vfb_size < 2048) vfb_size = 2048;
   else if (vfb_size < 4096) vfb_size = 4096;
 
+  /* -----------------------------------------------------------
+   *   Try the per-thread free lists first, without locking
+   *   (graph memory nodes are not thread safe, skip then)
+   * -----------------------------------------------------------
+   */
+  VideoFrame* frame;
+  if (!graphAnalysisEnable) {
+    frame = GetFrameFromFreeList(vfb_size, device);
+    if (frame != NULL)
+      return frame;
+  }
+
+  std::unique_lock<std::recursive_mutex> env_lock(memory_mutex);
+
   /* -----------------------------------------------------------
    *   Try to return an unused but already allocated instance
    * -----------------------------------------------------------
    */
-  VideoFrame* frame = GetFrameFromRegistry(vfb_size, device);
+  frame = GetFrameFromRegistry(vfb_size, device);
   if (frame != NULL)
     return frame;
 
@@ -3520,7 +3747,7 @@ VideoFrame* ScriptEnvironment::GetNewFrame(size_t vfb_size, size_t margin, Devic
   * Couldn't allocate, shrink cache and get more unused frames
   * -----------------------------------------------------------
   */
-  ShrinkCache(device);
+  ShrinkCache(device, vfb_size);
 
   /* -----------------------------------------------------------
   *   Try to return an unused frame again
@@ -3558,8 +3785,9 @@ VideoFrame* ScriptEnvironment::GetNewFrame(size_t vfb_size, size_t margin, Devic
       /*++it2: not here: may delete iterator position */)
     {
       VFBStorage *vfb = static_cast<VFBStorage*>(it2->first);
-      if (device == vfb->device && 0 == vfb->refcount) // vfb refcount check
+      if (device == vfb->device && FrameBufferFreeList::Claim(vfb)) // vfb refcount check
       {
+        device->free_list->Remove(vfb);
         vfb->device->memory_used -= vfb->GetDataSize(); // frame->vfb->GetDataSize();
         delete vfb;
         for (auto &it3: it2->second)
@@ -3618,7 +3846,29 @@ VideoFrame* ScriptEnvironment::GetNewFrame(size_t vfb_size, size_t margin, Devic
   return NULL;
 }
 
-void ScriptEnvironment::ShrinkCache(Device *device)
+// Non-empty caches of the device, cheapest to recompute (per byte) first.
+// Caches of equal cost stay in least recently used order.
+std::vector<ScriptEnvironment::CacheCost> ScriptEnvironment::ShrinkableCaches(Device* device)
+{
+  std::vector<CacheCost> caches;
+  for (Cache* cache : CacheRegistry)
+  {
+    if (cache->GetDevice() != device)
+      continue;
+    CacheCost c;
+    c.cache = cache;
+    c.size = cache->SetCacheHints(CACHE_GET_SIZE, 0);
+    if (c.size == 0)
+      continue;
+    cache->GetRecomputeCost(&c.seconds_per_mb, &c.frame_bytes);
+    caches.push_back(c);
+  }
+  std::stable_sort(caches.begin(), caches.end(),
+    [](const CacheCost& a, const CacheCost& b) { return a.seconds_per_mb < b.seconds_per_mb; });
+  return caches;
+}
+
+void ScriptEnvironment::ShrinkCache(Device *device, size_t vfb_size)
 {
   /* -----------------------------------------------------------
   *   Shrink cache to keep memory limit
@@ -3626,25 +3876,24 @@ void ScriptEnvironment::ShrinkCache(Device *device)
   */
   int shrinkcount = 0;
 
-  for (auto &cit: CacheRegistry)
-  {
-    // Oh darn. We'd need more memory than we are allowed to use.
-    // Let's reduce the amount of caching.
+  // Oh darn. We'd need more memory than we are allowed to use.
+  // Let's reduce the amount of caching.
 
-    // We try to shrink least recently used caches first.
+  // Take a slot from the caches whose frames are the cheapest to recompute,
+  // until the evicted frames cover the request and the 15% reserve.
+  const double over = (double)device->memory_used + vfb_size - device->memory_max * 0.85;
+  const size_t needed = max(vfb_size, over > 0 ? (size_t)over : (size_t)0);
+  size_t released = 0;
 
-    Cache* cache = cit;
-    if (cache->GetDevice() != device) {
-      continue;
-    }
-    int cache_size = cache->SetCacheHints(CACHE_GET_SIZE, 0);
-    if (cache_size != 0)
-    {
-      _RPT2(0, "ScriptEnvironment::EnsureMemoryLimit shrink cache. cache=%p new size=%d\n", (void*)cache, cache_size - 1);
-      cache->SetCacheHints(CACHE_SET_MAX_CAPACITY, cache_size - 1);
-      shrinkcount++;
-    } // if
-  } // for cit
+  for (const CacheCost& c : ShrinkableCaches(device))
+  {
+    if (shrinkcount != 0 && released >= needed)
+      break;
+    _RPT2(0, "ScriptEnvironment::EnsureMemoryLimit shrink cache. cache=%p new size=%d\n", (void*)c.cache, c.size - 1);
+    c.cache->SetCacheHints(CACHE_SET_MAX_CAPACITY, c.size - 1);
+    released += c.frame_bytes;
+    shrinkcount++;
+  } // for c
 
   if (shrinkcount != 0)
   {
@@ -3671,8 +3920,10 @@ void ScriptEnvironment::ShrinkCache(Device *device)
       {
         VFBStorage *vfb = static_cast<VFBStorage*>(it2->first);
         // vfb device and refcount check and free count exceeds the threshold
-        if (device == vfb->device && 0 == vfb->refcount && vfb->free_count++ >= device->free_thresh)
+        if (device == vfb->device && 0 == vfb->refcount && vfb->free_count++ >= device->free_thresh
+          && FrameBufferFreeList::Claim(vfb))
         {
+          device->free_list->Remove(vfb);
 #if 0
           static int counter = 0;
           char buf[200]; sprintf(buf, "Free frame !!! %d\r\n", counter++);
@@ -3978,6 +4229,11 @@ bool ScriptEnvironment::MakeWritable(PVideoFrame* pvf) {
   // Otherwise, allocate a new frame (using NewVideoFrame) and
   // copy the data into it.  Then modify the passed PVideoFrame
   // to point to the new buffer.
+  *pvf = CopyVideoFrame(vf);
+  return true;
+}
+
+PVideoFrame ScriptEnvironment::CopyVideoFrame(const PVideoFrame& vf) {
   Device* device = vf->GetFrameBuffer()->device;
   PVideoFrame dst;
 
@@ -4016,8 +4272,7 @@ bool ScriptEnvironment::MakeWritable(PVideoFrame* pvf) {
 
   copyFrameProps(vf, dst);
 
-  *pvf = dst;
-  return true;
+  return dst;
 }
 
 
@@ -4037,14 +4292,16 @@ PVideoFrame ScriptEnvironment::Subframe(PVideoFrame src, int rel_offset, int new
   if (propNumKeys(&avsmap) > 0)
     subframe->setProperties(src->getConstProperties());
 
-  size_t vfb_size = src->GetFrameBuffer()->GetDataSize();
+  // the Y plane may be shared from another buffer
+  VideoFrameBuffer* vfb = subframe->GetFrameBuffer();
+  size_t vfb_size = vfb->GetDataSize();
 
   // vector and maps needs locking
   std::unique_lock<std::recursive_mutex> env_lock(memory_mutex);
   assert(NULL != subframe);
 
   // automatically inserts if not exists
-  FrameRegistry2[vfb_size][src->GetFrameBuffer()].push_back(DebugTimestampedFrame(subframe));
+  FrameRegistry2[vfb_size][vfb].push_back(DebugTimestampedFrame(subframe));
 
   return subframe;
 }
@@ -4099,6 +4356,156 @@ PVideoFrame ScriptEnvironment::SubframePlanar(PVideoFrame src, int rel_offset, i
   return subframe;
 }
 
+// Planes not given are allocated in a new buffer, the others stay where they are:
+// the frame holds a reference to their buffers, like a Subframe does.
+PVideoFrame ScriptEnvironment::NewVideoFrameFromPlanes(const VideoInfo& vi, const PVideoFrame* src_frames, const int* src_planes, const PVideoFrame* prop_src)
+{
+  static const int planesYUVA[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+  static const int planesRGBA[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
+  const int* planes = (vi.IsPlanarRGB() || vi.IsPlanarRGBA()) ? planesRGBA : planesYUVA;
+  const int planecount = vi.IsPlanar() ? vi.NumComponents() : 1;
+
+  int row_sizes[4], heights[4], pitches[4], offsets[4];
+  VideoFrameBuffer* buffers[4] = {};
+  bool copy_plane[4] = {};
+  size_t plane_sizes[4] = {};
+  size_t size = 0;
+
+  for (int i = 0; i < planecount; i++) {
+    const int plane = planecount == 1 ? DEFAULT_PLANE : planes[i];
+    row_sizes[i] = vi.RowSize(plane);
+    heights[i] = planecount == 1 ? vi.height : vi.height >> vi.GetPlaneHeightSubsampling(plane);
+    if (!src_frames[i])
+      continue;
+    const PVideoFrame& src = src_frames[i];
+    if (src->GetRowSize(src_planes[i]) != row_sizes[i] || src->GetHeight(src_planes[i]) != heights[i])
+      ThrowError("NewVideoFrameFromPlanes: source plane size does not match, plane %d", i);
+    if (src->GetFrameBuffer()->device->device_type != DEV_TYPE_CPU)
+      ThrowError("NewVideoFrameFromPlanes: only CPU frames are supported");
+    if (src->GetPitch(src_planes[i]) < 0) {
+      // flipped view, the new frame gets a normal copy
+      copy_plane[i] = true;
+      continue;
+    }
+    buffers[i] = src->GetPlaneFrameBuffer(src_planes[i]);
+    offsets[i] = src->GetOffset(src_planes[i]);
+    pitches[i] = src->GetPitch(src_planes[i]);
+  }
+
+  // The chroma planes have a common pitch, and alpha has the pitch of the first plane
+  // (Subframe keeps them together). A second one with a different pitch is copied.
+  static const int pitch_partner[4] = { 3, 2, 1, 0 };
+  for (int i = 2; i < planecount; i++) {
+    const int partner = pitch_partner[i];
+    if (buffers[i] && buffers[partner] && pitches[i] != pitches[partner]) {
+      buffers[i] = nullptr;
+      copy_plane[i] = true;
+    }
+  }
+
+  for (int i = 0; i < planecount; i++) {
+    if (buffers[i])
+      continue;
+    const int partner = pitch_partner[i];
+    if (partner < planecount && buffers[partner])
+      pitches[i] = pitches[partner];
+    else
+      pitches[i] = AlignNumber(row_sizes[i], frame_align);
+    plane_sizes[i] = AlignNumber((size_t)pitches[i] * heights[i], (size_t)plane_align);
+    size += plane_sizes[i];
+  }
+
+  VideoFrame* res;
+  if (size > 0) {
+    res = GetNewFrame(size, frame_align - 1, Devices->GetCPUDevice());
+    int offset = (int)(AlignPointer(res->vfb->GetWritePtr(), frame_align) - res->vfb->GetWritePtr()); // first line offset for proper alignment
+    for (int i = 0; i < planecount; i++) {
+      if (buffers[i])
+        continue;
+      offsets[i] = offset;
+      offset += (int)plane_sizes[i];
+    }
+  }
+  else {
+    // every plane is shared, the frame lives on the buffer of the first one
+    res = new VideoFrame(buffers[0], new AVSMap(), 0, 0, 0, 0, vi.pixel_type);
+    std::unique_lock<std::recursive_mutex> env_lock(memory_mutex);
+    FrameRegistry2[buffers[0]->GetDataSize()][buffers[0]].push_back(DebugTimestampedFrame(res));
+  }
+
+  res->offset = offsets[0];
+  res->pitch = pitches[0];
+  res->row_size = row_sizes[0];
+  res->height = heights[0];
+  if (planecount >= 3) {
+    res->offsetU = offsets[1];
+    res->offsetV = offsets[2];
+    res->pitchUV = pitches[1];
+    res->row_sizeUV = row_sizes[1];
+    res->heightUV = heights[1];
+  }
+  else {
+    res->offsetU = res->offsetV = offsets[0];
+    res->pitchUV = res->row_sizeUV = res->heightUV = 0;
+  }
+  if (planecount == 4) {
+    res->offsetA = offsets[3];
+    res->pitchA = pitches[3];
+    res->row_sizeA = row_sizes[3];
+  }
+  else {
+    res->offsetA = res->pitchA = res->row_sizeA = 0;
+  }
+  res->pixel_type = vi.pixel_type;
+
+  for (int i = 0; i < planecount; i++)
+    if (buffers[i])
+      res->SharePlane(planes[i], buffers[i]);
+
+  PVideoFrame result(res);
+  for (int i = 0; i < planecount; i++)
+    if (copy_plane[i])
+      BitBlt(result->GetWritePtr(planes[i]), result->GetPitch(planes[i]), src_frames[i]->GetReadPtr(src_planes[i]),
+        src_frames[i]->GetPitch(src_planes[i]), row_sizes[i], heights[i]);
+
+  if (prop_src)
+    copyFrameProps(*prop_src, result);
+
+  return result;
+}
+
+void ScriptEnvironment::RegisterInvokeMemo(RuntimeInvokeMemo* memo)
+{
+  std::lock_guard<std::mutex> lock(invoke_memos_mutex);
+  invoke_memos.push_back(memo);
+}
+
+void ScriptEnvironment::UnregisterInvokeMemo(RuntimeInvokeMemo* memo)
+{
+  std::lock_guard<std::mutex> lock(invoke_memos_mutex);
+  invoke_memos.erase(std::remove(invoke_memos.begin(), invoke_memos.end(), memo), invoke_memos.end());
+}
+
+void ScriptEnvironment::ClearRuntimeInvokeMemos()
+{
+  std::vector<RuntimeInvokeMemo::Entry> taken;
+  {
+    std::lock_guard<std::mutex> lock(invoke_memos_mutex);
+    for (auto memo : invoke_memos) {
+      auto entries = memo->TakeEntries();
+      std::move(entries.begin(), entries.end(), std::back_inserter(taken));
+    }
+  }
+  // clips released here
+}
+
+// For code that finds the planes from the frame buffer, like AVS 2.5 plugins and device transfers,
+// these may not expect negative pitch either
+PVideoFrame ScriptEnvironment::GetSingleBufferFrame(const PVideoFrame& src)
+{
+  return (src->HasSharedPlanes() || src->HasNegativePitch()) ? CopyVideoFrame(src) : src;
+}
+
 void* ScriptEnvironment::ManageCache(int key, void* data) {
 // An extensible interface for providing system or user access to the
 // ScriptEnvironment class without extending the IScriptEnvironment
@@ -4151,20 +4558,15 @@ void* ScriptEnvironment::ManageCache(int key, void* data) {
     if ((device->memory_used > device->memory_max) || (device->memory_max - device->memory_used < device->memory_max*0.1f))
     {
       // If we don't have enough free reserves, take away a cache slot from
-      // a cache instance that hasn't been used since long.
+      // the cache instance whose frames are the cheapest to recompute.
 
-      for (Cache* old_cache : CacheRegistry)
+      for (const CacheCost& c : ShrinkableCaches(device))
       {
-        if (old_cache->GetDevice() != device) {
+        if (c.cache == cache)
           continue;
-        }
-        int osize = cache->SetCacheHints(CACHE_GET_SIZE, 0);
-        if (osize != 0)
-        {
-          old_cache->SetCacheHints(CACHE_SET_MAX_CAPACITY, osize - 1);
-          break;
-        }
-      } // for cit
+        c.cache->SetCacheHints(CACHE_SET_MAX_CAPACITY, c.size - 1);
+        break;
+      } // for c
     }
 #ifdef _DEBUG
     _RPT2(0, "ScriptEnvironment::ManageCache increase capacity to %d cache_id=%s\n", cache_cap + 1, cache->FuncName.c_str());
@@ -4289,6 +4691,19 @@ static size_t Flatten(const AVSValue& src, AVSValue* dst, size_t index, int leve
   return index;
 }
 
+// Built-in functions by name, in the order of builtin_functions
+static const FunctionMap& BuiltinFunctionMap()
+{
+  static const FunctionMap map = [] {
+    FunctionMap m;
+    for (int i = 0; i < sizeof(builtin_functions) / sizeof(builtin_functions[0]); ++i)
+      for (const AVSFunction* j = builtin_functions[i]; !j->empty(); ++j)
+        m[j->name].push_back(j);
+    return m;
+  }();
+  return map;
+}
+
 const Function* ScriptEnvironment::Lookup(const char* search_name, const AVSValue* args, size_t num_args,
   bool& pstrict, size_t args_names_count, const char* const* arg_names, IScriptEnvironment2* ctx)
 {
@@ -4310,7 +4725,15 @@ const Function* ScriptEnvironment::Lookup(const char* search_name, const AVSValu
     }
   }
 
-  std::unique_lock<std::recursive_mutex> env_lock(plugin_mutex);
+  // Runtime scripts look up functions on every frame from all worker threads,
+  // so this is done on a snapshot of the function tables, without locking.
+  const FunctionTable* table = plugin_manager->GetFunctionTable();
+  if (!table) {
+    std::unique_lock<std::recursive_mutex> env_lock(plugin_mutex);
+    table = plugin_manager->UpdateFunctionTable();
+  }
+  const FunctionMap& builtins = BuiltinFunctionMap();
+  const FunctionMap::const_iterator builtin_it = builtins.find(search_name);
 
   const Function *result = NULL;
 
@@ -4323,19 +4746,27 @@ const Function* ScriptEnvironment::Lookup(const char* search_name, const AVSValu
     for (int strict = 1; strict >= 0; --strict) {
       pstrict = strict & 1;
       // first, look in loaded plugins or user defined functions
-      result = plugin_manager->Lookup(search_name, args, num_args, pstrict, args_names_count, arg_names);
-      if (result)
-        return result;
+      const AVSFunction* plugin_func = plugin_manager->Lookup(*table, search_name, args, num_args, pstrict, args_names_count, arg_names);
+      if (plugin_func && plugin_manager->IsLazyFunction(plugin_func))
+      {
+        // Autoloaded plugin known from the manifest only: load it now and look up the real function
+        {
+          std::unique_lock<std::recursive_mutex> env_lock(plugin_mutex);
+          plugin_manager->LoadLazyPlugin(plugin_func);
+        }
+        args_names_count = orig_args_names_count;
+        return Lookup(search_name, args, num_args, pstrict, args_names_count, arg_names, ctx);
+      }
+      if (plugin_func)
+        return plugin_func;
 
       // then, look for a built-in function
-      for (int i = 0; i < sizeof(builtin_functions)/sizeof(builtin_functions[0]); ++i)
-        for (const AVSFunction* j = builtin_functions[i]; !j->empty(); ++j)
+      if (builtin_it != builtins.end())
+        for (const AVSFunction* j : builtin_it->second)
         {
-          if (streqi(j->name, search_name)) {
-            if (AVSFunction::TypeMatch(j->param_types, args, num_args, pstrict, ctx) &&
-              AVSFunction::ArgNameMatch(j->param_types, args_names_count, arg_names))
-              return j;
-          }
+          if (AVSFunction::TypeMatch(j->param_types, args, num_args, pstrict, ctx) &&
+            AVSFunction::ArgNameMatch(j->param_types, args_names_count, arg_names))
+            return j;
         }
     }
     // Try again without arg name matching
@@ -4346,9 +4777,17 @@ const Function* ScriptEnvironment::Lookup(const char* search_name, const AVSValu
   // If we got here it means the function has not been found.
   // If we haven't done so yet, load the plugins in the autoload folders
   // and try again.
-  if (!plugin_manager->HasAutoloadExecuted())
+  bool autoloaded = false;
+  {
+    std::unique_lock<std::recursive_mutex> env_lock(plugin_mutex);
+    if (!plugin_manager->HasAutoloadExecuted())
+    {
+      plugin_manager->AutoloadPlugins();
+      autoloaded = true;
+    }
+  }
+  if (autoloaded)
   {
-    plugin_manager->AutoloadPlugins();
     args_names_count = orig_args_names_count;
     return Lookup(search_name, args, num_args, pstrict, args_names_count, arg_names, ctx);
   }
@@ -4783,12 +5222,51 @@ bool ScriptEnvironment::Invoke_(AVSValue *result, const AVSValue& implicit_last,
     // Invoked by a thread or GetFrame
     AVSValue funcArgs(args3.data(), (int)args3.size());
 
-    if (f->isPluginAvs25) // like GRunT's AverageLuma wrapper
-      *result = f->apply(funcArgs, f->user_data, (IScriptEnvironment*)((IScriptEnvironment_Avs25*)env_thread));
-    else if (f->isPluginPreV11C)
-      *result = f->apply(funcArgs, f->user_data, (IScriptEnvironment*)((IScriptEnvironment_AvsPreV11C*)env_thread));
-    else
+    // Filters (clip in, clip out) are taken from the memo of this thread if
+    // they were made with the same arguments before. Not script functions,
+    // they may depend on variables.
+    // Only calls with a clip among the top-level arguments are memoized; clips
+    // inside array arguments (e.g. Apply's "s.*") do not count, such calls
+    // are constructed on each frame.
+    RuntimeInvokeMemo* memo = nullptr;
+    uint64_t memo_hash = 0;
+    if (!AVSFunction::IsScriptFunction(f) &&
+      std::any_of(args3.begin(), args3.end(), [](const AVSValue& v) { return v.IsClip(); }))
+    {
+#ifdef XP_TLS
+      ScriptEnvironmentTLS* tls = (ScriptEnvironmentTLS*)(TlsGetValue(dwTlsIndex));
+#else
+      ScriptEnvironmentTLS* tls = g_TLS;
+#endif
+      memo = &(tls != nullptr ? tls : threadEnv->GetTLS())->invoke_memo;
+      memo_hash = RuntimeInvokeMemo::Hash(f, funcArgs);
+      if (memo->Find(f, memo_hash, funcArgs, result))
+        return true;
+    }
+
+    if (f->isPluginAvs25) { // like GRunT's AverageLuma wrapper
+      SingleBufferFrames::ApplyScope scope(f, nullptr);
+      *result = f->apply(SingleBufferFrames::WrapArgs(funcArgs), f->user_data, (IScriptEnvironment*)((IScriptEnvironment_Avs25*)env_thread));
+    }
+    else if (f->isPluginPreV11C) {
+      SingleBufferFrames::ApplyScope scope(f, nullptr);
+      *result = f->apply(SingleBufferFrames::WrapArgs(funcArgs), f->user_data, (IScriptEnvironment*)((IScriptEnvironment_AvsPreV11C*)env_thread));
+    }
+    else if (SingleBufferFrames::IsNeededFor(f)) {
+      std::vector<SingleBufferFrames*> wrappers;
+      {
+        SingleBufferFrames::ApplyScope scope(f, &wrappers);
+        *result = f->apply(SingleBufferFrames::WrapArgs(funcArgs, &wrappers), f->user_data, env_thread);
+      }
+      SingleBufferFrames::CheckResult(f, *result, wrappers);
+    }
+    else {
+      SingleBufferFrames::ApplyScope scope(f, nullptr);
       *result = f->apply(funcArgs, f->user_data, env_thread);
+    }
+
+    if (memo != nullptr && result->IsClip())
+      memo->Add(f, memo_hash, funcArgs, *result);
     return true;
   }
 
@@ -5045,6 +5523,8 @@ bool ScriptEnvironment::Invoke_(AVSValue *result, const AVSValue& implicit_last,
 bool ScriptEnvironment::FunctionExists(const char* name)
 {
   std::unique_lock<std::recursive_mutex> env_lock(plugin_mutex);
+  // the answer may be different when the plugin is loaded from the manifest
+  plugin_manager->PluginInitSideEffect();
 
   // Look among variable table
   AVSValue result;
@@ -5600,11 +6080,11 @@ PVideoFrame ScriptEnvironment::GetOnDeviceFrame(const PVideoFrame& src, Device*
 }
 
 
-ThreadPool* ScriptEnvironment::NewThreadPool(size_t nThreads)
+ThreadPool* ScriptEnvironment::NewThreadPool(size_t nThreads, ThreadPoolScheduler scheduler)
 {
   // Creates threads with threadIDs (which envI->GetThreadId() is returning) starting from 
   // (nTotalThreads+0) to (nTotalThreads+nThreads-1)
-  ThreadPool* pool = new ThreadPool(nThreads, nTotalThreads, threadEnv.get());
+  ThreadPool* pool = new ThreadPool(nThreads, nTotalThreads, threadEnv.get(), scheduler);
   ThreadPoolRegistry.emplace_back(pool);
 
   nTotalThreads += nThreads;
@@ -5694,6 +6174,16 @@ ThreadPool* ScriptEnvironment::NewThreadPool(size_t nThreads)
   return pool;
 }
 
+void ScriptEnvironment::SetProfiler(const char* path)
+{
+  // profiling is done in FilterGraphNode, so graph analysis is needed
+  if (profiler)
+    profiler->SetPath(path);
+  else
+    profiler = std::unique_ptr<Profiler>(new Profiler(path));
+  graphAnalysisEnable = true;
+}
+
 void ScriptEnvironment::SetDeviceOpt(DeviceOpt opt, int val)
 {
   Devices->SetDeviceOpt(opt, val, threadEnv.get());
@@ -5765,22 +6255,26 @@ IScriptEnvironment2* CreateScriptEnvironment2_internal(int version, bool fromAvs
   _putenv("OMP_WAIT_POLICY=passive");
 #endif
 
+  if (version > AVISYNTH_INTERFACE_VERSION)
+    return NULL;
+
+  ScriptEnvironment* core = new ScriptEnvironment();
+  // clips are handed to hosts before v12 with single buffer frames; the C interface is at v11
+  core->SetHostInterfaceVersion(fromC ? std::min(version, 11) : version);
+
   // When a CPP plugin explicitely requests avs2.5 interface
   if (fromAvs25) {
-    auto IEnv25 = (new ScriptEnvironment())->GetMainThreadEnv()->GetEnv25();
+    auto IEnv25 = core->GetMainThreadEnv()->GetEnv25();
     // return a disguised IScriptEnvironment_Avs25
     return reinterpret_cast<IScriptEnvironment2*>(IEnv25);
   }
   else if (fromC && version < 11) {
     // V11 supports 64 bit data types; no difference in IScriptEnvironment
-    auto IEnvPreV11C = (new ScriptEnvironment())->GetMainThreadEnv()->GetEnvPreV11C();
+    auto IEnvPreV11C = core->GetMainThreadEnv()->GetEnvPreV11C();
     // return a disguised IScriptEnvironment_AvsC
     return reinterpret_cast<IScriptEnvironment2*>(IEnvPreV11C);
   }
-  else if (version <= AVISYNTH_INTERFACE_VERSION)
-    return (new ScriptEnvironment())->GetMainThreadEnv();
-  else
-    return NULL;
+  return core->GetMainThreadEnv();
 }
 
 AVSC_API(IScriptEnvironment2*, CreateScriptEnvironment2)(int version)
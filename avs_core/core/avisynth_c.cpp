@@ -11,6 +11,7 @@
 #include <avisynth_c.h>
 #include "AVSMap.h"
 #include "internal.h"
+#include "InternalEnvironment.h"
 
 #ifdef AVS_WINDOWS
 #include <avs/win.h>
@@ -863,7 +864,8 @@ AVS_VideoFrame * AVSC_CC avs_get_frame(AVS_Clip * p, int n)
 {
   p->error = 0;
   try {
-    PVideoFrame f0 = p->clip->GetFrame(n, p->env);
+    // the C interface has no v12 frame features (planes in other buffers, negative pitch)
+    PVideoFrame f0 = GetAndRevealCamouflagedEnv(p->env)->GetSingleBufferFrame(p->clip->GetFrame(n, p->env));
     AVS_VideoFrame* f;
     new((PVideoFrame*)&f) PVideoFrame(f0);
     return f;
@@ -37,6 +37,7 @@
 #include "LruCache.h"
 #include "InternalEnvironment.h"
 #include "DeviceManager.h"
+#include "Profiler.h"
 #include <cassert>
 #include <chrono>
 #include <cstdio>
@@ -73,6 +74,36 @@ public:
   }
 };
 
+static thread_local FrameDependencyCollector* tls_dependency_collector = nullptr;
+
+FrameDependencyCollector::FrameDependencyCollector() :
+  prev(tls_dependency_collector)
+{
+  tls_dependency_collector = this;
+}
+
+FrameDependencyCollector::~FrameDependencyCollector()
+{
+  tls_dependency_collector = prev;
+}
+
+bool FrameDependencyCollector::Add(IClip* cache, int n)
+{
+  FrameDependencyCollector* collector = tls_dependency_collector;
+  if (collector == nullptr)
+    return false;
+  const int num_frames = cache->GetVideoInfo().num_frames;
+  if (num_frames <= 0)
+    return false;
+  n = clamp(n, 0, num_frames - 1);
+  for (const Dependency& d : collector->frames) {
+    if (d.n == n && (IClip*)(void*)d.cache == cache)
+      return true;
+  }
+  collector->frames.push_back(Dependency{ cache, n });
+  return true;
+}
+
 struct CachePimpl
 {
   PClip child;
@@ -205,14 +236,17 @@ PVideoFrame __stdcall Cache::GetFrame(int n, IScriptEnvironment* env_)
   {
   case LRU_LOOKUP_NOT_FOUND:
     {
+      Profiler::OnCacheLookup(false);
       try
       {
 #ifdef _DEBUG
         snprintf(buf.get(), BUFSIZE, "Cache::GetFrame LRU_LOOKUP_NOT_FOUND: [%s] n=%6d child=%p\n", name.c_str(), n, (void*)_pimpl->child); // P.F.
         _RPT0(0, buf.get());
 #endif
+        const auto t_produce = std::chrono::steady_clock::now();
         //cache_handle.first->value = _pimpl->child->GetFrame(n, env);
         result = _pimpl->child->GetFrame(n, env); // P.F. fill result immediately
+        const std::chrono::duration<double> produce_seconds = std::chrono::steady_clock::now() - t_produce;
 
         // check device
         if (result->GetFrameBuffer()->device != device) {
@@ -226,7 +260,7 @@ PVideoFrame __stdcall Cache::GetFrame(int n, IScriptEnvironment* env_)
   #ifdef X86_32
         _mm_empty();
   #endif
-        _pimpl->VideoCache->commit_value(&cache_handle);
+        _pimpl->VideoCache->commit_value(&cache_handle, produce_seconds.count(), result->GetFrameBuffer()->GetDataSize());
       }
       catch (...)
       {
@@ -252,6 +286,7 @@ PVideoFrame __stdcall Cache::GetFrame(int n, IScriptEnvironment* env_)
     }
   case LRU_LOOKUP_FOUND_AND_READY:
     {
+      Profiler::OnCacheLookup(true);
       // theoretically cache_handle here may point to wrong entry,
       // because the lock in lookup is released before this readout
       // solution:
@@ -269,6 +304,7 @@ PVideoFrame __stdcall Cache::GetFrame(int n, IScriptEnvironment* env_)
     }
   case LRU_LOOKUP_NO_CACHE:
     {
+    Profiler::OnCacheLookup(false);
 #ifdef _DEBUG
     snprintf(buf.get(), BUFSIZE, "Cache::GetFrame <Before GetFrame> LRU_LOOKUP_NO_CACHE: [%s] n=%6d child=%p\n", name.c_str(), n, (void*)_pimpl->child); // P.F.
     _RPT0(0, buf.get());
@@ -293,6 +329,14 @@ PVideoFrame __stdcall Cache::GetFrame(int n, IScriptEnvironment* env_)
   return result;
 }
 
+void Cache::GetRecomputeCost(double* seconds_per_mb, size_t* frame_bytes) const
+{
+  double seconds, bytes;
+  _pimpl->VideoCache->cost_stats(&seconds, &bytes);
+  *seconds_per_mb = bytes > 0 ? seconds * (1024.0 * 1024.0) / bytes : 0.0;
+  *frame_bytes = (size_t)bytes;
+}
+
 void Cache::FillAudioZeros(void* buf, size_t start_offset, size_t count) {
     const int bps = _pimpl->vi.BytesPerAudioSample();
     unsigned char* byte_buf = (unsigned char*)buf;
@@ -471,6 +515,16 @@ int __stdcall Cache::SetCacheHints(int cachehints, int frame_range)
     case CACHE_GET_MTMODE:
       return MT_NICE_FILTER;
 
+    /*********************************************
+        PREFETCH
+    *********************************************/
+
+    case CACHE_GET_FRAME_DEPENDENCIES:
+      return (_pimpl->child->GetVersion() >= 5) ? _pimpl->child->SetCacheHints(cachehints, frame_range) : 0;
+
+    case CACHE_WILL_NEED_FRAME:
+      return FrameDependencyCollector::Add(this, frame_range) ? 1 : 0;
+
     /*********************************************
         VIDEO
     *********************************************/
@@ -722,6 +776,16 @@ int __stdcall CacheGuard::SetCacheHints(int cachehints, int frame_range)
   case CACHE_GET_MTMODE:
     return MT_NICE_FILTER;
 
+    /*********************************************
+    PREFETCH
+    *********************************************/
+
+  case CACHE_GET_FRAME_DEPENDENCIES:
+    return (child->GetVersion() >= 5) ? child->SetCacheHints(cachehints, frame_range) : 0;
+
+  case CACHE_WILL_NEED_FRAME:
+    return FrameDependencyCollector::Add(this, frame_range) ? 1 : 0;
+
     /*********************************************
     AVS 2.5 TRANSLATION
     *********************************************/
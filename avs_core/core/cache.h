@@ -67,12 +67,37 @@ public:
   int __stdcall SetCacheHints(int cachehints,int frame_range);
 
   Device* GetDevice() const { return device; }
+  // Average time (seconds) it takes the child to produce one MB of frame data
+  // and the average frame size. Used for choosing which caches to shrink.
+  void GetRecomputeCost(double* seconds_per_mb, size_t* frame_bytes) const;
 
   static AVSValue __cdecl Create(AVSValue args, void*, IScriptEnvironment* env);
   static bool __stdcall IsCache(const PClip& c);
 
 };
 
+// Collects the frames announced with CACHE_WILL_NEED_FRAME to the caches on
+// this thread while it is alive, see CACHE_GET_FRAME_DEPENDENCIES.
+class FrameDependencyCollector
+{
+public:
+  struct Dependency {
+    PClip cache;
+    int n;
+  };
+
+  std::vector<Dependency> frames;
+
+  FrameDependencyCollector();
+  ~FrameDependencyCollector();
+
+  // Called by the caches, returns false if no collector is active
+  static bool Add(IClip* cache, int n);
+
+private:
+  FrameDependencyCollector* prev;
+};
+
 class CacheGuard : public IClip
 {
 private:
@@ -56,6 +56,7 @@
 #endif
 #include "InternalEnvironment.h"
 #include "DeviceManager.h"
+#include "FrameRegistry.h"
 #include "AVSMap.h"
 #include "function.h"
 #include "assert.h"
@@ -441,7 +442,10 @@ const BYTE* VideoFrameBuffer::GetReadPtr() const { return data; }
 /* Baked ********************
 BYTE* VideoFrameBuffer::GetWritePtr() { ++sequence_number; return data; }
    Baked ********************/
-BYTE* VideoFrameBuffer::GetWritePtr() { InterlockedIncrement(&sequence_number); return data; }
+// Sequence numbers are drawn from one process-wide counter, so (buffer, sequence number)
+// identifies the content of a frame even across buffer reuse and reallocation.
+static volatile long vfb_sequence_counter = 0;
+BYTE* VideoFrameBuffer::GetWritePtr() { sequence_number = InterlockedIncrement(&vfb_sequence_counter); return data; }
 int VideoFrameBuffer::GetDataSize() const { return data_size; }
 int VideoFrameBuffer::GetSequenceNumber() const { return sequence_number; }
 int VideoFrameBuffer::GetRefcount() const { return refcount; }
@@ -500,6 +504,15 @@ BYTE* VideoFrame::GetWritePtr() const {
 }
    Baked ********************/
 
+void VideoFrame::ReleaseFrameBuffer(VideoFrameBuffer* vfb)
+{
+  // Last frame on this buffer: offer it to the free list while we still
+  // hold the reference, so nobody can delete it in the meantime.
+  if (vfb->refcount == 1 && vfb->device != nullptr)
+    vfb->device->free_list->Push(static_cast<VFBStorage*>(vfb));
+  InterlockedDecrement(&vfb->refcount);
+}
+
 void VideoFrame::AddRef() { InterlockedIncrement(&refcount); }
 void VideoFrame::Release() {
   VideoFrameBuffer* _vfb = vfb;
@@ -509,10 +522,67 @@ void VideoFrame::Release() {
       delete properties; // if needed, frame registry will re-create
       properties = nullptr;
     }
-    InterlockedDecrement(&_vfb->refcount);
+    for (int i = 0; i < 4; i++)
+      if (IsFirstShare(i))
+        ReleaseFrameBuffer(plane_vfb[i]);
+    for (int i = 0; i < 4; i++)
+      plane_vfb[i] = nullptr;
+    ReleaseFrameBuffer(_vfb);
   }
 }
 
+int VideoFrame::PlaneIndex(int plane) {
+  switch (plane) {
+  case PLANAR_U: case PLANAR_B: return 1;
+  case PLANAR_V: case PLANAR_R: return 2;
+  case PLANAR_A: return 3;
+  default: return 0; // PLANAR Y, PLANAR_G
+  };
+}
+
+// A frame holds one reference on each buffer it shares planes from
+bool VideoFrame::IsFirstShare(int index) const {
+  if (plane_vfb[index] == nullptr)
+    return false;
+  for (int i = 0; i < index; i++)
+    if (plane_vfb[i] == plane_vfb[index])
+      return false;
+  return true;
+}
+
+VideoFrameBuffer* VideoFrame::GetPlaneFrameBuffer(int plane) const {
+  VideoFrameBuffer* plane_buffer = plane_vfb[PlaneIndex(plane)];
+  return plane_buffer ? plane_buffer : vfb;
+}
+
+bool VideoFrame::HasSharedPlanes() const {
+  return plane_vfb[0] || plane_vfb[1] || plane_vfb[2] || plane_vfb[3];
+}
+
+bool VideoFrame::HasNegativePitch() const {
+  return pitch < 0 || pitchUV < 0 || pitchA < 0;
+}
+
+void VideoFrame::SharePlane(int plane, VideoFrameBuffer* plane_buffer) {
+  const int index = PlaneIndex(plane);
+  assert(plane_vfb[index] == nullptr);
+  if (plane_buffer == vfb)
+    return;
+  if (std::find(plane_vfb, plane_vfb + 4, plane_buffer) == plane_vfb + 4)
+    InterlockedIncrement(&plane_buffer->refcount);
+  plane_vfb[index] = plane_buffer;
+}
+
+// Subframes keep the planes where they are
+void VideoFrame::InheritSharedPlanes(VideoFrame* dst, int plane_count) const {
+  for (int i = 0; i < plane_count; i++)
+    if (plane_vfb[i] != nullptr) {
+      dst->plane_vfb[i] = plane_vfb[i];
+      if (dst->IsFirstShare(i))
+        InterlockedIncrement(&plane_vfb[i]->refcount);
+    }
+}
+
 int VideoFrame::GetPitch(int plane) const { switch (plane) { case PLANAR_U: case PLANAR_V: return pitchUV; case PLANAR_A: return pitchA; } return pitch; }
 
 int VideoFrame::GetRowSize(int plane) const {
@@ -570,14 +640,22 @@ int VideoFrame::GetOffset(int plane) const {
     };
 }
 
-const BYTE* VideoFrame::GetReadPtr(int plane) const { return vfb->GetReadPtr() + GetOffset(plane); }
+const BYTE* VideoFrame::GetReadPtr(int plane) const { return GetPlaneFrameBuffer(plane)->GetReadPtr() + GetOffset(plane); }
 
 bool VideoFrame::IsWritable() const {
-  if (refcount == 1 && vfb->refcount == 1) {
-    vfb->GetWritePtr(); // Bump sequence number
-    return true;
-  }
-  return false;
+  if (refcount != 1 || vfb->refcount != 1)
+    return false;
+  // Views with negative pitch are read-only: in-place code may expect increasing line addresses
+  if (HasNegativePitch())
+    return false;
+  for (int i = 0; i < 4; i++)
+    if (plane_vfb[i] != nullptr && plane_vfb[i]->refcount != 1)
+      return false;
+  vfb->GetWritePtr(); // Bump sequence number
+  for (int i = 0; i < 4; i++)
+    if (IsFirstShare(i))
+      plane_vfb[i]->GetWritePtr();
+  return true;
 }
 
 bool VideoFrame::IsPropertyWritable() const {
@@ -586,13 +664,14 @@ bool VideoFrame::IsPropertyWritable() const {
 
 BYTE* VideoFrame::GetWritePtr(int plane) const {
   if (!plane || plane == PLANAR_Y || plane == PLANAR_G) { // planar RGB order GBR
-    if (vfb->GetRefcount()>1) {
+    VideoFrameBuffer* plane_buffer = GetPlaneFrameBuffer(plane);
+    if (plane_buffer->GetRefcount()>1) {
       _ASSERT(FALSE);
 //        throw AvisynthError("Internal Error - refcount was more than one!");
     }
-    return (refcount == 1 && vfb->refcount == 1) ? vfb->GetWritePtr() + GetOffset(plane) : 0;
+    return (refcount == 1 && plane_buffer->refcount == 1) ? plane_buffer->GetWritePtr() + GetOffset(plane) : 0;
   }
-  return vfb->data + GetOffset(plane);
+  return GetPlaneFrameBuffer(plane)->data + GetOffset(plane);
 }
 
 AVSMap& VideoFrame::getProperties() {
@@ -0,0 +1,185 @@
+#ifndef _AVS_WORK_STEALING_QUEUE_H
+#define _AVS_WORK_STEALING_QUEUE_H
+
+#include <cassert>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+// Multi-producer multi-consumer job queue made of one deque per worker.
+//
+// Unlike mpmc_bounded_queue there is no single lock shared by every producer
+// and consumer. A worker takes jobs from the front of its own deque and, when
+// that runs dry, steals from the back of the other workers' deques. Producers
+// which are not workers of the pool spread their jobs round-robin.
+// The sleep mutex is only touched when a worker runs out of work or a
+// producer has to wake a sleeping worker, so a busy pool does not hit futex
+// calls on every job.
+template <typename T>
+class work_stealing_queue
+{
+public:
+  typedef size_t size_type;
+  typedef T value_type;
+
+private:
+  work_stealing_queue(const work_stealing_queue&);              // Disabled copy constructor
+  work_stealing_queue& operator = (const work_stealing_queue&); // Disabled assign operator
+
+  // Number of yields a worker spends looking for work before going to sleep
+  enum { SPIN_COUNT = 64 };
+
+  struct alignas(64) worker_deque
+  {
+    std::mutex mutex;
+    std::deque<T> items;
+  };
+
+  std::vector<std::unique_ptr<worker_deque>> m_deques;
+
+  // Number of items in all deques. Modified only while holding the lock of
+  // the deque which is changed, so it never goes below zero.
+  std::atomic<size_type> m_pending;
+  std::atomic<size_type> m_next;
+  std::atomic<int> m_sleepers;
+  std::atomic<bool> m_finished;
+
+  std::mutex m_sleep_mutex;
+  std::condition_variable m_wakeup;
+
+  bool try_pop_local(value_type* pItem, size_type worker_index)
+  {
+    worker_deque& d = *m_deques[worker_index];
+    std::lock_guard<std::mutex> lock(d.mutex);
+    if (d.items.empty())
+      return false;
+    *pItem = std::move(d.items.front());
+    d.items.pop_front();
+    --m_pending;
+    return true;
+  }
+
+  bool try_steal(value_type* pItem, size_type thief_index)
+  {
+    const size_type n = m_deques.size();
+    for (size_type i = 1; i < n; ++i)
+    {
+      worker_deque& d = *m_deques[(thief_index + i) % n];
+      // A busy victim is skipped instead of waited for
+      std::unique_lock<std::mutex> lock(d.mutex, std::try_to_lock);
+      if (!lock.owns_lock() || d.items.empty())
+        continue;
+      *pItem = std::move(d.items.back());
+      d.items.pop_back();
+      --m_pending;
+      return true;
+    }
+    return false;
+  }
+
+public:
+  work_stealing_queue(size_type nWorkers) :
+    m_deques(),
+    m_pending(0),
+    m_next(0),
+    m_sleepers(0),
+    m_finished(false)
+  {
+    if (nWorkers == 0)
+      nWorkers = 1;
+    m_deques.reserve(nWorkers);
+    for (size_type i = 0; i < nWorkers; ++i)
+      m_deques.emplace_back(new worker_deque());
+  }
+
+  size_type num_workers() const
+  {
+    return m_deques.size();
+  }
+
+  void finish()
+  {
+    std::unique_lock<std::mutex> lock(m_sleep_mutex);
+    if (m_finished == false) {
+      m_finished = true;
+      m_wakeup.notify_all();
+    }
+  }
+
+  bool is_finished() const
+  {
+    return m_finished;
+  }
+
+  // producer_index is the worker index of the calling thread, or any value
+  // >= num_workers() if the caller is not a worker of this queue.
+  bool push(T&& item, size_type producer_index)
+  {
+    if (m_finished)
+      return false;
+
+    const size_type n = m_deques.size();
+    const size_type index = producer_index < n ? producer_index : (m_next.fetch_add(1, std::memory_order_relaxed) % n);
+    {
+      worker_deque& d = *m_deques[index];
+      std::lock_guard<std::mutex> lock(d.mutex);
+      d.items.push_back(std::move(item));
+      ++m_pending;
+    }
+
+    // Pairs with the sleeper registration in pop: either the worker sees the
+    // new item before waiting, or we see the sleeper and wake it.
+    if (m_sleepers > 0) {
+      std::lock_guard<std::mutex> lock(m_sleep_mutex);
+      m_wakeup.notify_one();
+    }
+    return true;
+  }
+
+  // Blocks until an item is available. Returns false when the queue is finished.
+  bool pop(value_type* pItem, size_type worker_index)
+  {
+    assert(worker_index < m_deques.size());
+    while (true)
+    {
+      if (m_finished)
+        return false;
+
+      if (try_pop_local(pItem, worker_index) || try_steal(pItem, worker_index))
+        return true;
+
+      for (int spin = 0; spin < SPIN_COUNT && m_pending == 0 && !m_finished; ++spin)
+        std::this_thread::yield();
+      if (m_pending != 0)
+        continue;
+
+      std::unique_lock<std::mutex> lock(m_sleep_mutex);
+      ++m_sleepers;
+      while (m_pending == 0 && !m_finished)
+        m_wakeup.wait(lock);
+      --m_sleepers;
+    }
+  }
+
+  bool pop_remain(value_type* pItem)
+  {
+    assert(m_finished);
+    for (auto& d : m_deques)
+    {
+      std::lock_guard<std::mutex> lock(d->mutex);
+      if (d->items.empty())
+        continue;
+      *pItem = std::move(d->items.front());
+      d->items.pop_front();
+      --m_pending;
+      return true;
+    }
+    return false;
+  }
+};
+
+#endif  // _AVS_WORK_STEALING_QUEUE_H
@@ -59,7 +59,7 @@ extern const AVSFunction Conditional_filters[] = {
   {  "ConditionalFilter", BUILTIN_FUNC_PREFIX, "cccn[show]b[local]b", ConditionalFilter::Create, (void *)2 }, // function input
   {  "ScriptClip",        BUILTIN_FUNC_PREFIX, "cs[show]b[after_frame]b[local]b", ScriptClip::Create },
   {  "ScriptClip",        BUILTIN_FUNC_PREFIX, "cn[show]b[after_frame]b[local]b", ScriptClip::Create }, // function input
-  {  "ConditionalReader", BUILTIN_FUNC_PREFIX, "css[show]b[condvarsuffix]s[local]b", ConditionalReader::Create },
+  {  "ConditionalReader", BUILTIN_FUNC_PREFIX, "css[show]b[condvarsuffix]s[local]b[streaming]b[index]s", ConditionalReader::Create },
   {  "FrameEvaluate",     BUILTIN_FUNC_PREFIX, "cs[show]b[after_frame]b[local]b", ScriptClip::Create_eval },
   {  "WriteFile",         BUILTIN_FUNC_PREFIX, "c[filename]ss+[append]b[flush]b[local]b", Write::Create },
   {  "WriteFileIf",       BUILTIN_FUNC_PREFIX, "c[filename]ss+[append]b[flush]b[local]b", Write::Create_If },
@@ -100,6 +100,34 @@ extern const AVSFunction Conditional_filters[] = {
 #define W_DIVISOR 5  // Width divisor for onscreen messages
 
 
+// Runtime scripts given as a string are parsed once, when the filter is created,
+// and only the expression is evaluated on each frame. Expressions keep no state
+// (variables live in the environment), so the tree is shared by all threads.
+// A script which does not parse gives an empty expression; it is parsed again
+// on each frame by EvaluateRuntimeScript, which reports the error as before.
+static PExpression ParseRuntimeScript(const AVSValue& script, const char* filename, IScriptEnvironment* env)
+{
+  if (!script.IsString())
+    return PExpression();
+  try {
+    ScriptParser parser(env, script.AsString(), filename);
+    return parser.Parse();
+  }
+  catch (const AvisynthError&) {
+    return PExpression();
+  }
+}
+
+static AVSValue EvaluateRuntimeScript(const PExpression& exp, const AVSValue& script, const char* filename, IScriptEnvironment* env)
+{
+  if (!exp) {
+    ScriptParser parser(env, script.AsString(), filename);
+    return parser.Parse()->Evaluate(env);
+  }
+  return exp->Evaluate(env);
+}
+
+
 /********************************
  * Conditional Select
  *
@@ -111,7 +139,8 @@ ConditionalSelect::ConditionalSelect(PClip _child, AVSValue _script,
                                      int _num_args, PClip *_child_array,
                                      bool _show, bool _local, IScriptEnvironment* env) :
   GenericVideoFilter(_child), script(_script),
-  num_args(_num_args), child_array(_child_array), show(_show), local(_local) {
+  num_args(_num_args), child_array(_child_array), show(_show), local(_local),
+  IEnv(GetAndRevealCamouflagedEnv(env)) {
 
   child_devs = DEV_TYPE_ANY;
   for (int i=0; i<num_args; i++) {
@@ -135,11 +164,13 @@ ConditionalSelect::ConditionalSelect(PClip _child, AVSValue _script,
   if (child_devs == 0) {
     env->ThrowError("ConditionalSelect: No common device among sources!");
   }
+  script_exp = ParseRuntimeScript(script, "[Conditional Select, Expression]", env);
 }
 
 
 ConditionalSelect::~ConditionalSelect() {
   delete[] child_array;
+  IEnv->ClearRuntimeInvokeMemos();
 }
 
 int __stdcall ConditionalSelect::SetCacheHints(int cachehints, int frame_range)
@@ -185,9 +216,7 @@ PVideoFrame __stdcall ConditionalSelect::GetFrame(int n, IScriptEnvironment* env
 
   try {
     if (script.IsString()) {
-      ScriptParser parser(env, script.AsString(), "[Conditional Select, Expression]");
-      PExpression exp = parser.Parse();
-      result = exp->Evaluate(env);
+      result = EvaluateRuntimeScript(script_exp, script, "[Conditional Select, Expression]", env);
     }
     else {
       //auto& func = script.AsFunction(); // c++ strict conformance: cannot Convert PFunction to PFunction&
@@ -295,7 +324,8 @@ ConditionalFilter::ConditionalFilter(PClip _child, PClip _source1, PClip _source
                                      AVSValue  _condition1, AVSValue  _evaluator, AVSValue  _condition2,
                                      bool _show, bool _local, IScriptEnvironment* env) :
   GenericVideoFilter(_child), source1(_source1), source2(_source2),
-  eval1(_condition1), eval2(_condition2), show(_show), local(_local) {
+  eval1(_condition1), eval2(_condition2), show(_show), local(_local),
+  IEnv(GetAndRevealCamouflagedEnv(env)) {
 
     evaluator = NONE;
 
@@ -338,8 +368,14 @@ ConditionalFilter::ConditionalFilter(PClip _child, PClip _source1, PClip _source
     if (child_devs == 0) {
       env->ThrowError("ConditionalFilter: The two sources must support the same device!");
     }
+    eval1_exp = ParseRuntimeScript(eval1, "[Conditional Filter, Expresion 1]", env);
+    eval2_exp = ParseRuntimeScript(eval2, "[Conditional Filter, Expression 2]", env);
   }
 
+ConditionalFilter::~ConditionalFilter() {
+  IEnv->ClearRuntimeInvokeMemos();
+}
+
 const char* const t_TRUE="TRUE";
 const char* const t_FALSE="FALSE";
 
@@ -389,13 +425,8 @@ PVideoFrame __stdcall ConditionalFilter::GetFrame(int n, IScriptEnvironment* env
   AVSValue e2_result;
   try {
     if (eval1.IsString()) {
-      ScriptParser parser(env, eval1.AsString(), "[Conditional Filter, Expresion 1]");
-      PExpression exp = parser.Parse();
-      e1_result = exp->Evaluate(env);
-
-      ScriptParser parser2(env, eval2.AsString(), "[Conditional Filter, Expression 2]");
-      exp = parser2.Parse();
-      e2_result = exp->Evaluate(env);
+      e1_result = EvaluateRuntimeScript(eval1_exp, eval1, "[Conditional Filter, Expresion 1]", env);
+      e2_result = EvaluateRuntimeScript(eval2_exp, eval2, "[Conditional Filter, Expression 2]", env);
     }
     else {
       //auto& func = eval1.AsFunction(); // c++ strict conformance: cannot Convert PFunction to PFunction&
@@ -570,8 +601,14 @@ AVSValue __cdecl ConditionalFilter::Create(AVSValue args, void* user_data, IScri
  **************************/
 
 ScriptClip::ScriptClip(PClip _child, AVSValue  _script, bool _show, bool _only_eval, bool _eval_after_frame, bool _local, IScriptEnvironment* env) :
-  GenericVideoFilter(_child), script(_script), show(_show), only_eval(_only_eval), eval_after(_eval_after_frame), local(_local) {
-  AVS_UNUSED(env);
+  GenericVideoFilter(_child), script(_script), show(_show), only_eval(_only_eval), eval_after(_eval_after_frame), local(_local),
+  IEnv(GetAndRevealCamouflagedEnv(env)) {
+  script_exp = ParseRuntimeScript(script, "[ScriptClip]", env);
+}
+
+// The filters made by the runtime script may be kept in the memos, with its child
+ScriptClip::~ScriptClip() {
+  IEnv->ClearRuntimeInvokeMemos();
 }
 
 
@@ -631,9 +668,7 @@ PVideoFrame __stdcall ScriptClip::GetFrame(int n, IScriptEnvironment* env_)
 
   try {
     if (script.IsString()) {
-      ScriptParser parser(env, script.AsString(), "[ScriptClip]");
-      PExpression exp = parser.Parse();
-      result = exp->Evaluate(env);
+      result = EvaluateRuntimeScript(script_exp, script, "[ScriptClip]", env);
     }
     else {
       const PFunction& func = script.AsFunction();
@@ -35,6 +35,9 @@
 
 
 #include <avisynth.h>
+#include "../../core/parser/expression.h"
+
+class InternalEnvironment;
 
 
 class ConditionalSelect : public GenericVideoFilter
@@ -48,11 +51,13 @@ public:
 
 private:
   AVSValue script;
+  PExpression script_exp;
   const int num_args;
   PClip *child_array;
   const bool show;
   bool local;
   int child_devs;
+  InternalEnvironment* IEnv; // to clear the runtime Invoke memos on destruction
 };
 
 
@@ -70,6 +75,7 @@ class ConditionalFilter : public GenericVideoFilter
 
 public:
   ConditionalFilter(PClip _child, PClip _source1, PClip _source2, AVSValue  _condition1, AVSValue  _evaluator, AVSValue  _condition2, bool _show, bool _local, IScriptEnvironment* env);
+  ~ConditionalFilter();
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
   void __stdcall GetAudio(void* buf, int64_t start, int64_t count, IScriptEnvironment* env);
   int __stdcall SetCacheHints(int cachehints, int frame_range);
@@ -81,15 +87,19 @@ private:
   Eval evaluator;
   AVSValue eval1;
   AVSValue eval2;
+  PExpression eval1_exp;
+  PExpression eval2_exp;
   bool show;
   bool local;
   int child_devs;
+  InternalEnvironment* IEnv; // to clear the runtime Invoke memos on destruction
 };
 
 class ScriptClip : public GenericVideoFilter
 {
 public:
   ScriptClip(PClip _child, AVSValue  _script, bool _show, bool _only_eval, bool _eval_after_frame, bool _local, IScriptEnvironment* env);
+  ~ScriptClip();
   int __stdcall SetCacheHints(int cachehints, int frame_range);
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
   static AVSValue __cdecl Create(AVSValue args, void* user_data, IScriptEnvironment* env);
@@ -97,8 +107,10 @@ public:
 
 private:
   AVSValue script;
+  PExpression script_exp;
   bool show;
   bool only_eval;
   bool eval_after;
   bool local; // like in gRunT, watch at Neo and AVS+ differences! Compatibility is local=false
+  InternalEnvironment* IEnv; // to clear the runtime Invoke memos on destruction
 };
@@ -37,6 +37,8 @@
 #include "../focus.h" // sad
 #ifdef INTEL_INTRINSICS
 #include "intel/conditional_functions_sse.h"
+#include "intel/conditional_functions_avx2.h"
+#include "intel/conditional_functions_avx512.h"
 #include "../intel/focus_sse.h" // sad
 #endif
 #include "../../core/internal.h"
@@ -46,6 +48,8 @@
 #include <limits>
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <vector>
 #include "../core/AVSMap.h"
 
 extern const AVSFunction Conditional_funtions_filters[] = {
@@ -147,20 +151,360 @@ AVSValue AveragePlane::Create(AVSValue args, void* user_data, IScriptEnvironment
   return AvgPlane(args[0], user_data, plane, args[1].AsInt(0), env);
 }
 
-// Average plane
-template<typename pixel_t>
-static double get_sum_of_pixels_c(const BYTE* srcp8, size_t height, size_t width, size_t pitch) {
-  typedef typename std::conditional < sizeof(pixel_t) == 4, double, int64_t>::type sum_t;
-  sum_t accum = 0; // int32 holds sum of maximum 16 Mpixels for 8 bit, and 65536 pixels for uint16_t pixels
-  const pixel_t *srcp = reinterpret_cast<const pixel_t *>(srcp8);
-  pitch /= sizeof(pixel_t);
-  for (size_t y = 0; y < height; y++) {
-    for (size_t x = 0; x < width; x++) {
-      accum += srcp[x];
+template<bool average>
+void get_minmax_float_c(const BYTE* srcp, int pitch, int w, int h, float& min, float& max, double &sum)
+{
+  min = *reinterpret_cast<const float*>(srcp);
+  max = min;
+  sum = 0;
+
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      const float pix = reinterpret_cast<const float*>(srcp)[x];
+      if constexpr(average)
+        sum += pix;
+      if (pix < min) min = pix;
+      if (pix > max) max = pix;
     }
     srcp += pitch;
   }
-  return (double)accum;
+}
+
+template<typename pixel_t, bool average>
+void get_minmax_int_c(const BYTE* srcp, int pitch, int w, int h, int& min, int& max, int64_t& sum)
+{
+  min = *reinterpret_cast<const pixel_t*>(srcp);
+  max = min;
+  sum = 0;
+
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      const int pix = reinterpret_cast<const pixel_t*>(srcp)[x];
+      if constexpr (average)
+        sum += pix;
+      if (pix < min) min = pix;
+      if (pix > max) max = pix;
+    }
+    srcp += pitch;
+  }
+}
+
+/********************************
+ * Plane statistics memo
+ ********************************/
+
+// A runtime script usually asks several statistics of the same plane of the same frame:
+// AverageLuma, YPlaneMin, YPlaneMedian, YDifferenceFromPrevious and the like for a scene
+// detection. Sum, min and max are computed together in one pass, the histogram only when
+// a thresholded function or the median is called, and the results are kept per thread
+// for the next call. YDifferenceToNext(n) and YDifferenceFromPrevious(n+1) share a SAD.
+// A plane is identified by the frame buffer holding it and the buffer's sequence number, which is
+// unique process-wide and changes on every write access. No frame reference is held,
+// nothing has to be invalidated.
+
+struct PlaneStatsKey {
+  const VideoFrameBuffer* vfb;
+  int sequence_number;
+  const BYTE* srcp;
+  int pitch;
+
+  PlaneStatsKey() : vfb(nullptr), sequence_number(0), srcp(nullptr), pitch(0) {}
+  PlaneStatsKey(const PVideoFrame& frame, int plane) :
+    vfb(frame->GetPlaneFrameBuffer(plane)), sequence_number(vfb->GetSequenceNumber()),
+    srcp(frame->GetReadPtr(plane)), pitch(frame->GetPitch(plane)) {}
+
+  bool operator==(const PlaneStatsKey& other) const {
+    return vfb == other.vfb && sequence_number == other.sequence_number && srcp == other.srcp && pitch == other.pitch;
+  }
+};
+
+struct PlaneStats {
+  PlaneStatsKey key;
+  int w, h, bits_per_pixel;
+  bool chroma; // float histogram of U and V is shifted by 0.5
+  uint64_t last_used;
+
+  bool has_sum;
+  double sum; // exact for integer formats
+  double min, max;
+
+  bool has_histogram;
+  std::vector<uint32_t> histogram; // 1 << bits_per_pixel bins, 65536 for float
+};
+
+struct PlaneSad {
+  PlaneStatsKey key[2]; // ordered by srcp, SAD is symmetric
+  int row_size, height, pixel_type;
+  uint64_t last_used;
+  double sad;
+};
+
+class PlaneStatsMemo {
+  enum { MAX_ENTRIES = 8 };
+
+  PlaneStats stats[MAX_ENTRIES];
+  PlaneSad sads[MAX_ENTRIES];
+  uint64_t clock;
+
+  template<typename T>
+  static T* LeastRecentlyUsed(T* entries) {
+    T* oldest = &entries[0];
+    for (int i = 1; i < MAX_ENTRIES; i++)
+      if (entries[i].last_used < oldest->last_used)
+        oldest = &entries[i];
+    return oldest;
+  }
+
+  std::vector<uint32_t> scratch;
+
+public:
+  PlaneStatsMemo() : stats(), sads(), clock(0) {}
+
+  // Work area of the histogram counting
+  uint32_t* Scratch(size_t size)
+  {
+    if (scratch.size() < size)
+      scratch.resize(size);
+    return scratch.data();
+  }
+
+  // Entry of the plane, a new empty one when not found
+  PlaneStats& Stats(const PVideoFrame& frame, int plane, int bits_per_pixel)
+  {
+    const PlaneStatsKey key(frame, plane);
+    const int pixelsize = bits_per_pixel == 32 ? 4 : bits_per_pixel > 8 ? 2 : 1;
+    const int w = frame->GetRowSize(plane) / pixelsize;
+    const int h = frame->GetHeight(plane);
+    const bool chroma = plane == PLANAR_U || plane == PLANAR_V;
+
+    for (PlaneStats& s : stats) {
+      if (s.key == key && s.w == w && s.h == h && s.bits_per_pixel == bits_per_pixel && s.chroma == chroma) {
+        s.last_used = ++clock;
+        return s;
+      }
+    }
+
+    PlaneStats& s = *LeastRecentlyUsed(stats);
+    s.key = key;
+    s.w = w;
+    s.h = h;
+    s.bits_per_pixel = bits_per_pixel;
+    s.chroma = chroma;
+    s.last_used = ++clock;
+    s.has_sum = false;
+    s.has_histogram = false;
+    return s;
+  }
+
+  // Entry of the plane pair, a new one with sad < 0 when not found
+  PlaneSad& Sad(const PVideoFrame& frame, const PVideoFrame& frame2, int plane, int pixel_type)
+  {
+    PlaneStatsKey key(frame, plane);
+    PlaneStatsKey key2(frame2, plane);
+    if (std::less<const BYTE*>()(key2.srcp, key.srcp))
+      std::swap(key, key2);
+    const int row_size = frame->GetRowSize(plane);
+    const int height = frame->GetHeight(plane);
+
+    for (PlaneSad& s : sads) {
+      if (s.key[0] == key && s.key[1] == key2 && s.row_size == row_size && s.height == height && s.pixel_type == pixel_type) {
+        s.last_used = ++clock;
+        return s;
+      }
+    }
+
+    PlaneSad& s = *LeastRecentlyUsed(sads);
+    s.key[0] = key;
+    s.key[1] = key2;
+    s.row_size = row_size;
+    s.height = height;
+    s.pixel_type = pixel_type;
+    s.last_used = ++clock;
+    s.sad = -1;
+    return s;
+  }
+};
+
+static thread_local PlaneStatsMemo plane_stats_memo;
+
+// Histogram of integer samples. Neighbouring samples are counted in separate copies of
+// the histogram, added up at the end: in flat areas an increment does not have to wait
+// for the previous one of the same counter. 4 copies for 8 bit, 2 for 10-16 bits.
+template<typename pixel_t, int copies>
+static void fill_histogram_c(const BYTE* srcp, int pitch, int w, int h, int max_pixel_value, uint32_t* histogram, uint32_t* scratch)
+{
+  const int bins = max_pixel_value + 1;
+  uint32_t* counts = copies == 1 ? histogram : scratch;
+  std::fill_n(counts, bins * copies, 0);
+
+  for (int y = 0; y < h; y++) {
+    const pixel_t* srcp_t = reinterpret_cast<const pixel_t*>(srcp);
+    int x = 0;
+    for (; x + copies <= w; x += copies) {
+      for (int c = 0; c < copies; c++) {
+        if constexpr (sizeof(pixel_t) == 1)
+          counts[c * bins + srcp_t[x + c]]++; // safe
+        else
+          counts[c * bins + min((int)srcp_t[x + c], max_pixel_value)]++;
+      }
+    }
+    for (; x < w; x++) {
+      if constexpr (sizeof(pixel_t) == 1)
+        counts[srcp_t[x]]++;
+      else
+        counts[min((int)srcp_t[x], max_pixel_value)]++;
+    }
+    srcp += pitch;
+  }
+
+  if (copies > 1) {
+    for (int i = 0; i < bins; i++) {
+      uint32_t sum = 0;
+      for (int c = 0; c < copies; c++)
+        sum += counts[c * bins + i];
+      histogram[i] = sum;
+    }
+  }
+}
+
+// Sum, min and max of a plane
+static const PlaneStats& GetPlaneSumMinMax(const PVideoFrame& src, int plane, int bits_per_pixel, IScriptEnvironment* env)
+{
+  PlaneStats& s = plane_stats_memo.Stats(src, plane, bits_per_pixel);
+  if (s.has_sum)
+    return s;
+
+  const BYTE* srcp = src->GetReadPtr(plane);
+  const int pitch = src->GetPitch(plane);
+
+#ifdef INTEL_INTRINSICS
+  const int cpu = env->GetCPUFlags();
+#endif
+
+  if (bits_per_pixel == 32) {
+    float min, max;
+    // SIMD sums in double lanes, last bits may differ from C
+#ifdef INTEL_INTRINSICS
+    if ((cpu & CPUF_AVX512BW) && s.w >= 16)
+      get_sum_minmax_float_avx512(srcp, s.h, s.w, pitch, s.sum, min, max);
+    else if ((cpu & CPUF_AVX2) && s.w >= 8)
+      get_sum_minmax_float_avx2(srcp, s.h, s.w, pitch, s.sum, min, max);
+    else
+#endif
+    get_minmax_float_c<true>(srcp, pitch, s.w, s.h, min, max, s.sum);
+    s.min = min;
+    s.max = max;
+  }
+  else if (bits_per_pixel == 8) {
+    int min, max;
+    int64_t sum;
+#ifdef INTEL_INTRINSICS
+    if ((cpu & CPUF_AVX512BW) && s.w >= 64)
+      get_sum_minmax_uint8_avx512(srcp, s.h, s.w, pitch, sum, min, max);
+    else if ((cpu & CPUF_AVX2) && s.w >= 32)
+      get_sum_minmax_uint8_avx2(srcp, s.h, s.w, pitch, sum, min, max);
+    else if ((cpu & CPUF_SSE2) && s.w >= 16)
+      get_sum_minmax_uint8_sse2(srcp, s.h, s.w, pitch, sum, min, max);
+    else
+#endif
+    get_minmax_int_c<uint8_t, true>(srcp, pitch, s.w, s.h, min, max, sum);
+    s.sum = (double)sum;
+    s.min = min;
+    s.max = max;
+  }
+  else {
+    int min, max;
+    int64_t sum;
+#ifdef INTEL_INTRINSICS
+    if ((cpu & CPUF_AVX512BW) && s.w >= 32)
+      get_sum_minmax_uint16_avx512(srcp, s.h, s.w, pitch, sum, min, max);
+    else if ((cpu & CPUF_AVX2) && s.w >= 16)
+      get_sum_minmax_uint16_avx2(srcp, s.h, s.w, pitch, sum, min, max);
+    else if ((cpu & CPUF_SSE2) && s.w >= 8)
+      get_sum_minmax_uint16_sse2(srcp, s.h, s.w, pitch, sum, min, max);
+    else
+#endif
+    get_minmax_int_c<uint16_t, true>(srcp, pitch, s.w, s.h, min, max, sum);
+    s.sum = (double)sum;
+    s.min = min;
+    s.max = max;
+  }
+  s.has_sum = true;
+  return s;
+}
+
+// Histogram of a plane, has sum, min and max as well
+static const PlaneStats& GetPlaneHistogram(const PVideoFrame& src, int plane, int bits_per_pixel, IScriptEnvironment* env)
+{
+  PlaneStats& s = plane_stats_memo.Stats(src, plane, bits_per_pixel);
+  if (s.has_histogram)
+    return s;
+
+  // 8 and 16 bit histograms are exact, sum, min and max can be read from them.
+  // 10-14 bits clamp out-of-range values, float is quantized: separate pass.
+  const bool exact = bits_per_pixel == 8 || bits_per_pixel == 16;
+  if (!exact && !s.has_sum)
+    GetPlaneSumMinMax(src, plane, bits_per_pixel, env);
+
+  const BYTE* srcp = src->GetReadPtr(plane);
+  const int pitch = src->GetPitch(plane);
+  const int w = s.w;
+  const int h = s.h;
+
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  const int buffersize = bits_per_pixel == 32 ? 65536 : (1 << bits_per_pixel); // 65536 for float, too, reason for 10-14 bits: avoid overflow
+  s.histogram.resize(buffersize);
+  uint32_t* accum_buf = s.histogram.data();
+
+  // Count each component
+  if (bits_per_pixel == 8)
+    fill_histogram_c<uint8_t, 4>(srcp, pitch, w, h, max_pixel_value, accum_buf, plane_stats_memo.Scratch(buffersize * 4));
+  else if (bits_per_pixel <= 16)
+    fill_histogram_c<uint16_t, 2>(srcp, pitch, w, h, max_pixel_value, accum_buf, plane_stats_memo.Scratch(buffersize * 2));
+  else { //pixelsize==4 float
+    std::fill_n(accum_buf, buffersize, 0);
+ // for float results are always checked with 16 bit precision only
+ // or else we cannot populate non-digital steps with this standard method
+    // See similar in colors, ColorYUV analyze
+    if (s.chroma) {
+      const float shift = 32768.0f;
+      for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+          // -0.5..0.5 to 0..65535
+          const float pixel = reinterpret_cast<const float *>(srcp)[x];
+          accum_buf[clamp((int)(65535.0f*pixel + shift + 0.5f), 0, 65535)]++;
+        }
+        srcp += pitch;
+      }
+    }
+    else {
+      for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+          const float pixel = reinterpret_cast<const float *>(srcp)[x];
+          accum_buf[clamp((int)(65535.0f * pixel + 0.5f), 0, 65535)]++;
+        }
+        srcp += pitch;
+      }
+    }
+  }
+
+  if (!s.has_sum) {
+    int64_t sum = 0;
+    int i_min = buffersize - 1, i_max = 0;
+    for (int i = 0; i < buffersize; i++) {
+      if (accum_buf[i] == 0)
+        continue;
+      sum += (int64_t)i * accum_buf[i];
+      i_min = min(i_min, i);
+      i_max = i;
+    }
+    s.sum = (double)sum;
+    s.min = i_min;
+    s.max = i_max;
+    s.has_sum = true;
+  }
+  s.has_histogram = true;
+  return s;
 }
 
 AVSValue AveragePlane::AvgPlane(AVSValue clip, void* , int plane, int offset, IScriptEnvironment* env)
@@ -219,42 +563,13 @@ AVSValue AveragePlane::AvgPlane(AVSValue clip, void* , int plane, int offset, IS
 
   int pixelsize = vi.ComponentSize();
 
-  const BYTE* srcp = src->GetReadPtr(plane);
   int height = src->GetHeight(plane);
   int width = src->GetRowSize(plane) / pixelsize;
-  int pitch = src->GetPitch(plane);
 
   if (width == 0 || height == 0)
     env->ThrowError("Average Plane: plane does not exist!");
 
-  double sum = 0.0;
-
-
-  int total_pixels = width*height;
-  bool sum_in_32bits;
-  if (pixelsize == 4)
-    sum_in_32bits = false;
-  else // worst case
-    sum_in_32bits = ((int64_t)total_pixels * (pixelsize == 1 ? 255 : 65535)) <= std::numeric_limits<int>::max();
-
-#ifdef INTEL_INTRINSICS
-  if ((pixelsize==1) && sum_in_32bits && (env->GetCPUFlags() & CPUF_SSE2) && width >= 16) {
-    sum = get_sum_of_pixels_sse2(srcp, height, width, pitch);
-  } else
-#ifdef X86_32
-  if ((pixelsize==1) && sum_in_32bits && (env->GetCPUFlags() & CPUF_INTEGER_SSE) && width >= 8) {
-    sum = get_sum_of_pixels_isse(srcp, height, width, pitch);
-  } else
-#endif
-#endif
-  {
-    if(pixelsize==1)
-      sum = get_sum_of_pixels_c<uint8_t>(srcp, height, width, pitch);
-    else if(pixelsize==2)
-      sum = get_sum_of_pixels_c<uint16_t>(srcp, height, width, pitch);
-    else // pixelsize==4
-      sum = get_sum_of_pixels_c<float>(srcp, height, width, pitch);
-  }
+  const double sum = GetPlaneSumMinMax(src, plane, vi.BitsPerComponent(), env).sum;
 
   float f = (float)(sum / (height * width));
 
@@ -278,11 +593,11 @@ AVSValue ComparePlane::Create_next(AVSValue args, void* user_data, IScriptEnviro
 
 
 template<typename pixel_t>
-static double get_sad_c(const BYTE* c_plane8, const BYTE* t_plane8, size_t height, size_t width, size_t c_pitch, size_t t_pitch) {
+static double get_sad_c(const BYTE* c_plane8, const BYTE* t_plane8, size_t height, size_t width, int c_pitch, int t_pitch) {
   const pixel_t *c_plane = reinterpret_cast<const pixel_t *>(c_plane8);
   const pixel_t *t_plane = reinterpret_cast<const pixel_t *>(t_plane8);
-  c_pitch /= sizeof(pixel_t);
-  t_pitch /= sizeof(pixel_t);
+  c_pitch /= (int)sizeof(pixel_t);
+  t_pitch /= (int)sizeof(pixel_t);
   typedef typename std::conditional < sizeof(pixel_t) == 4, double, int64_t>::type sum_t;
   sum_t accum = 0; // int32 holds sum of maximum 16 Mpixels for 8 bit, and 65536 pixels for uint16_t pixels
 
@@ -298,11 +613,11 @@ static double get_sad_c(const BYTE* c_plane8, const BYTE* t_plane8, size_t heigh
 }
 
 template<typename pixel_t>
-static double get_sad_rgb_c(const BYTE* c_plane8, const BYTE* t_plane8, size_t height, size_t width, size_t c_pitch, size_t t_pitch) {
+static double get_sad_rgb_c(const BYTE* c_plane8, const BYTE* t_plane8, size_t height, size_t width, int c_pitch, int t_pitch) {
   const pixel_t *c_plane = reinterpret_cast<const pixel_t *>(c_plane8);
   const pixel_t *t_plane = reinterpret_cast<const pixel_t *>(t_plane8);
-  c_pitch /= sizeof(pixel_t);
-  t_pitch /= sizeof(pixel_t);
+  c_pitch /= (int)sizeof(pixel_t);
+  t_pitch /= (int)sizeof(pixel_t);
   int64_t accum = 0; // packed rgb: integer type only
   for (size_t y = 0; y < height; y++) {
     for (size_t x = 0; x < width; x+=4) {
@@ -317,6 +632,96 @@ static double get_sad_rgb_c(const BYTE* c_plane8, const BYTE* t_plane8, size_t h
 
 }
 
+// sum of absolute differences of a plane, packed RGB without alpha
+static double get_plane_sad(const BYTE* srcp, const BYTE* srcp2, int height, int rowsize, int pitch, int pitch2, const VideoInfo& vi, IScriptEnvironment* env)
+{
+  const int pixelsize = vi.ComponentSize();
+  const int width = rowsize / pixelsize;
+
+#ifdef X86_32
+  int bits_per_pixel = vi.BitsPerComponent();
+  int total_pixels = width * height;
+  bool sum_in_32bits;
+  if (pixelsize == 4)
+    sum_in_32bits = false;
+  else // worst case check
+    sum_in_32bits = ((int64_t)total_pixels * ((1 << bits_per_pixel) - 1)) <= std::numeric_limits<int>::max();
+#endif
+
+  double sad = 0;
+  // for c: width, for sse: rowsize
+  if (vi.IsRGB32() || vi.IsRGB64()) {
+#ifdef INTEL_INTRINSICS
+    if ((pixelsize == 2) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
+      // int64 internally, no sum_in_32bits
+      sad = (double)calculate_sad_8_or_16_sse2<uint16_t,true>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus. 21.68/21.39
+    } else if ((pixelsize == 1) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
+      sad = (double)calculate_sad_8_or_16_sse2<uint8_t,true>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus, no overflow
+    } else
+#ifdef X86_32
+      if ((pixelsize==1) && sum_in_32bits && (env->GetCPUFlags() & CPUF_INTEGER_SSE) && width >= 8) {
+        sad = get_sad_rgb_isse(srcp, srcp2, height, rowsize, pitch, pitch2);
+      } else
+#endif
+#endif
+      {
+        if(pixelsize==1)
+          sad = get_sad_rgb_c<uint8_t>(srcp, srcp2, height, width, pitch, pitch2);
+        else
+          sad = get_sad_rgb_c<uint16_t>(srcp, srcp2, height, width, pitch, pitch2);
+      }
+  } else {
+#ifdef INTEL_INTRINSICS
+    const int cpu = env->GetCPUFlags();
+    if ((cpu & CPUF_AVX512BW) && rowsize >= 64) {
+      if (pixelsize == 1)
+        sad = get_sad_avx512<uint8_t>(srcp, srcp2, height, width, pitch, pitch2);
+      else if (pixelsize == 2)
+        sad = get_sad_avx512<uint16_t>(srcp, srcp2, height, width, pitch, pitch2);
+      else
+        sad = get_sad_avx512<float>(srcp, srcp2, height, width, pitch, pitch2);
+    } else if ((cpu & CPUF_AVX2) && rowsize >= 32) {
+      if (pixelsize == 1)
+        sad = get_sad_avx2<uint8_t>(srcp, srcp2, height, width, pitch, pitch2);
+      else if (pixelsize == 2)
+        sad = get_sad_avx2<uint16_t>(srcp, srcp2, height, width, pitch, pitch2);
+      else
+        sad = get_sad_avx2<float>(srcp, srcp2, height, width, pitch, pitch2);
+    } else
+    if ((pixelsize==2) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
+      sad = (double)calculate_sad_8_or_16_sse2<uint16_t,false>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus, no overflow
+    } else if ((pixelsize==1) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
+      sad = (double)calculate_sad_8_or_16_sse2<uint8_t,false>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus, no overflow
+    } else
+#ifdef X86_32
+      if ((pixelsize==1) && sum_in_32bits && (env->GetCPUFlags() & CPUF_INTEGER_SSE) && width >= 8) {
+        sad = get_sad_isse(srcp, srcp2, height, width, pitch, pitch2);
+      } else
+#endif
+#endif
+      {
+        if(pixelsize==1)
+          sad = get_sad_c<uint8_t>(srcp, srcp2, height, width, pitch, pitch2);
+        else if (pixelsize==2)
+          sad = get_sad_c<uint16_t>(srcp, srcp2, height, width, pitch, pitch2);
+        else // pixelsize==4
+          sad = get_sad_c<float>(srcp, srcp2, height, width, pitch, pitch2);
+      }
+  }
+
+  return sad;
+}
+
+// get_plane_sad of the same planes of two frames, memoized
+static double GetPlaneSad(const PVideoFrame& src, const PVideoFrame& src2, int plane, const VideoInfo& vi, IScriptEnvironment* env)
+{
+  PlaneSad& s = plane_stats_memo.Sad(src, src2, plane, vi.pixel_type);
+  if (s.sad < 0)
+    s.sad = get_plane_sad(src->GetReadPtr(plane), src2->GetReadPtr(plane), src->GetHeight(plane), src->GetRowSize(plane),
+      src->GetPitch(plane), src2->GetPitch(plane), vi, env);
+  return s.sad;
+}
+
 AVSValue ComparePlane::CmpPlane(AVSValue clip, AVSValue clip2, void* , int plane, IScriptEnvironment* env)
 {
   if (!clip.IsClip())
@@ -355,16 +760,12 @@ AVSValue ComparePlane::CmpPlane(AVSValue clip, AVSValue clip2, void* , int plane
 
   int pixelsize = vi.ComponentSize();
 
-  const BYTE* srcp = src->GetReadPtr(plane);
-  const BYTE* srcp2 = src2->GetReadPtr(plane);
   const int height = src->GetHeight(plane);
   const int rowsize = src->GetRowSize(plane);
   const int width = rowsize / pixelsize;
-  const int pitch = src->GetPitch(plane);
   const int height2 = src2->GetHeight(plane);
   const int rowsize2 = src2->GetRowSize(plane);
   const int width2 = rowsize2 / pixelsize;
-  const int pitch2 = src2->GetPitch(plane);
 
   if(vi.ComponentSize() != vi2.ComponentSize())
     env->ThrowError("Plane Difference: Bit-depth are not the same!");
@@ -375,62 +776,7 @@ AVSValue ComparePlane::CmpPlane(AVSValue clip, AVSValue clip2, void* , int plane
   if (height != height2 || width != width2)
     env->ThrowError("Plane Difference: Images are not the same size!");
 
-#ifdef X86_32
-  int bits_per_pixel = vi.BitsPerComponent();
-  int total_pixels = width*height;
-  bool sum_in_32bits;
-  if (pixelsize == 4)
-    sum_in_32bits = false;
-  else // worst case check
-    sum_in_32bits = ((int64_t)total_pixels * ((1 << bits_per_pixel) - 1)) <= std::numeric_limits<int>::max();
-#endif
-
-  double sad = 0.0;
-
-  // for c: width, for sse: rowsize
-  if (vi.IsRGB32() || vi.IsRGB64()) {
-#ifdef INTEL_INTRINSICS
-    if ((pixelsize == 2) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
-      // int64 internally, no sum_in_32bits
-      sad = (double)calculate_sad_8_or_16_sse2<uint16_t,true>(srcp, srcp2, pitch, pitch2, width*pixelsize, height); // in focus. 21.68/21.39
-    } else if ((pixelsize == 1) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
-      sad = (double)calculate_sad_8_or_16_sse2<uint8_t,true>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus, no overflow
-    } else
-#ifdef X86_32
-      if ((pixelsize==1) && sum_in_32bits && (env->GetCPUFlags() & CPUF_INTEGER_SSE) && width >= 8) {
-        sad = get_sad_rgb_isse(srcp, srcp2, height, rowsize, pitch, pitch2);
-      } else
-#endif
-#endif
-      {
-        if (pixelsize == 1)
-          sad = (double)get_sad_rgb_c<uint8_t>(srcp, srcp2, height, width, pitch, pitch2);
-        else // pixelsize==2
-          sad = (double)get_sad_rgb_c<uint16_t>(srcp, srcp2, height, width, pitch, pitch2);
-      }
-  } else {
-#ifdef INTEL_INTRINSICS
-    if ((pixelsize==2) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
-      sad = (double)calculate_sad_8_or_16_sse2<uint16_t,false>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus, no overflow
-    } else
-      if ((pixelsize==1) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
-      sad = (double)calculate_sad_8_or_16_sse2<uint8_t,false>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus, no overflow
-    } else
-#ifdef X86_32
-      if ((pixelsize==1) && sum_in_32bits && (env->GetCPUFlags() & CPUF_INTEGER_SSE) && width >= 8) {
-        sad = get_sad_isse(srcp, srcp2, height, rowsize, pitch, pitch2);
-      } else
-#endif
-#endif
-      {
-        if(pixelsize==1)
-          sad = get_sad_c<uint8_t>(srcp, srcp2, height, width, pitch, pitch2);
-        else if(pixelsize==2)
-          sad = get_sad_c<uint16_t>(srcp, srcp2, height, width, pitch, pitch2);
-        else // pixelsize==4
-          sad = get_sad_c<float>(srcp, srcp2, height, width, pitch, pitch2);
-      }
-  }
+  double sad = GetPlaneSad(src, src2, plane, vi, env);
 
   float f;
 
@@ -472,71 +818,13 @@ AVSValue ComparePlane::CmpPlaneSame(AVSValue clip, void* , int offset, int plane
 
   int pixelsize = vi.ComponentSize();
 
-  const BYTE* srcp = src->GetReadPtr(plane);
-  const BYTE* srcp2 = src2->GetReadPtr(plane);
   int height = src->GetHeight(plane);
-  int rowsize = src->GetRowSize(plane);
-  int width = rowsize / pixelsize;
-  int pitch = src->GetPitch(plane);
-  int pitch2 = src2->GetPitch(plane);
+  int width = src->GetRowSize(plane) / pixelsize;
 
   if (width == 0 || height == 0)
     env->ThrowError("Plane Difference: No chroma planes in greyscale clip!");
 
-#ifdef X86_32
-  int bits_per_pixel = vi.BitsPerComponent();
-  int total_pixels = width * height;
-  bool sum_in_32bits;
-  if (pixelsize == 4)
-    sum_in_32bits = false;
-  else // worst case check
-    sum_in_32bits = ((int64_t)total_pixels * ((1 << bits_per_pixel) - 1)) <= std::numeric_limits<int>::max();
-#endif
-
-  double sad = 0;
-  // for c: width, for sse: rowsize
-  if (vi.IsRGB32() || vi.IsRGB64()) {
-#ifdef INTEL_INTRINSICS
-    if ((pixelsize == 2) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
-      // int64 internally, no sum_in_32bits
-      sad = (double)calculate_sad_8_or_16_sse2<uint16_t,true>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus. 21.68/21.39
-    } else if ((pixelsize == 1) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
-      sad = (double)calculate_sad_8_or_16_sse2<uint8_t,true>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus, no overflow
-    } else
-#ifdef X86_32
-      if ((pixelsize==1) && sum_in_32bits && (env->GetCPUFlags() & CPUF_INTEGER_SSE) && width >= 8) {
-        sad = get_sad_rgb_isse(srcp, srcp2, height, rowsize, pitch, pitch2);
-      } else
-#endif
-#endif
-      {
-        if(pixelsize==1)
-          sad = get_sad_rgb_c<uint8_t>(srcp, srcp2, height, width, pitch, pitch2);
-        else
-          sad = get_sad_rgb_c<uint16_t>(srcp, srcp2, height, width, pitch, pitch2);
-      }
-  } else {
-#ifdef INTEL_INTRINSICS
-    if ((pixelsize==2) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
-      sad = (double)calculate_sad_8_or_16_sse2<uint16_t,false>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus, no overflow
-    } else if ((pixelsize==1) && (env->GetCPUFlags() & CPUF_SSE2) && rowsize >= 16) {
-      sad = (double)calculate_sad_8_or_16_sse2<uint8_t,false>(srcp, srcp2, pitch, pitch2, rowsize, height); // in focus, no overflow
-    } else
-#ifdef X86_32
-      if ((pixelsize==1) && sum_in_32bits && (env->GetCPUFlags() & CPUF_INTEGER_SSE) && width >= 8) {
-        sad = get_sad_isse(srcp, srcp2, height, width, pitch, pitch2);
-      } else
-#endif
-#endif
-      {
-        if(pixelsize==1)
-          sad = get_sad_c<uint8_t>(srcp, srcp2, height, width, pitch, pitch2);
-        else if (pixelsize==2)
-          sad = get_sad_c<uint16_t>(srcp, srcp2, height, width, pitch, pitch2);
-        else // pixelsize==4
-          sad = get_sad_c<float>(srcp, srcp2, height, width, pitch, pitch2);
-      }
-  }
+  double sad = GetPlaneSad(src, src2, plane, vi, env);
 
   float f;
 
@@ -590,47 +878,6 @@ AVSValue MinMaxPlane::Create_minmax(AVSValue args, void* user_data, IScriptEnvir
   return MinMax(args[0], user_data, args[1].AsDblDef(0.0), args[2].AsInt(0), plane, MinMaxPlane::MINMAX_DIFFERENCE, false, env);
 }
 
-template<bool average>
-void get_minmax_float_c(const BYTE* srcp, int pitch, int w, int h, float& min, float& max, double &sum)
-{
-  min = *reinterpret_cast<const float*>(srcp);
-  max = min;
-  sum = 0;
-
-  for (int y = 0; y < h; y++) {
-    for (int x = 0; x < w; x++) {
-      const float pix = reinterpret_cast<const float*>(srcp)[x];
-      if constexpr(average)
-        sum += pix;
-      if (pix < min) min = pix;
-      if (pix > max) max = pix;
-    }
-    srcp += pitch;
-  }
-}
-
-template<typename pixel_t, bool average>
-void get_minmax_int_c(const BYTE* srcp, int pitch, int w, int h, int& min, int& max, int64_t& sum)
-{
-  min = *reinterpret_cast<const pixel_t*>(srcp);
-  max = min;
-  sum = 0;
-
-  for (int y = 0; y < h; y++) {
-    int tmpsum = 0;
-    for (int x = 0; x < w; x++) {
-      const int pix = reinterpret_cast<const pixel_t*>(srcp)[x];
-      if constexpr (average)
-        sum += pix;
-      if (pix < min) min = pix;
-      if (pix > max) max = pix;
-    }
-    if constexpr (average)
-      sum += tmpsum;
-    srcp += pitch;
-  }
-}
-
 AVSValue MinMaxPlane::MinMax(AVSValue clip, void* , double threshold, int offset, int plane, int mode, bool setvar, IScriptEnvironment* env) {
 
   if (!clip.IsClip())
@@ -683,8 +930,6 @@ AVSValue MinMaxPlane::MinMax(AVSValue clip, void* , double threshold, int offset
   // Prepare the source
   PVideoFrame src = child->GetFrame(n, env);
 
-  const BYTE* srcp = src->GetReadPtr(plane);
-  int pitch = src->GetPitch(plane);
   int pixelsize = vi.ComponentSize();
   int w = src->GetRowSize(plane) / pixelsize; // good for packed rgb as well
   int h = src->GetHeight(plane);
@@ -692,6 +937,8 @@ AVSValue MinMaxPlane::MinMax(AVSValue clip, void* , double threshold, int offset
   if (w == 0 || h == 0)
     env->ThrowError("MinMax: plane does not exist!");
 
+  const int bits_per_pixel = vi.BitsPerComponent();
+
   float stats_min;
   float stats_max;
   float stats_median;
@@ -701,36 +948,22 @@ AVSValue MinMaxPlane::MinMax(AVSValue clip, void* , double threshold, int offset
 
   if (threshold == 0 || mode == MinMaxPlane::STATS) {
     // special case, no histogram needed
+    const PlaneStats& stats = GetPlaneSumMinMax(src, plane, bits_per_pixel, env);
 
     if (pixelsize == 4) // 32 bit float
     {
-      double sum = 0;
-      if (mode == MinMaxPlane::STATS)
-        get_minmax_float_c<true>(srcp, pitch, w, h, stats_min, stats_max, sum);
-      else
-        get_minmax_float_c<false>(srcp, pitch, w, h, stats_min, stats_max, sum);
+      stats_min = (float)stats.min;
+      stats_max = (float)stats.max;
 
       if (mode == MinMaxPlane::MIN) return stats_min;
       else if (mode == MinMaxPlane::MAX) return stats_max;
       else if (mode == MinMaxPlane::MINMAX_DIFFERENCE) return stats_max - stats_min;
-      stats_average = (float)(sum / (w * h));
       // STATS: go on
     }
     else
     {
-      int min, max;
-      int64_t sum = 0;
-      // sse4.1 is not any faster
-      if(pixelsize == 1)
-        if (mode == MinMaxPlane::STATS)
-          get_minmax_int_c<uint8_t, true>(srcp, pitch, w, h, min, max, sum);
-        else
-          get_minmax_int_c<uint8_t, false>(srcp, pitch, w, h, min, max, sum);
-      else
-        if (mode == MinMaxPlane::STATS)
-          get_minmax_int_c<uint16_t, true>(srcp, pitch, w, h, min, max, sum);
-        else
-          get_minmax_int_c<uint16_t, false>(srcp, pitch, w, h, min, max, sum);
+      const int min = (int)stats.min;
+      const int max = (int)stats.max;
 
       if (mode == MinMaxPlane::MIN) return min;
       else if (mode == MinMaxPlane::MAX) return max;
@@ -739,62 +972,13 @@ AVSValue MinMaxPlane::MinMax(AVSValue clip, void* , double threshold, int offset
       // STATS: go on
       stats_min = (float)min;
       stats_max = (float)max;
-      stats_average = (float)((double)sum / (w * h));
     }
+    stats_average = (float)(stats.sum / (w * h));
   }
 
-  const int bits_per_pixel = vi.BitsPerComponent();
-  const int max_pixel_value = (1 << bits_per_pixel) - 1;
-
-  const int buffersize = pixelsize == 4 ? 65536 : (1 << bits_per_pixel); // 65536 for float, too, reason for 10-14 bits: avoid overflow
-  uint32_t* accum_buf = new uint32_t[buffersize];
-
-  // Reset accumulators
-  std::fill_n(accum_buf, buffersize, 0);
-
-  // Count each component
-  if (pixelsize == 1) {
-    for (int y = 0; y < h; y++) {
-      for (int x = 0; x < w; x++) {
-        accum_buf[srcp[x]]++; // safe
-      }
-      srcp += pitch;
-    }
-  }
-  else if (pixelsize == 2) {
-    for (int y = 0; y < h; y++) {
-      for (int x = 0; x < w; x++) {
-        accum_buf[min((int)(reinterpret_cast<const uint16_t *>(srcp)[x]), max_pixel_value)]++;
-      }
-      srcp += pitch;
-    }
-  }
-  else { //pixelsize==4 float
- // for float results are always checked with 16 bit precision only
- // or else we cannot populate non-digital steps with this standard method
-    // See similar in colors, ColorYUV analyze
-    const bool chroma = (plane == PLANAR_U) || (plane == PLANAR_V);
-    if (chroma) {
-      const float shift = 32768.0f;
-      for (int y = 0; y < h; y++) {
-        for (int x = 0; x < w; x++) {
-          // -0.5..0.5 to 0..65535
-          const float pixel = reinterpret_cast<const float *>(srcp)[x];
-          accum_buf[clamp((int)(65535.0f*pixel + shift + 0.5f), 0, 65535)]++;
-        }
-        srcp += pitch;
-      }
-    }
-    else {
-      for (int y = 0; y < h; y++) {
-        for (int x = 0; x < w; x++) {
-          const float pixel = reinterpret_cast<const float *>(srcp)[x];
-          accum_buf[clamp((int)(65535.0f * pixel + 0.5f), 0, 65535)]++;
-        }
-        srcp += pitch;
-      }
-    }
-  }
+  const PlaneStats& stats = GetPlaneHistogram(src, plane, bits_per_pixel, env);
+  const uint32_t* accum_buf = stats.histogram.data();
+  const int buffersize = (int)stats.histogram.size();
 
   int pixels = w*h;
   threshold /=100.0;  // Thresh now 0-1
@@ -879,7 +1063,6 @@ AVSValue MinMaxPlane::MinMax(AVSValue clip, void* , double threshold, int offset
     stats_median = (float)retval;
   }
 
-  delete[] accum_buf;
   //_RPT2(0, "End of MinMax cn=%d n=%d\r", cn.AsInt(), n);
 
   if (mode == MinMaxPlane::STATS) {
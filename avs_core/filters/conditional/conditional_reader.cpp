@@ -39,6 +39,14 @@
 #include <cstring>
 #include "../convert/convert_helper.h"
 #include <regex>
+#include <algorithm>
+#include <avs/filesystem.h>
+#ifndef AVS_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 
 /*****************************************************************************
@@ -173,8 +181,102 @@ iscomment(char *string)
 // Reader ------------------------------------------------
 
 
+// Read only view of a whole file
+class MappedTextFile
+{
+public:
+  const char* data;
+  size_t size;
+
+  MappedTextFile() : data(nullptr), size(0)
+  {
+#ifdef AVS_WINDOWS
+    file = INVALID_HANDLE_VALUE;
+    mapping = NULL;
+#endif
+  }
+
+  // Returns false if the file could not be opened or mapped
+  bool Open(const char* filename)
+  {
+#ifdef AVS_WINDOWS
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+      return false;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+      return false;
+    size = (size_t)file_size.QuadPart;
+    if (size == 0)
+      return true;
+    mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+      return false;
+    data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    return data != nullptr;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      return false;
+    }
+    size = (size_t)st.st_size;
+    if (size != 0) {
+      void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED)
+        data = (const char*)p;
+    }
+    close(fd); // the mapping stays
+    return size == 0 || data != nullptr;
+#endif
+  }
+
+  ~MappedTextFile()
+  {
+#ifdef AVS_WINDOWS
+    if (data)
+      UnmapViewOfFile(data);
+    if (mapping)
+      CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+#else
+    if (data)
+      munmap((void*)data, size);
+#endif
+  }
+
+  // Copies the line starting at pos to line, without the line break. Returns the position of the next line.
+  size_t GetLine(size_t pos, std::string& line) const
+  {
+    const char* start = data + pos;
+    const char* eol = (const char*)memchr(start, '\n', size - pos);
+    size_t len = eol ? eol - start : size - pos;
+    line.assign(start, len);
+    if (len && line[len - 1] == '\r')
+      line.resize(len - 1);
+    return eol ? pos + len + 1 : size;
+  }
+
+  // Line number of the line starting at pos, for error messages
+  int LineNumber(size_t pos) const
+  {
+    return 1 + (int)std::count(data, data + pos, '\n');
+  }
+
+private:
+#ifdef AVS_WINDOWS
+  HANDLE file;
+  HANDLE mapping;
+#endif
+};
+
+
 ConditionalReader::ConditionalReader(PClip _child, const char* filename, const char _varname[],
-  bool _show, const char *_condVarSuffix, bool _local, IScriptEnvironment* env)
+  bool _show, const char *_condVarSuffix, bool _local, bool streaming, const char* index_name, IScriptEnvironment* env)
  : GenericVideoFilter(_child), show(_show), mode(MODE_UNKNOWN), offset(0), local(_local), stringcache(0)
 {
   FILE * f;
@@ -186,6 +288,11 @@ ConditionalReader::ConditionalReader(PClip _child, const char* filename, const c
     variableName += _condVarSuffix; // append if parameter exists
   variableNameFixed = env->SaveString(variableName.c_str());
 
+  if (streaming || *index_name) {
+    OpenStreaming(filename, index_name, env);
+    return;
+  }
+
   if ((f = fopen(filename, "rb")) == NULL)
     env->ThrowError("ConditionalReader: Could not open file '%s'.", filename);
 
@@ -193,136 +300,55 @@ ConditionalReader::ConditionalReader(PClip _child, const char* filename, const c
 
   try {
     while ((line = readline(f)) != NULL) {
-      char *ptr;
-      int fields;
+      ParsedLine p;
 
       lines++;
 
-      /* We skip spaces */
-      ptr = skipspaces(line);
+      if (ParseLine(line, lines, p, env)) {
+        switch (p.kind) {
+        case LINE_TYPE:
+          mode = p.type;
+          switch (mode) {
+          case MODE_INT: intVal = new int[vi.num_frames]; break;
+          case MODE_FLOAT: floatVal = new float[vi.num_frames]; break;
+          case MODE_BOOL: boolVal = new bool[vi.num_frames]; break;
+          case MODE_STRING: stringVal = new const char*[vi.num_frames]; break;
+          }
+          SetRange(0, vi.num_frames-1, AVSValue());
+          break;
 
-      /* Skip coment lines or empty lines */
-      if(iscomment(ptr) || *ptr == '\0') {
-        free(line);
-        line = 0;
-        continue;
-      }
+        case LINE_DEFAULT:
+          SetRange(0, vi.num_frames-1, ConvertType(p.value, lines, env));
+          break;
+
+        case LINE_OFFSET:
+          offset = p.start;
+          break;
 
-      if (mode == MODE_UNKNOWN) {
-        // We have not recieved a mode - We expect type.
-        char* keyword = ptr;
-
-        ptr = findspace(ptr);
-        if (*ptr) {
-          *ptr++ = '\0';
-          if (!lstrcmpi(keyword, "type")) {
-            /* We skip spaces */
-            char* type = skipspaces(ptr);
-
-            ptr = findspace(type);
-            *ptr = '\0';
-
-            if (!lstrcmpi(type, "int")) {
-              mode = MODE_INT;
-              intVal = new int[vi.num_frames];
-            } else if (!lstrcmpi(type, "float")) {
-              mode = MODE_FLOAT;
-              floatVal = new float[vi.num_frames];
-            } else if (!lstrcmpi(type, "bool")) {
-              mode = MODE_BOOL;
-              boolVal = new bool[vi.num_frames];
-            } else if (!lstrcmpi(type, "string")) {
-              mode = MODE_STRING;
-              stringVal = new const char*[vi.num_frames];
-            } else {
-              ThrowLine("ConditionalReader: Unknown 'Type' specified in line %d", lines, env);
-            }// end if compare type
-            SetRange(0, vi.num_frames-1, AVSValue());
-          }// end if compare keyword
-        }// end if fields
-
-      } else { // We have a defined mode and allocated the values.
-
-        char* keyword = ptr;
-        char* type = findspace(keyword);
-
-        if (*type) *type++ = '\0';
-
-        if (!lstrcmpi(keyword, "default")) {
-          AVSValue def = ConvertType(type, lines, env);
-          SetRange(0, vi.num_frames-1, def);
-
-        } else if (!lstrcmpi(keyword, "offset")) {
-          fields = sscanf(type, "%d", &offset);
-          if (fields != 1)
-            ThrowLine("ConditionalReader: Could not read Offset in line %d", lines, env);
-
-        } else if (keyword[0] == 'R' || keyword[0] == 'r') {  // Range
-          int start;
-          int stop;
-
-          type = skipspaces(type);
-          fields = sscanf(type, "%d", &start);
-
-          type = findspace(type);
-          type = skipspaces(type);
-          fields += sscanf(type, "%d", &stop);
-
-          type = findspace(type);
-          if (!*type || fields != 2)
-            ThrowLine("ConditionalReader: Could not read Range in line %d", lines, env);
-
-          if (start > stop)
-            ThrowLine("ConditionalReader: The Range start frame is after the end frame in line %d", lines, env);
-
-          AVSValue set = ConvertType(type+1, lines, env);
-          SetRange(start, stop, set);
-
-        } else if (keyword[0] == 'I' || keyword[0] == 'i') {  // Interpolate
-          if (mode == MODE_BOOL)
-            ThrowLine("ConditionalReader: Cannot Interpolate booleans in line %d", lines, env);
-
-          if (mode == MODE_STRING)
-            ThrowLine("ConditionalReader: Cannot Interpolate strings in line %d", lines, env);
-
-          type = skipspaces(type);
-          int start;
-          int stop;
-          char start_value[64];
-          char stop_value[64];
-          fields = sscanf(type, "%d %d %63s %63s", &start, &stop, start_value, stop_value);
-
-          if (fields != 4)
-            ThrowLine("ConditionalReader: Could not read Interpolation range in line %d", lines, env);
-          if (start > stop)
-            ThrowLine("ConditionalReader: The Interpolation start frame is after the end frame in line %d", lines, env);
-
-          start_value[63] = '\0';
-          AVSValue set_start = ConvertType(start_value, lines, env);
-
-          stop_value[63] = '\0';
-          AVSValue set_stop = ConvertType(stop_value, lines, env);
-
-          const int range = stop-start;
+        case LINE_RANGE:
+          SetRange(p.start, p.stop, ConvertType(p.value, lines, env));
+          break;
+
+        case LINE_INTERPOLATE: {
+          AVSValue set_start = ConvertType(p.start_value, lines, env);
+          AVSValue set_stop = ConvertType(p.stop_value, lines, env);
+
+          const int range = p.stop-p.start;
           const double diff = (set_stop.AsFloat() - set_start.AsFloat()) / range;
           for (int i = 0; i<=range; i++) {
             const double n = i * diff + set_start.AsFloat();
-            SetFrame(i+start, (mode == MODE_FLOAT)
+            SetFrame(i+p.start, (mode == MODE_FLOAT)
                     ? AVSValue(n)
                     : AVSValue((int)(n+0.5)));
           }
-        } else {
-          int cframe;
-          fields = sscanf(keyword, "%d", &cframe);
-          if ((*type || mode == MODE_STRING) && fields == 1) { // allow empty string
-            AVSValue set = ConvertType(type, lines, env);
-            SetFrame(cframe, set);
-          } else {
-            ThrowLine("ConditionalReader: Do not understand line %d", lines, env);
-          }
+          break;
         }
 
-      } // End we have defined type
+        case LINE_FRAME:
+          SetFrame(p.start, ConvertType(p.value, lines, env));
+          break;
+        }
+      }
       free(line);
       line = 0;
     }// end while still some file left to read.
@@ -343,6 +369,328 @@ ConditionalReader::ConditionalReader(PClip _child, const char* filename, const c
 }
 
 
+// Splits up a line of the file, modifying it. Returns false for lines to be skipped
+// (comments, empty lines, anything before the type line).
+
+bool ConditionalReader::ParseLine(char* line, int lineno, ParsedLine& p, IScriptEnvironment* env)
+{
+  int fields;
+
+  /* We skip spaces */
+  char* ptr = skipspaces(line);
+
+  /* Skip coment lines or empty lines */
+  if (iscomment(ptr) || *ptr == '\0')
+    return false;
+
+  p.kind = LINE_NONE;
+
+  if (mode == MODE_UNKNOWN) {
+    // We have not recieved a mode - We expect type.
+    char* keyword = ptr;
+
+    ptr = findspace(ptr);
+    if (*ptr) {
+      *ptr++ = '\0';
+      if (!lstrcmpi(keyword, "type")) {
+        /* We skip spaces */
+        char* type = skipspaces(ptr);
+
+        ptr = findspace(type);
+        *ptr = '\0';
+
+        p.kind = LINE_TYPE;
+        if (!lstrcmpi(type, "int")) {
+          p.type = MODE_INT;
+        } else if (!lstrcmpi(type, "float")) {
+          p.type = MODE_FLOAT;
+        } else if (!lstrcmpi(type, "bool")) {
+          p.type = MODE_BOOL;
+        } else if (!lstrcmpi(type, "string")) {
+          p.type = MODE_STRING;
+        } else {
+          ThrowLine("ConditionalReader: Unknown 'Type' specified in line %d", lineno, env);
+        }// end if compare type
+      }// end if compare keyword
+    }// end if fields
+    return p.kind != LINE_NONE;
+  }
+
+  // We have a defined mode.
+
+  char* keyword = ptr;
+  char* type = findspace(keyword);
+
+  if (*type) *type++ = '\0';
+
+  if (!lstrcmpi(keyword, "default")) {
+    p.kind = LINE_DEFAULT;
+    p.value = type;
+
+  } else if (!lstrcmpi(keyword, "offset")) {
+    p.kind = LINE_OFFSET;
+    fields = sscanf(type, "%d", &p.start);
+    if (fields != 1)
+      ThrowLine("ConditionalReader: Could not read Offset in line %d", lineno, env);
+
+  } else if (keyword[0] == 'R' || keyword[0] == 'r') {  // Range
+    type = skipspaces(type);
+    fields = sscanf(type, "%d", &p.start);
+
+    type = findspace(type);
+    type = skipspaces(type);
+    fields += sscanf(type, "%d", &p.stop);
+
+    type = findspace(type);
+    if (!*type || fields != 2)
+      ThrowLine("ConditionalReader: Could not read Range in line %d", lineno, env);
+
+    if (p.start > p.stop)
+      ThrowLine("ConditionalReader: The Range start frame is after the end frame in line %d", lineno, env);
+
+    p.kind = LINE_RANGE;
+    p.value = type+1;
+
+  } else if (keyword[0] == 'I' || keyword[0] == 'i') {  // Interpolate
+    if (mode == MODE_BOOL)
+      ThrowLine("ConditionalReader: Cannot Interpolate booleans in line %d", lineno, env);
+
+    if (mode == MODE_STRING)
+      ThrowLine("ConditionalReader: Cannot Interpolate strings in line %d", lineno, env);
+
+    type = skipspaces(type);
+    fields = sscanf(type, "%d %d %63s %63s", &p.start, &p.stop, p.start_value, p.stop_value);
+
+    if (fields != 4)
+      ThrowLine("ConditionalReader: Could not read Interpolation range in line %d", lineno, env);
+    if (p.start > p.stop)
+      ThrowLine("ConditionalReader: The Interpolation start frame is after the end frame in line %d", lineno, env);
+
+    p.start_value[63] = '\0';
+    p.stop_value[63] = '\0';
+    p.kind = LINE_INTERPOLATE;
+
+  } else {
+    fields = sscanf(keyword, "%d", &p.start);
+    if ((*type || mode == MODE_STRING) && fields == 1) { // allow empty string
+      p.kind = LINE_FRAME;
+      p.value = type;
+    } else {
+      ThrowLine("ConditionalReader: Do not understand line %d", lineno, env);
+    }
+  }
+  return true;
+}
+
+
+// Streaming ----------------------------------------------
+// Instead of the per-frame values, the position of the line which sets each frame
+// is stored (8 bytes per frame), the file stays mapped and the line is parsed again
+// when its frame is read. Values are checked then. The index can be saved beside the
+// file and is used again while the file is unchanged.
+
+void ConditionalReader::OpenStreaming(const char* filename, const char* index_name, IScriptEnvironment* env)
+{
+  mapped = std::unique_ptr<MappedTextFile>(new MappedTextFile());
+  if (!mapped->Open(filename))
+    env->ThrowError("ConditionalReader: Could not open file '%s'.", filename);
+
+  int64_t file_time = 0;
+  std::error_code ec;
+  auto t = fs::last_write_time(fs::path(filename), ec);
+  if (!ec)
+    file_time = (int64_t)t.time_since_epoch().count();
+
+  if (*index_name && LoadIndex(index_name, (int64_t)mapped->size, file_time))
+    return;
+
+  BuildIndex(env);
+
+  if (*index_name)
+    SaveIndex(index_name, (int64_t)mapped->size, file_time);
+}
+
+void ConditionalReader::BuildIndex(IScriptEnvironment* env)
+{
+  std::string line;
+  int lines = 0;
+  size_t pos = 0;
+
+  while (pos < mapped->size) {
+    const size_t line_pos = pos;
+    ParsedLine p;
+
+    pos = mapped->GetLine(pos, line);
+    lines++;
+
+    if (!ParseLine(&line[0], lines, p, env))
+      continue;
+
+    int start = 0;
+    int stop = vi.num_frames - 1;
+    switch (p.kind) {
+    case LINE_TYPE:
+      mode = p.type;
+      frame_lines.assign(vi.num_frames, -1);
+      continue;
+    case LINE_OFFSET:
+      offset = p.start;
+      offset_lines.emplace_back((int64_t)line_pos, offset);
+      continue;
+    case LINE_DEFAULT:
+      // shifted by the offset as well, like SetRange(0, num_frames - 1) does
+      start = max(offset, 0);
+      stop = min(vi.num_frames - 1 + offset, vi.num_frames - 1);
+      break;
+    case LINE_RANGE:
+    case LINE_INTERPOLATE:
+      start = max(p.start + offset, 0);
+      stop = min(p.stop + offset, vi.num_frames - 1);
+      break;
+    case LINE_FRAME:
+      start = stop = p.start + offset;
+      if (start < 0 || start > vi.num_frames - 1)
+        continue;
+      break;
+    }
+    std::fill(frame_lines.begin() + start, frame_lines.begin() + max(start, stop + 1), (int64_t)line_pos);
+  }
+
+  if (mode == MODE_UNKNOWN)
+    env->ThrowError("ConditionalReader: Type was not defined!");
+}
+
+struct ConditionalReaderIndexHeader {
+  char magic[8];
+  int32_t mode;
+  int32_t num_frames;
+  int64_t file_size;
+  int64_t file_time;
+  int64_t num_offset_lines;
+};
+
+static const char INDEX_MAGIC[8] = { 'A', 'V', 'S', 'C', 'R', 'I', 'X', '2' };
+
+bool ConditionalReader::LoadIndex(const char* index_name, int64_t file_size, int64_t file_time)
+{
+  FILE* f = fopen(index_name, "rb");
+  if (!f)
+    return false;
+
+  ConditionalReaderIndexHeader h;
+  bool ok = fread(&h, sizeof(h), 1, f) == 1
+    && !memcmp(h.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC))
+    && h.num_frames == vi.num_frames && h.file_size == file_size && h.file_time == file_time
+    && h.mode >= MODE_INT && h.mode <= MODE_STRING
+    && h.num_offset_lines >= 0 && h.num_offset_lines <= file_size;
+  if (ok) {
+    frame_lines.resize(h.num_frames);
+    offset_lines.resize((size_t)h.num_offset_lines);
+    ok = fread(frame_lines.data(), sizeof(int64_t), frame_lines.size(), f) == frame_lines.size();
+    for (size_t i = 0; ok && i < offset_lines.size(); i++) {
+      int64_t entry[2];
+      ok = fread(entry, sizeof(entry), 1, f) == 1;
+      offset_lines[i] = std::make_pair(entry[0], (int)entry[1]);
+    }
+    for (size_t i = 0; ok && i < frame_lines.size(); i++)
+      ok = frame_lines[i] >= -1 && frame_lines[i] < file_size;
+  }
+  fclose(f);
+
+  if (!ok) {
+    frame_lines.clear();
+    offset_lines.clear();
+    return false;
+  }
+  mode = h.mode;
+  return true;
+}
+
+// The index is only a speedup, it is not an error if it cannot be written
+void ConditionalReader::SaveIndex(const char* index_name, int64_t file_size, int64_t file_time)
+{
+  FILE* f = fopen(index_name, "wb");
+  if (!f)
+    return;
+
+  ConditionalReaderIndexHeader h;
+  memcpy(h.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  h.mode = mode;
+  h.num_frames = vi.num_frames;
+  h.file_size = file_size;
+  h.file_time = file_time;
+  h.num_offset_lines = (int64_t)offset_lines.size();
+
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+    && fwrite(frame_lines.data(), sizeof(int64_t), frame_lines.size(), f) == frame_lines.size();
+  for (size_t i = 0; ok && i < offset_lines.size(); i++) {
+    const int64_t entry[2] = { offset_lines[i].first, offset_lines[i].second };
+    ok = fwrite(entry, sizeof(entry), 1, f) == 1;
+  }
+  if (fclose(f) != 0 || !ok)
+    remove(index_name);
+}
+
+AVSValue ConditionalReader::GetStreamedValue(int framenumber, IScriptEnvironment* env)
+{
+  const int64_t line_pos = frame_lines[framenumber];
+
+  if (line_pos < 0) {
+    // no line sets the frame, as SetRange(AVSValue())
+    switch (mode) {
+    case MODE_INT: return AVSValue(0);
+    case MODE_FLOAT: return AVSValue(0.0f);
+    case MODE_BOOL: return AVSValue(false);
+    default: return AVSValue("");
+    }
+  }
+
+  if (mode == MODE_STRING) {
+    std::lock_guard<std::mutex> lock(string_mutex);
+    auto it = strings.find(line_pos);
+    if (it != strings.end())
+      return AVSValue(it->second.c_str());
+  }
+
+  std::string line;
+  ParsedLine p;
+  mapped->GetLine((size_t)line_pos, line);
+  ParseLine(&line[0], 0, p, env); // checked when the index was built
+
+  if (mode == MODE_STRING) {
+    std::lock_guard<std::mutex> lock(string_mutex);
+    return AVSValue(strings.emplace(line_pos, p.value).first->second.c_str());
+  }
+
+  try {
+    if (p.kind != LINE_INTERPOLATE)
+      return ConvertType(p.value, 0, env);
+
+    AVSValue set_start = ConvertType(p.start_value, 0, env);
+    AVSValue set_stop = ConvertType(p.stop_value, 0, env);
+
+    // frames of the line are counted from its start with the Offset before it
+    auto off = std::upper_bound(offset_lines.begin(), offset_lines.end(), std::make_pair(line_pos, INT_MAX));
+    const int line_offset = off == offset_lines.begin() ? 0 : (off - 1)->second;
+
+    const int range = p.stop-p.start;
+    const double diff = (set_stop.AsFloat() - set_start.AsFloat()) / range;
+    const double n = (framenumber - p.start - line_offset) * diff + set_start.AsFloat();
+    return (mode == MODE_FLOAT) ? AVSValue((float)n) : AVSValue((int)(n+0.5)); // as stored by SetFrame
+  }
+  catch (const AvisynthError&) {
+    // again, now with the line number in the message
+    const int lineno = mapped->LineNumber((size_t)line_pos);
+    if (p.kind == LINE_INTERPOLATE) {
+      ConvertType(p.start_value, lineno, env);
+      ConvertType(p.stop_value, lineno, env);
+    }
+    else
+      ConvertType(p.value, lineno, env);
+    throw;
+  }
+}
+
 
 // Converts from the char array given to the type specified.
 
@@ -483,9 +831,12 @@ void ConditionalReader::SetFrame(int framenumber, AVSValue v) {
 }
 
 // Get the value of a frame.
-AVSValue ConditionalReader::GetFrameValue(int framenumber) {
+AVSValue ConditionalReader::GetFrameValue(int framenumber, IScriptEnvironment* env) {
   framenumber = clamp(framenumber, 0, vi.num_frames-1);
 
+  if (mapped)
+    return GetStreamedValue(framenumber, env);
+
   switch (mode) {
     case MODE_INT:
       return AVSValue(intVal[framenumber]);
@@ -512,6 +863,13 @@ ConditionalReader::~ConditionalReader(void)
 
 void ConditionalReader::CleanUp(void)
 {
+  if (mapped) {
+    // no value arrays when streaming
+    mapped.reset();
+    mode = MODE_UNKNOWN;
+    return;
+  }
+
   switch (mode) {
     case MODE_INT:
       delete[] intVal;
@@ -547,11 +905,11 @@ void ConditionalReader::ThrowLine(const char* err, int line, IScriptEnvironment*
 
 PVideoFrame __stdcall ConditionalReader::GetFrame(int n, IScriptEnvironment* env_)
 {
-  AVSValue v = GetFrameValue(n);
-
   InternalEnvironment* IEnv = GetAndRevealCamouflagedEnv(env_);
   IScriptEnvironment* env = static_cast<IScriptEnvironment*>(IEnv);
 
+  AVSValue v = GetFrameValue(n, env);
+
   std::unique_ptr<GlobalVarFrame> var_frame;
 
   AVSValue child_val = child;
@@ -594,7 +952,8 @@ AVSValue __cdecl ConditionalReader::Create(AVSValue args, void*, IScriptEnvironm
 {
   const bool runtime_local_default = false; // Avisynth compatibility: false, Neo: true.
 
-  return new ConditionalReader(args[0].AsClip(), args[1].AsString(""), args[2].AsString("Conditional") , args[3].AsBool(false), args[4].AsString(""), args[5].AsBool(runtime_local_default), env);
+  return new ConditionalReader(args[0].AsClip(), args[1].AsString(""), args[2].AsString("Conditional") , args[3].AsBool(false), args[4].AsString(""), args[5].AsBool(runtime_local_default),
+    args[6].AsBool(false), args[7].AsString(""), env);
 }
 
 
@@ -606,8 +965,173 @@ static const char AplusT[] = "a+t";
 static const char WplusT[] = "w+t";
 
 
+static std::mutex async_writers_mutex;
+static std::map<std::string, std::weak_ptr<AsyncLineWriter>> async_writers; // by full file name
+
+std::shared_ptr<AsyncLineWriter> AsyncLineWriter::Get(const char* filename, FILE* fout, bool flush)
+{
+  std::lock_guard<std::mutex> lock(async_writers_mutex);
+  // forget the files whose writers are gone
+  for (auto it = async_writers.begin(); it != async_writers.end(); ) {
+    if (it->second.expired())
+      it = async_writers.erase(it);
+    else
+      ++it;
+  }
+  std::shared_ptr<AsyncLineWriter> writer = async_writers[filename].lock();
+  if (writer) {
+    fclose(fout);
+    std::lock_guard<std::mutex> writer_lock(writer->mutex);
+    writer->flush |= flush;
+  }
+  else {
+    writer = std::make_shared<AsyncLineWriter>(fout, flush);
+    async_writers[filename] = writer;
+  }
+  return writer;
+}
+
+std::shared_ptr<AsyncLineWriter> AsyncLineWriter::Find(const char* filename)
+{
+  std::lock_guard<std::mutex> lock(async_writers_mutex);
+  auto it = async_writers.find(filename);
+  if (it == async_writers.end())
+    return nullptr;
+  std::shared_ptr<AsyncLineWriter> writer = it->second.lock();
+  if (!writer)
+    async_writers.erase(it);
+  return writer;
+}
+
+AsyncLineWriter::AsyncLineWriter(FILE* fout, bool flush) :
+  fout(fout), flush(flush), written_end(0), stop(false)
+{
+  thread = std::thread(&AsyncLineWriter::Run, this);
+}
+
+AsyncLineWriter::~AsyncLineWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  ready_cond.notify_one();
+  thread.join();
+  fclose(fout);
+}
+
+int AsyncLineWriter::AddStream()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  next_frame.push_back(written_end);
+  return (int)next_frame.size() - 1;
+}
+
+void AsyncLineWriter::Push(int stream, int n, std::string&& line)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  space_cond.wait(lock, [this] { return pending.size() < MAX_PENDING; });
+  pending.emplace(std::make_pair(n, stream), std::move(line)); // after the earlier lines of the same key
+  Advance(stream);
+  if (IsReady())
+    ready_cond.notify_one();
+}
+
+void AsyncLineWriter::PushLast(std::string&& line)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  last_lines += line;
+}
+
+// Moves the stream past its frames which have arrived
+void AsyncLineWriter::Advance(int stream)
+{
+  int& next = next_frame[stream];
+  while (pending.find(std::make_pair(next, stream)) != pending.end())
+    next++;
+}
+
+// Whether the lowest waiting frame n can be written
+bool AsyncLineWriter::IsFrameReady(int n, bool give_up) const
+{
+  if (n < written_end)
+    return true;
+  if (give_up)
+    return true;
+  for (int next : next_frame) {
+    if (next <= n)
+      return false;
+  }
+  return true;
+}
+
+bool AsyncLineWriter::IsReady() const
+{
+  if (pending.empty())
+    return false;
+  const int n = pending.begin()->first.first;
+  int lowest = n;
+  for (int next : next_frame) {
+    if (next < lowest)
+      lowest = next;
+  }
+  const bool give_up = stop || pending.size() >= MAX_PENDING || pending.rbegin()->first.first - lowest > MAX_GAP;
+  return IsFrameReady(n, give_up);
+}
+
+// Moves the lines which can be written now to batch, in frame order
+void AsyncLineWriter::TakeReady(std::string& batch)
+{
+  while (IsReady()) {
+    const int n = pending.begin()->first.first;
+    auto it = pending.begin();
+    for (; it != pending.end() && it->first.first == n; ++it)
+      batch += it->second;
+    pending.erase(pending.begin(), it);
+    if (n >= written_end) {
+      written_end = n + 1;
+      // streams which did not get the frame go on after it
+      for (int stream = 0; stream < (int)next_frame.size(); stream++) {
+        if (next_frame[stream] < written_end) {
+          next_frame[stream] = written_end;
+          Advance(stream);
+        }
+      }
+    }
+  }
+  if (stop && pending.empty()) {
+    batch += last_lines;
+    last_lines.clear();
+  }
+}
+
+void AsyncLineWriter::Run()
+{
+  std::string batch;
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    ready_cond.wait(lock, [this] { return stop || IsReady(); });
+    batch.clear();
+    TakeReady(batch);
+    const bool done = stop && pending.empty();
+    const bool do_flush = flush;
+    lock.unlock();
+    space_cond.notify_all();
+
+    if (!batch.empty()) {
+      fwrite(batch.data(), 1, batch.size(), fout);
+      if (do_flush)
+        fflush(fout);
+    }
+    if (done)
+      return;
+    lock.lock();
+  }
+}
+
+
 Write::Write(PClip _child, const char* _filename, AVSValue args, int _linecheck, bool _append, bool _flush, bool _local, IScriptEnvironment* env_) :
-  GenericVideoFilter(_child), linecheck(_linecheck), flush(_flush), append(_append), local(_local), arglist(0)
+  GenericVideoFilter(_child), linecheck(_linecheck), flush(_flush), append(_append), local(_local)
 {
   InternalEnvironment* IEnv = GetAndRevealCamouflagedEnv(env_);
   IScriptEnvironment* env = static_cast<IScriptEnvironment*>(IEnv);
@@ -621,19 +1145,32 @@ Write::Write(PClip _child, const char* _filename, AVSValue args, int _linecheck,
   fout = fopen(filename, append ? AplusT : WplusT);	//append or purge file
   if (!fout) env->ThrowError("Write: File '%s' cannot be opened.", filename);
 
-  if (flush) fclose(fout);	//will be reopened in FileOut
-
-  arrsize = args.ArraySize();
+  const int arrsize = args.ArraySize();
+  for (int i = 0; i < arrsize; i++)
+    expressions.push_back(args[i]);
 
-  arglist = new exp_res[arrsize];
+  if (linecheck != -1 && linecheck != -2) {
+    // per frame lines: the file stays open in the writer, shared with the other Write filters
+    // of the file. Flush is done by the writer after each batch.
+    writer = AsyncLineWriter::Get(filename, fout, flush);
+    fout = nullptr;
+    stream = writer->AddStream();
+    return;
+  }
 
-  for (int i = 0; i < arrsize; i++) {
-    arglist[i].expression = args[i];
-    arglist[i].string = EMPTY;
+  if (linecheck == -2 && append) {
+    // the end line goes after the lines still waiting in the writer of the file
+    writer = AsyncLineWriter::Find(filename);
+    if (writer) {
+      fclose(fout);
+      fout = nullptr;
+    }
   }
 
-  if (linecheck != -1 && linecheck != -2)
-    return;
+  if (flush) {
+    fclose(fout);	//will be reopened in FileOut
+    fout = nullptr;
+  }
 
   AVSValue prev_last;
   AVSValue prev_current_frame;
@@ -654,10 +1191,10 @@ Write::Write(PClip _child, const char* _filename, AVSValue args, int _linecheck,
     env->SetGlobalVar("current_frame", (AVSValue)linecheck);  // special -1 or -2
   }
 
-  Write::DoEval(env); // at both write at start and write at end
+  Write::DoEval(end_line, env); // at both write at start and write at end
 
   if (linecheck == -1) { //write at start
-    Write::FileOut(env, AplusT);
+    Write::FileOut(end_line, env, AplusT);
   }
 
   if (!local) {
@@ -696,9 +1233,10 @@ PVideoFrame __stdcall Write::GetFrame(int n, IScriptEnvironment* env_) {
     env->SetGlobalVar("current_frame", (AVSValue)n);  // Set frame to be tested by the conditional filters.
   }
 
-  if (Write::DoEval(env)) {
-    Write::FileOut(env, AplusT);
-  }
+  std::string line;
+  if (!Write::DoEval(line, env))
+    line.clear(); // still tells the writer that the frame is done
+  writer->Push(stream, n, std::move(line));
 
   if (!local) {
     env->SetVar("last", prev_last);       // Restore implicit last
@@ -711,15 +1249,16 @@ PVideoFrame __stdcall Write::GetFrame(int n, IScriptEnvironment* env_) {
 
 Write::~Write(void) {
   if (linecheck == -2) {	//write at end
-    Write::FileOut(0, append ? AplusT : WplusT); // Allow for retruncating at actual end
+    if (writer)
+      writer->PushLast(std::move(end_line));
+    else
+      Write::FileOut(end_line, 0, append ? AplusT : WplusT); // Allow for retruncating at actual end
   }
-  if (!flush) fclose(fout);
-
-  delete[] arglist;
+  writer.reset(); // the last one writes the waiting lines
+  if (fout) fclose(fout);
 };
 
-void Write::FileOut(IScriptEnvironment* env, const char* mode) {
-  int i;
+void Write::FileOut(const std::string& line, IScriptEnvironment* env, const char* mode) {
   if (flush) {
     fout = fopen(filename, mode);
     if (!fout) {
@@ -727,23 +1266,23 @@ void Write::FileOut(IScriptEnvironment* env, const char* mode) {
       return;
     }
   }
-  for (i= ( (linecheck==1) ? 1 : 0) ; i<arrsize; i++ ) {
-    fputs(arglist[i].string, fout);
-  }
-  fputs("\n", fout);
+  fputs(line.c_str(), fout);
   if (flush) {
     fclose(fout);
+    fout = nullptr;
   }
 }
 
-bool Write::DoEval( IScriptEnvironment* env) {
+// Evaluates the expressions into line, with the newline. Returns false when the
+// condition of WriteFileIf is false.
+bool Write::DoEval(std::string& line, IScriptEnvironment* env) {
   bool keep_this_line = true;
-  int i;
   AVSValue expr;
   AVSValue result;
 
-  for (i=0; i<arrsize; i++) {
-    expr = arglist[i].expression;
+  line.clear();
+  for (size_t i = 0; i < expressions.size(); i++) {
+    expr = expressions[i];
 
     if ( (linecheck==1) && (i==0)) {
       try {
@@ -771,12 +1310,13 @@ bool Write::DoEval( IScriptEnvironment* env) {
           result = env->Invoke("Eval", expr);
         }
         result = env->Invoke("string",result);	//convert all results to a string
-        arglist[i].string = result.AsString(EMPTY);
+        line += result.AsString(EMPTY);
       } catch (const AvisynthError &error) {
-        arglist[i].string = env->SaveString(error.msg);
+        line += error.msg;
       }
     }
   }
+  line += "\n";
   return keep_this_line;
 }
 
@@ -785,7 +1325,7 @@ int __stdcall Write::SetCacheHints(int cachehints, int frame_range)
   switch (cachehints)
   {
   case CACHE_GET_MTMODE:
-    return MT_SERIALIZED;
+    return MT_NICE_FILTER; // lines are put in frame order by the writer
   }
   return 0;  // We do not pass cache requests upwards.
 }
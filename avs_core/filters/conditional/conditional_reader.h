@@ -24,6 +24,10 @@
 #include <vector>
 #include <string>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <map>
+#include <memory>
 
 #ifdef AVS_POSIX
 #include <limits.h>
@@ -42,9 +46,23 @@ struct StringCache {
   StringCache *next;
 };
 
+class MappedTextFile;
+
 class ConditionalReader : public GenericVideoFilter
 {
 private:
+  enum { LINE_NONE, LINE_TYPE, LINE_DEFAULT, LINE_OFFSET, LINE_RANGE, LINE_INTERPOLATE, LINE_FRAME };
+
+  // A line of the file split up by ParseLine, pointers into the line
+  struct ParsedLine {
+    int kind;
+    int type;        // LINE_TYPE: the mode
+    int start, stop; // frames, LINE_OFFSET: the offset in start
+    const char* value;
+    char start_value[64];
+    char stop_value[64];
+  };
+
   const bool show;
   std::string variableName;
   const char* variableNameFixed;
@@ -59,15 +77,30 @@ private:
     const char* *stringVal;
   };
 
+  // streaming: the file stays mapped, the values are parsed when their frame is read
+  std::unique_ptr<MappedTextFile> mapped;
+  std::vector<int64_t> frame_lines; // file position of the line setting the frame, -1: none
+  std::vector<std::pair<int64_t, int>> offset_lines; // position and value of the Offset lines
+  std::mutex string_mutex;
+  std::map<int64_t, std::string> strings; // string values by line position
+
+  bool ParseLine(char* line, int lineno, ParsedLine& p, IScriptEnvironment* env);
   AVSValue ConvertType(const char* content, int line, IScriptEnvironment* env);
   void SetRange(int start_frame, int stop_frame, AVSValue v);
   void SetFrame(int framenumber, AVSValue v);
   void ThrowLine(const char* err, int line, IScriptEnvironment* env);
-  AVSValue GetFrameValue(int framenumber);
+  AVSValue GetFrameValue(int framenumber, IScriptEnvironment* env);
   void CleanUp(void);
 
+  void OpenStreaming(const char* filename, const char* index_name, IScriptEnvironment* env);
+  void BuildIndex(IScriptEnvironment* env);
+  bool LoadIndex(const char* index_name, int64_t file_size, int64_t file_time);
+  void SaveIndex(const char* index_name, int64_t file_size, int64_t file_time);
+  AVSValue GetStreamedValue(int framenumber, IScriptEnvironment* env);
+
 public:
-  ConditionalReader(PClip _child, const char* filename, const char _varname[], bool _show, const char *_condVarSuffix, bool _local, IScriptEnvironment* env);
+  ConditionalReader(PClip _child, const char* filename, const char _varname[], bool _show, const char *_condVarSuffix, bool _local,
+    bool streaming, const char* index_name, IScriptEnvironment* env);
   ~ConditionalReader(void);
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
   int __stdcall SetCacheHints(int cachehints, int frame_range);
@@ -80,6 +113,54 @@ public:
 ** Ernst Peché, 2004
 */
 
+// Writes the lines of the Write filters of one file on a background thread, in frame
+// order. GetFrame only hands the line over; lines are collected and written in batches.
+// Each filter is a stream. A frame is written when every stream has passed it, the lines
+// of the streams in the order the filters were made (upstream first), so the file does not
+// depend on the order in which the threads of Prefetch finish their frames.
+// A frame still missing is given up when MAX_PENDING lines are waiting or when a line
+// arrives more than MAX_GAP frames beyond it (seek, or a filter not getting all the frames).
+// Lines of frames already written are written right away.
+class AsyncLineWriter
+{
+public:
+  // The writer of the file, made with fout when there is none yet. Otherwise fout is closed.
+  static std::shared_ptr<AsyncLineWriter> Get(const char* filename, FILE* fout, bool flush);
+  // The writer of the file, if any
+  static std::shared_ptr<AsyncLineWriter> Find(const char* filename);
+
+  AsyncLineWriter(FILE* fout, bool flush);
+  ~AsyncLineWriter(); // writes all waiting lines
+
+  int AddStream();
+  // An empty line only tells that the stream is done with frame n
+  void Push(int stream, int n, std::string&& line);
+  // Written after all the others
+  void PushLast(std::string&& line);
+
+private:
+  enum { MAX_PENDING = 4096, MAX_GAP = 256 };
+
+  FILE* const fout;
+  bool flush;
+
+  std::mutex mutex;
+  std::condition_variable ready_cond;
+  std::condition_variable space_cond;
+  std::multimap<std::pair<int, int>, std::string> pending; // (frame, stream)
+  std::vector<int> next_frame; // of each stream
+  int written_end; // frames before this are written
+  std::string last_lines;
+  bool stop;
+  std::thread thread;
+
+  void Advance(int stream);
+  bool IsFrameReady(int n, bool give_up) const;
+  bool IsReady() const;
+  void TakeReady(std::string& batch);
+  void Run();
+};
+
 class Write : public GenericVideoFilter
 {
 private:
@@ -94,18 +175,16 @@ private:
 #else
 	char filename[PATH_MAX];
 #endif
-	int arrsize;
-	struct exp_res {
-		AVSValue expression;
-		const char* string;
-	};
-	exp_res* arglist;
+	std::vector<AVSValue> expressions;
+	std::string end_line; // evaluated at start, written at end
+	std::shared_ptr<AsyncLineWriter> writer;
+	int stream;
 
-	bool DoEval(IScriptEnvironment* env);
-	void FileOut(IScriptEnvironment* env, const char* mode);
+	bool DoEval(std::string& line, IScriptEnvironment* env);
+	void FileOut(const std::string& line, IScriptEnvironment* env, const char* mode);
 
 public:
-    Write(PClip _child, const char* _filename, AVSValue args, int _linecheck, bool _flush, bool _append, bool _local, IScriptEnvironment* env);
+    Write(PClip _child, const char* _filename, AVSValue args, int _linecheck, bool _append, bool _flush, bool _local, IScriptEnvironment* env);
 	~Write(void);
 	PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
   int __stdcall SetCacheHints(int cachehints, int frame_range);
@@ -0,0 +1,276 @@
+
+// Avisynth v2.5.  Copyright 2002 Ben Rudiak-Gould et al.
+// http://avisynth.nl
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA, or visit
+// http://www.gnu.org/copyleft/gpl.html .
+//
+// Linking Avisynth statically or dynamically with other modules is making a
+// combined work based on Avisynth.  Thus, the terms and conditions of the GNU
+// General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of Avisynth give you
+// permission to link Avisynth with independent modules that communicate with
+// Avisynth solely through the interfaces defined in avisynth.h, regardless of the license
+// terms of these independent modules, and to copy and distribute the
+// resulting combined work under terms of your choice, provided that
+// every copy of the combined work is accompanied by a complete copy of
+// the source code of Avisynth (the version of Avisynth used to produce the
+// combined work), being distributed under the terms of the GNU General
+// Public License plus this exception.  An independent module is a module
+// which is not derived from or based on Avisynth, such as 3rd-party filters,
+// import and export plugins, or graphical user interfaces.
+
+
+#include <avisynth.h>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+// experimental simd includes for avx2 compiled files
+#if defined (__GNUC__) && ! defined (__INTEL_COMPILER)
+#include <x86intrin.h>
+// x86intrin.h includes header files for whatever instruction
+// sets are specified on the compiler command line, such as: xopintrin.h, fma4intrin.h
+#else
+#include <immintrin.h> // MS version of immintrin.h covers AVX, AVX2 and FMA3
+#endif // __GNUC__
+
+#include "conditional_functions_avx2.h"
+
+// sum, min and max of a plane in one pass
+void get_sum_minmax_uint8_avx2(const uint8_t* srcp, size_t height, size_t width, int pitch, int64_t& sum, int& min, int& max) {
+  const size_t mod32_width = width / 32 * 32;
+  int64_t result = 0;
+  int tail_min = 255;
+  int tail_max = 0;
+  __m256i acc = _mm256_setzero_si256();
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i vmin = _mm256_set1_epi8((char)0xFF);
+  __m256i vmax = _mm256_setzero_si256();
+
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < mod32_width; x += 32) {
+      __m256i src = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcp + x));
+      acc = _mm256_add_epi64(acc, _mm256_sad_epu8(src, zero));
+      vmin = _mm256_min_epu8(vmin, src);
+      vmax = _mm256_max_epu8(vmax, src);
+    }
+
+    for (size_t x = mod32_width; x < width; ++x) {
+      const int pix = srcp[x];
+      result += pix;
+      tail_min = std::min(tail_min, pix);
+      tail_max = std::max(tail_max, pix);
+    }
+
+    srcp += pitch;
+  }
+
+  alignas(32) int64_t accs[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(accs), acc);
+  sum = result + accs[0] + accs[1] + accs[2] + accs[3];
+
+  alignas(32) uint8_t mins[32], maxs[32];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(mins), vmin);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), vmax);
+  min = tail_min;
+  max = tail_max;
+  if (mod32_width > 0) {
+    for (int i = 0; i < 32; i++) {
+      min = std::min(min, (int)mins[i]);
+      max = std::max(max, (int)maxs[i]);
+    }
+  }
+  _mm256_zeroupper();
+}
+
+void get_sum_minmax_uint16_avx2(const uint8_t* srcp8, size_t height, size_t width, int pitch, int64_t& sum, int& min, int& max) {
+  const uint16_t* srcp = reinterpret_cast<const uint16_t*>(srcp8);
+  pitch /= (int)sizeof(uint16_t);
+  const size_t mod16_width = width / 16 * 16;
+  int64_t result = 0;
+  int tail_min = 65535;
+  int tail_max = 0;
+  __m256i acc = _mm256_setzero_si256();
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i vmin = _mm256_set1_epi16((short)0xFFFF);
+  __m256i vmax = _mm256_setzero_si256();
+
+  for (size_t y = 0; y < height; ++y) {
+    // 32 bit lanes hold a row of up to 262144 pixels
+    __m256i rowsum = _mm256_setzero_si256();
+    for (size_t x = 0; x < mod16_width; x += 16) {
+      __m256i src = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcp + x));
+      rowsum = _mm256_add_epi32(rowsum, _mm256_unpacklo_epi16(src, zero));
+      rowsum = _mm256_add_epi32(rowsum, _mm256_unpackhi_epi16(src, zero));
+      vmin = _mm256_min_epu16(vmin, src);
+      vmax = _mm256_max_epu16(vmax, src);
+    }
+    acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(rowsum, zero));
+    acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(rowsum, zero));
+
+    for (size_t x = mod16_width; x < width; ++x) {
+      const int pix = srcp[x];
+      result += pix;
+      tail_min = std::min(tail_min, pix);
+      tail_max = std::max(tail_max, pix);
+    }
+
+    srcp += pitch;
+  }
+
+  alignas(32) int64_t accs[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(accs), acc);
+  sum = result + accs[0] + accs[1] + accs[2] + accs[3];
+
+  alignas(32) uint16_t mins[16], maxs[16];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(mins), vmin);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), vmax);
+  min = tail_min;
+  max = tail_max;
+  if (mod16_width > 0) {
+    for (int i = 0; i < 16; i++) {
+      min = std::min(min, (int)mins[i]);
+      max = std::max(max, (int)maxs[i]);
+    }
+  }
+  _mm256_zeroupper();
+}
+
+// Sum is accumulated in double lanes: may differ from the C sum in the last bits.
+// min and max follow the C code, NaN is skipped unless it is the very first pixel.
+void get_sum_minmax_float_avx2(const uint8_t* srcp8, size_t height, size_t width, int pitch, double& sum, float& min, float& max) {
+  const float* srcp = reinterpret_cast<const float*>(srcp8);
+  pitch /= (int)sizeof(float);
+  const size_t mod8_width = width / 8 * 8;
+  double result = 0;
+  float tail_min = srcp[0];
+  float tail_max = srcp[0];
+  __m256d acc_lo = _mm256_setzero_pd();
+  __m256d acc_hi = _mm256_setzero_pd();
+  __m256 vmin = _mm256_set1_ps(srcp[0]);
+  __m256 vmax = vmin;
+
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < mod8_width; x += 8) {
+      __m256 src = _mm256_loadu_ps(srcp + x);
+      acc_lo = _mm256_add_pd(acc_lo, _mm256_cvtps_pd(_mm256_castps256_ps128(src)));
+      acc_hi = _mm256_add_pd(acc_hi, _mm256_cvtps_pd(_mm256_extractf128_ps(src, 1)));
+      // second operand is returned for NaN
+      vmin = _mm256_min_ps(src, vmin);
+      vmax = _mm256_max_ps(src, vmax);
+    }
+
+    for (size_t x = mod8_width; x < width; ++x) {
+      const float pix = srcp[x];
+      result += pix;
+      if (pix < tail_min) tail_min = pix;
+      if (pix > tail_max) tail_max = pix;
+    }
+
+    srcp += pitch;
+  }
+
+  alignas(32) double accs[4];
+  _mm256_store_pd(accs, _mm256_add_pd(acc_lo, acc_hi));
+  sum = result + ((accs[0] + accs[1]) + (accs[2] + accs[3]));
+
+  alignas(32) float mins[8], maxs[8];
+  _mm256_store_ps(mins, vmin);
+  _mm256_store_ps(maxs, vmax);
+  min = tail_min;
+  max = tail_max;
+  for (int i = 0; i < 8; i++) {
+    if (mins[i] < min) min = mins[i];
+    if (maxs[i] > max) max = maxs[i];
+  }
+  _mm256_zeroupper();
+}
+
+// sum of absolute differences, planar
+template<typename pixel_t>
+double get_sad_avx2(const uint8_t* src_ptr8, const uint8_t* other_ptr8, size_t height, size_t width, int src_pitch, int other_pitch) {
+  const pixel_t* src_ptr = reinterpret_cast<const pixel_t*>(src_ptr8);
+  const pixel_t* other_ptr = reinterpret_cast<const pixel_t*>(other_ptr8);
+  src_pitch /= (int)sizeof(pixel_t);
+  other_pitch /= (int)sizeof(pixel_t);
+  constexpr size_t pixels_per_cycle = 32 / sizeof(pixel_t);
+  const size_t mod_width = width / pixels_per_cycle * pixels_per_cycle;
+  const __m256i zero = _mm256_setzero_si256();
+
+  if constexpr (std::is_floating_point<pixel_t>::value) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256d acc_lo = _mm256_setzero_pd();
+    __m256d acc_hi = _mm256_setzero_pd();
+    double result = 0;
+    for (size_t y = 0; y < height; ++y) {
+      for (size_t x = 0; x < mod_width; x += pixels_per_cycle) {
+        __m256 src = _mm256_loadu_ps(src_ptr + x);
+        __m256 other = _mm256_loadu_ps(other_ptr + x);
+        __m256 absdiff = _mm256_and_ps(_mm256_sub_ps(other, src), abs_mask);
+        acc_lo = _mm256_add_pd(acc_lo, _mm256_cvtps_pd(_mm256_castps256_ps128(absdiff)));
+        acc_hi = _mm256_add_pd(acc_hi, _mm256_cvtps_pd(_mm256_extractf128_ps(absdiff, 1)));
+      }
+      for (size_t x = mod_width; x < width; ++x)
+        result += std::abs(other_ptr[x] - src_ptr[x]);
+      src_ptr += src_pitch;
+      other_ptr += other_pitch;
+    }
+    alignas(32) double accs[4];
+    _mm256_store_pd(accs, _mm256_add_pd(acc_lo, acc_hi));
+    _mm256_zeroupper();
+    return result + ((accs[0] + accs[1]) + (accs[2] + accs[3]));
+  }
+  else {
+    int64_t result = 0;
+    __m256i acc = _mm256_setzero_si256();
+    for (size_t y = 0; y < height; ++y) {
+      if constexpr (sizeof(pixel_t) == 1) {
+        for (size_t x = 0; x < mod_width; x += pixels_per_cycle) {
+          __m256i src = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src_ptr + x));
+          __m256i other = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(other_ptr + x));
+          acc = _mm256_add_epi64(acc, _mm256_sad_epu8(src, other));
+        }
+      }
+      else {
+        __m256i rowsum = _mm256_setzero_si256();
+        for (size_t x = 0; x < mod_width; x += pixels_per_cycle) {
+          __m256i src = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src_ptr + x));
+          __m256i other = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(other_ptr + x));
+          __m256i absdiff = _mm256_or_si256(_mm256_subs_epu16(src, other), _mm256_subs_epu16(other, src));
+          rowsum = _mm256_add_epi32(rowsum, _mm256_unpacklo_epi16(absdiff, zero));
+          rowsum = _mm256_add_epi32(rowsum, _mm256_unpackhi_epi16(absdiff, zero));
+        }
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(rowsum, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(rowsum, zero));
+      }
+      for (size_t x = mod_width; x < width; ++x)
+        result += std::abs(other_ptr[x] - src_ptr[x]);
+      src_ptr += src_pitch;
+      other_ptr += other_pitch;
+    }
+    alignas(32) int64_t accs[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(accs), acc);
+    _mm256_zeroupper();
+    return (double)(result + accs[0] + accs[1] + accs[2] + accs[3]);
+  }
+}
+
+// instantiate
+template double get_sad_avx2<uint8_t>(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, int src_pitch, int other_pitch);
+template double get_sad_avx2<uint16_t>(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, int src_pitch, int other_pitch);
+template double get_sad_avx2<float>(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, int src_pitch, int other_pitch);
@@ -0,0 +1,276 @@
+
+// Avisynth v2.5.  Copyright 2002 Ben Rudiak-Gould et al.
+// http://avisynth.nl
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA, or visit
+// http://www.gnu.org/copyleft/gpl.html .
+//
+// Linking Avisynth statically or dynamically with other modules is making a
+// combined work based on Avisynth.  Thus, the terms and conditions of the GNU
+// General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of Avisynth give you
+// permission to link Avisynth with independent modules that communicate with
+// Avisynth solely through the interfaces defined in avisynth.h, regardless of the license
+// terms of these independent modules, and to copy and distribute the
+// resulting combined work under terms of your choice, provided that
+// every copy of the combined work is accompanied by a complete copy of
+// the source code of Avisynth (the version of Avisynth used to produce the
+// combined work), being distributed under the terms of the GNU General
+// Public License plus this exception.  An independent module is a module
+// which is not derived from or based on Avisynth, such as 3rd-party filters,
+// import and export plugins, or graphical user interfaces.
+
+
+#include <avisynth.h>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+// experimental simd includes for avx512 compiled files
+#if defined (__GNUC__) && ! defined (__INTEL_COMPILER)
+#include <x86intrin.h>
+// x86intrin.h includes header files for whatever instruction
+// sets are specified on the compiler command line, such as: xopintrin.h, fma4intrin.h
+#else
+#include <immintrin.h> // MS version of immintrin.h covers AVX, AVX2, AVX512 and FMA3
+#endif // __GNUC__
+
+#include "conditional_functions_avx512.h"
+
+// All kernels here need AVX512F and AVX512BW.
+
+// sum, min and max of a plane in one pass
+void get_sum_minmax_uint8_avx512(const uint8_t* srcp, size_t height, size_t width, int pitch, int64_t& sum, int& min, int& max) {
+  const size_t mod64_width = width / 64 * 64;
+  int64_t result = 0;
+  int tail_min = 255;
+  int tail_max = 0;
+  __m512i acc = _mm512_setzero_si512();
+  const __m512i zero = _mm512_setzero_si512();
+  __m512i vmin = _mm512_set1_epi8((char)0xFF);
+  __m512i vmax = _mm512_setzero_si512();
+
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < mod64_width; x += 64) {
+      __m512i src = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(srcp + x));
+      acc = _mm512_add_epi64(acc, _mm512_sad_epu8(src, zero));
+      vmin = _mm512_min_epu8(vmin, src);
+      vmax = _mm512_max_epu8(vmax, src);
+    }
+
+    for (size_t x = mod64_width; x < width; ++x) {
+      const int pix = srcp[x];
+      result += pix;
+      tail_min = std::min(tail_min, pix);
+      tail_max = std::max(tail_max, pix);
+    }
+
+    srcp += pitch;
+  }
+
+  sum = result + _mm512_reduce_add_epi64(acc);
+
+  alignas(64) uint8_t mins[64], maxs[64];
+  _mm512_store_si512(reinterpret_cast<__m512i*>(mins), vmin);
+  _mm512_store_si512(reinterpret_cast<__m512i*>(maxs), vmax);
+  min = tail_min;
+  max = tail_max;
+  if (mod64_width > 0) {
+    for (int i = 0; i < 64; i++) {
+      min = std::min(min, (int)mins[i]);
+      max = std::max(max, (int)maxs[i]);
+    }
+  }
+  _mm256_zeroupper();
+}
+
+void get_sum_minmax_uint16_avx512(const uint8_t* srcp8, size_t height, size_t width, int pitch, int64_t& sum, int& min, int& max) {
+  const uint16_t* srcp = reinterpret_cast<const uint16_t*>(srcp8);
+  pitch /= (int)sizeof(uint16_t);
+  const size_t mod32_width = width / 32 * 32;
+  int64_t result = 0;
+  int tail_min = 65535;
+  int tail_max = 0;
+  __m512i acc = _mm512_setzero_si512();
+  const __m512i zero = _mm512_setzero_si512();
+  __m512i vmin = _mm512_set1_epi16((short)0xFFFF);
+  __m512i vmax = _mm512_setzero_si512();
+
+  for (size_t y = 0; y < height; ++y) {
+    // 32 bit lanes hold a row of up to 524288 pixels
+    __m512i rowsum = _mm512_setzero_si512();
+    for (size_t x = 0; x < mod32_width; x += 32) {
+      __m512i src = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(srcp + x));
+      rowsum = _mm512_add_epi32(rowsum, _mm512_unpacklo_epi16(src, zero));
+      rowsum = _mm512_add_epi32(rowsum, _mm512_unpackhi_epi16(src, zero));
+      vmin = _mm512_min_epu16(vmin, src);
+      vmax = _mm512_max_epu16(vmax, src);
+    }
+    acc = _mm512_add_epi64(acc, _mm512_unpacklo_epi32(rowsum, zero));
+    acc = _mm512_add_epi64(acc, _mm512_unpackhi_epi32(rowsum, zero));
+
+    for (size_t x = mod32_width; x < width; ++x) {
+      const int pix = srcp[x];
+      result += pix;
+      tail_min = std::min(tail_min, pix);
+      tail_max = std::max(tail_max, pix);
+    }
+
+    srcp += pitch;
+  }
+
+  sum = result + _mm512_reduce_add_epi64(acc);
+
+  alignas(64) uint16_t mins[32], maxs[32];
+  _mm512_store_si512(reinterpret_cast<__m512i*>(mins), vmin);
+  _mm512_store_si512(reinterpret_cast<__m512i*>(maxs), vmax);
+  min = tail_min;
+  max = tail_max;
+  if (mod32_width > 0) {
+    for (int i = 0; i < 32; i++) {
+      min = std::min(min, (int)mins[i]);
+      max = std::max(max, (int)maxs[i]);
+    }
+  }
+  _mm256_zeroupper();
+}
+
+static inline __m256 hi_half_ps(__m512 a) {
+  return _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(a), 1)); // no AVX512DQ needed
+}
+
+// Sum is accumulated in double lanes: may differ from the C sum in the last bits.
+// min and max follow the C code, NaN is skipped unless it is the very first pixel.
+void get_sum_minmax_float_avx512(const uint8_t* srcp8, size_t height, size_t width, int pitch, double& sum, float& min, float& max) {
+  const float* srcp = reinterpret_cast<const float*>(srcp8);
+  pitch /= (int)sizeof(float);
+  const size_t mod16_width = width / 16 * 16;
+  double result = 0;
+  float tail_min = srcp[0];
+  float tail_max = srcp[0];
+  __m512d acc_lo = _mm512_setzero_pd();
+  __m512d acc_hi = _mm512_setzero_pd();
+  __m512 vmin = _mm512_set1_ps(srcp[0]);
+  __m512 vmax = vmin;
+
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < mod16_width; x += 16) {
+      __m512 src = _mm512_loadu_ps(srcp + x);
+      acc_lo = _mm512_add_pd(acc_lo, _mm512_cvtps_pd(_mm512_castps512_ps256(src)));
+      acc_hi = _mm512_add_pd(acc_hi, _mm512_cvtps_pd(hi_half_ps(src)));
+      // second operand is returned for NaN
+      vmin = _mm512_min_ps(src, vmin);
+      vmax = _mm512_max_ps(src, vmax);
+    }
+
+    for (size_t x = mod16_width; x < width; ++x) {
+      const float pix = srcp[x];
+      result += pix;
+      if (pix < tail_min) tail_min = pix;
+      if (pix > tail_max) tail_max = pix;
+    }
+
+    srcp += pitch;
+  }
+
+  alignas(64) double accs[8];
+  _mm512_store_pd(accs, _mm512_add_pd(acc_lo, acc_hi));
+  sum = result + (((accs[0] + accs[1]) + (accs[2] + accs[3])) + ((accs[4] + accs[5]) + (accs[6] + accs[7])));
+
+  alignas(64) float mins[16], maxs[16];
+  _mm512_store_ps(mins, vmin);
+  _mm512_store_ps(maxs, vmax);
+  min = tail_min;
+  max = tail_max;
+  for (int i = 0; i < 16; i++) {
+    if (mins[i] < min) min = mins[i];
+    if (maxs[i] > max) max = maxs[i];
+  }
+  _mm256_zeroupper();
+}
+
+// sum of absolute differences, planar
+template<typename pixel_t>
+double get_sad_avx512(const uint8_t* src_ptr8, const uint8_t* other_ptr8, size_t height, size_t width, int src_pitch, int other_pitch) {
+  const pixel_t* src_ptr = reinterpret_cast<const pixel_t*>(src_ptr8);
+  const pixel_t* other_ptr = reinterpret_cast<const pixel_t*>(other_ptr8);
+  src_pitch /= (int)sizeof(pixel_t);
+  other_pitch /= (int)sizeof(pixel_t);
+  constexpr size_t pixels_per_cycle = 64 / sizeof(pixel_t);
+  const size_t mod_width = width / pixels_per_cycle * pixels_per_cycle;
+  const __m512i zero = _mm512_setzero_si512();
+
+  if constexpr (std::is_floating_point<pixel_t>::value) {
+    __m512d acc_lo = _mm512_setzero_pd();
+    __m512d acc_hi = _mm512_setzero_pd();
+    double result = 0;
+    for (size_t y = 0; y < height; ++y) {
+      for (size_t x = 0; x < mod_width; x += pixels_per_cycle) {
+        __m512 src = _mm512_loadu_ps(src_ptr + x);
+        __m512 other = _mm512_loadu_ps(other_ptr + x);
+        __m512 absdiff = _mm512_abs_ps(_mm512_sub_ps(other, src));
+        acc_lo = _mm512_add_pd(acc_lo, _mm512_cvtps_pd(_mm512_castps512_ps256(absdiff)));
+        acc_hi = _mm512_add_pd(acc_hi, _mm512_cvtps_pd(hi_half_ps(absdiff)));
+      }
+      for (size_t x = mod_width; x < width; ++x)
+        result += std::abs(other_ptr[x] - src_ptr[x]);
+      src_ptr += src_pitch;
+      other_ptr += other_pitch;
+    }
+    alignas(64) double accs[8];
+    _mm512_store_pd(accs, _mm512_add_pd(acc_lo, acc_hi));
+    _mm256_zeroupper();
+    return result + (((accs[0] + accs[1]) + (accs[2] + accs[3])) + ((accs[4] + accs[5]) + (accs[6] + accs[7])));
+  }
+  else {
+    int64_t result = 0;
+    __m512i acc = _mm512_setzero_si512();
+    for (size_t y = 0; y < height; ++y) {
+      if constexpr (sizeof(pixel_t) == 1) {
+        for (size_t x = 0; x < mod_width; x += pixels_per_cycle) {
+          __m512i src = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(src_ptr + x));
+          __m512i other = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(other_ptr + x));
+          acc = _mm512_add_epi64(acc, _mm512_sad_epu8(src, other));
+        }
+      }
+      else {
+        __m512i rowsum = _mm512_setzero_si512();
+        for (size_t x = 0; x < mod_width; x += pixels_per_cycle) {
+          __m512i src = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(src_ptr + x));
+          __m512i other = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(other_ptr + x));
+          __m512i absdiff = _mm512_or_si512(_mm512_subs_epu16(src, other), _mm512_subs_epu16(other, src));
+          rowsum = _mm512_add_epi32(rowsum, _mm512_unpacklo_epi16(absdiff, zero));
+          rowsum = _mm512_add_epi32(rowsum, _mm512_unpackhi_epi16(absdiff, zero));
+        }
+        acc = _mm512_add_epi64(acc, _mm512_unpacklo_epi32(rowsum, zero));
+        acc = _mm512_add_epi64(acc, _mm512_unpackhi_epi32(rowsum, zero));
+      }
+      for (size_t x = mod_width; x < width; ++x)
+        result += std::abs(other_ptr[x] - src_ptr[x]);
+      src_ptr += src_pitch;
+      other_ptr += other_pitch;
+    }
+    const int64_t vector_sum = _mm512_reduce_add_epi64(acc);
+    _mm256_zeroupper();
+    return (double)(result + vector_sum);
+  }
+}
+
+// instantiate
+template double get_sad_avx512<uint8_t>(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, int src_pitch, int other_pitch);
+template double get_sad_avx512<uint16_t>(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, int src_pitch, int other_pitch);
+template double get_sad_avx512<float>(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, int src_pitch, int other_pitch);
@@ -0,0 +1,52 @@
+
+// Avisynth v2.5.  Copyright 2002 Ben Rudiak-Gould et al.
+// http://avisynth.nl
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA, or visit
+// http://www.gnu.org/copyleft/gpl.html .
+//
+// Linking Avisynth statically or dynamically with other modules is making a
+// combined work based on Avisynth.  Thus, the terms and conditions of the GNU
+// General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of Avisynth give you
+// permission to link Avisynth with independent modules that communicate with
+// Avisynth solely through the interfaces defined in avisynth.h, regardless of the license
+// terms of these independent modules, and to copy and distribute the
+// resulting combined work under terms of your choice, provided that
+// every copy of the combined work is accompanied by a complete copy of
+// the source code of Avisynth (the version of Avisynth used to produce the
+// combined work), being distributed under the terms of the GNU General
+// Public License plus this exception.  An independent module is a module
+// which is not derived from or based on Avisynth, such as 3rd-party filters,
+// import and export plugins, or graphical user interfaces.
+
+
+#ifndef __Conditional_Functions_AVX512_H__
+#define __Conditional_Functions_AVX512_H__
+
+#include <avisynth.h>
+
+// AVX512F + AVX512BW
+
+void get_sum_minmax_uint8_avx512(const uint8_t* srcp, size_t height, size_t width, int pitch, int64_t& sum, int& min, int& max);
+void get_sum_minmax_uint16_avx512(const uint8_t* srcp, size_t height, size_t width, int pitch, int64_t& sum, int& min, int& max);
+void get_sum_minmax_float_avx512(const uint8_t* srcp, size_t height, size_t width, int pitch, double& sum, float& min, float& max);
+
+// width in pixels
+template<typename pixel_t>
+double get_sad_avx512(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, int src_pitch, int other_pitch);
+
+#endif // __Conditional_Functions_AVX512_H__
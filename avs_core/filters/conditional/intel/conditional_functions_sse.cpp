@@ -38,58 +38,108 @@
 #include <emmintrin.h>
 #include <algorithm>
 
-// sum: sad with zero
-double get_sum_of_pixels_sse2(const uint8_t* srcp, size_t height, size_t width, size_t pitch) {
+// sum, min and max of a plane in one pass
+void get_sum_minmax_uint8_sse2(const uint8_t* srcp, size_t height, size_t width, int pitch, int64_t& sum, int& min, int& max) {
   size_t mod16_width = width / 16 * 16;
   int64_t result = 0;
-  __m128i sum = _mm_setzero_si128();
+  int tail_min = 255;
+  int tail_max = 0;
+  __m128i acc = _mm_setzero_si128();
   __m128i zero = _mm_setzero_si128();
+  __m128i vmin = _mm_set1_epi8((char)0xFF);
+  __m128i vmax = _mm_setzero_si128();
 
   for (size_t y = 0; y < height; ++y) {
-    for (size_t x = 0; x < mod16_width; x+=16) {
-      __m128i src = _mm_load_si128(reinterpret_cast<const __m128i*>(srcp + x));
-      __m128i sad = _mm_sad_epu8(src, zero);
-      sum = _mm_add_epi32(sum, sad);
+    for (size_t x = 0; x < mod16_width; x += 16) {
+      __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcp + x));
+      acc = _mm_add_epi64(acc, _mm_sad_epu8(src, zero));
+      vmin = _mm_min_epu8(vmin, src);
+      vmax = _mm_max_epu8(vmax, src);
     }
 
     for (size_t x = mod16_width; x < width; ++x) {
-      result += srcp[x];
+      const int pix = srcp[x];
+      result += pix;
+      tail_min = std::min(tail_min, pix);
+      tail_max = std::max(tail_max, pix);
     }
 
     srcp += pitch;
   }
-  __m128i upper = _mm_castps_si128(_mm_movehl_ps(_mm_setzero_ps(), _mm_castsi128_ps(sum)));
-  sum = _mm_add_epi32(sum, upper);
-  result += _mm_cvtsi128_si32(sum);
-  return (double)result;
+  acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+  alignas(16) int64_t acc_lo[2];
+  _mm_store_si128(reinterpret_cast<__m128i*>(acc_lo), acc);
+  sum = result + acc_lo[0];
+
+  alignas(16) uint8_t mins[16], maxs[16];
+  _mm_store_si128(reinterpret_cast<__m128i*>(mins), vmin);
+  _mm_store_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+  min = tail_min;
+  max = tail_max;
+  if (mod16_width > 0) {
+    for (int i = 0; i < 16; i++) {
+      min = std::min(min, (int)mins[i]);
+      max = std::max(max, (int)maxs[i]);
+    }
+  }
 }
 
-#ifdef X86_32
-double get_sum_of_pixels_isse(const uint8_t* srcp, size_t height, size_t width, size_t pitch) {
+// uint16_t: min/max on sign-flipped words, no unsigned 16 bit min/max in SSE2
+void get_sum_minmax_uint16_sse2(const uint8_t* srcp8, size_t height, size_t width, int pitch, int64_t& sum, int& min, int& max) {
+  const uint16_t* srcp = reinterpret_cast<const uint16_t*>(srcp8);
+  pitch /= (int)sizeof(uint16_t);
   size_t mod8_width = width / 8 * 8;
   int64_t result = 0;
-  __m64 sum = _mm_setzero_si64();
-  __m64 zero = _mm_setzero_si64();
+  int tail_min = 65535;
+  int tail_max = 0;
+  __m128i acc = _mm_setzero_si128();
+  __m128i zero = _mm_setzero_si128();
+  __m128i signflip = _mm_set1_epi16((short)0x8000);
+  __m128i vmin = _mm_set1_epi16(0x7FFF);
+  __m128i vmax = _mm_set1_epi16((short)0x8000);
 
   for (size_t y = 0; y < height; ++y) {
-    for (size_t x = 0; x < mod8_width; x+=8) {
-      __m64 src = *reinterpret_cast<const __m64*>(srcp + x);
-      __m64 sad = _mm_sad_pu8(src, zero);
-      sum = _mm_add_pi32(sum, sad);
+    // 32 bit lanes hold a row of up to 131072 pixels
+    __m128i rowsum = _mm_setzero_si128();
+    for (size_t x = 0; x < mod8_width; x += 8) {
+      __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcp + x));
+      rowsum = _mm_add_epi32(rowsum, _mm_unpacklo_epi16(src, zero));
+      rowsum = _mm_add_epi32(rowsum, _mm_unpackhi_epi16(src, zero));
+      __m128i flipped = _mm_xor_si128(src, signflip);
+      vmin = _mm_min_epi16(vmin, flipped);
+      vmax = _mm_max_epi16(vmax, flipped);
     }
+    acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(rowsum, zero));
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(rowsum, zero));
 
     for (size_t x = mod8_width; x < width; ++x) {
-      result += srcp[x];
+      const int pix = srcp[x];
+      result += pix;
+      tail_min = std::min(tail_min, pix);
+      tail_max = std::max(tail_max, pix);
     }
 
     srcp += pitch;
   }
-  result += _mm_cvtsi64_si32(sum);
-  _mm_empty();
-  return (double)result;
+  alignas(16) int64_t acc_lo[2];
+  _mm_store_si128(reinterpret_cast<__m128i*>(acc_lo), acc);
+  sum = result + acc_lo[0] + acc_lo[1];
+
+  alignas(16) int16_t mins[8], maxs[8];
+  _mm_store_si128(reinterpret_cast<__m128i*>(mins), vmin);
+  _mm_store_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+  min = tail_min;
+  max = tail_max;
+  if (mod8_width > 0) {
+    for (int i = 0; i < 8; i++) {
+      min = std::min(min, (int)(uint16_t)(mins[i] ^ 0x8000));
+      max = std::max(max, (int)(uint16_t)(maxs[i] ^ 0x8000));
+    }
+  }
 }
 
-size_t get_sad_isse(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, size_t src_pitch, size_t other_pitch) {
+#ifdef X86_32
+size_t get_sad_isse(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, int src_pitch, int other_pitch) {
   size_t mod8_width = width / 8 * 8;
   size_t result = 0;
   __m64 sum = _mm_setzero_si64();
@@ -114,7 +164,7 @@ size_t get_sad_isse(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t hei
   return result;
 }
 
-size_t get_sad_rgb_isse(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, size_t src_pitch, size_t other_pitch) {
+size_t get_sad_rgb_isse(const uint8_t* src_ptr, const uint8_t* other_ptr, size_t height, size_t width, int src_pitch, int other_pitch) {
   size_t mod8_width = width / 8 * 8;
   size_t result = 0;
   __m64 rgb_mask = _mm_set1_pi32(0x00FFFFFF);
@@ -88,6 +88,9 @@
 #include <memory>
 #include <cmath>
 #include <unordered_map>
+#include <map>
+#include <tuple>
+#include <thread>
 
 #include <avisynth.h>
 
@@ -277,6 +280,54 @@ instr(t1, t1, t2); \
 vandps(t1, t1, CPTR_AVX(elfloat_one)); \
 stack1.push_back(t1);
 
+// AVX-512: comparisons set opmask registers. k1 is reserved for the partial chunk at the end of the line,
+// k2..k5 are scratch inside one operation.
+#define CmpOp_Avx512(op) \
+auto t1 = stack.back(); \
+stack.pop_back(); \
+auto t2 = stack.back(); \
+stack.pop_back(); \
+vcmpps(k2, t1.first, t2.first, op); \
+vcmpps(k3, t1.second, t2.second, op); \
+vbroadcastss(t1.first, k2, CPTR_AVX512(elfloat_one)); \
+vbroadcastss(t1.second, k3, CPTR_AVX512(elfloat_one)); \
+stack.push_back(t1);
+
+#define CmpOp_Single_Avx512(op) \
+auto t1 = stack1.back(); \
+stack1.pop_back(); \
+auto t2 = stack1.back(); \
+stack1.pop_back(); \
+vcmpps(k2, t1, t2, op); \
+vbroadcastss(t1, k2, CPTR_AVX512(elfloat_one)); \
+stack1.push_back(t1);
+
+#define LogicOp_Avx512(kinstr) \
+auto t1 = stack.back(); \
+stack.pop_back(); \
+auto t2 = stack.back(); \
+stack.pop_back(); \
+vcmpps(k2, t1.first, zero, _CMP_GT_OQ); \
+vcmpps(k3, t1.second, zero, _CMP_GT_OQ); \
+vcmpps(k4, t2.first, zero, _CMP_GT_OQ); \
+vcmpps(k5, t2.second, zero, _CMP_GT_OQ); \
+kinstr(k2, k2, k4); \
+kinstr(k3, k3, k5); \
+vbroadcastss(t1.first, k2, CPTR_AVX512(elfloat_one)); \
+vbroadcastss(t1.second, k3, CPTR_AVX512(elfloat_one)); \
+stack.push_back(t1);
+
+#define LogicOp_Single_Avx512(kinstr) \
+auto t1 = stack1.back(); \
+stack1.pop_back(); \
+auto t2 = stack1.back(); \
+stack1.pop_back(); \
+vcmpps(k2, t1, zero, _CMP_GT_OQ); \
+vcmpps(k3, t2, zero, _CMP_GT_OQ); \
+kinstr(k2, k2, k3); \
+vbroadcastss(t1, k2, CPTR_AVX512(elfloat_one)); \
+stack1.push_back(t1);
+
 enum {
     elabsmask, elc7F, elmin_norm_pos, elinv_mant_mask,
     elfloat_one, elfloat_minusone, elfloat_half, elsignmask, elstore8, elstore10, elstore12, elstore14, elstore16,
@@ -500,6 +551,8 @@ static constexpr ExprUnion logexpconst_avx alignas(32)[87][8] = {
 #undef XCONST
 
 #define CPTR_AVX(x) (ymmword_ptr[constptr + (x) * 32])
+// AVX-512: the same table, one float of the row as {1to16} broadcast operand
+#define CPTR_AVX512(x) (dword_ptr[constptr + (x) * 32])
 
 #define EXP_PS(x) { \
 XmmReg fx, emm0, etmp, y, mask, z; \
@@ -1267,6 +1320,212 @@ vcvtdq2ps(aTmp,aTmp); \
 vmulps(aTmp, aTmp, d); \
 vsubps(x, x, aTmp); }
 
+// AVX-512 versions. Same algorithms and same constants (broadcast from the ymm table) as the AVX2 ones,
+// vector masks are replaced by opmask registers k2..k5.
+#define EXP_PS_AVX512(x) { \
+ZmmReg fx, emm0, etmp, y, mask, z; \
+vminps(x, x, CPTR_AVX512(elexp_hi)); \
+vmaxps(x, x, CPTR_AVX512(elexp_lo)); \
+vmulps(fx, x, CPTR_AVX512(elcephes_LOG2EF)); \
+vaddps(fx, fx, CPTR_AVX512(elfloat_half)); \
+vcvttps2dq(emm0, fx); \
+vcvtdq2ps(etmp, emm0); \
+vcmpps(k2, etmp, fx, _CMP_GT_OQ); /* cmpnleps */ \
+vbroadcastss(mask, k2, CPTR_AVX512(elfloat_one)); \
+vsubps(fx, etmp, mask); \
+vfnmadd231ps(x, fx, CPTR_AVX512(elcephes_exp_C1)); \
+vfnmadd231ps(x, fx, CPTR_AVX512(elcephes_exp_C2)); \
+vmulps(z, x, x); \
+vbroadcastss(y, CPTR_AVX512(elcephes_exp_p0)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_exp_p1)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_exp_p2)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_exp_p3)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_exp_p4)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_exp_p5)); \
+vfmadd213ps(y, z, x); \
+vaddps(y, y, CPTR_AVX512(elfloat_one)); \
+vcvttps2dq(emm0, fx); \
+vpaddd(emm0, emm0, CPTR_AVX512(elc7F)); \
+vpslld(emm0, emm0, 23); \
+vmulps(x, y, emm0); \
+}
+
+#define LOG_PS_AVX512(x) { \
+ZmmReg emm0, mask, y, etmp, z; \
+vcmpps(k3, zero, x, _CMP_GT_OQ); /* invalid mask, cmpnleps */ \
+vmaxps(x, x, CPTR_AVX512(elmin_norm_pos)); \
+vpsrld(emm0, x, 23); \
+vpandd(x, x, CPTR_AVX512(elinv_mant_mask)); \
+vpord(x, x, CPTR_AVX512(elfloat_half)); \
+vpsubd(emm0, emm0, CPTR_AVX512(elc7F)); \
+vcvtdq2ps(emm0, emm0); \
+vaddps(emm0, emm0, CPTR_AVX512(elfloat_one)); \
+vcmpps(k2, x, CPTR_AVX512(elcephes_SQRTHF), _CMP_LT_OQ); /* cmpltps */ \
+vmovaps(etmp, k2, x); \
+vsubps(x, x, CPTR_AVX512(elfloat_one)); \
+vbroadcastss(mask, k2, CPTR_AVX512(elfloat_one)); \
+vsubps(emm0, emm0, mask); \
+vaddps(x, x, etmp); \
+vmulps(z, x, x); \
+vbroadcastss(y, CPTR_AVX512(elcephes_log_p0)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_log_p1)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_log_p2)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_log_p3)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_log_p4)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_log_p5)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_log_p6)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_log_p7)); \
+vfmadd213ps(y, x, CPTR_AVX512(elcephes_log_p8)); \
+vmulps(y, y, x); \
+vmulps(y, y, z); \
+vfmadd231ps(y, emm0, CPTR_AVX512(elcephes_log_q1)); \
+vfnmadd231ps(y, z, CPTR_AVX512(elfloat_half)); \
+vaddps(x, x, y); \
+vfmadd231ps(x, emm0, CPTR_AVX512(elcephes_log_q2)); \
+vpternlogd(x, k3, x, x, 0xFF); /* all bits set (NaN) where invalid */ \
+}
+
+#define TAN_PS_AVX512(x0) { \
+ZmmReg x1, x2, x3, x4, x5, x6, x7, x8, x9, x10; \
+/* Normalize to [-pi, pi] */ \
+vmulps(x2, x0, CPTR_AVX512(float_invpi)); /* x / pi */ \
+vrndscaleps(x3, x2, FROUND_TO_NEAREST_INT); /* round(x / pi) */ \
+vbroadcastss(x4, CPTR_AVX512(float_pi1)); \
+vmulps(x5, x3, x4); /* round(x / pi) * pi1 */ \
+vsubps(x6, x0, x5); \
+vmulps(x7, x3, CPTR_AVX512(float_pi2)); \
+vsubps(x6, x6, x7); \
+vmulps(x7, x3, CPTR_AVX512(float_pi3)); \
+vsubps(x6, x6, x7); \
+vmulps(x7, x3, CPTR_AVX512(float_pi4)); \
+vsubps(x6, x6, x7); /* now x is in range [-pi, pi] */ \
+/* normalize to [-pi/2, pi/2] */ \
+vmulps(x5, x4, CPTR_AVX512(elfloat_half)); /* halfPI */ \
+vcmpps(k2, x6, x5, _CMP_GT_OQ); /* y > halfPI */ \
+vsubps(x8, x4, x6); /* pi - y */ \
+vblendmps(x6, k2, x6, x8); \
+vpxord(x7, x5, CPTR_AVX512(elsignmask)); /* -halfPI */ \
+vcmpps(k3, x6, x7, _CMP_LT_OQ); /* y < -halfPI */ \
+vpxord(x2, x4, CPTR_AVX512(elsignmask)); /* -pi */ \
+vsubps(x2, x2, x6); /* -pi - y */ \
+vblendmps(x6, k3, x6, x2); \
+/* small values */ \
+vpandd(x2, x6, CPTR_AVX512(elabsmask)); /* abs_y */ \
+vcmpps(k4, x2, CPTR_AVX512(float_tan_small_limit), _CMP_LT_OQ); \
+/* asymptotic proximity */ \
+vsubps(x4, x5, x2); /* distToAsymptote = halfPI - abs_y */ \
+vcmpps(k5, x4, CPTR_AVX512(float_tan_asympt_limit), _CMP_LT_OQ); \
+vmulps(x8, x4, CPTR_AVX512(float_tan_asympt_a2)); \
+vaddps(x8, x8, CPTR_AVX512(float_tan_asympt_a1)); \
+vmulps(x8, x8, x4); \
+vbroadcastss(x4, CPTR_AVX512(elfloat_one)); \
+vdivps(x9, x4, x8); \
+vpandd(x8, x6, CPTR_AVX512(elsignmask)); /* sign of y */ \
+vpxord(x9, x9, x8); \
+/* rational approximation */ \
+vmulps(x2, x6, x6); /* y^2 */ \
+vbroadcastss(x10, CPTR_AVX512(float_tan_p8)); \
+vfmadd213ps(x10, x2, CPTR_AVX512(float_tan_p6)); \
+vfmadd213ps(x10, x2, CPTR_AVX512(float_tan_p4)); \
+vfmadd213ps(x10, x2, CPTR_AVX512(float_tan_p2)); \
+vfmadd213ps(x10, x2, CPTR_AVX512(float_tan_p0)); \
+vmulps(x10, x10, x6); \
+vbroadcastss(x8, CPTR_AVX512(float_tan_q8)); \
+vfmadd213ps(x8, x2, CPTR_AVX512(float_tan_q6)); \
+vfmadd213ps(x8, x2, CPTR_AVX512(float_tan_q4)); \
+vfmadd213ps(x8, x2, CPTR_AVX512(float_tan_q2)); \
+vfmadd213ps(x8, x2, CPTR_AVX512(float_tan_q0)); \
+vdivps(x1, x10, x8); \
+vblendmps(x1, k5, x1, x9); /* asymptotic or rational */ \
+vblendmps(x0, k4, x1, x6); /* very small: y itself */ \
+}
+
+#define ATAN2_PS_AVX512(x0 /*y*/, x1 /*x*/) { \
+ZmmReg x2, x3, x4, x5, x6, x7, x8; \
+vbroadcastss(x2, CPTR_AVX512(elabsmask)); \
+vpandd(x8, x1, x2); /* ax = fabsf (x); */ \
+vpandd(x2, x0, x2); /* ay = fabsf (y); */ \
+vmaxps(x4, x8, x2); /* mx = fmaxf (ay, ax); */ \
+vminps(x5, x8, x2); /* fminf (ay, ax); */ \
+vdivps(x4, x5, x4); /* a = mn / mx; */ \
+vmulps(x5, x4, x4); /* s = a * a; */ \
+vmulps(x6, x5, x5); /* q = s * s; */ \
+vbroadcastss(x7, CPTR_AVX512(float_atan2f_rmul)); \
+vfmadd213ps(x7, x6, CPTR_AVX512(float_atan2f_radd)); /* r = atan2f_rmul * q + atan2f_radd; */ \
+vbroadcastss(x3, CPTR_AVX512(float_atan2f_tmul)); \
+vfmadd213ps(x3, x6, CPTR_AVX512(float_atan2f_tadd)); /* t = atan2f_tmul * q + atan2f_tadd */ \
+vmulps(x6, x5, x4); \
+vfmadd231ps(x3, x5, x7); /* r = r * s + t; */ \
+vfmadd213ps(x3, x6, x4); /* r = (r * c) + a */ \
+/* Map to full circle */ \
+vbroadcastss(x4, CPTR_AVX512(float_atan2f_halfpi)); \
+vsubps(x4, x4, x3); /* r = atan2f_halfpi - r */ \
+vcmpps(k2, x8, x2, _CMP_LT_OQ); /* if (ay > ax) */ \
+vblendmps(x2, k2, x3, x4); \
+vbroadcastss(x3, CPTR_AVX512(float_atan2f_pi)); \
+vsubps(x3, x3, x2); /* r = atan2f_pi - r */ \
+vcmpps(k3, x1, zero, _CMP_LT_OQ); /* if (x < 0) */ \
+vblendmps(x1, k3, x2, x3); \
+vpxord(x2, x1, CPTR_AVX512(elsignmask)); /* r = -r */ \
+vcmpps(k4, x0, zero, _CMP_LT_OQ); /* if (y < 0) */ \
+vblendmps(x0, k4, x1, x2); \
+/* 0,0 given -> convert NaN to 0 */ \
+vcmpps(k5, x0, x0, _CMP_ORD_Q); \
+vmovaps(x0, k5, x0); \
+}
+
+// y dst x src
+#define SINCOS_PS_AVX512(issin, y, x) { \
+ZmmReg t1, sign, t2, t3, t4; \
+/* // Remove sign */ \
+vbroadcastss(t1, CPTR_AVX512(elabsmask)); \
+if (issin) { \
+  vpandnd(sign, t1, x); \
+} \
+else { \
+  vpxord(sign, sign, sign); \
+} \
+vpandd(t1, t1, x); \
+/*// Range reduction*/ \
+vbroadcastss(t3, CPTR_AVX512(float_rintf)); \
+vmulps(t2, t1, CPTR_AVX512(float_invpi)); \
+vaddps(t2, t2, t3); \
+vpslld(t4, t2, 31); \
+vpxord(sign, sign, t4); \
+vsubps(t2, t2, t3); \
+vfnmadd231ps(t1, t2, CPTR_AVX512(float_pi1)); \
+vfnmadd231ps(t1, t2, CPTR_AVX512(float_pi2)); \
+vfnmadd231ps(t1, t2, CPTR_AVX512(float_pi3)); \
+vfnmadd231ps(t1, t2, CPTR_AVX512(float_pi4)); \
+if (issin) { \
+  vmulps(t2, t1, t1); \
+  vbroadcastss(t3, CPTR_AVX512(float_sinC7)); \
+  vfmadd231ps(t3, t2, CPTR_AVX512(float_sinC9)); \
+  vfmadd213ps(t3, t2, CPTR_AVX512(float_sinC5)); \
+  vfmadd213ps(t3, t2, CPTR_AVX512(float_sinC3)); \
+  vmulps(t3, t3, t2); \
+  vfmadd231ps(t1, t1, t3); \
+} \
+else { \
+  vmulps(t2, t1, t1); \
+  vbroadcastss(t1, CPTR_AVX512(float_cosC6)); \
+  vfmadd231ps(t1, t2, CPTR_AVX512(float_cosC8)); \
+  vfmadd213ps(t1, t2, CPTR_AVX512(float_cosC4)); \
+  vfmadd213ps(t1, t2, CPTR_AVX512(float_cosC2)); \
+  vfmadd213ps(t1, t2, CPTR_AVX512(elfloat_one)); \
+} \
+/*// Apply sign */ \
+vpxord(y, t1, sign); \
+}
+
+#define FMOD_PS_AVX512(x, d) { \
+ZmmReg aTmp; \
+vdivps(aTmp, x, d); \
+vcvttps2dq(aTmp,aTmp); \
+vcvtdq2ps(aTmp,aTmp); \
+vmulps(aTmp, aTmp, d); \
+vsubps(x, x, aTmp); }
+
 struct ExprEval : public jitasm::function<void, ExprEval, uint8_t *, const intptr_t *, intptr_t, intptr_t> {
 
   std::vector<ExprOp> ops;
@@ -4153,157 +4412,863 @@ generated epilog example (new):
   }
 };
 
-#endif
-
-
-/********************************************************************
-***** Declare index of new filters for Avisynth's filter engine *****
-********************************************************************/
-
-extern const AVSFunction Exprfilter_filters[] = {
-  { "Expr", BUILTIN_FUNC_PREFIX, "c+s+[format]s[optAvx2]b[optSingleMode]b[optSSE2]b[scale_inputs]s[clamp_float]b[clamp_float_UV]b[lut]i[optVectorC]b", Exprfilter::Create },
-  { 0 }
-};
-
-
-AVSValue __cdecl Exprfilter::Create(AVSValue args, void* , IScriptEnvironment* env) {
-
-  std::vector<PClip> children;
-  std::vector<std::string> expressions;
-  int next_paramindex;
-
-  // one or more clips
-  if (args[0].IsArray() && args[0][0].IsClip()) { // c+s+ case
-    children.resize(args[0].ArraySize());
-
-    for (int i = 0; i < (int)children.size(); ++i) // Copy all
-      children[i] = args[0][i].AsClip();
-
-    next_paramindex = 1;
-  }
-  else if (args[1].IsArray() && args[1][0].IsClip()) { // cc+s+ case
-    children.resize(1 + args[1].ArraySize());
+// AVX-512 (F+BW) code generator, follows ExprEvalAvx2 with zmm registers: 16 pixels per zmm, 32 in dual mode.
+// Comparisons and conditional moves go through opmask registers. The partial chunk at the end of the line is
+// loaded and stored with opmask k1, so no pixels are read or written beyond the plane width.
+struct ExprEvalAvx512 : public jitasm::function<void, ExprEvalAvx512, uint8_t *, const intptr_t *, intptr_t, intptr_t> {
 
-    children[0] = args[0].AsClip(); // Copy 1st
-    for (int i = 1; i < (int)children.size(); ++i) // Copy rest
-      children[i] = args[1][i - 1].AsClip();
+  std::vector<ExprOp> ops;
+  int numInputs;
+  int cpuFlags;
+  int planewidth; // original, lut can overwrite
+  int planeheight;
+  bool singleMode;
 
-    next_paramindex = 2;
-  }
-  else if (args[1].IsClip()) { //cc case
-    children.resize(2);
+  ExprEvalAvx512(std::vector<ExprOp> &ops, int numInputs, int cpuFlags, int planewidth, int planeheight, bool singleMode) : ops(ops), numInputs(numInputs), cpuFlags(cpuFlags),
+    planewidth(planewidth), planeheight(planeheight), singleMode(singleMode) {}
 
-    children[0] = args[0].AsClip();
-    children[1] = args[1].AsClip();
+  template<bool processSingle, bool maskUnused>
+  AVS_FORCEINLINE void processingLoop(Reg &regptrs, ZmmReg &zero, Reg &constptr, Reg &SpatialY)
+  {
+    std::list<std::pair<ZmmReg, ZmmReg>> stack;
+    std::list<ZmmReg> stack1;
 
-    next_paramindex = 2;
-  }
-  else if (args[0].IsClip()) { // single clip, cs+ case
-    children.resize(1);
-    children[0] = args[0].AsClip();
+    // Like in avx2, in dual mode (!processSingle) only the upper register holds the partial chunk,
+    // when the rest fits in one zmm (width mod 32 is <= 16 pixels), processSingle=true is used
+    const bool maskIt = maskUnused && ((planewidth & 15) != 0);
+    const int mask = ((1 << (planewidth & 15)) - 1);
 
-    next_paramindex = 1;
-  }
-  else {
-    env->ThrowError("Expr: Invalid parameter type");
-  }
+    const KReg k1(jitasm::K1), k2(jitasm::K2), k3(jitasm::K3), k4(jitasm::K4), k5(jitasm::K5);
 
-  // one or more expressions: s+
-  if (args[next_paramindex].Defined()) {
-    AVSValue exprarg = args[next_paramindex++];
-    if (exprarg.IsArray()) {
-      int nexpr = exprarg.ArraySize();
-      expressions.resize(nexpr);
-      for (int i = 0; i < nexpr; i++)
-        expressions[i] = exprarg[i].AsString();
-    }
-    else if (exprarg.IsString()) {
-      expressions.resize(1);
-      expressions[0] = exprarg.AsString();
-    }
-    else {
-      env->ThrowError("Expr: Invalid parameter type for expression string");
+    if (maskIt) {
+      Reg32 m;
+      mov(m, mask);
+      kmovw(k1, m);
     }
-  }
-
-  // optional named argument: format
-  const char *newformat = nullptr;
-  if (args[next_paramindex].Defined()) {
-    // always string
-    newformat = args[next_paramindex].AsString();
-  }
-  next_paramindex++;
 
-#ifdef VS_TARGET_CPU_X86
-  // test parameter for avx2-less mode even with avx2 available
-#ifdef TEST_AVX2_CODEGEN_IN_AVX
-  bool optAvx2 = !!(env->GetCPUFlags() & CPUF_AVX);
-#else
-  bool optAvx2 = !!(env->GetCPUFlags() & CPUF_AVX2);
-#endif
-  bool optSSE2 = !!(env->GetCPUFlags() & CPUF_SSE2);
+    for (const auto &iter : ops) {
+      if (iter.op == opLoadSpatialX) {
+        if (processSingle) {
+          ZmmReg r1;
+          XmmReg r1x;
+          vmovd(r1x, dword_ptr[regptrs + sizeof(void *) * (RWPTR_START_OF_XCOUNTER)]);
+          vcvtdq2ps(r1x, r1x);
+          vbroadcastss(r1, r1x);
+          vaddps(r1, r1, zmmword_ptr[constptr + spatialX * 32]); // spatialX and spatialX2 rows: 0..15
+          stack1.push_back(r1);
+        }
+        else {
+          ZmmReg r1, r2;
+          XmmReg r1x, r2x;
+          Reg32 x2;
+          mov(x2, dword_ptr[regptrs + sizeof(void *) * (RWPTR_START_OF_XCOUNTER)]);
+          vmovd(r1x, x2);
+          add(x2, 16);
+          vmovd(r2x, x2);
+          vcvtdq2ps(r1x, r1x);
+          vcvtdq2ps(r2x, r2x);
+          vbroadcastss(r1, r1x);
+          vbroadcastss(r2, r2x);
+          vaddps(r1, r1, zmmword_ptr[constptr + spatialX * 32]);
+          vaddps(r2, r2, zmmword_ptr[constptr + spatialX * 32]);
+          stack.push_back(std::make_pair(r1, r2));
+        }
+      }
+      else if (iter.op == opLoadSpatialY) {
+        ZmmReg r1;
+        XmmReg r1x;
+#ifdef JITASM64
+        vmovq(r1x, SpatialY);
 #else
-  bool optAvx2 = false;
-  bool optSSE2 = false;
+        vmovd(r1x, SpatialY);
 #endif
-
-  if (args[next_paramindex].Defined()) {
-    if (optAvx2) // disable only
-      optAvx2 = args[next_paramindex].AsBool();
-  }
-  next_paramindex++;
-
-  bool optSingleMode = false;
-  if (args[next_paramindex].Defined()) {
-    optSingleMode = args[next_paramindex].AsBool();
-  }
-  next_paramindex++;
-
-  if (args[next_paramindex].Defined()) {
-    if (optSSE2) // disable only
-      optSSE2 = args[next_paramindex].AsBool();
-  }
-  next_paramindex++;
-
-  std::string scale_inputs = args[next_paramindex].Defined() ? args[next_paramindex].AsString("none") : "none";
-  transform(scale_inputs.begin(), scale_inputs.end(), scale_inputs.begin(), ::tolower);
-  next_paramindex++;
-
-  const bool clamp_float = args[next_paramindex].AsBool(false);
-  next_paramindex++;
-
-  const bool clamp_float_UV = args[next_paramindex].AsBool(false);
-  next_paramindex++;
-
-  // clamp_float clamp_float_uv -> clamp_float_i   clamp range for Y clamp range for UV
-  // false       x                 0               0..1              -0.5..+0.5
-  // true        false             1               0..1              -0.5..+0.5
-  // true        true              2               0..1              0..1
-
-  int clamp_float_i;
-  if (clamp_float)
-    clamp_float_i = clamp_float_UV ? 2 : 1;
-  else
-    clamp_float_i = 0;
-
-  const int lutmode = args[next_paramindex].AsInt(0); // 0, 1, 2
-  next_paramindex++;
-
-  const bool optVectorC = args[next_paramindex].AsBool(true);
-
-  return new Exprfilter(children, expressions, newformat, optAvx2, optSingleMode, optSSE2, optVectorC, scale_inputs, clamp_float_i, lutmode, env);
-
-}
-
-// Base SIMD Processor interface
-class ISIMDProcessor {
-public:
-  virtual void processVector(
-    std::vector<const uint8_t*>&srcp,
-    uint8_t*& dstp,
-    int x, int y) = 0;
-  virtual ~ISIMDProcessor() = default;
-};
+        vcvtdq2ps(r1x, r1x);
+        vbroadcastss(r1, r1x);
+        if (processSingle)
+          stack1.push_back(r1);
+        else {
+          ZmmReg r2;
+          vmovaps(r2, r1);
+          stack.push_back(std::make_pair(r1, r2));
+        }
+      }
+      else if (iter.op == opLoadInternalVar || iter.op == opLoadFramePropVar) {
+        const int index = iter.e.ival + (iter.op == opLoadInternalVar ? RWPTR_START_OF_INTERNAL_VARIABLES : RWPTR_START_OF_INTERNAL_FRAMEPROP_VARIABLES);
+        ZmmReg r1;
+        vbroadcastss(r1, dword_ptr[regptrs + sizeof(void *) * index]);
+        if (processSingle)
+          stack1.push_back(r1);
+        else {
+          ZmmReg r2;
+          vmovaps(r2, r1);
+          stack.push_back(std::make_pair(r1, r2));
+        }
+      }
+      else if (iter.op == opLoadSrc8 || iter.op == opLoadSrc16 || iter.op == opLoadSrcF32 || iter.op == opLoadSrcF16) {
+        // 16 pixels per register
+        const int step = iter.op == opLoadSrc8 ? 16 : iter.op == opLoadSrcF32 ? 64 : 32;
+        Reg a;
+        mov(a, ptr[regptrs + sizeof(void *) * (iter.e.ival + RWPTR_START_OF_INPUTS)]);
+        auto load = [&](const ZmmReg& r, int offset, bool masked) {
+          switch (iter.op) {
+          case opLoadSrc8:
+            // 8->32 bits like _mm512_cvtepu8_epi32
+            if (masked) vpmovzxbd(r, k1, xmmword_ptr[a + offset]);
+            else vpmovzxbd(r, xmmword_ptr[a + offset]);
+            vcvtdq2ps(r, r);
+            break;
+          case opLoadSrc16:
+            // 16->32 bits like _mm512_cvtepu16_epi32
+            if (masked) vpmovzxwd(r, k1, ymmword_ptr[a + offset]);
+            else vpmovzxwd(r, ymmword_ptr[a + offset]);
+            vcvtdq2ps(r, r);
+            break;
+          case opLoadSrcF32:
+            if (masked) vmovups(r, k1, zmmword_ptr[a + offset]);
+            else vmovups(r, zmmword_ptr[a + offset]);
+            break;
+          case opLoadSrcF16: // not supported in avs+
+            if (masked) vcvtph2ps(r, k1, ymmword_ptr[a + offset]);
+            else vcvtph2ps(r, ymmword_ptr[a + offset]);
+            break;
+          }
+        };
+        if (processSingle) {
+          ZmmReg r1;
+          load(r1, 0, maskIt);
+          stack1.push_back(r1);
+        }
+        else {
+          ZmmReg r1, r2;
+          load(r1, 0, false);
+          load(r2, step, maskIt);
+          stack.push_back(std::make_pair(r1, r2));
+        }
+      }
+      else if (iter.op == opLoadVar) {
+        if (processSingle) {
+          ZmmReg r1;
+          // 64 bytes/variable
+          int offset = sizeof(void *) * RWPTR_START_OF_USERVARIABLES + 64 * iter.e.ival;
+          if (maskIt)
+            vmovups(r1, k1, zmmword_ptr[regptrs + offset]);
+          else
+            vmovups(r1, zmmword_ptr[regptrs + offset]);
+          stack1.push_back(r1);
+        }
+        else {
+          ZmmReg r1, r2;
+          // 128 bytes/variable
+          int offset = sizeof(void *) * RWPTR_START_OF_USERVARIABLES + 128 * iter.e.ival;
+          vmovups(r1, zmmword_ptr[regptrs + offset]);
+          if (maskIt)
+            vmovups(r2, k1, zmmword_ptr[regptrs + offset + 64]);
+          else
+            vmovups(r2, zmmword_ptr[regptrs + offset + 64]);
+          stack.push_back(std::make_pair(r1, r2));
+        }
+      }
+      else if (iter.op == opLoadConst) {
+        ZmmReg r1;
+        Reg32 a;
+        XmmReg r1x;
+        mov(a, iter.e.ival);
+        vmovd(r1x, a);
+        vbroadcastss(r1, r1x);
+        if (processSingle)
+          stack1.push_back(r1);
+        else {
+          ZmmReg r2;
+          vmovaps(r2, r1);
+          stack.push_back(std::make_pair(r1, r2));
+        }
+      }
+      else if (iter.op == opDup) {
+        if (processSingle) {
+          auto p = std::next(stack1.rbegin(), iter.e.ival);
+          ZmmReg r1;
+          vmovaps(r1, *p);
+          stack1.push_back(r1);
+        }
+        else {
+          auto p = std::next(stack.rbegin(), iter.e.ival);
+          ZmmReg r1, r2;
+          vmovaps(r1, p->first);
+          vmovaps(r2, p->second);
+          stack.push_back(std::make_pair(r1, r2));
+        }
+      }
+      else if (iter.op == opSwap) {
+        if(processSingle)
+          std::swap(stack1.back(), *std::next(stack1.rbegin(), iter.e.ival));
+        else
+          std::swap(stack.back(), *std::next(stack.rbegin(), iter.e.ival));
+      }
+      else if (iter.op == opAdd) {
+        if (processSingle) {
+          TwoArgOp_Single_Avx(vaddps);
+        }
+        else {
+          TwoArgOp_Avx(vaddps);
+        }
+      }
+      else if (iter.op == opSub) {
+        if (processSingle) {
+          TwoArgOp_Single_Avx(vsubps);
+        }
+        else {
+          TwoArgOp_Avx(vsubps);
+        }
+      }
+      else if (iter.op == opMul) {
+        if (processSingle) {
+          TwoArgOp_Single_Avx(vmulps);
+        }
+        else {
+          TwoArgOp_Avx(vmulps);
+        }
+      }
+      else if (iter.op == opDiv) {
+        if (processSingle) {
+          TwoArgOp_Single_Avx(vdivps);
+        }
+        else {
+          TwoArgOp_Avx(vdivps);
+        }
+      }
+      else if (iter.op == opFmod) {
+        if (processSingle) {
+          auto t1 = stack1.back();
+          stack1.pop_back();
+          auto &t2 = stack1.back();
+          FMOD_PS_AVX512(t2, t1)
+        }
+        else {
+          auto t1 = stack.back();
+          stack.pop_back();
+          auto &t2 = stack.back();
+          FMOD_PS_AVX512(t2.first, t1.first)
+          FMOD_PS_AVX512(t2.second, t1.second)
+        }
+      }
+      else if (iter.op == opMax) {
+        if (processSingle) {
+          TwoArgOp_Single_Avx(vmaxps);
+        }
+        else {
+          TwoArgOp_Avx(vmaxps);
+        }
+      }
+      else if (iter.op == opMin) {
+        if (processSingle) {
+          TwoArgOp_Single_Avx(vminps);
+        }
+        else {
+          TwoArgOp_Avx(vminps);
+        }
+      }
+      else if (iter.op == opSqrt) {
+        if (processSingle) {
+          auto &t1 = stack1.back();
+          vmaxps(t1, t1, zero);
+          vsqrtps(t1, t1);
+        }
+        else {
+          auto &t1 = stack.back();
+          vmaxps(t1.first, t1.first, zero);
+          vmaxps(t1.second, t1.second, zero);
+          vsqrtps(t1.first, t1.first);
+          vsqrtps(t1.second, t1.second);
+        }
+      }
+      else if (iter.op == opStore8 || iter.op == opStore10 || iter.op == opStore12 || iter.op == opStore14 || iter.op == opStore16) {
+        const int maxval =
+          iter.op == opStore8 ? elstore8 :
+          iter.op == opStore10 ? elstore10 :
+          iter.op == opStore12 ? elstore12 :
+          iter.op == opStore14 ? elstore14 : elstore16;
+        Reg a;
+        auto store = [&](const ZmmReg& t, int offset, bool masked) {
+          vaddps(t, t, CPTR_AVX512(elfloat_half)); // rounder for truncate! no banker's rounding
+          vmaxps(t, t, zero);
+          vminps(t, t, CPTR_AVX512(maxval));
+          vcvttps2dq(t, t); // min / max clamp ensures that the saturating narrowing store does not saturate
+          if (iter.op == opStore8) {
+            if (masked) vpmovusdb(xmmword_ptr[a + offset], k1, t);
+            else vpmovusdb(xmmword_ptr[a + offset], t);
+          }
+          else {
+            if (masked) vpmovusdw(ymmword_ptr[a + offset * 2], k1, t);
+            else vpmovusdw(ymmword_ptr[a + offset * 2], t);
+          }
+        };
+        if (processSingle) {
+          auto t1 = stack1.back();
+          stack1.pop_back();
+          mov(a, ptr[regptrs]);
+          store(t1, 0, maskIt);
+        }
+        else {
+          auto t1 = stack.back();
+          stack.pop_back();
+          mov(a, ptr[regptrs]);
+          store(t1.first, 0, false);
+          store(t1.second, 16, maskIt);
+        }
+      }
+      else if (iter.op == opStoreF32 || iter.op == opStoreF16) {
+        Reg a;
+        auto store = [&](const ZmmReg& t, int offset, bool masked) {
+          if (iter.op == opStoreF32) {
+            if (masked) vmovups(zmmword_ptr[a + offset * 4], k1, t);
+            else vmovups(zmmword_ptr[a + offset * 4], t);
+          }
+          else { // not supported in avs+
+            if (masked) vcvtps2ph(ymmword_ptr[a + offset * 2], k1, t, 0);
+            else vcvtps2ph(ymmword_ptr[a + offset * 2], t, 0);
+          }
+        };
+        if (processSingle) {
+          auto t1 = stack1.back();
+          stack1.pop_back();
+          mov(a, ptr[regptrs]);
+          store(t1, 0, maskIt);
+        }
+        else {
+          auto t1 = stack.back();
+          stack.pop_back();
+          mov(a, ptr[regptrs]);
+          store(t1.first, 0, false);
+          store(t1.second, 16, maskIt);
+        }
+      }
+      else if (iter.op == opStoreVar || iter.op == opStoreVarAndDrop1) {
+        if (processSingle) {
+          auto t1 = stack1.back();
+          // 64 bytes/variable
+          int offset = sizeof(void *) * RWPTR_START_OF_USERVARIABLES + 64 * iter.e.ival;
+          vmovups(zmmword_ptr[regptrs + offset], t1);
+          if (iter.op == opStoreVarAndDrop1)
+            stack1.pop_back();
+        }
+        else {
+          auto t1 = stack.back();
+          // 128 bytes/variable
+          int offset = sizeof(void *) * RWPTR_START_OF_USERVARIABLES + 128 * iter.e.ival;
+          vmovups(zmmword_ptr[regptrs + offset], t1.first);
+          vmovups(zmmword_ptr[regptrs + offset + 64], t1.second);
+          if (iter.op == opStoreVarAndDrop1)
+            stack.pop_back();
+        }
+      }
+      else if (iter.op == opAbs) {
+        if (processSingle) {
+          auto &t1 = stack1.back();
+          vpandd(t1, t1, CPTR_AVX512(elabsmask));
+        }
+        else {
+          auto &t1 = stack.back();
+          vpandd(t1.first, t1.first, CPTR_AVX512(elabsmask));
+          vpandd(t1.second, t1.second, CPTR_AVX512(elabsmask));
+        }
+      }
+      else if (iter.op == opSgn) {
+        // 1, 0, -1
+        auto sgn = [&](const ZmmReg& t) {
+          ZmmReg r1;
+          vcmpps(k2, t, zero, _CMP_GT_OQ);
+          vcmpps(k3, t, zero, _CMP_LT_OQ);
+          vbroadcastss(r1, k2, CPTR_AVX512(elfloat_one));
+          vbroadcastss(t, k3, CPTR_AVX512(elfloat_minusone));
+          vpord(t, t, r1);
+        };
+        if (processSingle) {
+          sgn(stack1.back());
+        }
+        else {
+          auto &t1 = stack.back();
+          sgn(t1.first);
+          sgn(t1.second);
+        }
+      }
+      else if (iter.op == opNeg) {
+        if (processSingle) {
+          auto &t1 = stack1.back();
+          vcmpps(k2, t1, zero, _CMP_LE_OQ); // cmpleps
+          vbroadcastss(t1, k2, CPTR_AVX512(elfloat_one));
+        }
+        else {
+          auto &t1 = stack.back();
+          vcmpps(k2, t1.first, zero, _CMP_LE_OQ); // cmpleps
+          vcmpps(k3, t1.second, zero, _CMP_LE_OQ);
+          vbroadcastss(t1.first, k2, CPTR_AVX512(elfloat_one));
+          vbroadcastss(t1.second, k3, CPTR_AVX512(elfloat_one));
+        }
+      }
+      else if (iter.op == opNegSign) {
+        if (processSingle) {
+          auto& t1 = stack1.back();
+          vpxord(t1, t1, CPTR_AVX512(elsignmask));
+        }
+        else {
+          auto& t1 = stack.back();
+          vpxord(t1.first, t1.first, CPTR_AVX512(elsignmask));
+          vpxord(t1.second, t1.second, CPTR_AVX512(elsignmask));
+        }
+      }
+      else if (iter.op == opAnd) {
+        if (processSingle) {
+          LogicOp_Single_Avx512(kandw);
+        }
+        else {
+          LogicOp_Avx512(kandw);
+        }
+      }
+      else if (iter.op == opOr) {
+        if (processSingle) {
+          LogicOp_Single_Avx512(korw);
+        }
+        else {
+          LogicOp_Avx512(korw);
+        }
+      }
+      else if (iter.op == opXor) {
+        if (processSingle) {
+          LogicOp_Single_Avx512(kxorw);
+        }
+        else {
+          LogicOp_Avx512(kxorw);
+        }
+      }
+      else if (iter.op == opGt) { // a > b (gt) -> b < (lt) a
+        if (processSingle) {
+          CmpOp_Single_Avx512(_CMP_LT_OQ);
+        }
+        else {
+          CmpOp_Avx512(_CMP_LT_OQ);
+        }
+      }
+      else if (iter.op == opLt) { // a < b (lt) -> b > (gt,nle) a
+        if (processSingle) {
+          CmpOp_Single_Avx512(_CMP_GT_OQ);
+        }
+        else {
+          CmpOp_Avx512(_CMP_GT_OQ);
+        }
+      }
+      else if (iter.op == opEq) {
+        if (processSingle) {
+          CmpOp_Single_Avx512(_CMP_EQ_OQ);
+        }
+        else {
+          CmpOp_Avx512(_CMP_EQ_OQ);
+        }
+      }
+      else if (iter.op == opNotEq) { // avs+
+        if (processSingle) {
+          CmpOp_Single_Avx512(_CMP_NEQ_OQ);
+        }
+        else {
+          CmpOp_Avx512(_CMP_NEQ_OQ);
+        }
+      }
+      else if (iter.op == opLE) { // a <= b -> b >= (ge,nlt) a
+        if (processSingle) {
+          CmpOp_Single_Avx512(_CMP_GE_OS);
+        }
+        else {
+          CmpOp_Avx512(_CMP_GE_OS);
+        }
+      }
+      else if (iter.op == opGE) { // a >= b -> b <= (le) a
+        if (processSingle) {
+          CmpOp_Single_Avx512(_CMP_LE_OS);
+        }
+        else {
+          CmpOp_Avx512(_CMP_LE_OS);
+        }
+      }
+      else if (iter.op == opTernary) {
+        // cond > 0 ? t2 : t1
+        if (processSingle) {
+          auto t1 = stack1.back();
+          stack1.pop_back();
+          auto t2 = stack1.back();
+          stack1.pop_back();
+          auto t3 = stack1.back();
+          stack1.pop_back();
+          ZmmReg r1;
+          vcmpps(k2, t3, zero, _CMP_GT_OQ);
+          vblendmps(r1, k2, t1, t2);
+          stack1.push_back(r1);
+        }
+        else {
+          auto t1 = stack.back();
+          stack.pop_back();
+          auto t2 = stack.back();
+          stack.pop_back();
+          auto t3 = stack.back();
+          stack.pop_back();
+          ZmmReg r1, r2;
+          vcmpps(k2, t3.first, zero, _CMP_GT_OQ);
+          vcmpps(k3, t3.second, zero, _CMP_GT_OQ);
+          vblendmps(r1, k2, t1.first, t2.first);
+          vblendmps(r2, k3, t1.second, t2.second);
+          stack.push_back(std::make_pair(r1, r2));
+        }
+      }
+      else if (iter.op == opExp) {
+        if (processSingle) {
+          auto &t1 = stack1.back();
+          EXP_PS_AVX512(t1);
+        }
+        else {
+          auto &t1 = stack.back();
+          EXP_PS_AVX512(t1.first);
+          EXP_PS_AVX512(t1.second);
+        }
+      }
+      else if (iter.op == opLog) {
+        if (processSingle) {
+          auto &t1 = stack1.back();
+          LOG_PS_AVX512(t1);
+        } else {
+          auto &t1 = stack.back();
+          LOG_PS_AVX512(t1.first);
+          LOG_PS_AVX512(t1.second);
+        }
+      }
+      else if (iter.op == opPow) {
+        if (processSingle) {
+          auto t1 = stack1.back();
+          stack1.pop_back();
+          auto &t2 = stack1.back();
+          LOG_PS_AVX512(t2);
+          vmulps(t2, t2, t1);
+          EXP_PS_AVX512(t2);
+        } else {
+          auto t1 = stack.back();
+          stack.pop_back();
+          auto &t2 = stack.back();
+          LOG_PS_AVX512(t2.first);
+          vmulps(t2.first, t2.first, t1.first);
+          EXP_PS_AVX512(t2.first);
+          LOG_PS_AVX512(t2.second);
+          vmulps(t2.second, t2.second, t1.second);
+          EXP_PS_AVX512(t2.second);
+        }
+      }
+      else if (iter.op == opSin || iter.op == opCos) {
+        const bool issin = iter.op == opSin;
+        if (processSingle) {
+          auto& _t1 = stack1.back();
+          SINCOS_PS_AVX512(issin, _t1, _t1);
+        }
+        else {
+          auto& _t1 = stack.back();
+          SINCOS_PS_AVX512(issin, _t1.first, _t1.first);
+          SINCOS_PS_AVX512(issin, _t1.second, _t1.second);
+        }
+      }
+      else if (iter.op == opTan) {
+        if (processSingle) {
+          auto& t1 = stack1.back();
+          TAN_PS_AVX512(t1);
+        }
+        else {
+          auto& t1 = stack.back();
+          TAN_PS_AVX512(t1.first);
+          TAN_PS_AVX512(t1.second);
+        }
+      }
+      else if (iter.op == opAtan2) {
+        if (processSingle) {
+          auto t1 = stack1.back();
+          stack1.pop_back();
+          auto &t2 = stack1.back();
+          ATAN2_PS_AVX512(t2, t1);
+        } else {
+          auto t1 = stack.back();
+          stack.pop_back();
+          auto &t2 = stack.back();
+          ATAN2_PS_AVX512(t2.first, t1.first);
+          ATAN2_PS_AVX512(t2.second, t1.second);
+        }
+      }
+      else if (iter.op == opClip) {
+        // clip(a, low, high) = min(max(a, low),high)
+        if (processSingle) {
+          auto t1 = stack1.back();
+          stack1.pop_back();
+          auto t2 = stack1.back();
+          stack1.pop_back();
+          auto &t3 = stack1.back();
+          vmaxps(t3, t3, t2);
+          vminps(t3, t3, t1);
+        }
+        else {
+          auto t1 = stack.back();
+          stack.pop_back();
+          auto t2 = stack.back();
+          stack.pop_back();
+          auto &t3 = stack.back();
+          vmaxps(t3.first, t3.first, t2.first);
+          vminps(t3.first, t3.first, t1.first);
+          vmaxps(t3.second, t3.second, t2.second);
+          vminps(t3.second, t3.second, t1.second);
+        }
+      }
+      else if (iter.op == opRound || iter.op == opFloor || iter.op == opCeil || iter.op == opTrunc) {
+        // vrndscaleps with scale 0 takes the same rounding control as vroundps
+        const int rounder_flag =
+          (iter.op == opRound) ? (FROUND_TO_NEAREST_INT | FROUND_NO_EXC) :
+          (iter.op == opFloor) ? (FROUND_TO_NEG_INF | FROUND_NO_EXC) :
+          (iter.op == opCeil) ? (FROUND_TO_POS_INF | FROUND_NO_EXC) :
+          (FROUND_TO_ZERO | FROUND_NO_EXC); // opTrunc
+        if (processSingle) {
+          auto& t1 = stack1.back();
+          vrndscaleps(t1, t1, rounder_flag);
+        }
+        else {
+          auto& t1 = stack.back();
+          vrndscaleps(t1.first, t1.first, rounder_flag);
+          vrndscaleps(t1.second, t1.second, rounder_flag);
+        }
+      }
+    }
+  }
+
+  void main(Reg regptrs, Reg regoffs, Reg niter, Reg SpatialY)
+  {
+    ZmmReg zero;
+    vpxord(zero, zero, zero);
+    Reg constptr;
+    mov(constptr, (uintptr_t)logexpconst_avx);
+
+    L("wloop");
+    cmp(niter, 0); // while(niter>0)
+    je("wend");
+    sub(niter, 1);
+
+    if(singleMode)
+      processingLoop<true, false>(regptrs, zero, constptr, SpatialY);
+    else
+      processingLoop<false, false>(regptrs, zero, constptr, SpatialY);
+
+    // increase read and write pointers by 16 or 32 pixels
+    const int EXTRA = 2; // output pointer, xcounter
+    if constexpr(sizeof(void *) == 8) {
+      // x64: two 8 byte pointers in an xmm
+      int numIter = (numInputs + EXTRA + 1) / 2;
+
+      for (int i = 0; i < numIter; i++) {
+        XmmReg r1, r2;
+        vmovdqu(r1, xmmword_ptr[regptrs + 16 * i]);
+        vmovdqu(r2, xmmword_ptr[regoffs + 16 * i]);
+        vpaddq(r1, r1, r2); // pointers are 64 bits
+        vmovdqu(xmmword_ptr[regptrs + 16 * i], r1);
+      }
+    }
+    else {
+      // x86: four 4 byte pointers in an xmm
+      int numIter = (numInputs + EXTRA + 3) / 4;
+      for (int i = 0; i < numIter; i++) {
+        XmmReg r1, r2;
+        vmovdqu(r1, xmmword_ptr[regptrs + 16 * i]);
+        vmovdqu(r2, xmmword_ptr[regoffs + 16 * i]);
+        vpaddd(r1, r1, r2); // pointers are 32 bits
+        vmovdqu(xmmword_ptr[regptrs + 16 * i], r1);
+      }
+    }
+
+    jmp("wloop");
+    L("wend");
+
+    int nrestpixels = planewidth & (singleMode ? 15 : 31);
+    if(nrestpixels > 16) // dual process with masking
+      processingLoop<false, true>(regptrs, zero, constptr, SpatialY);
+    else if (nrestpixels == 16) // single process, no masking
+      processingLoop<true, false>(regptrs, zero, constptr, SpatialY);
+    else if (nrestpixels > 0) // single process, masking
+      processingLoop<true, true>(regptrs, zero, constptr, SpatialY);
+  }
+};
+
+#endif
+
+
+/********************************************************************
+***** Declare index of new filters for Avisynth's filter engine *****
+********************************************************************/
+
+extern const AVSFunction Exprfilter_filters[] = {
+  { "Expr", BUILTIN_FUNC_PREFIX, "c+s+[format]s[optAvx2]b[optSingleMode]b[optSSE2]b[scale_inputs]s[clamp_float]b[clamp_float_UV]b[lut]i[optVectorC]b[threads]i[optAvx512]b[optRPN]b[dumpRPN]s", Exprfilter::Create },
+  { 0 }
+};
+
+
+AVSValue __cdecl Exprfilter::Create(AVSValue args, void* , IScriptEnvironment* env) {
+
+  std::vector<PClip> children;
+  std::vector<std::string> expressions;
+  int next_paramindex;
+
+  // one or more clips
+  if (args[0].IsArray() && args[0][0].IsClip()) { // c+s+ case
+    children.resize(args[0].ArraySize());
+
+    for (int i = 0; i < (int)children.size(); ++i) // Copy all
+      children[i] = args[0][i].AsClip();
+
+    next_paramindex = 1;
+  }
+  else if (args[1].IsArray() && args[1][0].IsClip()) { // cc+s+ case
+    children.resize(1 + args[1].ArraySize());
+
+    children[0] = args[0].AsClip(); // Copy 1st
+    for (int i = 1; i < (int)children.size(); ++i) // Copy rest
+      children[i] = args[1][i - 1].AsClip();
+
+    next_paramindex = 2;
+  }
+  else if (args[1].IsClip()) { //cc case
+    children.resize(2);
+
+    children[0] = args[0].AsClip();
+    children[1] = args[1].AsClip();
+
+    next_paramindex = 2;
+  }
+  else if (args[0].IsClip()) { // single clip, cs+ case
+    children.resize(1);
+    children[0] = args[0].AsClip();
+
+    next_paramindex = 1;
+  }
+  else {
+    env->ThrowError("Expr: Invalid parameter type");
+  }
+
+  // one or more expressions: s+
+  if (args[next_paramindex].Defined()) {
+    AVSValue exprarg = args[next_paramindex++];
+    if (exprarg.IsArray()) {
+      int nexpr = exprarg.ArraySize();
+      expressions.resize(nexpr);
+      for (int i = 0; i < nexpr; i++)
+        expressions[i] = exprarg[i].AsString();
+    }
+    else if (exprarg.IsString()) {
+      expressions.resize(1);
+      expressions[0] = exprarg.AsString();
+    }
+    else {
+      env->ThrowError("Expr: Invalid parameter type for expression string");
+    }
+  }
+
+  // optional named argument: format
+  const char *newformat = nullptr;
+  if (args[next_paramindex].Defined()) {
+    // always string
+    newformat = args[next_paramindex].AsString();
+  }
+  next_paramindex++;
+
+#ifdef VS_TARGET_CPU_X86
+  // test parameter for avx2-less mode even with avx2 available
+#ifdef TEST_AVX2_CODEGEN_IN_AVX
+  bool optAvx2 = !!(env->GetCPUFlags() & CPUF_AVX);
+#else
+  bool optAvx2 = !!(env->GetCPUFlags() & CPUF_AVX2);
+#endif
+  bool optSSE2 = !!(env->GetCPUFlags() & CPUF_SSE2);
+  bool optAvx512 = !!(env->GetCPUFlags() & CPUF_AVX512F);
+#else
+  bool optAvx2 = false;
+  bool optSSE2 = false;
+  bool optAvx512 = false;
+#endif
+
+  if (args[next_paramindex].Defined()) {
+    if (optAvx2) // disable only
+      optAvx2 = args[next_paramindex].AsBool();
+  }
+  next_paramindex++;
+
+  bool optSingleMode = false;
+  if (args[next_paramindex].Defined()) {
+    optSingleMode = args[next_paramindex].AsBool();
+  }
+  next_paramindex++;
+
+  if (args[next_paramindex].Defined()) {
+    if (optSSE2) // disable only
+      optSSE2 = args[next_paramindex].AsBool();
+  }
+  next_paramindex++;
+
+  std::string scale_inputs = args[next_paramindex].Defined() ? args[next_paramindex].AsString("none") : "none";
+  transform(scale_inputs.begin(), scale_inputs.end(), scale_inputs.begin(), ::tolower);
+  next_paramindex++;
+
+  const bool clamp_float = args[next_paramindex].AsBool(false);
+  next_paramindex++;
+
+  const bool clamp_float_UV = args[next_paramindex].AsBool(false);
+  next_paramindex++;
+
+  // clamp_float clamp_float_uv -> clamp_float_i   clamp range for Y clamp range for UV
+  // false       x                 0               0..1              -0.5..+0.5
+  // true        false             1               0..1              -0.5..+0.5
+  // true        true              2               0..1              0..1
+
+  int clamp_float_i;
+  if (clamp_float)
+    clamp_float_i = clamp_float_UV ? 2 : 1;
+  else
+    clamp_float_i = 0;
+
+  const int lutmode = args[next_paramindex].AsInt(0); // 0, 1, 2
+  next_paramindex++;
+
+  const bool optVectorC = args[next_paramindex].AsBool(true);
+  next_paramindex++;
+
+  int threads = args[next_paramindex].AsInt(1); // 1: no intra-frame threading, 0: one band per logical CPU
+  if (threads < 0)
+    env->ThrowError("Expr: 'threads' must be 0 (auto) or more");
+  if (threads == 0)
+    threads = std::max(1, (int)std::thread::hardware_concurrency());
+  next_paramindex++;
+
+  if (args[next_paramindex].Defined()) {
+    if (optAvx512) // disable only
+      optAvx512 = args[next_paramindex].AsBool();
+  }
+  next_paramindex++;
+  optAvx512 = optAvx512 && optAvx2; // avx512 code follows the avx2 path and its constraints
+
+  const bool optRPN = args[next_paramindex].AsBool(true);
+  next_paramindex++;
+
+  const std::string dumpRPN = args[next_paramindex].AsString("");
+  next_paramindex++;
+
+  return new Exprfilter(children, expressions, newformat, optAvx2, optAvx512, optSingleMode, optSSE2, optVectorC, scale_inputs, clamp_float_i, lutmode, threads,
+    optRPN, dumpRPN, env);
+
+}
+
+// Base SIMD Processor interface
+class ISIMDProcessor {
+public:
+  virtual void processVector(
+    std::vector<const uint8_t*>&srcp,
+    uint8_t*& dstp,
+    int x, int y) = 0;
+  virtual ~ISIMDProcessor() = default;
+};
 
 /**
  * Custom aligned memory allocator for STL containers like std::vector
@@ -4447,17 +5412,19 @@ public:
     stackIndex++;
   }
 
-  // Load from source with relative offset
+  // Load from source with relative offset. src is row 0 of the plane, y is the row with the offset added,
+  // stride is in bytes
   template<typename T>
-  void loadRelSource(const T* src, int x, int dx, int dy, int width, int height, int stride) {
+  void loadRelSource(const uint8_t* src, int x, int dx, int y, int width, int height, int stride) {
     auto& current_stack = stack[stackIndex];
     for (int i = 0; i < VectorSize; ++i)
       current_stack[i] = stacktop[i];
     // At edges: repeat, no mirror
-    int newY = std::max(0, std::min(dy, height - 1));
+    int newY = std::max(0, std::min(y, height - 1));
+    const T* row = reinterpret_cast<const T*>(src + (ptrdiff_t)newY * stride);
     for (int i = 0; i < VectorSize; ++i) {
       int newX = std::max(0, std::min(x + dx + i, width - 1));
-      stacktop[i] = static_cast<float>(reinterpret_cast<const T*>((uint8_t*)&src[newY * stride])[newX]);
+      stacktop[i] = static_cast<float>(row[newX]);
     }
     stackIndex++;
   }
@@ -4802,13 +5769,13 @@ public:
         loadSource<float>(reinterpret_cast<const float*>(srcp[vops_current->e.ival]), x);
         break;
       case opLoadRelSrc8:
-        loadRelSource<uint8_t>(reinterpret_cast<const uint8_t*>(srcp[vops_current->e.ival]), x, vops_current->dx, vops_current->dy, w, h, src_stride[vops_current->e.ival]);
+        loadRelSource<uint8_t>(srcp_orig[vops_current->e.ival], x, vops_current->dx, y + vops_current->dy, w, h, src_stride[vops_current->e.ival]);
         break;
       case opLoadRelSrc16:
-        loadRelSource<uint16_t>(reinterpret_cast<const uint16_t*>(srcp[vops_current->e.ival]), x, vops_current->dx, vops_current->dy, w, h, src_stride[vops_current->e.ival]);
+        loadRelSource<uint16_t>(srcp_orig[vops_current->e.ival], x, vops_current->dx, y + vops_current->dy, w, h, src_stride[vops_current->e.ival]);
         break;
       case opLoadRelSrcF32:
-        loadRelSource<float>(reinterpret_cast<const float*>(srcp[vops_current->e.ival]), x, vops_current->dx, vops_current->dy, w, h, src_stride[vops_current->e.ival]);
+        loadRelSource<float>(srcp_orig[vops_current->e.ival], x, vops_current->dx, y + vops_current->dy, w, h, src_stride[vops_current->e.ival]);
         break;
       case opLoadConst:
         push_and_broadcast(vops_current->e.fval);
@@ -4927,7 +5894,7 @@ public:
 
 
 template<int MaxVectorSize>
-void processFrameWithDynamicVectors(int plane, int w, int h, int pixels_per_iter, float framecount, float relative_time, int numInputs,
+void processFrameWithDynamicVectors(int plane, int w, int h, int y_start, int y_end, int pixels_per_iter, float framecount, float relative_time, int numInputs,
   uint8_t* &dstp, int dst_stride,
   std::vector<const uint8_t*>& srcp, std::vector<int>& src_stride, std::vector<intptr_t>& ptroffsets, std::vector<const uint8_t*>& srcp_orig, ExprData& d) {
 
@@ -4953,7 +5920,13 @@ void processFrameWithDynamicVectors(int plane, int w, int h, int pixels_per_iter
     SIMDProcessorFactory::createProcessor<4>(w, h, d.maxStackSize, variable_area, internal_vars, src_stride, srcp_orig, vops) : nullptr;
   std::unique_ptr<ISIMDProcessor> processor1 = SIMDProcessorFactory::createProcessor<1>(w, h, d.maxStackSize, variable_area, internal_vars, src_stride, srcp_orig, vops);
 
-  for (int y = 0; y < h; y++) {
+  dstp += (intptr_t)dst_stride * y_start;
+  if (d.lutmode == 0) {
+    for (int i = 0; i < numInputs; i++)
+      srcp[i] += (intptr_t)src_stride[i] * y_start;
+  }
+
+  for (int y = y_start; y < y_end; y++) {
     int x = 0;
 
     // Conditionally process larger vector sizes
@@ -4989,7 +5962,8 @@ void processFrameWithDynamicVectors(int plane, int w, int h, int pixels_per_iter
   }
 }
 
-void Exprfilter::processFrame(int plane, int w, int h, int pixels_per_iter, float framecount, float relative_time, int numInputs, 
+// Rows y_start..y_end-1 of the plane. Pointers are of row 0.
+void Exprfilter::processFrame(int plane, int w, int h, int y_start, int y_end, int pixels_per_iter, float framecount, float relative_time, int numInputs,
   uint8_t*& dstp, int dst_stride,
   std::vector<const uint8_t*>& srcp, std::vector<int>& src_stride, std::vector<intptr_t>& ptroffsets, std::vector<const uint8_t*>& srcp_orig)
 {
@@ -5000,7 +5974,7 @@ void Exprfilter::processFrame(int plane, int w, int h, int pixels_per_iter, floa
 
     ExprData::ProcessLineProc proc = d.proc[plane];
 
-    alignas(32) intptr_t rwptrs[RWPTR_SIZE]; // should work, gcc 8.3 gives false warning
+    alignas(64) intptr_t rwptrs[RWPTR_SIZE]; // should work, gcc 8.3 gives false warning
     
     *reinterpret_cast<float*>(&rwptrs[RWPTR_START_OF_INTERNAL_VARIABLES + INTERNAL_VAR_CURRENT_FRAME]) = (float)framecount;
     *reinterpret_cast<float*>(&rwptrs[RWPTR_START_OF_INTERNAL_VARIABLES + INTERNAL_VAR_RELTIME]) = (float)relative_time;
@@ -5009,7 +5983,7 @@ void Exprfilter::processFrame(int plane, int w, int h, int pixels_per_iter, floa
       int whereToPut = framePropToRead.var_index;
       *reinterpret_cast<float*>(&rwptrs[RWPTR_START_OF_INTERNAL_FRAMEPROP_VARIABLES + whereToPut]) = framePropToRead.value;
     };
-    for (int y = 0; y < h; y++) {
+    for (int y = y_start; y < y_end; y++) {
       rwptrs[RWPTR_START_OF_OUTPUT] = reinterpret_cast<intptr_t>(dstp + dst_stride * y);
       rwptrs[RWPTR_START_OF_XCOUNTER] = 0; // xcounter internal variable
       for (int i = 0; i < numInputs; i++) {
@@ -5028,7 +6002,7 @@ void Exprfilter::processFrame(int plane, int w, int h, int pixels_per_iter, floa
     // As of 2025: original:1-2.5fps, new MAX_C_VECT=16: MSVC~6fps MSVC AVX2:~6fps, LLVM-14,7fps, LLVM AVX2-19fps
 
     processFrameWithDynamicVectors<MAX_C_VECT>(
-      plane, w, h, pixels_per_iter, framecount, relative_time, numInputs,
+      plane, w, h, y_start, y_end, pixels_per_iter, framecount, relative_time, numInputs,
       dstp, dst_stride,
       srcp, src_stride, ptroffsets, srcp_orig, d);
   }
@@ -5051,7 +6025,13 @@ void Exprfilter::processFrame(int plane, int w, int h, int pixels_per_iter, floa
       internal_vars[INTERNAL_VAR_FRAMEPROP_VARIABLES_START + whereToPut] = framePropToRead.value;
     };
 
-    for (int y = 0; y < h; y++) {
+    dstp += (intptr_t)dst_stride * y_start;
+    if (d.lutmode == 0) {
+      for (int i = 0; i < numInputs; i++)
+        srcp[i] += (intptr_t)src_stride[i] * y_start;
+    }
+
+    for (int y = y_start; y < y_end; y++) {
       for (int x = 0; x < w; x++) {
         int si = 0;
         int i = -1;
@@ -5404,7 +6384,7 @@ void Exprfilter::calculate_lut(IScriptEnvironment* env)
 
     // for simd:
     // same as in GetFrame
-    const int pixels_per_iter = (optAvx2 && d.planeOptAvx2[plane]) ? (optSingleMode ? 8 : 16) : (optSingleMode ? 4 : 8);
+    const int pixels_per_iter = (optAvx2 && d.planeOptAvx2[plane]) ? (optAvx512 ? (optSingleMode ? 16 : 32) : (optSingleMode ? 8 : 16)) : (optSingleMode ? 4 : 8);
     std::vector<intptr_t> ptroffsets(1 + 1 + MAX_EXPR_INPUTS);
     ptroffsets[RWPTR_START_OF_OUTPUT] = d.vi.ComponentSize() * pixels_per_iter; // stepping for output pointer
     ptroffsets[RWPTR_START_OF_XCOUNTER] = pixels_per_iter; // stepping for xcounter
@@ -5419,7 +6399,7 @@ void Exprfilter::calculate_lut(IScriptEnvironment* env)
 
     const int dummy_framecount = 0;
     const int dummy_relative_time = 0;
-    processFrame(plane, w, h, pixels_per_iter, dummy_framecount, dummy_relative_time, d.numInputs, dstp, dst_stride, srcp, src_stride, ptroffsets, srcp_orig);
+    processFrame(plane, w, h, 0, h, pixels_per_iter, dummy_framecount, dummy_relative_time, d.numInputs, dstp, dst_stride, srcp, src_stride, ptroffsets, srcp_orig);
   } // for planes
 }
 
@@ -5452,6 +6432,29 @@ static void do_lut_xy(const uint8_t* lut8, uint8_t* dstp, int dst_stride, const
   }
 }
 
+// A band of rows of a plane, processed on the environment thread pool when threads > 1.
+// Own copies of the pointer arrays, the C paths move them.
+struct ExprBand {
+  Exprfilter* filter;
+  int plane, w, h, y_start, y_end, pixels_per_iter, numInputs;
+  float framecount, relative_time;
+  uint8_t* dstp;
+  int dst_stride;
+  std::vector<const uint8_t*> srcp;
+  std::vector<const uint8_t*> srcp_orig;
+  std::vector<int> src_stride;
+  std::vector<intptr_t> ptroffsets;
+};
+
+static AVSValue __cdecl ExprBandWorker(IScriptEnvironment2* env, void* data)
+{
+  AVS_UNUSED(env);
+  ExprBand& b = *static_cast<ExprBand*>(data);
+  b.filter->processFrame(b.plane, b.w, b.h, b.y_start, b.y_end, b.pixels_per_iter, b.framecount, b.relative_time, b.numInputs,
+    b.dstp, b.dst_stride, b.srcp, b.src_stride, b.ptroffsets, b.srcp_orig);
+  return AVSValue();
+}
+
 PVideoFrame __stdcall Exprfilter::GetFrame(int n, IScriptEnvironment *env) {
   // ExprData d class variable already filled
 
@@ -5484,6 +6487,10 @@ PVideoFrame __stdcall Exprfilter::GetFrame(int n, IScriptEnvironment *env) {
   const int planes_r[4] = { PLANAR_R, PLANAR_G, PLANAR_B, PLANAR_A }; // expression string order is R G B unlike internal G B R plane order
   const int *plane_enums_d = (d.vi.IsYUV() || d.vi.IsYUVA()) ? planes_y : planes_r;
 
+  std::vector<ExprBand> bands; // of all planes, run together after the plane loop
+  if (threads > 1 && lutmode == 0)
+    bands.reserve(4 * threads);
+
   for (int plane = 0; plane < d.vi.NumComponents(); plane++) {
 
     const int plane_enum_d = plane_enums_d[plane];
@@ -5503,7 +6510,7 @@ PVideoFrame __stdcall Exprfilter::GetFrame(int n, IScriptEnvironment *env) {
       w = d.vi.width >> d.vi.GetPlaneWidthSubsampling(plane_enum_d);
 
       // for simd:
-      const int pixels_per_iter = (optAvx2 && d.planeOptAvx2[plane]) ? (optSingleMode ? 8 : 16) : (optSingleMode ? 4 : 8);
+      const int pixels_per_iter = (optAvx2 && d.planeOptAvx2[plane]) ? (optAvx512 ? (optSingleMode ? 16 : 32) : (optSingleMode ? 8 : 16)) : (optSingleMode ? 4 : 8);
       std::vector<intptr_t> ptroffsets(1 + 1 + MAX_EXPR_INPUTS);
       ptroffsets[RWPTR_START_OF_OUTPUT] = d.vi.ComponentSize() * pixels_per_iter; // stepping for output pointer
       ptroffsets[RWPTR_START_OF_XCOUNTER] = pixels_per_iter; // stepping for xcounter
@@ -5532,8 +6539,16 @@ PVideoFrame __stdcall Exprfilter::GetFrame(int n, IScriptEnvironment *env) {
         }
       }
 
-      if (lutmode == 0) {
-        processFrame(plane, w, h, pixels_per_iter, framecount, relative_time, d.numInputs, dstp, dst_stride, srcp, src_stride, ptroffsets, srcp_orig);
+      const int nbands = threads > 1 ? std::min(threads, h / MIN_BAND_ROWS) : 1;
+      if (lutmode == 0 && nbands > 1) {
+        for (int b = 0; b < nbands; b++) {
+          const int y_start = (int)((int64_t)h * b / nbands);
+          const int y_end = (int)((int64_t)h * (b + 1) / nbands);
+          bands.push_back({ this, plane, w, h, y_start, y_end, pixels_per_iter, d.numInputs, framecount, relative_time,
+            dstp, dst_stride, srcp, srcp_orig, src_stride, ptroffsets });
+        }
+      } else if (lutmode == 0) {
+        processFrame(plane, w, h, 0, h, pixels_per_iter, framecount, relative_time, d.numInputs, dstp, dst_stride, srcp, src_stride, ptroffsets, srcp_orig);
       } else {
         // lut table for plane is filled, do lookup now
         const int bits_per_pixel = d.vi.BitsPerComponent();
@@ -5644,6 +6659,17 @@ PVideoFrame __stdcall Exprfilter::GetFrame(int n, IScriptEnvironment *env) {
     } // plane modes
   } // for planes
 
+  if (!bands.empty()) {
+    // the first band is done on this thread while the pool does the others
+    InternalEnvironment* envi = GetAndRevealCamouflagedEnv(env);
+    IJobCompletion* completion = envi->NewCompletion(bands.size() - 1);
+    for (size_t i = 1; i < bands.size(); i++)
+      envi->ParallelJob(ExprBandWorker, &bands[i], completion);
+    ExprBandWorker(nullptr, &bands[0]);
+    completion->Wait();
+    completion->Destroy();
+  }
+
   return dst;
 }
 
@@ -6902,10 +7928,558 @@ static void foldConstants(std::vector<ExprOp> &ops) {
     }
 }
 
-Exprfilter::Exprfilter(const std::vector<PClip>& _child_array, const std::vector<std::string>& _expr_array, const char *_newformat, const bool _optAvx2,
-  const bool _optSingleMode, const bool _optSSE2, const bool _optVectorC, const std::string _scale_inputs, const int _clamp_float_i, const int _lutmode, IScriptEnvironment *env) :
-  children(_child_array), expressions(_expr_array), optAvx2(_optAvx2), optSingleMode(_optSingleMode), optSSE2(_optSSE2),
-  optVectorC(_optVectorC), scale_inputs(_scale_inputs), clamp_float_i(_clamp_float_i), lutmode(_lutmode) {
+// Stack size needed by ops
+static size_t getStackSize(const std::vector<ExprOp>& ops) {
+  size_t size = 0;
+  size_t maxSize = 0;
+  for (const ExprOp& op : ops) {
+    if (isLoadOp(op.op) || op.op == opDup)
+      maxSize = std::max(++size, maxSize);
+    else if (op.op == opStoreVarAndDrop1)
+      size--;
+    else if (numOperands(op.op) > 1)
+      size -= numOperands(op.op) - 1;
+  }
+  return maxSize;
+}
+
+// RPN optimizer, runs after foldConstants. Shared by all code paths (JIT and C), they see only the new ops.
+//
+// The program is turned into a DAG by running the stack symbolically: dup, swap and user variables
+// disappear, identical subexpressions become a single node (value numbering), and variables which
+// are stored but never read are dropped with them. Constants are folded, pow by a small integer
+// becomes a multiplication chain, division by a power of two a multiplication.
+// Then RPN is generated again. The operand which needs more stack slots is evaluated first
+// (Sethi-Ullman order) so that fewer registers are live at the same time. A value used more
+// than once is copied with dup while it is still on the stack, otherwise it is saved in a
+// temporary variable at its first evaluation.
+// Apart from the pow chains (like those done in foldConstants) the result is bit-identical.
+class ExprOptimizer {
+  struct Node {
+    ExprOp op;
+    int child[3];
+    int need; // stack slots needed to evaluate it
+    int uses; // number of references from the (reachable) DAG
+    int var; // temporary variable holding its value, or -1
+    bool loaded; // var was read back
+    size_t storePos; // position of the opStoreVar in out
+  };
+
+  std::vector<Node> nodes;
+  std::map<std::tuple<uint32_t, uint32_t, int, int, int, int, int>, int> numbering;
+  std::vector<int> stack;
+  std::vector<int> freeVars;
+  std::vector<ExprOp> out;
+
+  static bool isCommutative(uint32_t op) {
+    // not min and max: with a NaN operand their result depends on the order
+    return op == opAdd || op == opMul || op == opEq || op == opNotEq || op == opAnd || op == opOr || op == opXor;
+  }
+
+  // recomputing is as cheap as reading back a variable
+  static bool isCheapLeaf(uint32_t op) {
+    return op == opLoadConst || op == opLoadSrc8 || op == opLoadSrc16 || op == opLoadSrcF32 || op == opLoadSrcF16 ||
+      op == opLoadSpatialX || op == opLoadSpatialY || op == opLoadInternalVar || op == opLoadFramePropVar;
+  }
+
+  bool isConst(int n) const { return nodes[n].op.op == opLoadConst; }
+  float constValue(int n) const { return nodes[n].op.e.fval; }
+
+  int makeConst(float f) {
+    return makeNode(ExprOp(opLoadConst, f));
+  }
+
+  int makeNode(const ExprOp& op, int c0 = -1, int c1 = -1, int c2 = -1) {
+    const int operands = numOperands(op.op);
+
+    // constant folding
+    if (operands == 1 && isConst(c0))
+      return makeConst(calculateOneOperand(op.op, constValue(c0)));
+    if (operands == 2 && isConst(c0) && isConst(c1))
+      return makeConst(calculateTwoOperands(op.op, constValue(c0), constValue(c1)));
+    if (op.op == opTernary && isConst(c0))
+      return constValue(c0) > 0.0f ? c1 : c2;
+
+    // the simplifications of foldConstants, constants may have come from variables
+    if (operands == 2 && isConst(c1)) {
+      const float f = constValue(c1);
+      switch (op.op) {
+      case opAdd: case opSub:
+        if (f == 0.0f)
+          return c0;
+        break;
+      case opMul:
+        if (f == 1.0f)
+          return c0;
+        if (f == -1.0f)
+          return makeNode(ExprOp(opNegSign), c0);
+        break;
+      case opDiv:
+        if (f == 1.0f)
+          return c0;
+        if (f == -1.0f)
+          return makeNode(ExprOp(opNegSign), c0);
+        {
+          // x / 2^n is exactly x * 2^-n
+          int exponent;
+          const float mantissa = std::frexp(f, &exponent);
+          const float reciprocal = 1.0f / f;
+          if (std::abs(mantissa) == 0.5f && std::isnormal(reciprocal))
+            return makeNode(ExprOp(opMul), c0, makeConst(reciprocal));
+        }
+        break;
+      case opPow:
+        if (f == 1.0f)
+          return c0;
+        if (f == 0.5f)
+          return makeNode(ExprOp(opSqrt), c0);
+        if (f >= 2.0f && f <= 16.0f && f == std::floor(f)) {
+          // square-and-multiply, x^5 = (x*x)*(x*x)*x
+          const int n = (int)f;
+          int bit = 16;
+          while (!(n & bit))
+            bit >>= 1;
+          int r = c0;
+          for (bit >>= 1; bit; bit >>= 1) {
+            r = makeNode(ExprOp(opMul), r, r);
+            if (n & bit)
+              r = makeNode(ExprOp(opMul), r, c0);
+          }
+          return r;
+        }
+        break;
+      }
+    }
+
+    if (operands == 2 && isCommutative(op.op) && c0 > c1)
+      std::swap(c0, c1);
+
+    const auto key = std::make_tuple(op.op, operands == 0 ? op.e.uval : 0u, op.dx, op.dy, c0, c1, c2);
+    auto it = numbering.find(key);
+    if (it != numbering.end())
+      return it->second;
+
+    Node node = { operands == 0 ? op : ExprOp((SOperation)op.op), { c0, c1, c2 }, 1, 0, -1, false, 0 };
+    if (operands == 1)
+      node.need = nodes[c0].need;
+    else if (operands == 2)
+      node.need = nodes[c0].need == nodes[c1].need ? nodes[c0].need + 1 : std::max(nodes[c0].need, nodes[c1].need);
+    else if (operands == 3)
+      node.need = std::max(nodes[c0].need, std::max(nodes[c1].need + 1, nodes[c2].need + 2));
+    nodes.push_back(node);
+    const int n = (int)nodes.size() - 1;
+    numbering[key] = n;
+    return n;
+  }
+
+  void countUses(int n, std::vector<bool>& visited) {
+    nodes[n].uses++;
+    if (visited[n])
+      return;
+    visited[n] = true;
+    const int operands = numOperands(nodes[n].op.op);
+    for (int i = 0; i < operands; i++)
+      countUses(nodes[n].child[i], visited);
+  }
+
+  void emit(int n) {
+    Node& node = nodes[n];
+
+    // still on the stack as an operand of a pending operation: copy it
+    for (size_t k = 0; k < stack.size(); k++) {
+      if (stack[stack.size() - 1 - k] == n) {
+        out.push_back(ExprOp(opDup, (int32_t)k));
+        stack.push_back(n);
+        release(n);
+        return;
+      }
+    }
+
+    if (node.var >= 0) {
+      out.push_back(ExprOp(opLoadVar, node.var));
+      node.loaded = true;
+      stack.push_back(n);
+      release(n);
+      return;
+    }
+
+    const int operands = numOperands(node.op.op);
+    if (operands == 2 && nodes[node.child[1]].need > nodes[node.child[0]].need) {
+      emit(node.child[1]);
+      emit(node.child[0]);
+      if (!isCommutative(node.op.op)) {
+        out.push_back(ExprOp(opSwap, 1));
+        std::swap(stack[stack.size() - 1], stack[stack.size() - 2]);
+      }
+    }
+    else {
+      for (int i = 0; i < operands; i++)
+        emit(node.child[i]);
+    }
+    out.push_back(node.op);
+    stack.resize(stack.size() - operands);
+    stack.push_back(n);
+
+    // needed later again
+    if (node.uses > 1 && !isCheapLeaf(node.op.op) && !freeVars.empty()) {
+      node.var = freeVars.back();
+      freeVars.pop_back();
+      node.storePos = out.size();
+      out.push_back(ExprOp(opStoreVar, node.var));
+    }
+    release(n);
+  }
+
+  void release(int n) {
+    Node& node = nodes[n];
+    if (--node.uses == 0 && node.var >= 0)
+      freeVars.push_back(node.var);
+  }
+
+public:
+  void optimize(std::vector<ExprOp>& ops) {
+    if (ops.empty())
+      return;
+    const uint32_t storeOp = ops.back().op;
+    if (storeOp != opStore8 && storeOp != opStore10 && storeOp != opStore12 && storeOp != opStore14 &&
+      storeOp != opStore16 && storeOp != opStoreF32 && storeOp != opStoreF16)
+      return;
+
+    // symbolic run, the parser has checked the stack balance
+    std::vector<int> vars(MAX_USER_VARIABLES, -1);
+    for (size_t i = 0; i + 1 < ops.size(); i++) {
+      const ExprOp& op = ops[i];
+      const int operands = numOperands(op.op);
+      switch (op.op) {
+      case opDup:
+        stack.push_back(stack[stack.size() - 1 - op.e.ival]);
+        break;
+      case opSwap:
+        std::swap(stack[stack.size() - 1], stack[stack.size() - 1 - op.e.ival]);
+        break;
+      case opStoreVar:
+        vars[op.e.ival] = stack.back();
+        break;
+      case opStoreVarAndDrop1:
+        vars[op.e.ival] = stack.back();
+        stack.pop_back();
+        break;
+      case opLoadVar:
+        stack.push_back(vars[op.e.ival]);
+        break;
+      default:
+        if (operands == 0) {
+          stack.push_back(makeNode(op));
+        }
+        else {
+          int c[3] = { -1, -1, -1 };
+          for (int j = operands - 1; j >= 0; j--) {
+            c[j] = stack.back();
+            stack.pop_back();
+          }
+          stack.push_back(makeNode(op, c[0], c[1], c[2]));
+        }
+        break;
+      }
+    }
+    const int root = stack.back();
+    stack.clear();
+
+    std::vector<bool> visited(nodes.size(), false);
+    countUses(root, visited);
+
+    for (int i = MAX_USER_VARIABLES - 1; i >= 0; i--)
+      freeVars.push_back(i);
+    emit(root);
+    out.push_back(ExprOp((SOperation)storeOp));
+
+    // temporaries which were always found on the stack need no store
+    std::vector<bool> drop(out.size(), false);
+    for (const Node& node : nodes) {
+      if (node.var >= 0 && !node.loaded)
+        drop[node.storePos] = true;
+    }
+    ops.clear();
+    for (size_t i = 0; i < out.size(); i++) {
+      if (!drop[i])
+        ops.push_back(out[i]);
+    }
+  }
+};
+
+static const char* exprOpName(uint32_t op) {
+  switch (op) {
+  case opAdd: return "+";
+  case opSub: return "-";
+  case opMul: return "*";
+  case opDiv: return "/";
+  case opFmod: return "%";
+  case opMax: return "max";
+  case opMin: return "min";
+  case opSqrt: return "sqrt";
+  case opAbs: return "abs";
+  case opSgn: return "sgn";
+  case opGt: return ">";
+  case opLt: return "<";
+  case opEq: return "==";
+  case opNotEq: return "!=";
+  case opLE: return "<=";
+  case opGE: return ">=";
+  case opTernary: return "?";
+  case opAnd: return "and";
+  case opOr: return "or";
+  case opXor: return "xor";
+  case opNeg: return "not";
+  case opNegSign: return "neg";
+  case opExp: return "exp";
+  case opLog: return "log";
+  case opPow: return "pow";
+  case opSin: return "sin";
+  case opCos: return "cos";
+  case opTan: return "tan";
+  case opAsin: return "asin";
+  case opAcos: return "acos";
+  case opAtan: return "atan";
+  case opAtan2: return "atan2";
+  case opClip: return "clip";
+  case opRound: return "round";
+  case opFloor: return "floor";
+  case opCeil: return "ceil";
+  case opTrunc: return "trunc";
+  case opLoadSpatialX: return "sx";
+  case opLoadSpatialY: return "sy";
+  }
+  return nullptr;
+}
+
+// RPN text of the (parsed and optimized) ops, for dumpRPN. The final store is implicit,
+// variables are named v0, v1... after their index.
+static std::string exprToString(const std::vector<ExprOp>& ops, const std::vector<ExprFramePropData>& fp) {
+  std::ostringstream s;
+  s.imbue(std::locale::classic());
+  s.precision(9);
+  auto clipName = [](int index) { return (char)(index < 3 ? 'x' + index : 'a' + index - 3); };
+  for (const ExprOp& op : ops) {
+    const size_t len = (size_t)s.tellp();
+    switch (op.op) {
+    case opLoadSrc8: case opLoadSrc16: case opLoadSrcF32: case opLoadSrcF16:
+      s << clipName(op.e.ival);
+      break;
+    case opLoadRelSrc8: case opLoadRelSrc16: case opLoadRelSrcF32:
+      s << clipName(op.e.ival) << '[' << op.dx << ',' << op.dy << ']';
+      break;
+    case opLoadConst:
+      s << op.e.fval;
+      break;
+    case opLoadInternalVar:
+      s << (op.e.ival == INTERNAL_VAR_CURRENT_FRAME ? "frameno" : "time");
+      break;
+    case opLoadFramePropVar:
+      for (const auto& f : fp) {
+        if (f.var_index == op.e.ival)
+          s << clipName(f.srcIndex) << '.' << f.name;
+      }
+      break;
+    case opDup:
+      s << "dup";
+      if (op.e.ival != 0)
+        s << op.e.ival;
+      break;
+    case opSwap:
+      s << "swap";
+      if (op.e.ival != 1)
+        s << op.e.ival;
+      break;
+    case opStoreVar:
+      s << 'v' << op.e.ival << '@';
+      break;
+    case opStoreVarAndDrop1:
+      s << 'v' << op.e.ival << '^';
+      break;
+    case opLoadVar:
+      s << 'v' << op.e.ival;
+      break;
+    default:
+      if (exprOpName(op.op))
+        s << exprOpName(op.op);
+      break;
+    }
+    if ((size_t)s.tellp() != len)
+      s << ' ';
+  }
+  std::string str = s.str();
+  if (!str.empty())
+    str.pop_back();
+  return str;
+}
+
+#ifdef VS_TARGET_CPU_X86
+/***************************************
+ ***** JIT code cache ******************
+ ***************************************/
+
+// The same expression is often compiled many times: batch-generated scripts with hundreds of
+// identical Expr calls, or Expr inside a ScriptClip body, which is instantiated on every frame.
+// Generated code is shared process-wide, keyed by everything the code generators depend on.
+// Entries are weak, the code lives as long as a filter uses it. Code blocks are placed into
+// larger executable chunks instead of getting a mapping of their own.
+
+enum { EXPR_JIT_SSE2, EXPR_JIT_AVX2, EXPR_JIT_AVX512 };
+
+struct ExprJitKey {
+  int kind;
+  std::vector<uint32_t> ops; // op, value, dx, dy
+  int numInputs;
+  int cpuFlags;
+  int width, height;
+  bool singleMode;
+
+  bool operator<(const ExprJitKey& other) const {
+    return std::tie(kind, ops, numInputs, cpuFlags, width, height, singleMode) <
+      std::tie(other.kind, other.ops, other.numInputs, other.cpuFlags, other.width, other.height, other.singleMode);
+  }
+};
+
+struct ExprJitCode {
+  void* entry;
+};
+
+struct ExprJitCache {
+  enum { CHUNK_SIZE = 256 * 1024, CODE_ALIGN = 64 };
+
+  struct Chunk {
+    uint8_t* base;
+    size_t size;
+    size_t used;
+    int live; // code blocks in use
+  };
+
+  std::mutex mutex;
+  std::map<ExprJitKey, std::weak_ptr<ExprJitCode>> codes;
+  std::vector<Chunk> chunks; // the last one is filled
+
+  void* Allocate(size_t size) {
+    size = (size + CODE_ALIGN - 1) & ~(size_t)(CODE_ALIGN - 1);
+    if (chunks.empty() || chunks.back().used + size > chunks.back().size) {
+      Chunk chunk;
+      chunk.size = std::max((size_t)CHUNK_SIZE, size);
+#ifdef VS_TARGET_OS_WINDOWS
+      chunk.base = (uint8_t*)VirtualAlloc(nullptr, chunk.size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+      chunk.base = (uint8_t*)mmap(nullptr, chunk.size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANON | MAP_PRIVATE, -1, 0);
+      if (chunk.base == MAP_FAILED)
+        chunk.base = nullptr;
+#endif
+      if (chunk.base == nullptr)
+        return nullptr;
+      chunk.used = 0;
+      chunk.live = 0;
+      chunks.push_back(chunk);
+    }
+    Chunk& chunk = chunks.back();
+    void* p = chunk.base + chunk.used;
+    chunk.used += size;
+    chunk.live++;
+    return p;
+  }
+
+  void Free(void* p) {
+    for (size_t i = 0; i < chunks.size(); i++) {
+      Chunk& chunk = chunks[i];
+      if ((uint8_t*)p < chunk.base || (uint8_t*)p >= chunk.base + chunk.size)
+        continue;
+      if (--chunk.live == 0) {
+        if (i == chunks.size() - 1) {
+          chunk.used = 0; // keep the current one for the next codes
+        }
+        else {
+#ifdef VS_TARGET_OS_WINDOWS
+          VirtualFree(chunk.base, 0, MEM_RELEASE);
+#else
+          munmap(chunk.base, chunk.size);
+#endif
+          chunks.erase(chunks.begin() + i);
+        }
+      }
+      return;
+    }
+  }
+};
+
+static ExprJitCache& GetExprJitCache()
+{
+  // never destroyed: the last codes may be released after static destructors ran
+  static ExprJitCache* cache = new ExprJitCache();
+  return *cache;
+}
+
+template<typename ExprEvalT>
+static void* MakeExprJitCode(ExprJitCache& cache, std::vector<ExprOp>& ops, int numInputs, int cpuFlags, int width, int height, bool singleMode, bool avx)
+{
+  ExprEvalT ExprObj(ops, numInputs, cpuFlags, width, height, singleMode);
+  // PF modded jitasm. true: epilog with vmovaps, and vzeroupper
+  if (!ExprObj.GetCode(avx) || !ExprObj.GetCodeSize())
+    return nullptr;
+  void* p = cache.Allocate(ExprObj.GetCodeSize());
+  if (p != nullptr)
+    memcpy(p, ExprObj.GetCode(), ExprObj.GetCodeSize());
+  return p;
+}
+
+static std::shared_ptr<ExprJitCode> GetSharedExprJitCode(int kind, std::vector<ExprOp>& ops, int numInputs, int cpuFlags, int width, int height, bool singleMode)
+{
+  ExprJitKey key = { kind, {}, numInputs, cpuFlags, width, height, singleMode };
+  key.ops.reserve(ops.size() * 4);
+  for (const ExprOp& op : ops) {
+    key.ops.push_back(op.op);
+    key.ops.push_back(op.e.uval);
+    key.ops.push_back((uint32_t)op.dx);
+    key.ops.push_back((uint32_t)op.dy);
+  }
+
+  ExprJitCache& cache = GetExprJitCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+
+  auto it = cache.codes.find(key);
+  if (it != cache.codes.end()) {
+    std::shared_ptr<ExprJitCode> code = it->second.lock();
+    if (code)
+      return code;
+  }
+
+  // Made under the lock, a parallel load of the same expression waits for it instead of making it again
+  void* entry;
+  if (kind == EXPR_JIT_AVX512)
+    entry = MakeExprJitCode<ExprEvalAvx512>(cache, ops, numInputs, cpuFlags, width, height, singleMode, true);
+  else if (kind == EXPR_JIT_AVX2)
+    entry = MakeExprJitCode<ExprEvalAvx2>(cache, ops, numInputs, cpuFlags, width, height, singleMode, true);
+  else
+    entry = MakeExprJitCode<ExprEval>(cache, ops, numInputs, cpuFlags, width, height, singleMode, false);
+  if (entry == nullptr)
+    return nullptr;
+
+  std::shared_ptr<ExprJitCode> code(new ExprJitCode{ entry }, [key](ExprJitCode* p) {
+    ExprJitCache& cache = GetExprJitCache();
+    {
+      std::lock_guard<std::mutex> lock(cache.mutex);
+      auto it = cache.codes.find(key);
+      // may have been replaced by a new code since this one expired
+      if (it != cache.codes.end() && it->second.expired())
+        cache.codes.erase(it);
+      cache.Free(p->entry);
+    }
+    delete p;
+  });
+  cache.codes[key] = code;
+  return code;
+}
+#endif
+
+Exprfilter::Exprfilter(const std::vector<PClip>& _child_array, const std::vector<std::string>& _expr_array, const char *_newformat, const bool _optAvx2, const bool _optAvx512,
+  const bool _optSingleMode, const bool _optSSE2, const bool _optVectorC, const std::string _scale_inputs, const int _clamp_float_i, const int _lutmode, const int _threads,
+  const bool _optRPN, const std::string _dumpRPN, IScriptEnvironment *env) :
+  children(_child_array), expressions(_expr_array), optAvx2(_optAvx2), optAvx512(_optAvx512), optSingleMode(_optSingleMode), optSSE2(_optSSE2),
+  optVectorC(_optVectorC), threads(_threads), optRPN(_optRPN), dumpRPN(_dumpRPN), scale_inputs(_scale_inputs), clamp_float_i(_clamp_float_i), lutmode(_lutmode) {
 
   vi = children[0]->GetVideoInfo();
   d.vi = vi;
@@ -7092,6 +8666,9 @@ Exprfilter::Exprfilter(const std::vector<PClip>& _child_array, const std::vector
         autoconv_full_scale, autoconv_conv_int, autoconv_conv_float, clamp_float_i, shift_float, d.lutmode,
         env), d.maxStackSize);
       foldConstants(d.ops[i]);
+      if (optRPN)
+        ExprOptimizer().optimize(d.ops[i]);
+      d.maxStackSize = std::max(getStackSize(d.ops[i]), d.maxStackSize); // may differ from the parsed one
 
       // optimize constant store, change operation to "fill"
       if (d.plane[i] == poProcess && d.ops[i].size() == 2 && d.ops[i][0].op == opLoadConst) {
@@ -7187,6 +8764,15 @@ Exprfilter::Exprfilter(const std::vector<PClip>& _child_array, const std::vector
 
     }
 
+    if (!dumpRPN.empty()) {
+      FILE* f = fopen(dumpRPN.c_str(), "w");
+      if (f == nullptr)
+        env->ThrowError("Expr: cannot open dumpRPN file '%s'", dumpRPN.c_str());
+      for (int i = 0; i < d.vi.NumComponents(); i++)
+        fprintf(f, "plane %d: %s\n", i, exprToString(d.ops[i], d.frameprops[i]).c_str());
+      fclose(f);
+    }
+
 #ifdef VS_TARGET_CPU_X86
     // optAvx2 can only disable avx2 when available
 
@@ -7201,30 +8787,17 @@ Exprfilter::Exprfilter(const std::vector<PClip>& _child_array, const std::vector
         // to decide if partial chunk is left from the width at the end of the 4/8/16 pixel processing unit big main loops
         // when lut: fake width (x size of lut table) of the lut-init
 
-        if (optAvx2 && d.planeOptAvx2[i]) {
-
-          // avx2
-          ExprEvalAvx2 ExprObj(d.ops[i], d.numInputs, env->GetCPUFlags(), planewidth_real_or_lut, planeheight, optSingleMode);
-          if (ExprObj.GetCode(true) && ExprObj.GetCodeSize()) { // PF modded jitasm. true: epilog with vmovaps, and vzeroupper
-#ifdef VS_TARGET_OS_WINDOWS
-            d.proc[i] = (ExprData::ProcessLineProc)VirtualAlloc(nullptr, ExprObj.GetCodeSize(), MEM_COMMIT, PAGE_EXECUTE_READWRITE);
-#else
-            d.proc[i] = (ExprData::ProcessLineProc)mmap(nullptr, ExprObj.GetCodeSize(), PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANON | MAP_PRIVATE, 0, 0);
-#endif
-            memcpy((void *)d.proc[i], ExprObj.GetCode(), ExprObj.GetCodeSize());
-          }
-        }
-        else if (optSSE2 && d.planeOptSSE2[i]) {
-          // sse2, sse4
-          ExprEval ExprObj(d.ops[i], d.numInputs, env->GetCPUFlags(), planewidth_real_or_lut, planeheight, optSingleMode);
-          if (ExprObj.GetCode() && ExprObj.GetCodeSize()) {
-#ifdef VS_TARGET_OS_WINDOWS
-            d.proc[i] = (ExprData::ProcessLineProc)VirtualAlloc(nullptr, ExprObj.GetCodeSize(), MEM_COMMIT, PAGE_EXECUTE_READWRITE);
-#else
-            d.proc[i] = (ExprData::ProcessLineProc)mmap(nullptr, ExprObj.GetCodeSize(), PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANON | MAP_PRIVATE, 0, 0);
-#endif
-            memcpy((void *)d.proc[i], ExprObj.GetCode(), ExprObj.GetCodeSize());
-          }
+        int kind = -1;
+        if (optAvx512 && d.planeOptAvx2[i])
+          kind = EXPR_JIT_AVX512;
+        else if (optAvx2 && d.planeOptAvx2[i])
+          kind = EXPR_JIT_AVX2;
+        else if (optSSE2 && d.planeOptSSE2[i])
+          kind = EXPR_JIT_SSE2; // sse2, sse4
+        if (kind >= 0) {
+          d.code[i] = GetSharedExprJitCode(kind, d.ops[i], d.numInputs, env->GetCPUFlags(), planewidth_real_or_lut, planeheight, optSingleMode);
+          if (d.code[i])
+            d.proc[i] = (ExprData::ProcessLineProc)d.code[i]->entry;
         }
 
       } // if plane is to be processed
@@ -2,10 +2,8 @@
 #define __Exprfilter_h
 
 #include <avisynth.h>
+#include <memory>
 #include <mutex>
-#ifdef AVS_POSIX
-#include <sys/mman.h>
-#endif
 
 #define MAX_C_VECT 16 // C Expr part: 16*float has still have benefit, less interpreter overhead.
 
@@ -34,7 +32,7 @@
 
 // pad to 32 bytes boundary in x86: 64 * sizeof(pointer) is 32 byte aligned
 #define RWPTR_START_OF_USERVARIABLES (RWPTR_START_OF_INTERNAL_FRAMEPROP_VARIABLES + MAX_FRAMEPROP_VARIABLES) // count = max.256 (for 2*ymm sized variables)
-#define RWPTR_SIZE (RWPTR_START_OF_USERVARIABLES + MAX_USER_VARIABLES * (2*32 / sizeof(void *)))
+#define RWPTR_SIZE (RWPTR_START_OF_USERVARIABLES + MAX_USER_VARIABLES * (2*64 / sizeof(void *))) // 2*zmm sized variables
 
 struct split1 {
   enum empties_t { empties_ok, no_empties };
@@ -106,6 +104,8 @@ struct ExprOp {
   }
 };
 
+struct ExprJitCode;
+
 struct ExprFramePropData {
   int srcIndex;
   std::string name;
@@ -143,20 +143,11 @@ struct ExprData {
 #ifdef VS_TARGET_CPU_X86
   typedef void(*ProcessLineProc)(void *rwptrs, intptr_t ptroff[RWPTR_SIZE], intptr_t niter, uint32_t spatialY);
   ProcessLineProc proc[4]; // 4th: alpha
+  std::shared_ptr<ExprJitCode> code[4]; // owner of proc, shared between filters with the same expression
   ExprData() : clips(), vi(), proc() {}
 #else
   ExprData() : clips(), vi() {}
 #endif
-  ~ExprData() {
-#ifdef VS_TARGET_CPU_X86
-    for (int i = 0; i < 4; i++) // 4th: alpha
-#ifdef VS_TARGET_OS_WINDOWS
-      VirtualFree((LPVOID)proc[i], 0, MEM_RELEASE);
-#else
-      munmap((void *)proc[i], 0);
-#endif
-#endif
-  }
 };
 
 class Exprfilter : public IClip
@@ -170,9 +161,16 @@ private:
   VideoInfo vi;
   ExprData d;
   const bool optAvx2; // disable avx2 path
+  const bool optAvx512; // disable avx512 path
   const bool optSingleMode; // generate asm code using only one XMM/YMM register set instead of two
   const bool optSSE2; // disable simd path
   const bool optVectorC; // if non-SIMD C path, then this goes to a vectorization friendly implementation
+  const int threads; // >1: planes are processed in bands of rows on the environment thread pool
+  const bool optRPN; // CSE and rescheduling of the parsed expressions
+  const std::string dumpRPN; // write the final RPN of the planes to this file
+
+  // bands are not made smaller than this
+  enum { MIN_BAND_ROWS = 16 };
 
   // scale_inputs related settings
   const std::string scale_inputs;
@@ -189,9 +187,10 @@ private:
   void preReadFrameProps(int plane, std::vector<PVideoFrame>& src, IScriptEnvironment* env);
   void calculate_lut(IScriptEnvironment *env);
 public:
-  Exprfilter(const std::vector<PClip>& _child_array, const std::vector<std::string>& _expr_array, const char *_newformat, const bool _optAvx2,
-    const bool _optSingleMode2, const bool _optSSE2, const bool _optVectorC, const std::string _scale_inputs, const int _clamp_float, const int _lutmode, IScriptEnvironment *env);
-  void processFrame(int plane, int w, int h, int pixels_per_iter, float framecount, float relative_time, int numInputs,
+  Exprfilter(const std::vector<PClip>& _child_array, const std::vector<std::string>& _expr_array, const char *_newformat, const bool _optAvx2, const bool _optAvx512,
+    const bool _optSingleMode2, const bool _optSSE2, const bool _optVectorC, const std::string _scale_inputs, const int _clamp_float, const int _lutmode, const int _threads,
+    const bool _optRPN, const std::string _dumpRPN, IScriptEnvironment *env);
+  void processFrame(int plane, int w, int h, int y_start, int y_end, int pixels_per_iter, float framecount, float relative_time, int numInputs,
     uint8_t*& dstp, int dst_stride,
     std::vector<const uint8_t*>& srcp, std::vector<int>& src_stride, std::vector<intptr_t>& ptroffsets, std::vector<const uint8_t*>& srcp_orig);
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment *env);
@@ -211,7 +210,8 @@ public:
   }
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return children[0]->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
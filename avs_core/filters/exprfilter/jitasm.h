@@ -203,6 +203,8 @@ enum PhysicalRegID
 	MM0=0, MM1, MM2, MM3, MM4, MM5, MM6, MM7,
 	XMM0=0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7, XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15,
 	YMM0=0, YMM1, YMM2, YMM3, YMM4, YMM5, YMM6, YMM7, YMM8, YMM9, YMM10, YMM11, YMM12, YMM13, YMM14, YMM15,
+	ZMM0=0, ZMM1, ZMM2, ZMM3, ZMM4, ZMM5, ZMM6, ZMM7, ZMM8, ZMM9, ZMM10, ZMM11, ZMM12, ZMM13, ZMM14, ZMM15,
+	K0=0, K1, K2, K3, K4, K5, K6, K7,
 };
 
 enum
@@ -229,11 +231,14 @@ enum RegType
 	R_TYPE_MMX,				///< MMX register
 	R_TYPE_XMM,				///< XMM register
 	R_TYPE_YMM,				///< YMM register
+	R_TYPE_ZMM,				///< ZMM register
 	R_TYPE_FPU,				///< FPU register
 	R_TYPE_SYMBOLIC_GP,		///< Symbolic general purpose register
 	R_TYPE_SYMBOLIC_MMX,	///< Symbolic MMX register
 	R_TYPE_SYMBOLIC_XMM,	///< Symbolic XMM register
-	R_TYPE_SYMBOLIC_YMM		///< Symbolic YMM register
+	R_TYPE_SYMBOLIC_YMM,	///< Symbolic YMM register
+	R_TYPE_SYMBOLIC_ZMM,	///< Symbolic ZMM register
+	R_TYPE_K				///< AVX-512 opmask register, never allocated
 };
 
 /// Register identifier
@@ -246,7 +251,7 @@ struct RegID
 	bool operator!=(const RegID& rhs) const {return !(*this == rhs);}
 	bool operator<(const RegID& rhs) const {return type != rhs.type ? type < rhs.type : id < rhs.id;}
 	bool IsInvalid() const	{return type == R_TYPE_GP && id == INVALID;}
-	bool IsSymbolic() const {return type == R_TYPE_SYMBOLIC_GP || type == R_TYPE_SYMBOLIC_MMX || type == R_TYPE_SYMBOLIC_XMM || type == R_TYPE_SYMBOLIC_YMM;}
+	bool IsSymbolic() const {return type == R_TYPE_SYMBOLIC_GP || type == R_TYPE_SYMBOLIC_MMX || type == R_TYPE_SYMBOLIC_XMM || type == R_TYPE_SYMBOLIC_YMM || type == R_TYPE_SYMBOLIC_ZMM;}
 	RegType GetType() const {return static_cast<RegType>(type);}
 
 	static RegID Invalid() {
@@ -295,6 +300,7 @@ enum OpdSize
 	O_SIZE_128,
 	O_SIZE_224,
 	O_SIZE_256,
+	O_SIZE_512,
 	O_SIZE_864,
 	O_SIZE_4096
 };
@@ -347,6 +353,8 @@ namespace detail
 		bool	IsMmxReg() const	{return IsReg() && (reg_.type == R_TYPE_MMX || reg_.type == R_TYPE_SYMBOLIC_MMX);}
 		bool	IsXmmReg() const	{return IsReg() && (reg_.type == R_TYPE_XMM || reg_.type == R_TYPE_SYMBOLIC_XMM);}
 		bool	IsYmmReg() const	{return IsReg() && (reg_.type == R_TYPE_YMM || reg_.type == R_TYPE_SYMBOLIC_YMM);}
+		bool	IsZmmReg() const	{return IsReg() && (reg_.type == R_TYPE_ZMM || reg_.type == R_TYPE_SYMBOLIC_ZMM);}
+		bool	IsKReg() const		{return IsReg() && reg_.type == R_TYPE_K;}
 		bool	IsMem() const		{return (opdtype_ & O_TYPE_TYPE_MASK) == O_TYPE_MEM;}
 		bool	IsImm() const		{return (opdtype_ & O_TYPE_TYPE_MASK) == O_TYPE_IMM;}
 		bool	IsDummy() const		{return (opdtype_ & O_TYPE_DUMMY) != 0;}
@@ -428,6 +436,7 @@ namespace detail
 	template<> inline OpdSize ToOpdSize<128>() {return O_SIZE_128;}
 	template<> inline OpdSize ToOpdSize<224>() {return O_SIZE_224;}
 	template<> inline OpdSize ToOpdSize<256>() {return O_SIZE_256;}
+	template<> inline OpdSize ToOpdSize<512>() {return O_SIZE_512;}
 	template<> inline OpdSize ToOpdSize<864>() {return O_SIZE_864;}
 	template<> inline OpdSize ToOpdSize<4096>() {return O_SIZE_4096;}
 
@@ -456,6 +465,7 @@ typedef detail::OpdT<80>	Opd80;
 typedef detail::OpdT<128>	Opd128;
 typedef detail::OpdT<224>	Opd224;		// FPU environment
 typedef detail::OpdT<256>	Opd256;
+typedef detail::OpdT<512>	Opd512;
 typedef detail::OpdT<864>	Opd864;		// FPU state
 typedef detail::OpdT<4096>	Opd4096;	// FPU, MMX, XMM, MXCSR state
 
@@ -511,6 +521,16 @@ struct YmmReg : Opd256 {
 	}
 };
 
+/// ZMM register
+struct ZmmReg : Opd512 {
+	ZmmReg() : Opd512(RegID::CreateSymbolicRegID(R_TYPE_SYMBOLIC_ZMM)) {}
+	explicit ZmmReg(PhysicalRegID id) : Opd512(RegID::CreatePhysicalRegID(R_TYPE_ZMM, id)) {}
+};
+/// AVX-512 opmask register. Not register allocated, the code generator picks k1..k7 itself.
+struct KReg : Opd16 {
+	explicit KReg(PhysicalRegID id) : Opd16(RegID::CreatePhysicalRegID(R_TYPE_K, id)) {}
+};
+
 struct FpuReg_st0 : FpuReg {FpuReg_st0() : FpuReg(ST0) {}};
 
 template<class OpdN>
@@ -526,6 +546,7 @@ typedef MemT<Opd80>		Mem80;
 typedef MemT<Opd128>	Mem128;
 typedef MemT<Opd224>	Mem224;		// FPU environment
 typedef MemT<Opd256>	Mem256;
+typedef MemT<Opd512>	Mem512;
 typedef MemT<Opd864>	Mem864;		// FPU state
 typedef MemT<Opd4096>	Mem4096;	// FPU, MMX, XMM, MXCSR state
 
@@ -957,6 +978,9 @@ enum InstrID
 	I_VEXTRACTI128, I_VINSERTI128, I_VMASKMOVD, I_VMASKMOVQ, I_VPSLLVD, I_VPSLLVQ, I_VPSRAVD, I_VPSRLVD, I_VPSRLVQ,
 	I_VGATHERDPS, I_VGATHERQPS, I_VGATHERDPD, I_VGATHERQPD, I_VPGATHERDD, I_VPGATHERQD, I_VPGATHERDQ, I_VPGATHERQQ,
 
+	// AVX-512 (subset)
+	I_VBLENDMPS, I_VPMOVUSDB, I_VPMOVUSDW, I_VPTERNLOGD, I_VRNDSCALEPS, I_KANDW, I_KMOVW, I_KORW, I_KXORW,
+
 	// jitasm compiler instructions
 	I_COMPILER_DECLARE_REG_ARG,		///< Declare register argument
 	I_COMPILER_DECLARE_STACK_ARG,	///< Declare stack argument
@@ -999,6 +1023,12 @@ enum EncodingFlags
 	E_VEX_F2				= 3 << E_VEX_PP_SHIFT,
 	E_XOP_P00				= 0 << E_VEX_PP_SHIFT,
 	E_XOP_P01				= 1 << E_VEX_PP_SHIFT,
+	E_EVEX					= 1 << 20,	///< EVEX prefix, only zmm0-15 and disp32 addressing are encoded
+	E_EVEX_L2				= 1 << 21,	///< EVEX.L'
+	E_EVEX_Z				= 1 << 22,	///< Zeroing-masking
+	E_EVEX_B				= 1 << 23,	///< Embedded broadcast of a 32 bit memory operand
+	E_EVEX_AAA_SHIFT		= 24,
+	E_EVEX_AAA_MASK			= 0x7 << E_EVEX_AAA_SHIFT,	///< Opmask register
 
 	E_VEX_128		= E_VEX,
 	E_VEX_256		= E_VEX | E_VEX_L,
@@ -1020,6 +1050,7 @@ enum EncodingFlags
 	E_XOP_256		= E_XOP | E_VEX_L,
 	E_XOP_W0		= 0,
 	E_XOP_W1		= E_VEX_W,
+	E_EVEX_512		= E_EVEX | E_EVEX_L2,
 
 	// Aliases
 	E_VEX_128_0F_WIG = E_VEX_128 | E_VEX_0F | E_VEX_WIG,
@@ -1034,8 +1065,17 @@ enum EncodingFlags
 	E_VEX_256_66_0F38_W1 = E_VEX_256 | E_VEX_66_0F38 | E_VEX_W1,
 	E_VEX_128_66_0F3A_W0 = E_VEX_128 | E_VEX_66_0F3A | E_VEX_W0,
 	E_VEX_256_66_0F3A_W0 = E_VEX_256 | E_VEX_66_0F3A | E_VEX_W0,
+	E_EVEX_512_0F_W0 = E_EVEX_512 | E_VEX_0F | E_VEX_W0,
+	E_EVEX_512_66_0F_W0 = E_EVEX_512 | E_VEX_66_0F | E_VEX_W0,
+	E_EVEX_512_F3_0F_W0 = E_EVEX_512 | E_VEX_F3_0F | E_VEX_W0,
+	E_EVEX_512_66_0F38_W0 = E_EVEX_512 | E_VEX_66_0F38 | E_VEX_W0,
+	E_EVEX_512_F3_0F38_W0 = E_EVEX_512 | E_VEX_F3_0F38 | E_VEX_W0,
+	E_EVEX_512_66_0F3A_W0 = E_EVEX_512 | E_VEX_66_0F3A | E_VEX_W0,
 };
 
+/// EVEX opmask field for k, with zeroing-masking if zeroing
+inline uint32 EvexMask(const KReg& k, bool zeroing) {return (static_cast<uint32>(k.GetReg().id) << E_EVEX_AAA_SHIFT) | (zeroing ? E_EVEX_Z : 0);}
+
 /// Instruction
 struct Instr
 {
@@ -1105,7 +1145,21 @@ struct Backend
 
 	void EncodePrefixes(uint32 flag, const detail::Opd& reg, const detail::Opd& r_m, const detail::Opd& vex)
 	{
-		if (flag & (E_VEX | E_XOP)) {
+		if (flag & E_EVEX) {
+			// Encode EVEX prefix. R', V' and X (for register r/m) stay clear, registers are below 16
+#ifdef JITASM64
+			if (r_m.IsMem() && r_m.GetAddressBaseSize() != O_SIZE_64) db(0x67);
+#endif
+			uint8 vvvv = vex.IsReg() ? 0xF - (uint8) vex.GetReg().id : 0xF;
+			uint8 mm = (flag & E_VEX_MMMMM_MASK) >> E_VEX_MMMMM_SHIFT;
+			uint8 pp = static_cast<uint8>((flag & E_VEX_PP_MASK) >> E_VEX_PP_SHIFT);
+			uint8 wrxb = GetWRXB(flag & E_VEX_W, reg, r_m);
+			uint8 ll = (flag & E_EVEX_L2 ? 2 : 0) | (flag & E_VEX_L ? 1 : 0);
+			db(0x62);
+			db((~wrxb & 7) << 5 | 0x10 | mm);
+			db((wrxb & 8) << 4 | vvvv << 3 | 4 | pp);
+			db((flag & E_EVEX_Z ? 0x80 : 0) | ll << 5 | (flag & E_EVEX_B ? 0x10 : 0) | 0x08 | (flag & E_EVEX_AAA_MASK) >> E_EVEX_AAA_SHIFT);
+		} else if (flag & (E_VEX | E_XOP)) {
 			// Encode VEX prefix
 #ifdef JITASM64
 			if (r_m.IsMem() && r_m.GetAddressBaseSize() != O_SIZE_64) db(0x67);
@@ -1158,7 +1212,7 @@ struct Backend
 		}
 	}
 
-	void EncodeModRM(uint8 reg, const detail::Opd& r_m)
+	void EncodeModRM(uint8 reg, const detail::Opd& r_m, bool no_disp8 = false)
 	{
 		reg &= 0x7;
 
@@ -1190,7 +1244,7 @@ struct Backend
 				// ModR/M
 				uint8 mod = 0;
 				if (r_m.GetDisp() == 0 || (sib && base == INVALID)) mod = base != EBP ? 0 : 1;
-				else if (detail::IsInt8(r_m.GetDisp())) mod = 1;
+				else if (detail::IsInt8(r_m.GetDisp()) && !no_disp8) mod = 1;	// EVEX disp8 would be scaled
 				else if (detail::IsInt32(r_m.GetDisp())) mod = 2;
 				else JITASM_ASSERT(0);
 				db(mod << 6 | reg << 3 | (sib ? 4 : base));
@@ -1262,7 +1316,7 @@ struct Backend
 			const detail::Opd& vex = opd3;
 			EncodePrefixes(instr.encoding_flag_, reg, r_m, vex);
 			EncodeOpcode(opcode);
-			EncodeModRM((uint8) (reg.IsImm() ? reg.GetImm() : reg.GetReg().id), r_m);
+			EncodeModRM((uint8) (reg.IsImm() ? reg.GetImm() : reg.GetReg().id), r_m, (instr.encoding_flag_ & E_EVEX) != 0);
 
 			// /is4
 			if (opd4.IsReg()) {
@@ -1633,6 +1687,8 @@ struct Frontend
 	typedef jitasm::MmxReg	MmxReg;
 	typedef jitasm::XmmReg	XmmReg;
 	typedef jitasm::YmmReg	YmmReg;
+	typedef jitasm::ZmmReg	ZmmReg;
+	typedef jitasm::KReg	KReg;
 
 	static Reg8			al, cl, dl, bl, ah, ch, dh, bh;
 	static Reg16		ax, cx, dx, bx, sp, bp, si, di;
@@ -1658,6 +1714,7 @@ struct Frontend
 	AddressingPtr<Opd64>	mmword_ptr;
 	AddressingPtr<Opd128>	xmmword_ptr;
 	AddressingPtr<Opd256>	ymmword_ptr;
+	AddressingPtr<Opd512>	zmmword_ptr;
 	AddressingPtr<Opd32>	real4_ptr;
 	AddressingPtr<Opd64>	real8_ptr;
 	AddressingPtr<Opd80>	real10_ptr;
@@ -5680,6 +5737,83 @@ struct Frontend
 	void vpxor(const YmmReg& dst, const YmmReg& src1, const YmmReg& src2)		{AppendInstr(I_PXOR,	0xEF, E_VEX_256_66_0F_WIG, W(dst), R(src2), R(src1));}
 	void vpxor(const YmmReg& dst, const YmmReg& src1, const Mem256& src2)		{AppendInstr(I_PXOR,	0xEF, E_VEX_256_66_0F_WIG, W(dst), R(src2), R(src1));}
 
+	// AVX-512 (subset). zmm0-15 only, 512 bit vector length.
+	// Mem32 sources of packed instructions are embedded broadcasts {1to16}.
+	// Masked forms take the opmask after the destination: register destinations are zero-masked, memory destinations merge-masked.
+	void vaddps(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_ADDPS, 0x58, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vaddps(const ZmmReg& dst, const ZmmReg& src1, const Mem512& src2)	{AppendInstr(I_ADDPS, 0x58, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vaddps(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_ADDPS, 0x58, E_EVEX_512_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vsubps(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_SUBPS, 0x5C, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vsubps(const ZmmReg& dst, const ZmmReg& src1, const Mem512& src2)	{AppendInstr(I_SUBPS, 0x5C, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vsubps(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_SUBPS, 0x5C, E_EVEX_512_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vmulps(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_MULPS, 0x59, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vmulps(const ZmmReg& dst, const ZmmReg& src1, const Mem512& src2)	{AppendInstr(I_MULPS, 0x59, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vmulps(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_MULPS, 0x59, E_EVEX_512_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vdivps(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_DIVPS, 0x5E, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vdivps(const ZmmReg& dst, const ZmmReg& src1, const Mem512& src2)	{AppendInstr(I_DIVPS, 0x5E, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vdivps(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_DIVPS, 0x5E, E_EVEX_512_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vminps(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_MINPS, 0x5D, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vminps(const ZmmReg& dst, const ZmmReg& src1, const Mem512& src2)	{AppendInstr(I_MINPS, 0x5D, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vminps(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_MINPS, 0x5D, E_EVEX_512_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vmaxps(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_MAXPS, 0x5F, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vmaxps(const ZmmReg& dst, const ZmmReg& src1, const Mem512& src2)	{AppendInstr(I_MAXPS, 0x5F, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1));}
+	void vmaxps(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_MAXPS, 0x5F, E_EVEX_512_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vsqrtps(const ZmmReg& dst, const ZmmReg& src)	{AppendInstr(I_SQRTPS, 0x51, E_EVEX_512_0F_W0, W(dst), R(src));}
+	void vfmadd213ps(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_VFMADD213PS, 0xA8, E_EVEX_512_66_0F38_W0, RW(dst), R(src2), R(src1));}
+	void vfmadd213ps(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_VFMADD213PS, 0xA8, E_EVEX_512_66_0F38_W0 | E_EVEX_B, RW(dst), R(src2), R(src1));}
+	void vfmadd231ps(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_VFMADD231PS, 0xB8, E_EVEX_512_66_0F38_W0, RW(dst), R(src2), R(src1));}
+	void vfmadd231ps(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_VFMADD231PS, 0xB8, E_EVEX_512_66_0F38_W0 | E_EVEX_B, RW(dst), R(src2), R(src1));}
+	void vfnmadd231ps(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_VFNMADD231PS, 0xBC, E_EVEX_512_66_0F38_W0, RW(dst), R(src2), R(src1));}
+	void vfnmadd231ps(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_VFNMADD231PS, 0xBC, E_EVEX_512_66_0F38_W0 | E_EVEX_B, RW(dst), R(src2), R(src1));}
+	void vpandd(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_PAND, 0xDB, E_EVEX_512_66_0F_W0, W(dst), R(src2), R(src1));}
+	void vpandd(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_PAND, 0xDB, E_EVEX_512_66_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vpandnd(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_PANDN, 0xDF, E_EVEX_512_66_0F_W0, W(dst), R(src2), R(src1));}
+	void vpandnd(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_PANDN, 0xDF, E_EVEX_512_66_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vpord(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_POR, 0xEB, E_EVEX_512_66_0F_W0, W(dst), R(src2), R(src1));}
+	void vpord(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_POR, 0xEB, E_EVEX_512_66_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vpxord(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_PXOR, 0xEF, E_EVEX_512_66_0F_W0, W(dst), R(src2), R(src1));}
+	void vpxord(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_PXOR, 0xEF, E_EVEX_512_66_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vpaddd(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_PADDD, 0xFE, E_EVEX_512_66_0F_W0, W(dst), R(src2), R(src1));}
+	void vpaddd(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_PADDD, 0xFE, E_EVEX_512_66_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vpsubd(const ZmmReg& dst, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_PSUBD, 0xFA, E_EVEX_512_66_0F_W0, W(dst), R(src2), R(src1));}
+	void vpsubd(const ZmmReg& dst, const ZmmReg& src1, const Mem32& src2)	{AppendInstr(I_PSUBD, 0xFA, E_EVEX_512_66_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1));}
+	void vpslld(const ZmmReg& dst, const ZmmReg& src, const Imm8& count)	{AppendInstr(I_PSLLD, 0x72, E_EVEX_512_66_0F_W0, Imm8(6), R(src), W(dst), count);}
+	void vpsrld(const ZmmReg& dst, const ZmmReg& src, const Imm8& count)	{AppendInstr(I_PSRLD, 0x72, E_EVEX_512_66_0F_W0, Imm8(2), R(src), W(dst), count);}
+	void vcvtdq2ps(const ZmmReg& dst, const ZmmReg& src)	{AppendInstr(I_CVTDQ2PS, 0x5B, E_EVEX_512_0F_W0, W(dst), R(src));}
+	void vcvtps2dq(const ZmmReg& dst, const ZmmReg& src)	{AppendInstr(I_CVTPS2DQ, 0x5B, E_EVEX_512_66_0F_W0, W(dst), R(src));}
+	void vcvttps2dq(const ZmmReg& dst, const ZmmReg& src)	{AppendInstr(I_CVTTPS2DQ, 0x5B, E_EVEX_512_F3_0F_W0, W(dst), R(src));}
+	void vrndscaleps(const ZmmReg& dst, const ZmmReg& src, const Imm8& mode)	{AppendInstr(I_VRNDSCALEPS, 0x08, E_EVEX_512_66_0F3A_W0, W(dst), R(src), mode);}
+	void vcmpps(const KReg& dst, const ZmmReg& src1, const ZmmReg& src2, const Imm8& imm)	{AppendInstr(I_CMPPS, 0xC2, E_EVEX_512_0F_W0, W(dst), R(src2), R(src1), imm);}
+	void vcmpps(const KReg& dst, const ZmmReg& src1, const Mem32& src2, const Imm8& imm)	{AppendInstr(I_CMPPS, 0xC2, E_EVEX_512_0F_W0 | E_EVEX_B, W(dst), R(src2), R(src1), imm);}
+	// dst = mask ? src2 : src1
+	void vblendmps(const ZmmReg& dst, const KReg& mask, const ZmmReg& src1, const ZmmReg& src2)	{AppendInstr(I_VBLENDMPS, 0x65, E_EVEX_512_66_0F38_W0 | EvexMask(mask, false), W(dst), R(src2), R(src1));}
+	void vmovaps(const ZmmReg& dst, const ZmmReg& src)	{AppendInstr(I_MOVAPS, 0x28, E_EVEX_512_0F_W0, W(dst), R(src));}
+	void vmovaps(const ZmmReg& dst, const KReg& mask, const ZmmReg& src)	{AppendInstr(I_MOVAPS, 0x28, E_EVEX_512_0F_W0 | EvexMask(mask, true), W(dst), R(src));}
+	void vmovups(const ZmmReg& dst, const Mem512& src)	{AppendInstr(I_MOVUPS, 0x10, E_EVEX_512_0F_W0, W(dst), R(src));}
+	void vmovups(const ZmmReg& dst, const KReg& mask, const Mem512& src)	{AppendInstr(I_MOVUPS, 0x10, E_EVEX_512_0F_W0 | EvexMask(mask, true), W(dst), R(src));}
+	void vmovups(const Mem512& dst, const ZmmReg& src)	{AppendInstr(I_MOVUPS, 0x11, E_EVEX_512_0F_W0, R(src), W(dst));}
+	void vmovups(const Mem512& dst, const KReg& mask, const ZmmReg& src)	{AppendInstr(I_MOVUPS, 0x11, E_EVEX_512_0F_W0 | EvexMask(mask, false), R(src), W(dst));}
+	void vbroadcastss(const ZmmReg& dst, const XmmReg& src)	{AppendInstr(I_VBROADCASTSS, 0x18, E_EVEX_512_66_0F38_W0, W(dst), R(src));}
+	void vbroadcastss(const ZmmReg& dst, const Mem32& src)	{AppendInstr(I_VBROADCASTSS, 0x18, E_EVEX_512_66_0F38_W0, W(dst), R(src));}
+	void vbroadcastss(const ZmmReg& dst, const KReg& mask, const Mem32& src)	{AppendInstr(I_VBROADCASTSS, 0x18, E_EVEX_512_66_0F38_W0 | EvexMask(mask, true), W(dst), R(src));}
+	void vpmovzxbd(const ZmmReg& dst, const Mem128& src)	{AppendInstr(I_PMOVZXBD, 0x31, E_EVEX_512_66_0F38_W0, W(dst), R(src));}
+	void vpmovzxbd(const ZmmReg& dst, const KReg& mask, const Mem128& src)	{AppendInstr(I_PMOVZXBD, 0x31, E_EVEX_512_66_0F38_W0 | EvexMask(mask, true), W(dst), R(src));}
+	void vpmovzxwd(const ZmmReg& dst, const Mem256& src)	{AppendInstr(I_PMOVZXWD, 0x33, E_EVEX_512_66_0F38_W0, W(dst), R(src));}
+	void vpmovzxwd(const ZmmReg& dst, const KReg& mask, const Mem256& src)	{AppendInstr(I_PMOVZXWD, 0x33, E_EVEX_512_66_0F38_W0 | EvexMask(mask, true), W(dst), R(src));}
+	void vpmovusdb(const Mem128& dst, const ZmmReg& src)	{AppendInstr(I_VPMOVUSDB, 0x11, E_EVEX_512_F3_0F38_W0, R(src), W(dst));}
+	void vpmovusdb(const Mem128& dst, const KReg& mask, const ZmmReg& src)	{AppendInstr(I_VPMOVUSDB, 0x11, E_EVEX_512_F3_0F38_W0 | EvexMask(mask, false), R(src), W(dst));}
+	void vpmovusdw(const Mem256& dst, const ZmmReg& src)	{AppendInstr(I_VPMOVUSDW, 0x13, E_EVEX_512_F3_0F38_W0, R(src), W(dst));}
+	void vpmovusdw(const Mem256& dst, const KReg& mask, const ZmmReg& src)	{AppendInstr(I_VPMOVUSDW, 0x13, E_EVEX_512_F3_0F38_W0 | EvexMask(mask, false), R(src), W(dst));}
+	void vcvtph2ps(const ZmmReg& dst, const Mem256& src)	{AppendInstr(I_VCVTPH2PS, 0x13, E_EVEX_512_66_0F38_W0, W(dst), R(src));}
+	void vcvtph2ps(const ZmmReg& dst, const KReg& mask, const Mem256& src)	{AppendInstr(I_VCVTPH2PS, 0x13, E_EVEX_512_66_0F38_W0 | EvexMask(mask, true), W(dst), R(src));}
+	void vcvtps2ph(const Mem256& dst, const ZmmReg& src, const Imm8& rc)	{AppendInstr(I_VCVTPS2PH, 0x1D, E_EVEX_512_66_0F3A_W0, R(src), W(dst), rc);}
+	void vcvtps2ph(const Mem256& dst, const KReg& mask, const ZmmReg& src, const Imm8& rc)	{AppendInstr(I_VCVTPS2PH, 0x1D, E_EVEX_512_66_0F3A_W0 | EvexMask(mask, false), R(src), W(dst), rc);}
+	void vpternlogd(const ZmmReg& dst, const KReg& mask, const ZmmReg& src1, const ZmmReg& src2, const Imm8& imm)	{AppendInstr(I_VPTERNLOGD, 0x25, E_EVEX_512_66_0F3A_W0 | EvexMask(mask, false), RW(dst), R(src2), R(src1), imm);}
+	void kmovw(const KReg& dst, const Reg32& src)	{AppendInstr(I_KMOVW, 0x92, E_VEX_128 | E_VEX_0F | E_VEX_W0, W(dst), R(src));}
+	void kandw(const KReg& dst, const KReg& src1, const KReg& src2)	{AppendInstr(I_KANDW, 0x41, E_VEX_256 | E_VEX_0F | E_VEX_W0, W(dst), R(src2), R(src1));}
+	void korw(const KReg& dst, const KReg& src1, const KReg& src2)	{AppendInstr(I_KORW, 0x45, E_VEX_256 | E_VEX_0F | E_VEX_W0, W(dst), R(src2), R(src1));}
+	void kxorw(const KReg& dst, const KReg& src1, const KReg& src2)	{AppendInstr(I_KXORW, 0x47, E_VEX_256 | E_VEX_0F | E_VEX_W0, W(dst), R(src2), R(src1));}
+
 
 	struct ControlState
 	{
@@ -6020,10 +6154,12 @@ namespace compiler
 			case R_TYPE_MMX:			return 1;
 			case R_TYPE_XMM:			return 2;
 			case R_TYPE_YMM:			return 2;
+			case R_TYPE_ZMM:			return 2;
 			case R_TYPE_SYMBOLIC_GP:	return 0;
 			case R_TYPE_SYMBOLIC_MMX:	return 1;
 			case R_TYPE_SYMBOLIC_XMM:	return 2;
 			case R_TYPE_SYMBOLIC_YMM:	return 2;
+			case R_TYPE_SYMBOLIC_ZMM:	return 2;
 			case R_TYPE_FPU:
 			default:
 				JITASM_ASSERT(0);
@@ -6043,10 +6179,12 @@ namespace compiler
 		else if (type == R_TYPE_MMX)			{name.assign("mm");}
 		else if (type == R_TYPE_XMM)			{name.assign("xmm");}
 		else if (type == R_TYPE_YMM)			{name.assign("ymm");}
+		else if (type == R_TYPE_ZMM)			{name.assign("zmm");}
 		else if (type == R_TYPE_SYMBOLIC_GP)	{name.assign("gpsym"); reg_idx -= NUM_OF_PHYSICAL_REG;}
 		else if (type == R_TYPE_SYMBOLIC_MMX)	{name.assign("mmsym"); reg_idx -= NUM_OF_PHYSICAL_REG;}
 		else if (type == R_TYPE_SYMBOLIC_XMM)	{name.assign("xmmsym"); reg_idx -= NUM_OF_PHYSICAL_REG;}
 		else if (type == R_TYPE_SYMBOLIC_YMM)	{name.assign("ymmsym"); reg_idx -= NUM_OF_PHYSICAL_REG;}
+		else if (type == R_TYPE_SYMBOLIC_ZMM)	{name.assign("zmmsym"); reg_idx -= NUM_OF_PHYSICAL_REG;}
 		detail::append_num(name, reg_idx);
 		return name;
 	}
@@ -6108,6 +6246,13 @@ namespace compiler
 		/// Allocate stack of spill slots
 		void AllocSpillSlots(detail::StackManager& stack_manager)
 		{
+			// ZMM
+			for (size_t i = 0; i < attributes_[2].size(); ++i) {
+				if (attributes_[2][i].spill && attributes_[2][i].size == O_SIZE_512 && attributes_[2][i].stack_slot.reg_.IsInvalid()) {
+					attributes_[2][i].stack_slot = stack_manager.Alloc(512 / 8, 32); // stack is 32 bytes aligned only, spilled with unaligned moves
+				}
+			}
+
 			// YMM
 			for (size_t i = 0; i < attributes_[2].size(); ++i) {
 				if (attributes_[2][i].spill && attributes_[2][i].size == O_SIZE_256 && attributes_[2][i].stack_slot.reg_.IsInvalid()) {
@@ -7041,7 +7186,7 @@ namespace compiler
 
 			for (size_t i = 0; i < Instr::MAX_OPERAND_COUNT; ++i) {
 				detail::Opd& opd = it->GetOpd(i);
-				if (opd.IsReg() && !opd.IsFpuReg()) {
+				if (opd.IsReg() && !opd.IsFpuReg() && !opd.IsKReg()) {
 					const RegID& reg = opd.GetReg();
 					const size_t reg_family = GetRegFamily(reg.GetType());
 					if (reg.IsSymbolic()) {
@@ -7175,7 +7320,7 @@ namespace compiler
 					// Add each use point of all operands
 					for (size_t j = 0; j < Instr::MAX_OPERAND_COUNT; ++j) {
 						const detail::Opd& opd = instr.GetOpd(j);
-						if (opd.IsGpReg() || opd.IsMmxReg() || opd.IsXmmReg() || opd.IsYmmReg()) {
+						if (opd.IsGpReg() || opd.IsMmxReg() || opd.IsXmmReg() || opd.IsYmmReg() || opd.IsZmmReg()) {
 							// Register operand
 							const RegID& reg = opd.GetReg();
 							block->GetLifetime(reg.GetType()).AddUsePoint(instr_offset, reg, opd.GetType(), opd.GetSize(), opd.reg_assignable_);
@@ -7369,6 +7514,8 @@ namespace compiler
 					f_->movaps(XmmReg(dst_reg), XmmReg(src_reg));
 			} else if (size == O_SIZE_256) {
 				f_->vmovaps(YmmReg(dst_reg), YmmReg(src_reg));
+			} else if (size == O_SIZE_512) {
+				f_->vmovaps(ZmmReg(dst_reg), ZmmReg(src_reg));
 			} else {
 				JITASM_ASSERT(0);
 			}
@@ -7390,6 +7537,10 @@ namespace compiler
 				f_->vxorps(YmmReg(reg1), YmmReg(reg1), YmmReg(reg2));
 				f_->vxorps(YmmReg(reg2), YmmReg(reg1), YmmReg(reg2));
 				f_->vxorps(YmmReg(reg1), YmmReg(reg1), YmmReg(reg2));
+			} else if (size == O_SIZE_512) {
+				f_->vpxord(ZmmReg(reg1), ZmmReg(reg1), ZmmReg(reg2));
+				f_->vpxord(ZmmReg(reg2), ZmmReg(reg1), ZmmReg(reg2));
+				f_->vpxord(ZmmReg(reg1), ZmmReg(reg1), ZmmReg(reg2));
 			} else {
 				JITASM_ASSERT(0);
 			}
@@ -7405,6 +7556,8 @@ namespace compiler
 					f_->movaps(XmmReg(dst_reg), f_->xmmword_ptr[var_manager_->GetSpillSlot(2, var)]);
 			} else if (size == O_SIZE_256) {
 				f_->vmovaps(YmmReg(dst_reg), f_->ymmword_ptr[var_manager_->GetSpillSlot(2, var)]);
+			} else if (size == O_SIZE_512) {
+				f_->vmovups(ZmmReg(dst_reg), f_->zmmword_ptr[var_manager_->GetSpillSlot(2, var)]);
 			} else {
 				JITASM_ASSERT(0);
 			}
@@ -7420,6 +7573,8 @@ namespace compiler
 					f_->movaps(f_->xmmword_ptr[var_manager_->GetSpillSlot(2, var)], XmmReg(src_reg));
 			} else if (size == O_SIZE_256) {
 				f_->vmovaps(f_->ymmword_ptr[var_manager_->GetSpillSlot(2, var)], YmmReg(src_reg));
+			} else if (size == O_SIZE_512) {
+				f_->vmovups(f_->zmmword_ptr[var_manager_->GetSpillSlot(2, var)], ZmmReg(src_reg));
 			} else {
 				JITASM_ASSERT(0);
 			}
@@ -750,7 +750,6 @@ Interleave::Interleave(const std::vector<PClip>&& _child_array, IScriptEnvironme
 
 int __stdcall Interleave::SetCacheHints(int cachehints,int frame_range)
 {
-  AVS_UNUSED(frame_range);
   switch (cachehints)
   {
   case CACHE_DONT_CACHE_ME:
@@ -759,6 +758,10 @@ int __stdcall Interleave::SetCacheHints(int cachehints,int frame_range)
     return MT_NICE_FILTER;
   case CACHE_GET_DEV_TYPE:
     return child_devs;
+  case CACHE_GET_FRAME_DEPENDENCIES:
+  case CACHE_WILL_NEED_FRAME:
+    child_array[congmod(frame_range, num_children)]->SetCacheHints(CACHE_WILL_NEED_FRAME, frame_range / num_children);
+    return 1;
   default:
     return 0;
   }
@@ -373,6 +373,14 @@ public:
     return child->GetParity(n*every+from);
   }
 
+  int __stdcall SetCacheHints(int cachehints, int frame_range) override {
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES || cachehints == CACHE_WILL_NEED_FRAME) {
+      child->SetCacheHints(CACHE_WILL_NEED_FRAME, frame_range*every+from);
+      return 1;
+    }
+    return NonCachedGenericVideoFilter::SetCacheHints(cachehints, frame_range);
+  }
+
   static AVSValue __cdecl Create(AVSValue args, void*, IScriptEnvironment* env);
 
   inline static AVSValue __cdecl Create_SelectEven(AVSValue args, void*, IScriptEnvironment* env) {
@@ -712,6 +712,21 @@ TemporalSoften::TemporalSoften( PClip _child, unsigned radius, unsigned luma_thr
     }
   }
   planes[c].planeId=0;
+
+  // below radius 3 the SIMD accumulation of the whole window is as fast
+  sliding_window = scenechange == 0 && pixelsize <= 2 && !vi.IsYUY2() && kernel >= 7;
+  for (int i = 0; i < c; i++) {
+    if (planes[i].threshold != 0 && planes[i].threshold != 255)
+      sliding_window = false;
+  }
+#if defined(INTEL_INTRINSICS) && defined(X86_32)
+  // the MMX average rounds differently
+  if (pixelsize == 1 && !(env->GetCPUFlags() & CPUF_SSE2))
+    sliding_window = false;
+#endif
+  window_last_request = -1;
+  window_n = -1;
+  window.resize(kernel);
 }
 
 //offset is the initial value of x. Used when C routine processes only parts of frames after SSE/MMX paths do their job.
@@ -809,7 +824,26 @@ static void accumulate_line(BYTE* c_plane, const BYTE** planeP, int planes, size
   // threshold == 255: simple average
   bool maxThreshold = (threshold == 255);
 #ifdef INTEL_INTRINSICS
-  if ((pixelsize == 2) && (env->GetCPUFlags() & CPUF_SSE4) && rowsize >= 16) {
+  if ((pixelsize == 2) && (env->GetCPUFlags() & CPUF_AVX2) && rowsize >= 32) {
+    // <maxThreshold, lessThan16bit>
+    if (maxThreshold) {
+      if (bits_per_pixel < 16)
+        accumulate_line_16_avx2<true, true>(c_plane, planeP, planes, rowsize, threshold << (bits_per_pixel - 8), div, bits_per_pixel);
+      else
+        accumulate_line_16_avx2<true, false>(c_plane, planeP, planes, rowsize, threshold << (bits_per_pixel - 8), div, bits_per_pixel);
+    }
+    else {
+      if (bits_per_pixel < 16)
+        accumulate_line_16_avx2<false, true>(c_plane, planeP, planes, rowsize, threshold << (bits_per_pixel - 8), div, bits_per_pixel);
+      else
+        accumulate_line_16_avx2<false, false>(c_plane, planeP, planes, rowsize, threshold << (bits_per_pixel - 8), div, bits_per_pixel);
+    }
+  } else if ((pixelsize == 4) && (env->GetCPUFlags() & CPUF_AVX2) && rowsize >= 32) {
+    if (maxThreshold)
+      accumulate_line_float_avx2<true>(c_plane, planeP, planes, rowsize, threshold / 255.0f);
+    else
+      accumulate_line_float_avx2<false>(c_plane, planeP, planes, rowsize, threshold / 255.0f);
+  } else if ((pixelsize == 2) && (env->GetCPUFlags() & CPUF_SSE4) && rowsize >= 16) {
     // <maxThreshold, lessThan16bit>
     if(maxThreshold) {
       if(bits_per_pixel < 16)
@@ -886,6 +920,64 @@ static void accumulate_line(BYTE* c_plane, const BYTE** planeP, int planes, size
    }
 }
 
+// Rounding of the average, as done by accumulate_line for the same plane
+enum {
+  SOFTEN_ROUND_FIXED15, // (sum * (32768 / n) + 16384) >> 15: C and SSSE3
+  SOFTEN_ROUND_SSE2,    // 8 bit SSE2
+  SOFTEN_ROUND_FLOAT    // 10-16 bit SIMD: sum * (1.0f / n), rounded to nearest even
+};
+
+static int soften_rounding(int pixelsize, size_t rowsize, IScriptEnvironment* env)
+{
+#ifdef INTEL_INTRINSICS
+  const int cpu = env->GetCPUFlags();
+  if ((pixelsize == 2) && (cpu & CPUF_SSE2) && rowsize >= 16)
+    return SOFTEN_ROUND_FLOAT;
+  if ((pixelsize == 1) && !(cpu & CPUF_SSSE3) && (cpu & CPUF_SSE2) && rowsize >= 16)
+    return SOFTEN_ROUND_SSE2;
+#endif
+  return SOFTEN_ROUND_FIXED15;
+}
+
+template<typename pixel_t>
+static void window_sum_line(int* sum, const BYTE* _srcp, size_t width)
+{
+  const pixel_t* srcp = reinterpret_cast<const pixel_t*>(_srcp);
+  for (size_t x = 0; x < width; ++x)
+    sum[x] += srcp[x];
+}
+
+// Writes the average of the window. When in is not null, the sums are updated
+// first: the pixels of in are added and the ones of out are removed.
+template<typename pixel_t, int rounding>
+static void window_average_line(int* sum, const BYTE* _in, const BYTE* _out, BYTE* _dstp, size_t width, int frames, int bits_per_pixel)
+{
+  const pixel_t* in = reinterpret_cast<const pixel_t*>(_in);
+  const pixel_t* out = reinterpret_cast<const pixel_t*>(_out);
+  pixel_t* dstp = reinterpret_cast<pixel_t*>(_dstp);
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  const int div = 32768 / frames;
+  const int div_sse2 = 65536 / frames;
+  const float inv = 1.0f / frames;
+
+  for (size_t x = 0; x < width; ++x) {
+    int s = sum[x];
+    if (in != nullptr) {
+      s += in[x] - out[x];
+      sum[x] = s;
+    }
+    if (rounding == SOFTEN_ROUND_FLOAT) {
+      // adding and subtracting 1.5*2^23 rounds like _mm_cvtps_epi32
+      const float f = ((float)s * inv + 12582912.0f) - 12582912.0f;
+      dstp[x] = (pixel_t)min((int)f, max_pixel_value);
+    }
+    else if (rounding == SOFTEN_ROUND_SSE2)
+      dstp[x] = (pixel_t)((((s * 2 * div_sse2) >> 16) + 1) >> 1);
+    else // s * div < 65536 * 32768, fits in unsigned
+      dstp[x] = (pixel_t)(((unsigned)s * (unsigned)div + 16384) >> 15);
+  }
+}
+
 template<typename pixel_t>
 static int64_t calculate_sad_c(const BYTE* cur_ptr, const BYTE* other_ptr, int cur_pitch, int other_pitch, size_t rowsize, size_t height)
 {
@@ -942,6 +1034,25 @@ static int64_t calculate_sad(const BYTE* cur_ptr, const BYTE* other_ptr, int cur
   }
 }
 
+int __stdcall TemporalSoften::SetCacheHints(int cachehints, int frame_range)
+{
+  switch (cachehints) {
+  case CACHE_GET_MTMODE:
+    return MT_NICE_FILTER;
+  case CACHE_GET_FRAME_DEPENDENCIES:
+  {
+    // same frames as GetFrame requests
+    const int n = frame_range;
+    const int radius = ((!luma_threshold && !chroma_threshold) || kernel < 3) ? 0 : (kernel - 1) / 2;
+    for (int p = n - radius; p <= n + radius; ++p)
+      child->SetCacheHints(CACHE_WILL_NEED_FRAME, clamp(p, 0, vi.num_frames - 1));
+    return 1;
+  }
+  default:
+    return 0;
+  }
+}
+
 PVideoFrame TemporalSoften::GetFrame(int n, IScriptEnvironment* env)
 {
   int radius = (kernel-1) / 2;
@@ -955,6 +1066,17 @@ PVideoFrame TemporalSoften::GetFrame(int n, IScriptEnvironment* env)
     return ret;
   }
 
+  if (sliding_window) {
+    // Only one thread at a time can own the window, the others do the full job
+    std::unique_lock<std::mutex> lock(window_mutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+      const bool sequential = (n == window_last_request + 1);
+      window_last_request = n;
+      if (sequential)
+        return GetFrameWindow(n, env);
+    }
+  }
+
   bool planeDisabled[16];
 
   for (int p = 0; p<16; p++) {
@@ -1075,6 +1197,109 @@ PVideoFrame TemporalSoften::GetFrame(int n, IScriptEnvironment* env)
 }
 
 
+// Simple average of the window, updated from the previous frame's sums when
+// possible. Results are the same as accumulate_line's. Called with window_mutex held.
+PVideoFrame TemporalSoften::GetFrameWindow(int n, IScriptEnvironment* env)
+{
+  const int radius = (kernel - 1) / 2;
+  const int last = vi.num_frames - 1;
+  auto slot = [this](int p) { return ((p % kernel) + kernel) % kernel; };
+
+  const bool slide = (window_n >= 0 && n == window_n + 1);
+  PVideoFrame incoming;
+  if (slide) {
+    incoming = child->GetFrame(clamp(n + radius, 0, last), env);
+  }
+  else {
+    window_n = -1;
+    for (int p = n - radius; p <= n + radius; ++p)
+      window[slot(p)] = child->GetFrame(clamp(p, 0, last), env);
+  }
+  // before the update it holds n-radius-1, the one that leaves
+  const PVideoFrame& outgoing = window[slot(n + radius)];
+
+  const PVideoFrame& src = window[slot(n)];
+  PVideoFrame dst = env->NewVideoFrameP(vi, &src);
+
+  // planes which are not averaged are copied
+  const int planesYUV[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+  const int planesRGB[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
+  const int* allplanes = vi.IsYUV() || vi.IsYUVA() ? planesYUV : planesRGB;
+  const int plane_count = vi.IsPlanar() ? vi.NumComponents() : 1;
+  for (int p = 0; p < plane_count; p++) {
+    const int plane = vi.IsPlanar() ? allplanes[p] : 0;
+    bool averaged = false;
+    int c = 0;
+    do {
+      averaged |= (planes[c].planeId == plane && planes[c].threshold != 0);
+      c++;
+    } while (planes[c].planeId);
+    if (!averaged)
+      copy_frame(src, dst, env, &plane, 1);
+  }
+
+  int c = 0;
+  do {
+    if (planes[c].threshold) {
+      const int planeId = planes[c].planeId;
+      const size_t width = dst->GetRowSize(planeId) / pixelsize;
+      const int h = dst->GetHeight(planeId);
+      const int rounding = soften_rounding(pixelsize, dst->GetRowSize(planeId | PLANAR_ALIGNED), env);
+      BYTE* dstp = dst->GetWritePtr(planeId);
+      const int pitch = dst->GetPitch(planeId);
+
+      std::vector<int>& sums = window_sums[c];
+      if (!slide) {
+        sums.assign(width * h, 0);
+        for (int i = 0; i < kernel; i++) {
+          const BYTE* srcp = window[i]->GetReadPtr(planeId);
+          const int src_pitch = window[i]->GetPitch(planeId);
+          for (int y = 0; y < h; y++) {
+            if (pixelsize == 1)
+              window_sum_line<uint8_t>(&sums[y * width], srcp, width);
+            else
+              window_sum_line<uint16_t>(&sums[y * width], srcp, width);
+            srcp += src_pitch;
+          }
+        }
+      }
+
+      const BYTE* inp = slide ? incoming->GetReadPtr(planeId) : nullptr;
+      const BYTE* outp = slide ? outgoing->GetReadPtr(planeId) : nullptr;
+      const int in_pitch = slide ? incoming->GetPitch(planeId) : 0;
+      const int out_pitch = slide ? outgoing->GetPitch(planeId) : 0;
+      for (int y = 0; y < h; y++) {
+        int* sum = &sums[y * width];
+        if (pixelsize == 1) {
+          if (rounding == SOFTEN_ROUND_SSE2)
+            window_average_line<uint8_t, SOFTEN_ROUND_SSE2>(sum, inp, outp, dstp, width, kernel, bits_per_pixel);
+          else
+            window_average_line<uint8_t, SOFTEN_ROUND_FIXED15>(sum, inp, outp, dstp, width, kernel, bits_per_pixel);
+        }
+        else {
+          if (rounding == SOFTEN_ROUND_FLOAT)
+            window_average_line<uint16_t, SOFTEN_ROUND_FLOAT>(sum, inp, outp, dstp, width, kernel, bits_per_pixel);
+          else
+            window_average_line<uint16_t, SOFTEN_ROUND_FIXED15>(sum, inp, outp, dstp, width, kernel, bits_per_pixel);
+        }
+        if (slide) {
+          inp += in_pitch;
+          outp += out_pitch;
+        }
+        dstp += pitch;
+      }
+    }
+    c++;
+  } while (planes[c].planeId);
+
+  if (slide)
+    window[slot(n + radius)] = incoming;
+  window_n = n;
+
+  return dst;
+}
+
+
 AVSValue __cdecl TemporalSoften::Create(AVSValue args, void*, IScriptEnvironment* env)
 {
   return new TemporalSoften( args[0].AsClip(), args[1].AsInt(), args[2].AsInt(),
@@ -36,6 +36,8 @@
 #define __Focus_H__
 
 #include <avisynth.h>
+#include <mutex>
+#include <vector>
 
 template<bool packedRGB3264>
 int calculate_sad_sse2(const BYTE* cur_ptr, const BYTE* other_ptr, int cur_pitch, int other_pitch, size_t rowsize, size_t height);
@@ -52,7 +54,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -72,7 +75,8 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -97,10 +101,7 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
   static AVSValue __cdecl Create(AVSValue args, void*, IScriptEnvironment* env);
 
-  int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
-    return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
-  }
+  int __stdcall SetCacheHints(int cachehints, int frame_range) override;
 
 private:
     typedef struct {
@@ -117,6 +118,18 @@ private:
   const int kernel;
 
   enum { MAX_RADIUS=7 };
+
+  // Sequential requests in simple average mode (thresholds 255, no
+  // scenechange) keep the window frames and the per-pixel sums of the
+  // previous frame: one frame comes in, one goes out.
+  bool sliding_window;
+  std::mutex window_mutex;
+  int window_last_request;
+  int window_n;                      // center of the window, -1 when the sums are not valid
+  std::vector<PVideoFrame> window;   // frames of n-radius..n+radius, indexed by position % kernel
+  std::vector<int> window_sums[3];   // per plane
+
+  PVideoFrame GetFrameWindow(int n, IScriptEnvironment* env);
 };
 
 
@@ -132,7 +145,8 @@ public:
   static AVSValue __cdecl Create(AVSValue args, void*, IScriptEnvironment* env);
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
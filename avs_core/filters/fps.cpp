@@ -620,6 +620,31 @@ ConvertFPS::ConvertFPS(PClip _child, unsigned new_numerator, unsigned new_denomi
 }
 
 
+int __stdcall ConvertFPS::SetCacheHints(int cachehints, int frame_range)
+{
+  switch (cachehints) {
+  case CACHE_GET_MTMODE:
+    return MT_NICE_FILTER;
+  case CACHE_GET_FRAME_DEPENDENCIES:
+  {
+    // the two source frames around n, the switch mode may reach one further
+    // at the start of a transition, that one is a neighbour's dependency anyway
+    const int n = frame_range;
+    const double frac_f = (double)((n * fa) % fb) / fb;
+    const int nsrc = int(n * fa / fb);
+    const int last = child->GetVideoInfo().num_frames - 1;
+    constexpr double threshold_f = 1.0 / 16.0;
+    if (zone >= 0 || frac_f <= 1.0 - threshold_f)
+      child->SetCacheHints(CACHE_WILL_NEED_FRAME, min(nsrc, last));
+    if (zone >= 0 || frac_f >= threshold_f)
+      child->SetCacheHints(CACHE_WILL_NEED_FRAME, min(nsrc + 1, last));
+    return 1;
+  }
+  default:
+    return 0;
+  }
+}
+
 PVideoFrame __stdcall ConvertFPS::GetFrame(int n, IScriptEnvironment* env)
 {
   // Using int64 modulo instead of modf, for double holds only 53 bits
@@ -406,3 +406,95 @@ void af_horizontal_planar_uint16_t_avx2(BYTE* dstp, size_t height, size_t pitch,
     dstp += pitch;
   }
 }
+
+
+// TemporalSoften, 10-16 bits. Same arithmetic as accumulate_line_16_sse41, 16 pixels at a time
+template<bool maxThreshold, bool lessThan16bit>
+void accumulate_line_16_avx2(BYTE* c_plane, const BYTE** planeP, int planes, size_t rowsize, int threshold, int div, int bits_per_pixel)
+{
+  AVS_UNUSED(div);
+  // threshold:
+  // 10-16 bits: orig threshold scaled by (bits_per_pixel-8)
+  int max_pixel_value = (1 << bits_per_pixel) - 1;
+  __m256i limit = _mm256_set1_epi16(max_pixel_value); //used for clamping when 10-14 bits
+  __m256 div_vector = _mm256_set1_ps(1.0f / (planes + 1));
+  __m256i thresh = _mm256_set1_epi16(threshold);
+  __m256i zero = _mm256_setzero_si256();
+
+  for (size_t x = 0; x < rowsize; x += 32) {
+    __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c_plane + x));
+    // unpack and pack are both in-lane, the order is restored by packus
+    __m256i low = _mm256_unpacklo_epi16(current, zero);
+    __m256i high = _mm256_unpackhi_epi16(current, zero);
+
+    for (int plane = planes - 1; plane >= 0; --plane) {
+      __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(planeP[plane] + x));
+
+      __m256i add_low, add_high;
+      if (maxThreshold) {
+        // fast: simple accumulate for average
+        add_low = _mm256_unpacklo_epi16(p, zero);
+        add_high = _mm256_unpackhi_epi16(p, zero);
+      }
+      else {
+        auto pc = _mm256_subs_epu16(p, current);
+        auto cp = _mm256_subs_epu16(current, p);
+        auto abs_cp = _mm256_or_si256(pc, cp);
+        auto leq_thresh = _mm256_cmpeq_epi16(_mm256_min_epu16(abs_cp, thresh), abs_cp);
+        __m256i blended = _mm256_blendv_epi8(current, p, leq_thresh); //abs(p-c) <= thresh ? p : c
+        add_low = _mm256_unpacklo_epi16(blended, zero);
+        add_high = _mm256_unpackhi_epi16(blended, zero);
+      }
+      low = _mm256_add_epi32(low, add_low);
+      high = _mm256_add_epi32(high, add_high);
+    }
+
+    // _mm256_cvtps_epi32: round to nearest, like the SSE versions
+    low = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(low), div_vector));
+    high = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(high), div_vector));
+    __m256i acc = _mm256_packus_epi32(low, high);
+    if (lessThan16bit)
+      acc = _mm256_min_epu16(acc, limit);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(c_plane + x), acc);
+  }
+}
+
+// instantiate
+template void accumulate_line_16_avx2<false, false>(BYTE* c_plane, const BYTE** planeP, int planes, size_t rowsize, int threshold, int div, int bits_per_pixel);
+template void accumulate_line_16_avx2<false, true>(BYTE* c_plane, const BYTE** planeP, int planes, size_t rowsize, int threshold, int div, int bits_per_pixel);
+template void accumulate_line_16_avx2<true, false>(BYTE* c_plane, const BYTE** planeP, int planes, size_t rowsize, int threshold, int div, int bits_per_pixel);
+template void accumulate_line_16_avx2<true, true>(BYTE* c_plane, const BYTE** planeP, int planes, size_t rowsize, int threshold, int div, int bits_per_pixel);
+
+
+// TemporalSoften, 32 bit float. Adds in the same order as accumulate_line_c<float>, results are identical
+template<bool maxThreshold>
+void accumulate_line_float_avx2(BYTE* c_plane, const BYTE** planeP, int planes, size_t rowsize, float threshold)
+{
+  __m256 thresh = _mm256_set1_ps(threshold);
+  __m256 divisor = _mm256_set1_ps((float)(planes + 1));
+  __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+
+  for (size_t x = 0; x < rowsize; x += 32) {
+    __m256 current = _mm256_loadu_ps(reinterpret_cast<const float*>(c_plane + x));
+    __m256 sum = current;
+
+    for (int plane = planes - 1; plane >= 0; --plane) {
+      __m256 p = _mm256_loadu_ps(reinterpret_cast<const float*>(planeP[plane] + x));
+      if (maxThreshold) {
+        sum = _mm256_add_ps(sum, p);
+      }
+      else {
+        __m256 absdiff = _mm256_and_ps(_mm256_sub_ps(current, p), abs_mask);
+        __m256 leq_thresh = _mm256_cmp_ps(absdiff, thresh, _CMP_LE_OQ);
+        sum = _mm256_add_ps(sum, _mm256_blendv_ps(current, p, leq_thresh)); //abs(p-c) <= thresh ? p : c
+      }
+    }
+
+    _mm256_storeu_ps(reinterpret_cast<float*>(c_plane + x), _mm256_div_ps(sum, divisor));
+  }
+}
+
+// instantiate
+template void accumulate_line_float_avx2<false>(BYTE* c_plane, const BYTE** planeP, int planes, size_t rowsize, float threshold);
+template void accumulate_line_float_avx2<true>(BYTE* c_plane, const BYTE** planeP, int planes, size_t rowsize, float threshold);
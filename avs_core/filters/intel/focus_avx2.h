@@ -42,4 +42,9 @@ void af_horizontal_planar_avx2(BYTE* dstp, size_t height, size_t pitch, size_t w
 void af_vertical_avx2(BYTE* line_buf, BYTE* dstp, int height, int pitch, int width, int amount);
 void af_vertical_uint16_t_avx2(BYTE* line_buf, BYTE* dstp, int height, int pitch, int row_size, int amount);
 
+template<bool maxThreshold, bool lessThan16bit>
+void accumulate_line_16_avx2(BYTE* c_plane, const BYTE** planeP, int planes, size_t rowsize, int threshold, int div, int bits_per_pixel);
+template<bool maxThreshold>
+void accumulate_line_float_avx2(BYTE* c_plane, const BYTE** planeP, int planes, size_t rowsize, float threshold);
+
 #endif  // __Focus_AVX2_H__
@@ -516,7 +516,10 @@ AVS_FORCEINLINE static void process_eight_pixels_h_uint16(const uint16_t* src, i
   if constexpr (lessthan16bit)
     result_2x4x_uint16_128 = _mm_min_epu16(result_2x4x_uint16_128, clamp_limit); // extra clamp for 10-14 bits
 
-  _mm_stream_si128(reinterpret_cast<__m128i*>(dst + x), result_2x4x_uint16_128);
+  if (program->streaming_stores)
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + x), result_2x4x_uint16_128);
+  else
+    _mm_store_si128(reinterpret_cast<__m128i*>(dst + x), result_2x4x_uint16_128);
 
 }
 
@@ -716,7 +719,10 @@ AVS_FORCEINLINE static void process_eight_pixels_h_float(const float* src, int x
 
   __m256 result256 = _mm256_insertf128_ps(_mm256_castps128_ps256(result_lo), result_hi, 1); // merge result, result_hi
 
-  _mm256_stream_ps(reinterpret_cast<float*>(dst + x), result256); // 8 results at a time
+  if (program->streaming_stores)
+    _mm256_stream_ps(reinterpret_cast<float*>(dst + x), result256); // 8 results at a time
+  else
+    _mm256_store_ps(reinterpret_cast<float*>(dst + x), result256);
 
 }
 
@@ -857,6 +863,7 @@ void resize_v_avx2_planar_uint16_t(BYTE* dst8, const BYTE* src8, int dst_pitch,
 {
   int filter_size = program->filter_size;
   short* current_coeff = program->pixel_coefficient;
+  const bool streaming_stores = program->streaming_stores;
 
   const __m256i zero = _mm256_setzero_si256();
 
@@ -944,7 +951,10 @@ void resize_v_avx2_planar_uint16_t(BYTE* dst8, const BYTE* src8, int dst_pitch,
       if (lessthan16bit) {
         result_2x8x_uint16 = _mm256_min_epu16(result_2x8x_uint16, clamp_limit); // extra clamp for 10-14 bit
       }
-      _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + x), result_2x8x_uint16);
+      if (streaming_stores)
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + x), result_2x8x_uint16);
+      else
+        _mm256_store_si256(reinterpret_cast<__m256i*>(dst + x), result_2x8x_uint16);
 
     }
 
@@ -961,6 +971,7 @@ void resize_v_avx2_planar_float(BYTE* dst8, const BYTE* src8, int dst_pitch, int
 
   int filter_size = program->filter_size;
   float* current_coeff = program->pixel_coefficient_float;
+  const bool streaming_stores = program->streaming_stores;
 
   const float* src = (const float*)src8;
   float* dst = (float*)dst8;
@@ -987,7 +998,10 @@ void resize_v_avx2_planar_float(BYTE* dst8, const BYTE* src8, int dst_pitch, int
         result_single = _mm256_fmadd_ps(src_val, coeff, result_single);
       }
 
-      _mm256_stream_ps(dst + x, result_single);
+      if (streaming_stores)
+        _mm256_stream_ps(dst + x, result_single);
+      else
+        _mm256_store_ps(dst + x, result_single);
     }
 
     dst += dst_pitch;
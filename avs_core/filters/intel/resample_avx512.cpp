@@ -0,0 +1,745 @@
+// Avisynth v2.5.  Copyright 2002 Ben Rudiak-Gould et al.
+// http://avisynth.nl
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA, or visit
+// http://www.gnu.org/copyleft/gpl.html .
+//
+// Linking Avisynth statically or dynamically with other modules is making a
+// combined work based on Avisynth.  Thus, the terms and conditions of the GNU
+// General Public License cover the whole combination.
+//
+// As a special exception, the copyright holders of Avisynth give you
+// permission to link Avisynth with independent modules that communicate with
+// Avisynth solely through the interfaces defined in avisynth.h, regardless of the license
+// terms of these independent modules, and to copy and distribute the
+// resulting combined work under terms of your choice, provided that
+// every copy of the combined work is accompanied by a complete copy of
+// the source code of Avisynth (the version of Avisynth used to produce the
+// combined work), being distributed under the terms of the GNU General
+// Public License plus this exception.  An independent module is a module
+// which is not derived from or based on Avisynth, such as 3rd-party filters,
+// import and export plugins, or graphical user interfaces.
+
+#include "resample_sse.h"
+#include <avs/config.h>
+#include "../core/internal.h"
+
+#include <avs/alignment.h>
+#include <avs/minmax.h>
+
+// experimental simd includes for avx512 compiled files
+#if defined (__GNUC__) && ! defined (__INTEL_COMPILER)
+#include <x86intrin.h>
+// x86intrin.h includes header files for whatever instruction
+// sets are specified on the compiler command line, such as: xopintrin.h, fma4intrin.h
+#else
+#include <immintrin.h> // MS version of immintrin.h covers AVX, AVX2, AVX512 and FMA3
+#endif // __GNUC__
+
+#if !defined(__FMA__)
+// Assume that all processors that have AVX512 also have FMA3
+#if defined (__GNUC__) && ! defined (__INTEL_COMPILER) && ! defined (__clang__)
+// Prevent error message in g++ when using FMA intrinsics with avx512:
+#pragma message "It is recommended to specify also option -mfma when using -mavx512f or higher"
+#else
+#define __FMA__  1
+#endif
+#endif
+// FMA3 instruction set
+#if defined (__FMA__) && (defined(__GNUC__) || defined(__clang__))  && ! defined (__INTEL_COMPILER)
+#include <fmaintrin.h>
+#endif // __FMA__
+
+
+#include "resample_avx512.h"
+
+// All kernels here need AVX512F, AVX512BW and AVX512VL.
+//
+// Horizontals keep the 8 output pixels per cycle of the AVX2 versions
+// (pixel_offset is padded only to 8 entries), but two pixels share one
+// 512 bit register: the lower 256 bits work on the first pixel, the upper
+// 256 bits on the second one.
+// In the unsafe zone (overread_possible, right end of the scanline) the
+// remaining pixels up to the real kernel size are fetched with masked loads,
+// instead of the 8-4-1 stepping of AVX2. Coefficients are zero padded,
+// so the masked-out (zero) pixels do not contribute.
+//
+// Verticals work on 32 pixels (8-16 bit) or 16 pixels (float) per cycle.
+// The last, partial block of a line is loaded and stored with masks,
+// nothing is read or written beyond width.
+
+// Reduces 4x2 pixels' partial sums (two pixels per register) to 8 sums in pixel order.
+// Transpose-add first: 128 bit lane L of the sum gets the lane L totals of the four registers,
+// then the two lanes of each pixel are folded and the pixels are interleaved back.
+AVS_FORCEINLINE static __m256i hsum_eight_pixels_epi32(const __m512i& result01, const __m512i& result23, const __m512i& result45, const __m512i& result67)
+{
+  __m512i sum0123 = _mm512_add_epi32(_mm512_unpacklo_epi32(result01, result23), _mm512_unpackhi_epi32(result01, result23));
+  __m512i sum4567 = _mm512_add_epi32(_mm512_unpacklo_epi32(result45, result67), _mm512_unpackhi_epi32(result45, result67));
+  __m512i sum = _mm512_add_epi32(_mm512_unpacklo_epi64(sum0123, sum4567), _mm512_unpackhi_epi64(sum0123, sum4567));
+  // lanes: 0246 (first half), 0246 (second half), 1357, 1357
+  sum = _mm512_add_epi32(sum, _mm512_shuffle_i64x2(sum, sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  const __m512i order = _mm512_setr_epi32(0, 8, 1, 9, 2, 10, 3, 11, 0, 8, 1, 9, 2, 10, 3, 11);
+  return _mm512_castsi512_si256(_mm512_permutexvar_epi32(order, sum));
+}
+
+AVS_FORCEINLINE static __m256 hsum_eight_pixels_ps(const __m512& result01, const __m512& result23, const __m512& result45, const __m512& result67)
+{
+  __m512 sum0123 = _mm512_add_ps(_mm512_unpacklo_ps(result01, result23), _mm512_unpackhi_ps(result01, result23));
+  __m512 sum4567 = _mm512_add_ps(_mm512_unpacklo_ps(result45, result67), _mm512_unpackhi_ps(result45, result67));
+  __m512 sum = _mm512_add_ps(
+    _mm512_castpd_ps(_mm512_unpacklo_pd(_mm512_castps_pd(sum0123), _mm512_castps_pd(sum4567))),
+    _mm512_castpd_ps(_mm512_unpackhi_pd(_mm512_castps_pd(sum0123), _mm512_castps_pd(sum4567))));
+  // lanes: 0246 (first half), 0246 (second half), 1357, 1357
+  sum = _mm512_add_ps(sum, _mm512_shuffle_f32x4(sum, sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  const __m512i order = _mm512_setr_epi32(0, 8, 1, 9, 2, 10, 3, 11, 0, 8, 1, 9, 2, 10, 3, 11);
+  return _mm512_castps512_ps256(_mm512_permutexvar_ps(order, sum));
+}
+
+// Loading two pixels' data or coefficients: the first pixel's goes to the lower, the second one's
+// to the upper half. The upper half is a merging masked load instead of a lane insert,
+// keeps the shuffle port free for the conversions and the reduction.
+AVS_FORCEINLINE static __m256i load_two_pixels_epi8(const uint8_t* p1, const uint8_t* p2)
+{
+  return _mm256_mask_loadu_epi8(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p1))), 0xFFFF0000, p2 - 16);
+}
+
+// only the lowest 'count' (< 16) of the 16 pixels, the rest is zero
+AVS_FORCEINLINE static __m256i load_two_pixels_partial_epi8(const uint8_t* p1, const uint8_t* p2, int count)
+{
+  const __mmask32 mask = (1u << count) - 1;
+  return _mm256_mask_loadu_epi8(_mm256_maskz_loadu_epi8(mask, p1), mask << 16, p2 - 16);
+}
+
+template<typename T> // short or uint16_t
+AVS_FORCEINLINE static __m512i load_two_pixels_epi16(const T* p1, const T* p2)
+{
+  return _mm512_mask_loadu_epi16(_mm512_castsi256_si512(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p1))), 0xFFFF0000, p2 - 16);
+}
+
+AVS_FORCEINLINE static __m512i load_two_pixels_partial_epi16(const uint16_t* p1, const uint16_t* p2, int count)
+{
+  const __mmask32 mask = (1u << count) - 1;
+  return _mm512_mask_loadu_epi16(_mm512_maskz_loadu_epi16(mask, p1), mask << 16, p2 - 16);
+}
+
+// Float has no conversion step, the plain lane insert is the faster there
+AVS_FORCEINLINE static __m512 load_two_pixels_ps(const float* p1, const float* p2)
+{
+  return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_castps_pd(_mm256_loadu_ps(p1))), _mm256_castps_pd(_mm256_loadu_ps(p2)), 1));
+}
+
+// only the lowest 'count' (< 8) of the 8 pixels, the rest is zero
+AVS_FORCEINLINE static __m512 load_two_pixels_partial_ps(const float* p1, const float* p2, int count)
+{
+  const __mmask8 mask = (__mmask8)((1u << count) - 1);
+  return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_castps_pd(_mm256_maskz_loadu_ps(mask, p1))), _mm256_castps_pd(_mm256_maskz_loadu_ps(mask, p2)), 1));
+}
+
+//-------- 512 bit uint8_t Horizontals
+
+// filtersizealigned16: special: 1..4. Generic: -1
+template<bool safe_aligned_mode, int filtersizealigned16>
+AVS_FORCEINLINE static void process_two_pixels_h_uint8(const uint8_t* src, int begin1, int begin2, const short* current_coeff, int filter_size, __m512i& result, int kernel_size)
+{
+  filter_size = (filtersizealigned16 >= 1) ? filtersizealigned16 * 16 : filter_size;
+  // knowing a quasi-constexpr filter_size from template for commonly used sizes
+  // aligned_filter_size 16, 32, 48, 64, hugely helps compiler optimization
+
+  const uint8_t* src_ptr1 = src + begin1;
+  const uint8_t* src_ptr2 = src + begin2;
+  const short* current_coeff2 = current_coeff + filter_size; // Points to second pixel's coefficients
+
+  int ksmod16;
+  if constexpr (safe_aligned_mode)
+    ksmod16 = filter_size;
+  else
+    ksmod16 = kernel_size / 16 * 16; // danger zone, scanline overread possible. Use exact unaligned kernel_size
+
+  int i = 0;
+  for (; i < ksmod16; i += 16) {
+    __m256i data = load_two_pixels_epi8(src_ptr1 + i, src_ptr2 + i);
+    __m512i coeff = load_two_pixels_epi16(current_coeff + i, current_coeff2 + i);
+    result = _mm512_add_epi32(result, _mm512_madd_epi16(_mm512_cvtepu8_epi16(data), coeff));
+  }
+
+  if constexpr (!safe_aligned_mode) {
+    if (i < kernel_size) {
+      __m256i data = load_two_pixels_partial_epi8(src_ptr1 + i, src_ptr2 + i, kernel_size - i);
+      __m512i coeff = load_two_pixels_epi16(current_coeff + i, current_coeff2 + i);
+      result = _mm512_add_epi32(result, _mm512_madd_epi16(_mm512_cvtepu8_epi16(data), coeff));
+    }
+  }
+}
+
+// filtersizealigned16: special: 1..4. Generic: -1
+template<bool is_safe, int filtersizealigned16>
+AVS_FORCEINLINE static void process_eight_pixels_h_uint8(const uint8_t* src, int x, const short* current_coeff_base, int filter_size,
+  const __m512i& rounder512, uint8_t* dst, ResamplingProgram* program)
+{
+  assert(program->filter_size_alignment >= 16); // code assumes this
+
+  filter_size = (filtersizealigned16 >= 1) ? filtersizealigned16 * 16 : filter_size;
+
+  const short* current_coeff = current_coeff_base + x * filter_size;
+  const int* offsets = program->pixel_offset.data() + x;
+  const int unaligned_kernel_size = program->filter_size_real;
+
+  __m512i result01 = rounder512;
+  __m512i result23 = rounder512;
+  __m512i result45 = rounder512;
+  __m512i result67 = rounder512;
+  process_two_pixels_h_uint8<is_safe, filtersizealigned16>(src, offsets[0], offsets[1], current_coeff + 0 * filter_size, filter_size, result01, unaligned_kernel_size);
+  process_two_pixels_h_uint8<is_safe, filtersizealigned16>(src, offsets[2], offsets[3], current_coeff + 2 * filter_size, filter_size, result23, unaligned_kernel_size);
+  process_two_pixels_h_uint8<is_safe, filtersizealigned16>(src, offsets[4], offsets[5], current_coeff + 4 * filter_size, filter_size, result45, unaligned_kernel_size);
+  process_two_pixels_h_uint8<is_safe, filtersizealigned16>(src, offsets[6], offsets[7], current_coeff + 6 * filter_size, filter_size, result67, unaligned_kernel_size);
+
+  __m256i result_8x_uint32 = hsum_eight_pixels_epi32(result01, result23, result45, result67);
+
+  // scale back, clamp to 0..255, store
+  __m256i result = _mm256_srai_epi32(result_8x_uint32, FPScale8bits);
+  result = _mm256_max_epi32(result, _mm256_setzero_si256());
+  __m128i result_8x_uint8 = _mm256_cvtusepi32_epi8(result);
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), result_8x_uint8);
+}
+
+// filtersizealigned16: special: 1..4. Generic: -1
+template<int filtersizealigned16>
+static void internal_resizer_h_avx512_generic_uint8_t(BYTE* dst, const BYTE* src, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int height, int bits_per_pixel) {
+  AVS_UNUSED(bits_per_pixel);
+  const int filter_size = (filtersizealigned16 >= 1) ? filtersizealigned16 * 16 : program->filter_size;
+
+  // rounder for both pixels of a register
+  const __m512i rounder512 = _mm512_setr_epi32(1 << (FPScale8bits - 1), 0, 0, 0, 0, 0, 0, 0, 1 << (FPScale8bits - 1), 0, 0, 0, 0, 0, 0, 0);
+
+  const int w_safe_mod8 = (program->overread_possible ? program->source_overread_beyond_targetx : width) / 8 * 8;
+
+  for (int y = 0; y < height; y++) {
+    const short* current_coeff_base = program->pixel_coefficient;
+
+    // Process safe aligned pixels
+    for (int x = 0; x < w_safe_mod8; x += 8) {
+      process_eight_pixels_h_uint8<true, filtersizealigned16>(src, x, current_coeff_base, filter_size, rounder512, dst, program);
+    }
+
+    // Process up to the actual kernel size instead of the aligned filter_size to prevent overreading beyond the last source pixel.
+    // We assume extra offset entries were added to the p->pixel_offset array (aligned to 8 during initialization).
+    // This may store 1-7 false pixels, but they are ignored since Avisynth will not read beyond the width.
+    for (int x = w_safe_mod8; x < width; x += 8) {
+      process_eight_pixels_h_uint8<false, filtersizealigned16>(src, x, current_coeff_base, filter_size, rounder512, dst, program);
+    }
+
+    dst += dst_pitch;
+    src += src_pitch;
+  }
+}
+
+// coeffs are safely padded/aligned to 16
+void resizer_h_avx512_generic_uint8_t(BYTE* dst8, const BYTE* src8, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int height, int bits_per_pixel) {
+  const int filter_size = program->filter_size;
+  assert(program->filter_size_alignment == 16);
+
+  if (filter_size == 16)
+    internal_resizer_h_avx512_generic_uint8_t<1>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else if (filter_size == 2 * 16)
+    internal_resizer_h_avx512_generic_uint8_t<2>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else if (filter_size == 3 * 16)
+    internal_resizer_h_avx512_generic_uint8_t<3>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else if (filter_size == 4 * 16)
+    internal_resizer_h_avx512_generic_uint8_t<4>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else // -1: basic method, use program->filter_size
+    internal_resizer_h_avx512_generic_uint8_t<-1>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+}
+
+//--------------------------------------------------------------------
+// 16 bit Horizontal
+
+template<bool safe_aligned_mode, bool lessthan16bit, int filtersizealigned16>
+AVS_FORCEINLINE static void process_two_pixels_h_uint16(const uint16_t* src, int begin1, int begin2, const short* current_coeff, int filter_size, __m512i& result, int kernel_size,
+  const __m512i& shifttosigned)
+{
+  filter_size = (filtersizealigned16 >= 1) ? filtersizealigned16 * 16 : filter_size;
+
+  const uint16_t* src_ptr1 = src + begin1;
+  const uint16_t* src_ptr2 = src + begin2;
+  const short* current_coeff2 = current_coeff + filter_size; // Points to second pixel's coefficients
+
+  int ksmod16;
+  if constexpr (safe_aligned_mode)
+    ksmod16 = filter_size;
+  else
+    ksmod16 = kernel_size / 16 * 16; // danger zone, scanline overread possible. Use exact unaligned kernel_size
+
+  int i = 0;
+  for (; i < ksmod16; i += 16) {
+    __m512i data = load_two_pixels_epi16(src_ptr1 + i, src_ptr2 + i);
+    if constexpr (!lessthan16bit)
+      data = _mm512_add_epi16(data, shifttosigned); // unsigned -> signed
+    __m512i coeff = load_two_pixels_epi16(current_coeff + i, current_coeff2 + i);
+    result = _mm512_add_epi32(result, _mm512_madd_epi16(data, coeff));
+  }
+
+  if constexpr (!safe_aligned_mode) {
+    if (i < kernel_size) {
+      __m512i data = load_two_pixels_partial_epi16(src_ptr1 + i, src_ptr2 + i, kernel_size - i);
+      if constexpr (!lessthan16bit)
+        data = _mm512_add_epi16(data, shifttosigned); // unsigned -> signed, masked-out pixels still meet zero coeffs
+      __m512i coeff = load_two_pixels_epi16(current_coeff + i, current_coeff2 + i);
+      result = _mm512_add_epi32(result, _mm512_madd_epi16(data, coeff));
+    }
+  }
+}
+
+template<bool is_safe, bool lessthan16bit, int filtersizealigned16>
+AVS_FORCEINLINE static void process_eight_pixels_h_uint16(const uint16_t* src, int x, const short* current_coeff_base, int filter_size,
+  const __m512i& rounder512, const __m512i& shifttosigned, const __m128i& clamp_limit,
+  uint16_t* dst, ResamplingProgram* program)
+{
+  assert(program->filter_size_alignment >= 16); // code assumes this
+
+  filter_size = (filtersizealigned16 >= 1) ? filtersizealigned16 * 16 : filter_size;
+
+  const short* current_coeff = current_coeff_base + x * filter_size;
+  const int* offsets = program->pixel_offset.data() + x;
+  const int unaligned_kernel_size = program->filter_size_real;
+
+  __m512i result01 = rounder512;
+  __m512i result23 = rounder512;
+  __m512i result45 = rounder512;
+  __m512i result67 = rounder512;
+  process_two_pixels_h_uint16<is_safe, lessthan16bit, filtersizealigned16>(src, offsets[0], offsets[1], current_coeff + 0 * filter_size, filter_size, result01, unaligned_kernel_size, shifttosigned);
+  process_two_pixels_h_uint16<is_safe, lessthan16bit, filtersizealigned16>(src, offsets[2], offsets[3], current_coeff + 2 * filter_size, filter_size, result23, unaligned_kernel_size, shifttosigned);
+  process_two_pixels_h_uint16<is_safe, lessthan16bit, filtersizealigned16>(src, offsets[4], offsets[5], current_coeff + 4 * filter_size, filter_size, result45, unaligned_kernel_size, shifttosigned);
+  process_two_pixels_h_uint16<is_safe, lessthan16bit, filtersizealigned16>(src, offsets[6], offsets[7], current_coeff + 6 * filter_size, filter_size, result67, unaligned_kernel_size, shifttosigned);
+
+  __m256i result_8x_uint32 = hsum_eight_pixels_epi32(result01, result23, result45, result67);
+
+  // correct if signed, scale back, clamp, store
+  if constexpr (!lessthan16bit)
+    result_8x_uint32 = _mm256_add_epi32(result_8x_uint32, _mm256_set1_epi32(+32768 << FPScale16bits)); // yes, 32 bit data. for 16 bits only
+  __m256i result = _mm256_srai_epi32(result_8x_uint32, FPScale16bits);
+  result = _mm256_max_epi32(result, _mm256_setzero_si256());
+  __m128i result_8x_uint16 = _mm256_cvtusepi32_epi16(result);
+  if constexpr (lessthan16bit)
+    result_8x_uint16 = _mm_min_epu16(result_8x_uint16, clamp_limit); // extra clamp for 10-14 bits
+
+  if (program->streaming_stores)
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + x), result_8x_uint16);
+  else
+    _mm_store_si128(reinterpret_cast<__m128i*>(dst + x), result_8x_uint16);
+}
+
+// filtersizealigned16: special: 1..4. Generic: -1
+template<bool lessthan16bit, int filtersizealigned16>
+static void internal_resizer_h_avx512_generic_uint16_t(BYTE* dst8, const BYTE* src8, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int height, int bits_per_pixel) {
+  const int filter_size = (filtersizealigned16 >= 1) ? filtersizealigned16 * 16 : program->filter_size;
+
+  const __m512i rounder512 = _mm512_setr_epi32(1 << (FPScale16bits - 1), 0, 0, 0, 0, 0, 0, 0, 1 << (FPScale16bits - 1), 0, 0, 0, 0, 0, 0, 0);
+  const __m512i shifttosigned = _mm512_set1_epi16(-32768); // for 16 bits only
+  const __m128i clamp_limit = _mm_set1_epi16((short)((1 << bits_per_pixel) - 1)); // clamp limit for <16 bits
+
+  const uint16_t* src = reinterpret_cast<const uint16_t*>(src8);
+  uint16_t* dst = reinterpret_cast<uint16_t*>(dst8);
+  dst_pitch /= sizeof(uint16_t);
+  src_pitch /= sizeof(uint16_t);
+
+  const int w_safe_mod8 = (program->overread_possible ? program->source_overread_beyond_targetx : width) / 8 * 8;
+
+  for (int y = 0; y < height; y++) {
+    const short* current_coeff_base = program->pixel_coefficient;
+
+    // Process safe aligned pixels
+    for (int x = 0; x < w_safe_mod8; x += 8) {
+      process_eight_pixels_h_uint16<true, lessthan16bit, filtersizealigned16>(src, x, current_coeff_base, filter_size, rounder512, shifttosigned, clamp_limit, dst, program);
+    }
+
+    // Process up to the actual kernel size instead of the aligned filter_size to prevent overreading beyond the last source pixel.
+    // May store 1-7 false pixels, like the AVX2 version.
+    for (int x = w_safe_mod8; x < width; x += 8) {
+      process_eight_pixels_h_uint16<false, lessthan16bit, filtersizealigned16>(src, x, current_coeff_base, filter_size, rounder512, shifttosigned, clamp_limit, dst, program);
+    }
+
+    dst += dst_pitch;
+    src += src_pitch;
+  }
+}
+
+template<bool lessthan16bit>
+void resizer_h_avx512_generic_uint16_t(BYTE* dst8, const BYTE* src8, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int height, int bits_per_pixel) {
+  const int filter_size = program->filter_size;
+  assert(program->filter_size_alignment == 16);
+
+  if (filter_size == 16)
+    internal_resizer_h_avx512_generic_uint16_t<lessthan16bit, 1>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else if (filter_size == 2 * 16)
+    internal_resizer_h_avx512_generic_uint16_t<lessthan16bit, 2>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else if (filter_size == 3 * 16)
+    internal_resizer_h_avx512_generic_uint16_t<lessthan16bit, 3>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else if (filter_size == 4 * 16)
+    internal_resizer_h_avx512_generic_uint16_t<lessthan16bit, 4>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else // -1: basic method, use program->filter_size
+    internal_resizer_h_avx512_generic_uint16_t<lessthan16bit, -1>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+}
+
+//--------------------------------------------------------------------
+// Float Horizontal
+
+template<bool safe_aligned_mode, int filtersizealigned8>
+AVS_FORCEINLINE static void process_two_pixels_h_float(const float* src, int begin1, int begin2, const float* current_coeff, int filter_size, __m512& result, int kernel_size)
+{
+  filter_size = (filtersizealigned8 >= 1) ? filtersizealigned8 * 8 : filter_size;
+
+  const float* src_ptr1 = src + begin1;
+  const float* src_ptr2 = src + begin2;
+  const float* current_coeff2 = current_coeff + filter_size; // Points to second pixel's coefficients
+
+  int ksmod8;
+  // 32 bytes contain 8 floats
+  if constexpr (safe_aligned_mode)
+    ksmod8 = filter_size;
+  else
+    ksmod8 = kernel_size / 8 * 8; // danger zone, scanline overread possible. Use exact unaligned kernel_size
+
+  int i = 0;
+  for (; i < ksmod8; i += 8) {
+    __m512 data = load_two_pixels_ps(src_ptr1 + i, src_ptr2 + i);
+    __m512 coeff = load_two_pixels_ps(current_coeff + i, current_coeff2 + i);
+    result = _mm512_fmadd_ps(data, coeff, result); // a*b + c
+  }
+
+  if constexpr (!safe_aligned_mode) {
+    if (i < kernel_size) {
+      __m512 data = load_two_pixels_partial_ps(src_ptr1 + i, src_ptr2 + i, kernel_size - i);
+      __m512 coeff = load_two_pixels_ps(current_coeff + i, current_coeff2 + i);
+      result = _mm512_fmadd_ps(data, coeff, result);
+    }
+  }
+}
+
+template<bool is_safe, int filtersizealigned8>
+AVS_FORCEINLINE static void process_eight_pixels_h_float(const float* src, int x, const float* current_coeff_base, int filter_size,
+  float* dst, ResamplingProgram* program)
+{
+  assert(program->filter_size_alignment >= 8); // code assumes this
+
+  filter_size = (filtersizealigned8 >= 1) ? filtersizealigned8 * 8 : filter_size;
+
+  const float* current_coeff = current_coeff_base + x * filter_size;
+  const int* offsets = program->pixel_offset.data() + x;
+  const int unaligned_kernel_size = program->filter_size_real;
+
+  __m512 result01 = _mm512_setzero_ps();
+  __m512 result23 = _mm512_setzero_ps();
+  __m512 result45 = _mm512_setzero_ps();
+  __m512 result67 = _mm512_setzero_ps();
+  process_two_pixels_h_float<is_safe, filtersizealigned8>(src, offsets[0], offsets[1], current_coeff + 0 * filter_size, filter_size, result01, unaligned_kernel_size);
+  process_two_pixels_h_float<is_safe, filtersizealigned8>(src, offsets[2], offsets[3], current_coeff + 2 * filter_size, filter_size, result23, unaligned_kernel_size);
+  process_two_pixels_h_float<is_safe, filtersizealigned8>(src, offsets[4], offsets[5], current_coeff + 4 * filter_size, filter_size, result45, unaligned_kernel_size);
+  process_two_pixels_h_float<is_safe, filtersizealigned8>(src, offsets[6], offsets[7], current_coeff + 6 * filter_size, filter_size, result67, unaligned_kernel_size);
+
+  const __m256 result = hsum_eight_pixels_ps(result01, result23, result45, result67); // 8 results at a time
+  if (program->streaming_stores)
+    _mm256_stream_ps(dst + x, result);
+  else
+    _mm256_store_ps(dst + x, result);
+}
+
+// filtersizealigned8: special: 1..4. Generic: -1
+template<int filtersizealigned8>
+static void internal_resizer_h_avx512_generic_float(BYTE* dst8, const BYTE* src8, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int height, int bits_per_pixel) {
+  AVS_UNUSED(bits_per_pixel);
+  const int filter_size = (filtersizealigned8 >= 1) ? filtersizealigned8 * 8 : program->filter_size;
+
+  const float* src = (const float*)src8;
+  float* dst = (float*)dst8;
+  dst_pitch = dst_pitch / sizeof(float);
+  src_pitch = src_pitch / sizeof(float);
+
+  const int w_safe_mod8 = (program->overread_possible ? program->source_overread_beyond_targetx : width) / 8 * 8;
+
+  for (int y = 0; y < height; y++) {
+    const float* current_coeff_base = program->pixel_coefficient_float;
+
+    // Process safe aligned pixels
+    for (int x = 0; x < w_safe_mod8; x += 8) {
+      process_eight_pixels_h_float<true, filtersizealigned8>(src, x, current_coeff_base, filter_size, dst, program);
+    }
+
+    // Process up to the actual kernel size instead of the aligned filter_size to prevent overreading beyond the last source pixel.
+    // May store 1-7 false pixels, like the AVX2 version.
+    for (int x = w_safe_mod8; x < width; x += 8) {
+      process_eight_pixels_h_float<false, filtersizealigned8>(src, x, current_coeff_base, filter_size, dst, program);
+    }
+
+    dst += dst_pitch;
+    src += src_pitch;
+  }
+}
+
+void resizer_h_avx512_generic_float(BYTE* dst8, const BYTE* src8, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int height, int bits_per_pixel) {
+  const int filter_size = program->filter_size;
+  assert(program->filter_size_alignment == 8);
+
+  if (filter_size == 8)
+    internal_resizer_h_avx512_generic_float<1>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else if (filter_size == 2 * 8)
+    internal_resizer_h_avx512_generic_float<2>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else if (filter_size == 3 * 8)
+    internal_resizer_h_avx512_generic_float<3>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else if (filter_size == 4 * 8)
+    internal_resizer_h_avx512_generic_float<4>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+  else // -1: basic method, use program->filter_size
+    internal_resizer_h_avx512_generic_float<-1>(dst8, src8, dst_pitch, src_pitch, program, width, height, bits_per_pixel);
+}
+
+//-------- 512 bit Verticals
+
+// 32 pixels. masked: last partial block of the line, mask has the valid pixels
+template<bool masked>
+AVS_FORCEINLINE static void process_32pixels_v_uint8(const uint8_t* src_ptr, int src_pitch, const short* current_coeff, int kernel_size,
+  uint8_t* dst, __mmask32 mask, const __m512i& rounder)
+{
+  auto load = [&](const uint8_t* p) {
+    if constexpr (masked)
+      return _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(mask, p));
+    else
+      return _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+  };
+
+  __m512i result_lo = rounder;
+  __m512i result_hi = rounder;
+
+  // Process pairs of rows (2 coeffs/cycle)
+  int i = 0;
+  for (; i < kernel_size - 1; i += 2) {
+    __m512i coeff = _mm512_set1_epi32(*reinterpret_cast<const int*>(current_coeff + i)); // CO|co|CO|co|...
+    __m512i src_even = load(src_ptr + i * src_pitch); // 32x 8->16bit pixels
+    __m512i src_odd = load(src_ptr + (i + 1) * src_pitch);
+    result_lo = _mm512_add_epi32(result_lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(src_even, src_odd), coeff));
+    result_hi = _mm512_add_epi32(result_hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(src_even, src_odd), coeff));
+  }
+
+  // Process the last odd row if needed
+  if (i < kernel_size) {
+    __m512i coeff = _mm512_set1_epi16(current_coeff[i]); // co|co|co|co|... against pixel|0
+    __m512i src_even = load(src_ptr + i * src_pitch);
+    __m512i zero = _mm512_setzero_si512();
+    result_lo = _mm512_add_epi32(result_lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(src_even, zero), coeff));
+    result_hi = _mm512_add_epi32(result_hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(src_even, zero), coeff));
+  }
+
+  // shift back integer arithmetic 14 bits precision, pack with saturation
+  result_lo = _mm512_srai_epi32(result_lo, FPScale8bits);
+  result_hi = _mm512_srai_epi32(result_hi, FPScale8bits);
+  __m512i result_32x_uint16 = _mm512_packus_epi32(result_lo, result_hi); // lane-wise, restores the pixel order of the unpacks
+  __m256i result_32x_uint8 = _mm512_cvtusepi16_epi8(result_32x_uint16);
+
+  if constexpr (masked)
+    _mm256_mask_storeu_epi8(dst, mask, result_32x_uint8);
+  else
+    _mm256_store_si256(reinterpret_cast<__m256i*>(dst), result_32x_uint8);
+}
+
+void resize_v_avx512_planar_uint8_t(BYTE* dst, const BYTE* src, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int target_height, int bits_per_pixel)
+{
+  AVS_UNUSED(bits_per_pixel);
+  const int filter_size = program->filter_size;
+  const short* current_coeff = program->pixel_coefficient;
+  const __m512i rounder = _mm512_set1_epi32(1 << (FPScale8bits - 1));
+
+  const int kernel_size = program->filter_size_real; // not the aligned
+
+  const int wmod32 = width / 32 * 32;
+  const __mmask32 mask = (__mmask32)((1u << (width - wmod32)) - 1);
+
+  for (int y = 0; y < target_height; y++) {
+    int offset = program->pixel_offset[y];
+    const BYTE* src_ptr = src + offset * src_pitch;
+
+    for (int x = 0; x < wmod32; x += 32)
+      process_32pixels_v_uint8<false>(src_ptr + x, src_pitch, current_coeff, kernel_size, dst + x, mask, rounder);
+
+    if (wmod32 < width)
+      process_32pixels_v_uint8<true>(src_ptr + wmod32, src_pitch, current_coeff, kernel_size, dst + wmod32, mask, rounder);
+
+    dst += dst_pitch;
+    current_coeff += filter_size;
+  }
+}
+
+template<bool masked, bool lessthan16bit>
+AVS_FORCEINLINE static void process_32pixels_v_uint16(const uint16_t* src_ptr, int src_pitch, const short* current_coeff, int kernel_size,
+  uint16_t* dst, __mmask32 mask, bool streaming_stores, const __m512i& rounder, const __m512i& shifttosigned, const __m512i& shiftfromsigned, const __m512i& clamp_limit)
+{
+  auto load = [&](const uint16_t* p) {
+    __m512i data;
+    if constexpr (masked)
+      data = _mm512_maskz_loadu_epi16(mask, p);
+    else
+      data = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(p));
+    if constexpr (!lessthan16bit)
+      data = _mm512_add_epi16(data, shifttosigned); // unsigned -> signed
+    return data;
+  };
+
+  __m512i result_lo = rounder;
+  __m512i result_hi = rounder;
+
+  // Process pairs of rows (2 coeffs/cycle)
+  int i = 0;
+  for (; i < kernel_size - 1; i += 2) {
+    __m512i coeff = _mm512_set1_epi32(*reinterpret_cast<const int*>(current_coeff + i)); // CO|co|CO|co|...
+    __m512i src_even = load(src_ptr + i * src_pitch); // 32x 16bit pixels
+    __m512i src_odd = load(src_ptr + (i + 1) * src_pitch);
+    result_lo = _mm512_add_epi32(result_lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(src_even, src_odd), coeff));
+    result_hi = _mm512_add_epi32(result_hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(src_even, src_odd), coeff));
+  }
+
+  // Process the last odd row if needed
+  if (i < kernel_size) {
+    __m512i coeff = _mm512_set1_epi16(current_coeff[i]); // co|co|co|co|... against pixel|0
+    __m512i src_even = load(src_ptr + i * src_pitch);
+    __m512i zero = _mm512_setzero_si512();
+    result_lo = _mm512_add_epi32(result_lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(src_even, zero), coeff));
+    result_hi = _mm512_add_epi32(result_hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(src_even, zero), coeff));
+  }
+
+  // correct if signed, scale back, store
+  if constexpr (!lessthan16bit) {
+    result_lo = _mm512_add_epi32(result_lo, shiftfromsigned);
+    result_hi = _mm512_add_epi32(result_hi, shiftfromsigned);
+  }
+  // shift back integer arithmetic 13 bits precision
+  result_lo = _mm512_srai_epi32(result_lo, FPScale16bits);
+  result_hi = _mm512_srai_epi32(result_hi, FPScale16bits);
+  __m512i result_32x_uint16 = _mm512_packus_epi32(result_lo, result_hi);
+  if constexpr (lessthan16bit)
+    result_32x_uint16 = _mm512_min_epu16(result_32x_uint16, clamp_limit); // extra clamp for 10-14 bit
+
+  if constexpr (masked)
+    _mm512_mask_storeu_epi16(dst, mask, result_32x_uint16);
+  else if (streaming_stores)
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(dst), result_32x_uint16);
+  else
+    _mm512_store_si512(reinterpret_cast<__m512i*>(dst), result_32x_uint16);
+}
+
+template<bool lessthan16bit>
+void resize_v_avx512_planar_uint16_t(BYTE* dst8, const BYTE* src8, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int target_height, int bits_per_pixel)
+{
+  const int filter_size = program->filter_size;
+  const short* current_coeff = program->pixel_coefficient;
+
+  // for 16 bits only
+  const __m512i shifttosigned = _mm512_set1_epi16(-32768);
+  const __m512i shiftfromsigned = _mm512_set1_epi32(32768 << FPScale16bits);
+
+  const __m512i rounder = _mm512_set1_epi32(1 << (FPScale16bits - 1));
+  const __m512i clamp_limit = _mm512_set1_epi16((short)((1 << bits_per_pixel) - 1)); // clamp limit for <16 bits
+
+  const uint16_t* src = (const uint16_t*)src8;
+  uint16_t* dst = (uint16_t*)dst8;
+  dst_pitch = dst_pitch / sizeof(uint16_t);
+  src_pitch = src_pitch / sizeof(uint16_t);
+
+  const int kernel_size = program->filter_size_real; // not the aligned
+  const bool streaming_stores = program->streaming_stores;
+
+  const int wmod32 = width / 32 * 32;
+  const __mmask32 mask = (__mmask32)((1u << (width - wmod32)) - 1);
+
+  for (int y = 0; y < target_height; y++) {
+    int offset = program->pixel_offset[y];
+    const uint16_t* src_ptr = src + offset * src_pitch;
+
+    for (int x = 0; x < wmod32; x += 32)
+      process_32pixels_v_uint16<false, lessthan16bit>(src_ptr + x, src_pitch, current_coeff, kernel_size, dst + x, mask, streaming_stores, rounder, shifttosigned, shiftfromsigned, clamp_limit);
+
+    if (wmod32 < width)
+      process_32pixels_v_uint16<true, lessthan16bit>(src_ptr + wmod32, src_pitch, current_coeff, kernel_size, dst + wmod32, mask, streaming_stores, rounder, shifttosigned, shiftfromsigned, clamp_limit);
+
+    dst += dst_pitch;
+    current_coeff += filter_size;
+  }
+}
+
+//-------- 512 bit float Verticals
+
+template<bool masked>
+AVS_FORCEINLINE static void process_16pixels_v_float(const float* src_ptr, int src_pitch, const float* current_coeff, int kernel_size,
+  float* dst, __mmask16 mask, bool streaming_stores)
+{
+  __m512 result = _mm512_setzero_ps();
+
+  // Process each row with its coefficient
+  for (int i = 0; i < kernel_size; i++) {
+    __m512 coeff = _mm512_set1_ps(current_coeff[i]);
+    __m512 src_val;
+    if constexpr (masked)
+      src_val = _mm512_maskz_loadu_ps(mask, src_ptr + i * src_pitch);
+    else
+      src_val = _mm512_loadu_ps(src_ptr + i * src_pitch);
+    result = _mm512_fmadd_ps(src_val, coeff, result);
+  }
+
+  if constexpr (masked)
+    _mm512_mask_storeu_ps(dst, mask, result);
+  else if (streaming_stores)
+    _mm512_stream_ps(dst, result);
+  else
+    _mm512_store_ps(dst, result);
+}
+
+void resize_v_avx512_planar_float(BYTE* dst8, const BYTE* src8, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int target_height, int bits_per_pixel)
+{
+  AVS_UNUSED(bits_per_pixel);
+
+  const int filter_size = program->filter_size;
+  const float* current_coeff = program->pixel_coefficient_float;
+
+  const float* src = (const float*)src8;
+  float* dst = (float*)dst8;
+  dst_pitch = dst_pitch / sizeof(float);
+  src_pitch = src_pitch / sizeof(float);
+
+  const int kernel_size = program->filter_size_real; // not the aligned
+  const bool streaming_stores = program->streaming_stores;
+
+  const int wmod16 = width / 16 * 16;
+  const __mmask16 mask = (__mmask16)((1u << (width - wmod16)) - 1);
+
+  for (int y = 0; y < target_height; y++) {
+    int offset = program->pixel_offset[y];
+    const float* src_ptr = src + offset * src_pitch;
+
+    for (int x = 0; x < wmod16; x += 16)
+      process_16pixels_v_float<false>(src_ptr + x, src_pitch, current_coeff, kernel_size, dst + x, mask, streaming_stores);
+
+    if (wmod16 < width)
+      process_16pixels_v_float<true>(src_ptr + wmod16, src_pitch, current_coeff, kernel_size, dst + wmod16, mask, streaming_stores);
+
+    dst += dst_pitch;
+    current_coeff += filter_size;
+  }
+}
+
+// avx512 16bit
+template void resizer_h_avx512_generic_uint16_t<false>(BYTE* dst8, const BYTE* src8, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int height, int bits_per_pixel);
+// avx512 10-14bit
+template void resizer_h_avx512_generic_uint16_t<true>(BYTE* dst8, const BYTE* src8, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int height, int bits_per_pixel);
+
+// avx512 16
+template void resize_v_avx512_planar_uint16_t<false>(BYTE* dst0, const BYTE* src0, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int target_height, int bits_per_pixel);
+// avx512 10-14bit
+template void resize_v_avx512_planar_uint16_t<true>(BYTE* dst0, const BYTE* src0, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int target_height, int bits_per_pixel);
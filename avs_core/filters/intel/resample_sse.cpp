@@ -234,6 +234,7 @@ void resize_v_sse2_planar_uint16_t(BYTE* dst8, const BYTE* src8, int dst_pitch,
   int filter_size = program->filter_size;
   short* current_coeff = program->pixel_coefficient;
   int wMod8 = (width / 8) * 8;  // Process 8 pixels at a time instead of 16
+  const bool streaming_stores = program->streaming_stores;
 
   const __m128i zero = _mm_setzero_si128();
   
@@ -319,7 +320,10 @@ void resize_v_sse2_planar_uint16_t(BYTE* dst8, const BYTE* src8, int dst_pitch,
       if constexpr (lessthan16bit) {
         result_8x_uint16 = _MM_MIN_EPU16(result_8x_uint16, clamp_limit); // extra clamp for 10-14 bit
       }
-      _mm_stream_si128(reinterpret_cast<__m128i*>(dst + x), result_8x_uint16);
+      if (streaming_stores)
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + x), result_8x_uint16);
+      else
+        _mm_store_si128(reinterpret_cast<__m128i*>(dst + x), result_8x_uint16);
     }
 
     dst += dst_pitch;
@@ -465,8 +469,14 @@ AVS_FORCEINLINE static void process_eight_pixels_h_float(const float* src, int x
 
   __m128 result_hi = sumQuad5678; // L1 L2 L3 L4
 
-  _mm_stream_ps(reinterpret_cast<float*>(dst + x), result_lo); // 8 results at a time
-  _mm_stream_ps(reinterpret_cast<float*>(dst + x + 4), result_hi); // 8 results at a time
+  if (program->streaming_stores) {
+    _mm_stream_ps(reinterpret_cast<float*>(dst + x), result_lo); // 8 results at a time
+    _mm_stream_ps(reinterpret_cast<float*>(dst + x + 4), result_hi); // 8 results at a time
+  }
+  else {
+    _mm_store_ps(reinterpret_cast<float*>(dst + x), result_lo);
+    _mm_store_ps(reinterpret_cast<float*>(dst + x + 4), result_hi);
+  }
 
 }
 
@@ -514,6 +524,7 @@ void resize_v_sse2_planar_float(BYTE* dst8, const BYTE* src8, int dst_pitch, int
 
   int filter_size = program->filter_size;
   float* current_coeff = program->pixel_coefficient_float;
+  const bool streaming_stores = program->streaming_stores;
 
   const float* src = (float*)src8;
   float* dst = (float*)dst8;
@@ -544,7 +555,10 @@ void resize_v_sse2_planar_float(BYTE* dst8, const BYTE* src8, int dst_pitch, int
       }
 
       // Store result
-      _mm_stream_ps(dst + x, result_single);
+      if (streaming_stores)
+        _mm_stream_ps(dst + x, result_single);
+      else
+        _mm_store_ps(dst + x, result_single);
     }
 
     dst += dst_pitch;
@@ -353,8 +353,19 @@ PVideoFrame __stdcall MergeChroma::GetFrame(int n, IScriptEnvironment* env)
         }
     }
     else {  // Planar YUV
-      env->MakeWritable(&src);
-      src->GetWritePtr(PLANAR_Y); //Must be requested
+      if (!src->IsWritable()) {
+        // luma is shared, only the planes to merge are copied
+        const PVideoFrame frames[4] = { src };
+        const int planes[4] = { PLANAR_Y };
+        PVideoFrame dst = env->NewVideoFrameFromPlanes(vi, frames, planes, &src);
+        env->BitBlt(dst->GetWritePtr(PLANAR_U), dst->GetPitch(PLANAR_U), src->GetReadPtr(PLANAR_U), src->GetPitch(PLANAR_U), src->GetRowSize(PLANAR_U), src->GetHeight(PLANAR_U));
+        env->BitBlt(dst->GetWritePtr(PLANAR_V), dst->GetPitch(PLANAR_V), src->GetReadPtr(PLANAR_V), src->GetPitch(PLANAR_V), src->GetRowSize(PLANAR_V), src->GetHeight(PLANAR_V));
+        if (vi.IsYUVA())
+          env->BitBlt(dst->GetWritePtr(PLANAR_A), dst->GetPitch(PLANAR_A), src->GetReadPtr(PLANAR_A), src->GetPitch(PLANAR_A), src->GetRowSize(PLANAR_A), src->GetHeight(PLANAR_A));
+        src = dst;
+      }
+      else
+        src->GetWritePtr(PLANAR_Y); //Must be requested
 
       BYTE* srcpU = (BYTE*)src->GetWritePtr(PLANAR_U);
       BYTE* chromapU = (BYTE*)chroma->GetReadPtr(PLANAR_U);
@@ -403,24 +414,10 @@ PVideoFrame __stdcall MergeChroma::GetFrame(int n, IScriptEnvironment* env)
       return chroma;
     }
     else {
-      if (src->IsWritable()) {
-        src->GetWritePtr(PLANAR_Y); //Must be requested
-        env->BitBlt(src->GetWritePtr(PLANAR_U), src->GetPitch(PLANAR_U), chroma->GetReadPtr(PLANAR_U), chroma->GetPitch(PLANAR_U), chroma->GetRowSize(PLANAR_U), chroma->GetHeight(PLANAR_U));
-        env->BitBlt(src->GetWritePtr(PLANAR_V), src->GetPitch(PLANAR_V), chroma->GetReadPtr(PLANAR_V), chroma->GetPitch(PLANAR_V), chroma->GetRowSize(PLANAR_V), chroma->GetHeight(PLANAR_V));
-        if (vi.IsYUVA())
-          env->BitBlt(src->GetWritePtr(PLANAR_A), src->GetPitch(PLANAR_A), chroma->GetReadPtr(PLANAR_A), chroma->GetPitch(PLANAR_A), chroma->GetRowSize(PLANAR_A), chroma->GetHeight(PLANAR_A));
-      }
-      else { // avoid the cost of 2 chroma blits
-        PVideoFrame dst = env->NewVideoFrameP(vi, &src);
-
-        env->BitBlt(dst->GetWritePtr(PLANAR_Y), dst->GetPitch(PLANAR_Y), src->GetReadPtr(PLANAR_Y), src->GetPitch(PLANAR_Y), src->GetRowSize(PLANAR_Y), src->GetHeight(PLANAR_Y));
-        env->BitBlt(dst->GetWritePtr(PLANAR_U), dst->GetPitch(PLANAR_U), chroma->GetReadPtr(PLANAR_U), chroma->GetPitch(PLANAR_U), chroma->GetRowSize(PLANAR_U), chroma->GetHeight(PLANAR_U));
-        env->BitBlt(dst->GetWritePtr(PLANAR_V), dst->GetPitch(PLANAR_V), chroma->GetReadPtr(PLANAR_V), chroma->GetPitch(PLANAR_V), chroma->GetRowSize(PLANAR_V), chroma->GetHeight(PLANAR_V));
-        if (vi.IsYUVA())
-          env->BitBlt(dst->GetWritePtr(PLANAR_A), dst->GetPitch(PLANAR_A), chroma->GetReadPtr(PLANAR_A), chroma->GetPitch(PLANAR_A), chroma->GetRowSize(PLANAR_A), chroma->GetHeight(PLANAR_A));
-
-        return dst;
-      }
+      // luma from the first clip, chroma (and alpha) from the second one, nothing is copied
+      const PVideoFrame frames[4] = { src, chroma, chroma, chroma };
+      const int planes[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+      return env->NewVideoFrameFromPlanes(vi, frames, planes, &src);
     }
   }
   return src;
@@ -527,35 +524,21 @@ PVideoFrame __stdcall MergeLuma::GetFrame(int n, IScriptEnvironment* env)
     return src;
   }  // Planar
   if (weight > 0.9961f) {
-    // 2nd clip weight is almost 100%: no merge, just copy
-    const VideoInfo& vi2 = clip->GetVideoInfo();
-    if (luma->IsWritable() && vi.IsSameColorspace(vi2)) {
-      if (luma->GetRowSize(PLANAR_U)) {
-        luma->GetWritePtr(PLANAR_Y); //Must be requested BUT only if we actually do something
-        env->BitBlt(luma->GetWritePtr(PLANAR_U), luma->GetPitch(PLANAR_U), src->GetReadPtr(PLANAR_U), src->GetPitch(PLANAR_U), src->GetRowSize(PLANAR_U), src->GetHeight(PLANAR_U));
-        env->BitBlt(luma->GetWritePtr(PLANAR_V), luma->GetPitch(PLANAR_V), src->GetReadPtr(PLANAR_V), src->GetPitch(PLANAR_V), src->GetRowSize(PLANAR_V), src->GetHeight(PLANAR_V));
-      }
-      if (luma->GetPitch(PLANAR_A)) // copy Alpha if exists
-        env->BitBlt(luma->GetWritePtr(PLANAR_A), luma->GetPitch(PLANAR_A), src->GetReadPtr(PLANAR_A), src->GetPitch(PLANAR_A), src->GetRowSize(PLANAR_A), src->GetHeight(PLANAR_A));
-
-      return luma;
-    }
-    else { // avoid the cost of 2 chroma blits
-      PVideoFrame dst = env->NewVideoFrameP(vi, &luma);
-
-      env->BitBlt(dst->GetWritePtr(PLANAR_Y), dst->GetPitch(PLANAR_Y), luma->GetReadPtr(PLANAR_Y), luma->GetPitch(PLANAR_Y), luma->GetRowSize(PLANAR_Y), luma->GetHeight(PLANAR_Y));
-      if (src->GetRowSize(PLANAR_U) && dst->GetRowSize(PLANAR_U)) {
-        env->BitBlt(dst->GetWritePtr(PLANAR_U), dst->GetPitch(PLANAR_U), src->GetReadPtr(PLANAR_U), src->GetPitch(PLANAR_U), src->GetRowSize(PLANAR_U), src->GetHeight(PLANAR_U));
-        env->BitBlt(dst->GetWritePtr(PLANAR_V), dst->GetPitch(PLANAR_V), src->GetReadPtr(PLANAR_V), src->GetPitch(PLANAR_V), src->GetRowSize(PLANAR_V), src->GetHeight(PLANAR_V));
-      }
-      if (dst->GetPitch(PLANAR_A) && src->GetPitch(PLANAR_A)) // copy Alpha if in both clip exists
-        env->BitBlt(dst->GetWritePtr(PLANAR_A), dst->GetPitch(PLANAR_A), src->GetReadPtr(PLANAR_A), src->GetPitch(PLANAR_A), src->GetRowSize(PLANAR_A), src->GetHeight(PLANAR_A));
-
-      return dst;
-    }
+    // 2nd clip weight is almost 100%: no merge, luma from the second clip, chroma (and alpha)
+    // from the first one, nothing is copied
+    const PVideoFrame frames[4] = { luma, src, src, src };
+    const int planes[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+    return env->NewVideoFrameFromPlanes(vi, frames, planes, &luma);
   }
   else { // weight <= 0.9961f
-    env->MakeWritable(&src);
+    if (!src->IsWritable()) {
+      // chroma (and alpha) is shared, only luma is copied for the merge
+      const PVideoFrame frames[4] = { nullptr, src, src, src };
+      const int planes[4] = { 0, PLANAR_U, PLANAR_V, PLANAR_A };
+      PVideoFrame dst = env->NewVideoFrameFromPlanes(vi, frames, planes, &src);
+      env->BitBlt(dst->GetWritePtr(PLANAR_Y), dst->GetPitch(PLANAR_Y), src->GetReadPtr(PLANAR_Y), src->GetPitch(PLANAR_Y), src->GetRowSize(PLANAR_Y), src->GetHeight(PLANAR_Y));
+      src = dst;
+    }
     BYTE* srcpY = (BYTE*)src->GetWritePtr(PLANAR_Y);
     BYTE* lumapY = (BYTE*)luma->GetReadPtr(PLANAR_Y);
     int src_pitch = src->GetPitch(PLANAR_Y);
@@ -314,6 +314,78 @@ void Convert444ToYV12(PVideoFrame &src, PVideoFrame &dst, int pixelsize, int bit
 
 }
 
+/*****   YV12, YV16 rectangle <-> YUV 4:4:4   *******/
+
+// The whole 4:4:4 frame corresponds to the rectangle at x, y of the subsampled one.
+// x, y and the size of the 4:4:4 frame are multiples of the chroma subsampling.
+template<bool to444>
+static void ConvertRect444(PVideoFrame &subsampled, PVideoFrame &frame444, int x, int y, bool is420, int pixelsize, IScriptEnvironment* env)
+{
+  const int xsub = 1;
+  const int ysub = is420 ? 1 : 0;
+  const int w = frame444->GetRowSize(PLANAR_Y) / pixelsize;
+  const int h = frame444->GetHeight(PLANAR_Y);
+
+  const int planes[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+  for (int p = 0; p < 4; p++) {
+    const int plane = planes[p];
+    const int pitch = subsampled->GetPitch(plane);
+    if (pitch == 0)
+      continue; // no alpha
+    const bool chroma = plane == PLANAR_U || plane == PLANAR_V;
+    const int offset = chroma ? (y >> ysub) * pitch + (x >> xsub) * pixelsize : y * pitch + x * pixelsize;
+
+    if (!chroma) {
+      if (to444)
+        env->BitBlt(frame444->GetWritePtr(plane), frame444->GetPitch(plane), subsampled->GetReadPtr(plane) + offset, pitch, w * pixelsize, h);
+      else
+        env->BitBlt(subsampled->GetWritePtr(plane) + offset, pitch, frame444->GetReadPtr(plane), frame444->GetPitch(plane), w * pixelsize, h);
+      continue;
+    }
+
+    if (to444) {
+      BYTE* dstp = frame444->GetWritePtr(plane);
+      const BYTE* srcp = subsampled->GetReadPtr(plane) + offset;
+      const int dst_pitch = frame444->GetPitch(plane);
+      if (is420) {
+        if (pixelsize == 1) convert_yv12_chroma_to_yv24_c<uint8_t>(dstp, srcp, dst_pitch, pitch, w >> xsub, h >> ysub);
+        else if (pixelsize == 2) convert_yv12_chroma_to_yv24_c<uint16_t>(dstp, srcp, dst_pitch, pitch, w >> xsub, h >> ysub);
+        else convert_yv12_chroma_to_yv24_c<float>(dstp, srcp, dst_pitch, pitch, w >> xsub, h >> ysub);
+      }
+      else {
+        if (pixelsize == 1) convert_yv16_chroma_to_yv24_c<uint8_t>(dstp, srcp, dst_pitch, pitch, w >> xsub, h);
+        else if (pixelsize == 2) convert_yv16_chroma_to_yv24_c<uint16_t>(dstp, srcp, dst_pitch, pitch, w >> xsub, h);
+        else convert_yv16_chroma_to_yv24_c<float>(dstp, srcp, dst_pitch, pitch, w >> xsub, h);
+      }
+    }
+    else {
+      BYTE* dstp = subsampled->GetWritePtr(plane) + offset;
+      const BYTE* srcp = frame444->GetReadPtr(plane);
+      const int src_pitch = frame444->GetPitch(plane);
+      if (is420) {
+        if (pixelsize == 1) convert_yv24_chroma_to_yv12_c<uint8_t>(dstp, srcp, pitch, src_pitch, w >> xsub, h >> ysub);
+        else if (pixelsize == 2) convert_yv24_chroma_to_yv12_c<uint16_t>(dstp, srcp, pitch, src_pitch, w >> xsub, h >> ysub);
+        else convert_yv24_chroma_to_yv12_c<float>(dstp, srcp, pitch, src_pitch, w >> xsub, h >> ysub);
+      }
+      else {
+        if (pixelsize == 1) convert_yv24_chroma_to_yv16_c<uint8_t>(dstp, srcp, pitch, src_pitch, w >> xsub, h);
+        else if (pixelsize == 2) convert_yv24_chroma_to_yv16_c<uint16_t>(dstp, srcp, pitch, src_pitch, w >> xsub, h);
+        else convert_yv24_chroma_to_yv16_c<float>(dstp, srcp, pitch, src_pitch, w >> xsub, h);
+      }
+    }
+  }
+}
+
+void Convert444FromSubsampledRect(PVideoFrame &src, PVideoFrame &dst, int x, int y, bool is420, int pixelsize, IScriptEnvironment* env)
+{
+  ConvertRect444<true>(src, dst, x, y, is420, pixelsize, env);
+}
+
+void Convert444ToSubsampledRect(PVideoFrame &src, PVideoFrame &dst, int x, int y, bool is420, int pixelsize, IScriptEnvironment* env)
+{
+  ConvertRect444<false>(dst, src, x, y, is420, pixelsize, env);
+}
+
 /*****   YUV 4:4:4 -> YUY2   *******/
 
 void Convert444ToYUY2(PVideoFrame &src, PVideoFrame &dst, int pixelsize, int bits_per_pixel, IScriptEnvironment* env) {
@@ -45,6 +45,9 @@ void Convert444FromYUY2(PVideoFrame &src, PVideoFrame &dst, int pixelsize, int b
 void Convert444ToYV16(PVideoFrame &src, PVideoFrame &dst, int pixelsize, int bits_per_pixel, IScriptEnvironment* env);
 void Convert444ToYV12(PVideoFrame &src, PVideoFrame &dst, int pixelsize, int bits_per_pixel, IScriptEnvironment* env);
 void Convert444ToYUY2(PVideoFrame &src, PVideoFrame &dst, int pixelsize, int bits_per_pixel, IScriptEnvironment* env);
+// 4:2:0 (is420) or 4:2:2 rectangle at x, y <-> whole 4:4:4 frame
+void Convert444FromSubsampledRect(PVideoFrame &src, PVideoFrame &dst, int x, int y, bool is420, int pixelsize, IScriptEnvironment* env);
+void Convert444ToSubsampledRect(PVideoFrame &src, PVideoFrame &dst, int x, int y, bool is420, int pixelsize, IScriptEnvironment* env);
 void ConvertYToYV12Chroma(BYTE *dst, BYTE *src, int dstpitch, int srcpitch, int pixelsize, int w, int h, IScriptEnvironment* env);
 void ConvertYToYV16Chroma(BYTE *dst, BYTE *src, int dstpitch, int srcpitch, int pixelsize, int w, int h, IScriptEnvironment* env);
 
@@ -273,6 +273,21 @@ GenericVideoFilter(_child) {
   isInternal422 = viInternalWorkingFormat.Is422();
   isInternal420 = viInternalWorkingFormat.Is420();
 
+  subsampledInPlace = isInternal444 && (inputVi.Is420() || inputVi.Is422()) && vi.pixel_type == inputVi.pixel_type;
+
+  // input formats having no quick conversion in GetFrame are converted here, once
+  if (isInternal444 && inputVi.pixel_type != viInternalWorkingFormat.pixel_type && !inputVi.Is420() && !inputVi.Is422()) {
+    if (inputVi.IsRGB()) {
+      AVSValue new_args[3] = { child, false, full_range ? "PC.601" : "rec601" };
+      child444 = env->Invoke("ConvertToYUV444", AVSValue(new_args, 3)).AsClip();
+    }
+    else {
+      // 411, Y
+      AVSValue new_args[2] = { child, false };
+      child444 = env->Invoke("ConvertToYUV444", AVSValue(new_args, 2)).AsClip();
+    }
+  }
+
   // more format match of overlay
   if (overlayVi.IsRGB()) {
     if (isInternalGrey) {
@@ -421,23 +436,58 @@ Overlay::~Overlay() {
 }
 
 PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
-  // fixme: do all necessary conversions in filter creation, not in GetFrame!
-  // 20201208 almost done
   int op_offset;
   float op_offset_f;
   int con_x_offset;
   int con_y_offset;
   FetchConditionals(env, &op_offset, &op_offset_f, &con_x_offset, &con_y_offset, ignore_conditional, condVarSuffix);
 
-  AVSValue child2;
   PVideoFrame frame;
 
+  // Position of the 4:4:4 working frame in the input frame. Other than
+  // (0, 0, full size) only in subsampledInPlace mode.
+  int rect_x = 0;
+  int rect_y = 0;
+  int rect_w = vi.width;
+  int rect_h = vi.height;
+  PVideoFrame subsampledFrame;
+
   if (inputVi.pixel_type == viInternalWorkingFormat.pixel_type)
   {
     // get frame as is.
     // includes 420, 422, 444, planarRGB(A)
     frame = child->GetFrame(n, env);
   }
+  else if (subsampledInPlace) {
+    // Area covered by the overlay, extended to whole chroma samples, horizontally to
+    // multiples of 32 pixels for aligned SIMD. Upsampling by duplication and downsampling
+    // by averaging gives back the original chroma, so the rest of the frame is the same
+    // as it would be after a whole frame conversion.
+    const int x = offset_x + con_x_offset;
+    const int y = offset_y + con_y_offset;
+    const int xmask = 31;
+    const int ymask = (1 << inputVi.GetPlaneHeightSubsampling(PLANAR_U)) - 1;
+    const int x_end = min(x + overlayVi.width, vi.width);
+    const int y_end = min(y + overlayVi.height, vi.height);
+    const int rect_x_end = min((x_end + xmask) & ~xmask, vi.width);
+    rect_x = max(x, 0) & ~xmask;
+    if (rect_x_end > rect_x && rect_x_end - rect_x < 32)
+      rect_x = max(rect_x_end - 32, 0) & ~xmask; // narrower rows would be downsampled by C, rounding differently
+    rect_y = max(y, 0) & ~ymask;
+    rect_w = rect_x_end - rect_x;
+    rect_h = ((y_end + ymask) & ~ymask) - rect_y;
+
+    subsampledFrame = child->GetFrame(n, env);
+    if (rect_w <= 0 || rect_h <= 0)
+      return subsampledFrame; // nothing to overlay
+    env->MakeWritable(&subsampledFrame);
+
+    VideoInfo viRect = viInternalWorkingFormat;
+    viRect.width = rect_w;
+    viRect.height = rect_h;
+    frame = env->NewVideoFrameP(viRect, &subsampledFrame);
+    Convert444FromSubsampledRect(subsampledFrame, frame, rect_x, rect_y, inputVi.Is420(), pixelsize, env);
+  }
   else if (isInternal444) {
     if (inputVi.Is420()) {
       // use blazing fast YV12 -> YV24 converter
@@ -452,15 +502,9 @@ PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
       frame = env->NewVideoFrameP(viInternalWorkingFormat, &Inframe);
       Convert444FromYV16(Inframe, frame, pixelsize, bits_per_pixel, env);
     }
-    else if (inputVi.IsRGB()) {
-      AVSValue new_args[3] = { child, false, full_range ? "PC.601" : "rec601" };
-      child2 = env->Invoke("ConvertToYUV444", AVSValue(new_args, 3)).AsClip();
-      frame = child2.AsClip()->GetFrame(n, env);
-    }
     else {
-      AVSValue new_args[2] = { child, false };
-      child2 = env->Invoke("ConvertToYUV444", AVSValue(new_args, 2)).AsClip();
-      frame = child2.AsClip()->GetFrame(n, env);
+      // RGB, 411, Y: converted in the constructor
+      frame = child444->GetFrame(n, env);
     }
   }
   else if (isInternalRGB) {
@@ -468,26 +512,13 @@ PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
       // Just for the sake of completeness.
       // when input is YUV, internal working format is never RGB
       env->ThrowError("Overlay: internal error; isInternalRGB but input is YUV");
-      /*
-      if (viInternalWorkingFormat.IsPlanarRGB()) {
-        // clip, matrix, interlaced
-        AVSValue new_args[3] = { child, full_range ? "PC.601" : "rec601", false };
-        child2 = env->Invoke("ConvertToPlanarRGB", AVSValue(new_args, 3)).AsClip();
-        frame = child2.AsClip()->GetFrame(n, env);
-      }
-      else if (viInternalWorkingFormat.IsPlanarRGBA()) {
-        AVSValue new_args[3] = { child, full_range ? "PC.601" : "rec601", false };
-        child2 = env->Invoke("ConvertToPlanarRGBA", AVSValue(new_args, 3)).AsClip();
-        frame = child2.AsClip()->GetFrame(n, env);
-      }
-      */
     }
   }
 
   // Fetch current frame and convert it to internal format
   env->MakeWritable(&frame);
 
-  ImageOverlayInternal* img = new ImageOverlayInternal(frame, vi.width, vi.height, viInternalWorkingFormat, child->GetVideoInfo().IsYUVA() || child->GetVideoInfo().IsPlanarRGBA(), false, env);
+  ImageOverlayInternal* img = new ImageOverlayInternal(frame, rect_w, rect_h, viInternalWorkingFormat, child->GetVideoInfo().IsYUVA() || child->GetVideoInfo().IsPlanarRGBA(), false, env);
 
   PVideoFrame Oframe;
   AVSValue overlay2;
@@ -584,7 +615,7 @@ PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
   ImageOverlayInternal* overlayImg = new ImageOverlayInternal(Oframe, overlayVi.width, overlayVi.height, actual_viInternalOverlayWorkingFormat, overlay->GetVideoInfo().IsYUVA() || overlay->GetVideoInfo().IsPlanarRGBA(), false, env);
 
   // Clip overlay to original image
-  ClipFrames(img, overlayImg, offset_x + con_x_offset, offset_y + con_y_offset);
+  ClipFrames(img, overlayImg, offset_x + con_x_offset - rect_x, offset_y + con_y_offset - rect_y);
 
   if (overlayImg->IsSizeZero()) { // Nothing to overlay
   }
@@ -654,7 +685,7 @@ PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
       maskImg = new ImageOverlayInternal(Mframe, maskVi.width, maskVi.height, viInternalOverlayWorkingFormat, mask->GetVideoInfo().IsYUVA() || mask->GetVideoInfo().IsPlanarRGBA(), greymask, env);
 
       img->ReturnOriginal(true);
-      ClipFrames(img, maskImg, offset_x + con_x_offset, offset_y + con_y_offset);
+      ClipFrames(img, maskImg, offset_x + con_x_offset - rect_x, offset_y + con_y_offset - rect_y);
 
 
     }
@@ -692,6 +723,11 @@ PVideoFrame __stdcall Overlay::GetFrame(int n, IScriptEnvironment *env) {
     delete img;
   }
 
+  if (subsampledInPlace) {
+    Convert444ToSubsampledRect(frame, subsampledFrame, rect_x, rect_y, inputVi.Is420(), pixelsize, env);
+    return subsampledFrame;
+  }
+
   // here img->frame is 444
   // apply fast conversion
   if(outputVi.Is420() && viInternalWorkingFormat.Is444())
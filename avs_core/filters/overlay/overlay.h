@@ -56,7 +56,8 @@ public:
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override
   {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
@@ -75,6 +76,7 @@ private:
 
   PClip overlay;
   PClip mask;
+  PClip child444; // input converted to the 4:4:4 working format, when there is no quick conversion in GetFrame
   int opacity;
   float opacity_f;
   bool greymask;
@@ -98,6 +100,10 @@ private:
   bool isInternal422;
   bool isInternal420;
 
+  // 4:2:0 or 4:2:2 input and output with 4:4:4 working format: only the area below the
+  // overlay is converted to 4:4:4 and back, in place.
+  bool subsampledInPlace;
+
 };
 
 
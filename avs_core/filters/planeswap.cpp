@@ -125,17 +125,10 @@ PVideoFrame __stdcall SwapUV::GetFrame(int n, IScriptEnvironment* env)
   PVideoFrame src = child->GetFrame(n, env);
 
   if (vi.IsPlanar()) {
-    // Abuse subframe to flip the UV plane pointers -- extremely fast but a bit naughty!
-    // !! if offsets would be size_t, be cautious when you subtract two unsigned size_t variables
-    const int uvoffset = src->GetOffset(PLANAR_V) - src->GetOffset(PLANAR_U); // very naughty - don't do this at home!!
-    if (vi.NumComponents() == 4) {
-      return env->SubframePlanarA(src, 0, src->GetPitch(PLANAR_Y), src->GetRowSize(PLANAR_Y), src->GetHeight(PLANAR_Y),
-        uvoffset, -uvoffset, src->GetPitch(PLANAR_V), 0);
-    }
-    else {
-      return env->SubframePlanar(src, 0, src->GetPitch(PLANAR_Y), src->GetRowSize(PLANAR_Y), src->GetHeight(PLANAR_Y),
-        uvoffset, -uvoffset, src->GetPitch(PLANAR_V));
-    }
+    // same planes with U and V exchanged, nothing is copied
+    const PVideoFrame frames[4] = { src, src, src, src };
+    const int planes[4] = { PLANAR_Y, PLANAR_V, PLANAR_U, PLANAR_A };
+    return env->NewVideoFrameFromPlanes(vi, frames, planes, &src);
   }
 
   // YUY2
@@ -282,23 +275,21 @@ PVideoFrame __stdcall SwapUVToY::GetFrame(int n, IScriptEnvironment* env)
   PVideoFrame src = child->GetFrame(n, env);
 
   bool NonYUY2toY8 = true;
-  int target_plane, source_plane;
+  int source_plane;
   switch (mode) {
-  case YToY8: source_plane = PLANAR_Y; target_plane = PLANAR_Y; break;
-  case UToY8: source_plane = PLANAR_U; target_plane = PLANAR_Y; break;
-  case VToY8: source_plane = PLANAR_V; target_plane = PLANAR_Y; break;
-  case RToY8: source_plane = PLANAR_R; target_plane = PLANAR_G; break; // Planar RGB: GBR!
-  case GToY8: source_plane = PLANAR_G; target_plane = PLANAR_G; break;
-  case BToY8: source_plane = PLANAR_B; target_plane = PLANAR_G; break;
-  case AToY8: source_plane = PLANAR_A; target_plane = vi.IsYUVA() ? PLANAR_Y : PLANAR_G; break; // Planar RGB: GBR!
+  case YToY8: source_plane = PLANAR_Y; break;
+  case UToY8: source_plane = PLANAR_U; break;
+  case VToY8: source_plane = PLANAR_V; break;
+  case RToY8: source_plane = PLANAR_R; break;
+  case GToY8: source_plane = PLANAR_G; break;
+  case BToY8: source_plane = PLANAR_B; break;
+  case AToY8: source_plane = PLANAR_A; break;
   default: NonYUY2toY8 = false;
   }
   if (NonYUY2toY8) {
-    // !! if offsets would be size_t, be cautious when you subtract two unsigned size_t variables
-    const int offset = src->GetOffset(source_plane) - src->GetOffset(target_plane); // very naughty - don't do this at home!!
-                                                                                    // Abuse Subframe to snatch the U/V/R/G/B/A plane
-    PVideoFrame sub = env->Subframe(src, offset, src->GetPitch(source_plane), src->GetRowSize(source_plane), src->GetHeight(source_plane));
-    // We have a single plane. It's safe to mod props after a subframe.
+    // The U/V/R/G/B/A plane is shared, not copied
+    PVideoFrame sub = env->NewVideoFrameFromPlanes(vi, &src, &source_plane, &src);
+    // We have a single plane. It's safe to mod props of the new frame.
     // Remove props that are irrelevant to a single plane.
     // _ChromaLocation, (_Primaries, _Transfer)
     auto props = env->getFramePropsRW(sub);
@@ -810,183 +801,40 @@ CombinePlanes::CombinePlanes(PClip _child, PClip _clip2, PClip _clip3, PClip _cl
 
 
 PVideoFrame __stdcall CombinePlanes::GetFrame(int n, IScriptEnvironment* env) {
+  // Target planes are shared from the source frames, nothing is copied.
+  // Frame properties come from the first clip.
+  PVideoFrame frames[4];
+  int planes[4] = { 0, 0, 0, 0 };
 
-  VideoInfo vi_src = clips[0]->GetVideoInfo();
-
-  // check if fast Subframe magic can replace BitBlt
-  if (!clips[1] && vi.NumComponents() <= vi_src.NumComponents()) // YUV<->RGB, YUVA<->RGBA YUV->Y
-  {
-    // we have only one clip, plane shuffle is valid if target has less plane that defined in source
-    PVideoFrame src = clips[0]->GetFrame(n, env);
-
-    int planes_y[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
-    int planes_r[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
-    int *planes = (vi_src.IsYUV() || vi_src.IsYUVA()) ? planes_y : planes_r;
-
-    int Offsets[4];
-    int Pitches[4], NewPitches[4];
-    int RowSizes[4], NewRowSizes[4];
-
-    int RelOffsets[4];
-
-    for (int i = 0; i < vi_src.NumComponents(); i++) {
-      Offsets[i] = src->GetOffset(planes[i]);
-      Pitches[i] = NewPitches[i] = src->GetPitch(planes[i]);
-      RowSizes[i] = NewRowSizes[i] = src->GetRowSize(planes[i]);
-      RelOffsets[i] = 0;
-    }
-
-    for (int i = 0; i < planecount; i++) {
-      int target_plane = target_planes[i];
-      int source_plane = source_planes[i];
-      int target_index, source_index;
-      switch (target_plane) {
-      case PLANAR_Y: case PLANAR_G: target_index = 0; break;
-      case PLANAR_U: case PLANAR_B: target_index = 1; break;
-      case PLANAR_V: case PLANAR_R: target_index = 2; break;
-      case PLANAR_A: target_index = 3; break;
-      }
-      switch (source_plane) {
-      case PLANAR_Y: case PLANAR_G: source_index = 0; break;
-      case PLANAR_U: case PLANAR_B: source_index = 1; break;
-      case PLANAR_V: case PLANAR_R: source_index = 2; break;
-      case PLANAR_A: source_index = 3; break;
-      }
-      // !! if offsets would be size_t, be cautious when you subtract two unsigned size_t variables
-      RelOffsets[target_index] = Offsets[source_index] - Offsets[target_index];
-      NewPitches[target_index] = Pitches[source_index];
-      NewRowSizes[target_index] = RowSizes[source_index];
-      // Y            U           V          A
-      // 10         1010        2010       3010     offsets
-      // src: AUVY target: YVUA
-      // 3010-10   2010-1010  1010-2010    10-3010
-      //  3000     =+1000      =-1000      =-3000   reloffsets
-      //  3010       2010        1010       10      new offsets inside
-    }
-
-    PVideoFrame dst;
-    if (vi.NumComponents() == 4) {
-      dst = env->SubframePlanarA(src, RelOffsets[0], NewPitches[0], NewRowSizes[0], src->GetHeight(),
-        RelOffsets[1], RelOffsets[2], NewPitches[1], RelOffsets[3]);
-    }
-    else if (vi.NumComponents() == 3) {
-      dst = env->SubframePlanar(src, RelOffsets[0], NewPitches[0], NewRowSizes[0], src->GetHeight(),
-        RelOffsets[1], RelOffsets[2], NewPitches[1]);
-    }
-    else {
-      dst = env->Subframe(src, RelOffsets[0], NewPitches[0], NewRowSizes[0], src->GetHeight());
-    }
-
-    // RGB(A)<->YUV(A) color space conversion can't be caught by Subframe...()
-    dst->AmendPixelType(vi.pixel_type);
-
-    return dst;
-  }
-
-  // check if first clip could be used as the target clip
-  PVideoFrame src = clips[0]->GetFrame(n, env);
-  PVideoFrame src1 = clips[1] ? clips[1]->GetFrame(n, env) : nullptr;
-
-  // case 1: when Y is kept from the original clip and other planes may be merged
-  if (vi_src.IsSameColorspace(vi) && target_planes[0] == source_planes[0]) {
-    // source (clip#0) has the same format as the target, and the first plane is the same
-    // luma (Y) comes w/o BitBlt. Only U and V (and optionally A) is copied.
-    if (src->IsWritable()) // we are the only one
-    {
-      src->AmendPixelType(vi.pixel_type);
-
-      PVideoFrame src_other = nullptr;
-      bool writeptr_obtained = false;
-
-      for (int i = 1; i < planecount; i++) {
-        int target_plane = target_planes[i];
-        int source_plane = source_planes[i];
-
-        if (clips[i]) { // source clips can be less than defined planes
-          if (!writeptr_obtained) {
-            src->GetWritePtr(PLANAR_Y); //Must be requested BUT only if we actually do something
-            writeptr_obtained = true;
-          }
-
-          if (i == 1)
-            src_other = src1; // already requested
-          else
-            src_other = clips[i]->GetFrame(n, env); // last defined clip is used for the others
-        }
-
-        if (src_other) {
-          env->BitBlt(src->GetWritePtr(target_plane), src->GetPitch(target_plane),
-            src_other->GetReadPtr(source_plane), src_other->GetPitch(source_plane), src_other->GetRowSize(source_plane), src_other->GetHeight(source_plane));
-        } else {
-          // we are still at the first (master) clip, no need for plane copy
-        }
-      }
-
-      return src;
-    }
-  }
-  else if (clips[1] && !clips[2]){
-    // Try to optimize a MergeLuma case, where luma comes from Y (can even be a format of single plane), 
-    // Clip a's UV is kept.
-    // MergeLuma's speed gain: if 'a' is IsWritable() then there is no need for BitBlt chroma planes.
-    // We can only make a BitBlt from Y.
-    // We'd like to recognize the following scenario
-    // Output YUV:
-    // - Y from clip #0 (format:Y)
-    // - UV from clip #1 (format YUV420, same as output)
-    // planes: "YUV"
-    // 
-    // clip #0 format does not match with the output, maybe it is a single plane
-    // let's try with the second (clip #1) if it can be used
-    if (clips[1]->GetVideoInfo().IsSameColorspace(vi) &&
-      // the rest plane IDs are matching between source and target
-      vi.NumComponents() >= 3 && target_planes[1] == source_planes[1] && target_planes[2] == source_planes[2] &&
-      (vi.NumComponents() < 4 || (vi.NumComponents() == 4 && target_planes[3] == source_planes[3])))
-    {
-      if (src1->IsWritable()) // we are the only one
-      {
-        src1->AmendPixelType(vi.pixel_type);
-
-        src1->GetWritePtr(PLANAR_Y); //Must be requested BUT only if we actually do something
-
-        int target_plane = target_planes[0];
-        int source_plane = source_planes[0];
-
-        // Copy from first clip
-        env->BitBlt(src1->GetWritePtr(target_plane), src1->GetPitch(target_plane),
-          src->GetReadPtr(source_plane), src->GetPitch(source_plane), src->GetRowSize(source_plane), src->GetHeight(source_plane));
-
-        env->copyFrameProps(src, src1);
-
-        return src1;
-      }
-    }
-  }
-
-  PVideoFrame dst = env->NewVideoFrame(vi);
-  bool propCopied = false;
-
+  PVideoFrame first = clips[0]->GetFrame(n, env);
+  PVideoFrame src = first;
   for (int i = 0; i < planecount; i++) {
-    if (clips[i]) { // source clips can be less than defined planes
-      if (i > 0) { // clip #0 was already requested
-        if (i == 1) // clip #1 was already requested
-          src = src1;
-        else
-          src = clips[i]->GetFrame(n, env); // last defined clip is used for the others
-      }
-  
-      if (!propCopied) {
-        env->copyFrameProps(src, dst);
-        propCopied = true;
+    if (i > 0 && clips[i]) // source clips can be less than defined planes, last defined clip is used for the others
+      src = clips[i]->GetFrame(n, env);
+
+    int target_index;
+    switch (target_planes[i]) {
+    case PLANAR_U: case PLANAR_B: target_index = 1; break;
+    case PLANAR_V: case PLANAR_R: target_index = 2; break;
+    case PLANAR_A: target_index = 3; break;
+    default: target_index = 0; break; // PLANAR_Y, PLANAR_G
+    }
+    frames[target_index] = src;
+    planes[target_index] = source_planes[i];
+  }
+
+  // Missing target planes are kept from the first clip when it has the same format
+  if (clips[0]->GetVideoInfo().IsSameColorspace(vi)) {
+    const int planes_y[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+    const int planes_r[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
+    const int *planes_first = (vi.IsYUV() || vi.IsYUVA()) ? planes_y : planes_r;
+    for (int i = 0; i < vi.NumComponents(); i++) {
+      if (!frames[i]) {
+        frames[i] = first;
+        planes[i] = planes_first[i];
       }
     }
-
-    int target_plane = target_planes[i];
-    int source_plane = source_planes[i];
-
-    env->BitBlt(dst->GetWritePtr(target_plane), dst->GetPitch(target_plane),
-      src->GetReadPtr(source_plane), src->GetPitch(source_plane), src->GetRowSize(source_plane), src->GetHeight(source_plane));
   }
 
-  return dst;
+  return env->NewVideoFrameFromPlanes(vi, frames, planes, &first);
 }
@@ -36,6 +36,7 @@
 #ifdef INTEL_INTRINSICS
 #include "intel/resample_sse.h"
 #include "intel/resample_avx2.h"
+#include "intel/resample_avx512.h"
 #include "intel/turn_sse.h"
 #endif
 #include <avs/config.h>
@@ -50,6 +51,9 @@
 
 #include <type_traits>
 #include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 
 // Prepares resampling coefficients for end conditions and/or SIMD processing by:
@@ -88,9 +92,8 @@ void resize_prepare_coeffs(ResamplingProgram* p, IScriptEnvironment* env, int fi
   if (p->bits_per_pixel == 32) {
     element_size = sizeof(float);
     src_coeff = p->pixel_coefficient_float;
-    new_coeff = env->Allocate(element_size * target_size_aligned * filter_size_aligned, 64, AVS_NORMAL_ALLOC);
+    new_coeff = avs_malloc(element_size * target_size_aligned * filter_size_aligned, 64);
     if (!new_coeff) {
-      env->Free(new_coeff);
       env->ThrowError("Could not reserve memory in a resampler.");
     }
     std::fill_n((float*)new_coeff, target_size_aligned * filter_size_aligned, 0.0f);
@@ -98,9 +101,8 @@ void resize_prepare_coeffs(ResamplingProgram* p, IScriptEnvironment* env, int fi
   else {
     element_size = sizeof(short);
     src_coeff = p->pixel_coefficient;
-    new_coeff = env->Allocate(element_size * target_size_aligned * filter_size_aligned, 64, AVS_NORMAL_ALLOC);
+    new_coeff = avs_malloc(element_size * target_size_aligned * filter_size_aligned, 64);
     if (!new_coeff) {
-      env->Free(new_coeff);
       env->ThrowError("Could not reserve memory in a resampler.");
     }
     memset(new_coeff, 0, element_size * target_size_aligned * filter_size_aligned);
@@ -179,11 +181,11 @@ void resize_prepare_coeffs(ResamplingProgram* p, IScriptEnvironment* env, int fi
 
   // Free old coefficients and assign new ones
   if (p->bits_per_pixel == 32) {
-    env->Free(p->pixel_coefficient_float);
+    avs_free(p->pixel_coefficient_float);
     p->pixel_coefficient_float = (float*)new_coeff;
   }
   else {
-    env->Free(p->pixel_coefficient);
+    avs_free(p->pixel_coefficient);
     p->pixel_coefficient = (short*)new_coeff;
   }
 
@@ -191,6 +193,82 @@ void resize_prepare_coeffs(ResamplingProgram* p, IScriptEnvironment* env, int fi
   // by now coeffs[old_filter_size][target_size] was copied and padded into coeffs[new_filter_size][target_size]
 }
 
+/***************************************
+ ***** Resampling program cache ********
+ ***************************************/
+
+// Batch-generated scripts resize the same geometry in thousands of places (Trim + Resize
+// per segment), building the same coefficient tables again and again. Prepared programs are
+// shared instead. Entries are weak, a program lives as long as a filter uses it.
+
+struct ResamplingProgramKey {
+  std::string kernel;
+  int source_size, target_size;
+  double crop_start, crop_size, center_pos;
+  int bits_per_pixel;
+  int filter_size_alignment;
+  bool streaming_stores;
+
+  bool operator<(const ResamplingProgramKey& other) const {
+    return std::tie(kernel, source_size, target_size, crop_start, crop_size, center_pos, bits_per_pixel, filter_size_alignment, streaming_stores) <
+      std::tie(other.kernel, other.source_size, other.target_size, other.crop_start, other.crop_size, other.center_pos, other.bits_per_pixel, other.filter_size_alignment, other.streaming_stores);
+  }
+};
+
+struct ResamplingProgramCache {
+  std::mutex mutex;
+  std::map<ResamplingProgramKey, std::weak_ptr<ResamplingProgram>> programs;
+};
+
+static ResamplingProgramCache& GetResamplingProgramCache()
+{
+  // never destroyed: the last programs may be released after static destructors ran
+  static ResamplingProgramCache* cache = new ResamplingProgramCache();
+  return *cache;
+}
+
+std::shared_ptr<ResamplingProgram> GetSharedResamplingProgram(ResamplingFunction* func, int source_size, double crop_start, double crop_size,
+  int target_size, int bits_per_pixel, double center_pos, int filter_size_alignment, bool streaming_stores, IScriptEnvironment* env)
+{
+  auto make_program = [&]() {
+    std::unique_ptr<ResamplingProgram> program(func->GetResamplingProgram(source_size, crop_start, crop_size, target_size, bits_per_pixel,
+      center_pos, center_pos, env));
+    resize_prepare_coeffs(program.get(), env, filter_size_alignment);
+    program->streaming_stores = streaming_stores;
+    return program.release();
+  };
+
+  ResamplingProgramKey key = { func->CacheKey(), source_size, target_size, crop_start, crop_size, center_pos,
+    bits_per_pixel, filter_size_alignment, streaming_stores };
+  if (key.kernel.empty())
+    return std::shared_ptr<ResamplingProgram>(make_program());
+
+  ResamplingProgramCache& cache = GetResamplingProgramCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+
+  auto it = cache.programs.find(key);
+  if (it != cache.programs.end()) {
+    std::shared_ptr<ResamplingProgram> program = it->second.lock();
+    if (program)
+      return program;
+  }
+
+  // Made under the lock, a parallel load of the same geometry waits for it instead of making it again
+  std::shared_ptr<ResamplingProgram> program(make_program(), [key](ResamplingProgram* p) {
+    ResamplingProgramCache& cache = GetResamplingProgramCache();
+    {
+      std::lock_guard<std::mutex> lock(cache.mutex);
+      auto it = cache.programs.find(key);
+      // may have been replaced by a new program since this one expired
+      if (it != cache.programs.end() && it->second.expired())
+        cache.programs.erase(it);
+    }
+    delete p;
+  });
+  cache.programs[key] = program;
+  return program;
+}
+
 /***************************************
  ***** Vertical Resizer Assembly *******
  ***************************************/
@@ -676,7 +754,6 @@ static void GetCenterShiftForResizers(double& center_pos_luma, double& center_po
 FilteredResizeH::FilteredResizeH(PClip _child, double subrange_left, double subrange_width,
   int target_width, ResamplingFunction* func, bool preserve_center, int chroma_placement, IScriptEnvironment* env)
   : GenericVideoFilter(_child),
-  resampling_program_luma(nullptr), resampling_program_chroma(nullptr), 
   resampler_h_chroma(nullptr), resampler_h_luma(nullptr),
   resampler_chroma(nullptr), resampler_luma(nullptr)
 
@@ -708,45 +785,48 @@ FilteredResizeH::FilteredResizeH(PClip _child, double subrange_left, double subr
   GetCenterShiftForResizers(center_pos_h_luma, center_pos_h_chroma, preserve_center, chroma_placement, vi, true /* for horizontal */);
   // 3.7.4- parameter, old Avisynth behavior: 0.5, 0.5
 
+// when not fast_resize, then we use vertical resizers between turnleft/turnright
+#ifdef INTEL_INTRINSICS
+  int cpu = env->GetCPUFlags();
+  bool has_sse2 = (cpu & CPUF_SSE2) != 0;
+#else
+  int cpu = 0;
+#endif
+
+  fast_resize = vi.IsPlanar();
+  // PF 2025: H is not slower than V in C implementation.
+  // Still, H resizers are incompatible with packed RGB formats
+
+  const int filter_size_alignment = fast_resize ?
+    GetFilterSizeAlignment(cpu, pixelsize) : FilteredResizeV::GetFilterSizeAlignment(cpu, pixelsize);
+
   // Main resampling program
-  resampling_program_luma = func->GetResamplingProgram(vi.width, subrange_left, subrange_width, target_width, bits_per_pixel, 
-    center_pos_h_luma, center_pos_h_luma, // for resizing it's the same for source and dest
-    env);
+  resampling_program_luma = GetSharedResamplingProgram(func, vi.width, subrange_left, subrange_width, target_width, bits_per_pixel, 
+    center_pos_h_luma, // for resizing it's the same for source and dest
+    filter_size_alignment, true, env);
   if (vi.IsPlanar() && !grey && !isRGBPfamily) {
     const int shift = vi.GetPlaneWidthSubsampling(PLANAR_U);
     const int div = 1 << shift;
 
 
-    resampling_program_chroma = func->GetResamplingProgram(
+    resampling_program_chroma = GetSharedResamplingProgram(func,
       vi.width >> shift,
       subrange_left / div,
       subrange_width / div,
       target_width >> shift,
       bits_per_pixel,
-      center_pos_h_chroma, center_pos_h_chroma, // horizontal
-      env);
+      center_pos_h_chroma, // horizontal
+      filter_size_alignment, true, env);
   }
 
-// when not fast_resize, then we use vertical resizers between turnleft/turnright
-#ifdef INTEL_INTRINSICS
-  int cpu = env->GetCPUFlags();
-  bool has_sse2 = (cpu & CPUF_SSE2) != 0;
-#else
-  int cpu = 0;
-#endif
-
-  fast_resize = vi.IsPlanar();
-  // PF 2025: H is not slower than V in C implementation.
-  // Still, H resizers are incompatible with packed RGB formats
-
     if (!fast_resize) {
 
       // nonfast-resize: using V resizer for horizontal resizing between a turnleft/right
 
-      resampler_luma = FilteredResizeV::GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_luma, env);
+      resampler_luma = FilteredResizeV::GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_luma.get());
 
       if (vi.IsPlanar() && !grey && !isRGBPfamily) {
-        resampler_chroma = FilteredResizeV::GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_chroma, env);
+        resampler_chroma = FilteredResizeV::GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_chroma.get());
       }
 
       // Temporary buffer size for turns
@@ -842,10 +922,10 @@ FilteredResizeH::FilteredResizeH(PClip _child, double subrange_left, double subr
     else {
       // planar format (or Y)
 #ifdef INTEL_INTRINSICS
-      resampler_h_luma = GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_luma, env);
+      resampler_h_luma = GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_luma.get());
 
       if (!grey && !isRGBPfamily) {
-        resampler_h_chroma = GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_chroma, env);
+        resampler_h_chroma = GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_chroma.get());
       }
 #else
       assert(0);
@@ -876,17 +956,17 @@ PVideoFrame __stdcall FilteredResizeH::GetFrame(int n, IScriptEnvironment* env)
     if (!vi.IsRGB() || isRGBPfamily) {
       // Y/G Plane
       turn_right(src->GetReadPtr(), temp_1, src_width * pixelsize, src_height, src->GetPitch(), temp_1_pitch); // * pixelsize: turn_right needs GetPlaneWidth full size
-      resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_luma, src_height, dst_width, bits_per_pixel);
+      resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_luma.get(), src_height, dst_width, bits_per_pixel);
       turn_left(temp_2, dst->GetWritePtr(), dst_height * pixelsize, dst_width, temp_2_pitch, dst->GetPitch());
 
       if (isRGBPfamily)
       {
         turn_right(src->GetReadPtr(PLANAR_B), temp_1, src_width * pixelsize, src_height, src->GetPitch(PLANAR_B), temp_1_pitch); // * pixelsize: turn_right needs GetPlaneWidth full size
-        resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_luma, src_height, dst_width, bits_per_pixel);
+        resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_luma.get(), src_height, dst_width, bits_per_pixel);
         turn_left(temp_2, dst->GetWritePtr(PLANAR_B), dst_height * pixelsize, dst_width, temp_2_pitch, dst->GetPitch(PLANAR_B));
 
         turn_right(src->GetReadPtr(PLANAR_R), temp_1, src_width * pixelsize, src_height, src->GetPitch(PLANAR_R), temp_1_pitch); // * pixelsize: turn_right needs GetPlaneWidth full size
-        resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_luma, src_height, dst_width, bits_per_pixel);
+        resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_luma.get(), src_height, dst_width, bits_per_pixel);
         turn_left(temp_2, dst->GetWritePtr(PLANAR_R), dst_height * pixelsize, dst_width, temp_2_pitch, dst->GetPitch(PLANAR_R));
       }
       else if (!grey) {
@@ -901,18 +981,18 @@ PVideoFrame __stdcall FilteredResizeH::GetFrame(int n, IScriptEnvironment* env)
         // turn_xxx: width * pixelsize: needs GetPlaneWidth-like full size
         // U Plane
         turn_right(src->GetReadPtr(PLANAR_U), temp_1, src_chroma_width * pixelsize, src_chroma_height, src->GetPitch(PLANAR_U), temp_1_pitch);
-        resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_chroma, src_chroma_height, dst_chroma_width, bits_per_pixel);
+        resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_chroma.get(), src_chroma_height, dst_chroma_width, bits_per_pixel);
         turn_left(temp_2, dst->GetWritePtr(PLANAR_U), dst_chroma_height * pixelsize, dst_chroma_width, temp_2_pitch, dst->GetPitch(PLANAR_U));
 
         // V Plane
         turn_right(src->GetReadPtr(PLANAR_V), temp_1, src_chroma_width * pixelsize, src_chroma_height, src->GetPitch(PLANAR_V), temp_1_pitch);
-        resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_chroma, src_chroma_height, dst_chroma_width, bits_per_pixel);
+        resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_chroma.get(), src_chroma_height, dst_chroma_width, bits_per_pixel);
         turn_left(temp_2, dst->GetWritePtr(PLANAR_V), dst_chroma_height * pixelsize, dst_chroma_width, temp_2_pitch, dst->GetPitch(PLANAR_V));
       }
       if (vi.IsYUVA() || vi.IsPlanarRGBA())
       {
         turn_right(src->GetReadPtr(PLANAR_A), temp_1, src_width * pixelsize, src_height, src->GetPitch(PLANAR_A), temp_1_pitch); // * pixelsize: turn_right needs GetPlaneWidth full size
-        resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_luma, src_height, dst_width, bits_per_pixel);
+        resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_luma.get(), src_height, dst_width, bits_per_pixel);
         turn_left(temp_2, dst->GetWritePtr(PLANAR_A), dst_height * pixelsize, dst_width, temp_2_pitch, dst->GetPitch(PLANAR_A));
       }
 
@@ -921,7 +1001,7 @@ PVideoFrame __stdcall FilteredResizeH::GetFrame(int n, IScriptEnvironment* env)
       // packed RGB
       // First left, then right. Reason: packed RGB bottom to top. Right+left shifts RGB24/RGB32 image to the opposite horizontal direction
       turn_left(src->GetReadPtr(), temp_1, vi.BytesFromPixels(src_width), src_height, src->GetPitch(), temp_1_pitch);
-      resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_luma, vi.BytesFromPixels(src_height) / pixelsize, dst_width, bits_per_pixel);
+      resampler_luma(temp_2, temp_1, temp_2_pitch, temp_1_pitch, resampling_program_luma.get(), vi.BytesFromPixels(src_height) / pixelsize, dst_width, bits_per_pixel);
       turn_right(temp_2, dst->GetWritePtr(), vi.BytesFromPixels(dst_height), dst_width, temp_2_pitch, dst->GetPitch());
     }
 
@@ -931,25 +1011,25 @@ PVideoFrame __stdcall FilteredResizeH::GetFrame(int n, IScriptEnvironment* env)
   else {
 
     // Y Plane
-    resampler_h_luma(dst->GetWritePtr(), src->GetReadPtr(), dst->GetPitch(), src->GetPitch(), resampling_program_luma, dst_width, dst_height, bits_per_pixel);
+    resampler_h_luma(dst->GetWritePtr(), src->GetReadPtr(), dst->GetPitch(), src->GetPitch(), resampling_program_luma.get(), dst_width, dst_height, bits_per_pixel);
 
     if (isRGBPfamily) {
-      resampler_h_luma(dst->GetWritePtr(PLANAR_B), src->GetReadPtr(PLANAR_B), dst->GetPitch(PLANAR_B), src->GetPitch(PLANAR_B), resampling_program_luma, dst_width, dst_height, bits_per_pixel);
-      resampler_h_luma(dst->GetWritePtr(PLANAR_R), src->GetReadPtr(PLANAR_R), dst->GetPitch(PLANAR_R), src->GetPitch(PLANAR_R), resampling_program_luma, dst_width, dst_height, bits_per_pixel);
+      resampler_h_luma(dst->GetWritePtr(PLANAR_B), src->GetReadPtr(PLANAR_B), dst->GetPitch(PLANAR_B), src->GetPitch(PLANAR_B), resampling_program_luma.get(), dst_width, dst_height, bits_per_pixel);
+      resampler_h_luma(dst->GetWritePtr(PLANAR_R), src->GetReadPtr(PLANAR_R), dst->GetPitch(PLANAR_R), src->GetPitch(PLANAR_R), resampling_program_luma.get(), dst_width, dst_height, bits_per_pixel);
     }
     else if (!grey) {
       const int dst_chroma_width = dst_width >> vi.GetPlaneWidthSubsampling(PLANAR_U);
       const int dst_chroma_height = dst_height >> vi.GetPlaneHeightSubsampling(PLANAR_U);
 
       // U Plane
-      resampler_h_chroma(dst->GetWritePtr(PLANAR_U), src->GetReadPtr(PLANAR_U), dst->GetPitch(PLANAR_U), src->GetPitch(PLANAR_U), resampling_program_chroma, dst_chroma_width, dst_chroma_height, bits_per_pixel);
+      resampler_h_chroma(dst->GetWritePtr(PLANAR_U), src->GetReadPtr(PLANAR_U), dst->GetPitch(PLANAR_U), src->GetPitch(PLANAR_U), resampling_program_chroma.get(), dst_chroma_width, dst_chroma_height, bits_per_pixel);
 
       // V Plane
-      resampler_h_chroma(dst->GetWritePtr(PLANAR_V), src->GetReadPtr(PLANAR_V), dst->GetPitch(PLANAR_V), src->GetPitch(PLANAR_V), resampling_program_chroma, dst_chroma_width, dst_chroma_height, bits_per_pixel);
+      resampler_h_chroma(dst->GetWritePtr(PLANAR_V), src->GetReadPtr(PLANAR_V), dst->GetPitch(PLANAR_V), src->GetPitch(PLANAR_V), resampling_program_chroma.get(), dst_chroma_width, dst_chroma_height, bits_per_pixel);
     }
     if (vi.IsYUVA() || vi.IsPlanarRGBA())
     {
-      resampler_h_luma(dst->GetWritePtr(PLANAR_A), src->GetReadPtr(PLANAR_A), dst->GetPitch(PLANAR_A), src->GetPitch(PLANAR_A), resampling_program_luma, dst_width, dst_height, bits_per_pixel);
+      resampler_h_luma(dst->GetWritePtr(PLANAR_A), src->GetReadPtr(PLANAR_A), dst->GetPitch(PLANAR_A), src->GetPitch(PLANAR_A), resampling_program_luma.get(), dst_width, dst_height, bits_per_pixel);
     }
 
   }
@@ -957,26 +1037,33 @@ PVideoFrame __stdcall FilteredResizeH::GetFrame(int n, IScriptEnvironment* env)
   return dst;
 }
 
-ResamplerH FilteredResizeH::GetResampler(int CPU, int pixelsize, int bits_per_pixel, ResamplingProgram* program, IScriptEnvironment* env)
+int FilteredResizeH::GetFilterSizeAlignment(int CPU, int pixelsize)
 {
   // even for plain C, maybe once we write more vectorizer compiler-friendly code
   int simd_coeff_count_padding = 8;
 #ifdef INTEL_INTRINSICS
   if (CPU & CPUF_SSSE3) {
-    // both 8 and 16 bit SSSE3 and AVX2 horizontal resizer benefits from 16 pixels/cycle
+    // both 8 and 16 bit SSSE3, AVX2 and AVX512 horizontal resizer benefits from 16 pixels/cycle
     // float is also using 32 bytes, but as 32/sizeof(float) = 8, then don't need 16
     if (pixelsize == 1 || pixelsize == 2)
       simd_coeff_count_padding = 16;
   }
 #endif
-  // not only prepares and pads for SIMD, but corrects and reorders
-  // coeffs at the right/bottom end, since we have variable kernel size
-  // because of boundary conditions
-  resize_prepare_coeffs(program, env, simd_coeff_count_padding);
+  return simd_coeff_count_padding;
+}
+
+ResamplerH FilteredResizeH::GetResampler(int CPU, int pixelsize, int bits_per_pixel, ResamplingProgram* program)
+{
+  // program is already prepared by resize_prepare_coeffs with GetFilterSizeAlignment:
+  // not only prepared and padded for SIMD, but coeffs at the right/bottom end are corrected
+  // and reordered, since we have variable kernel size because of boundary conditions
 
   if (pixelsize == 1)
   {
 #ifdef INTEL_INTRINSICS
+    if ((CPU & CPUF_AVX512BW) && (CPU & CPUF_AVX512VL)) {
+      return resizer_h_avx512_generic_uint8_t;
+    }
     if (CPU & CPUF_AVX2) {
       return resizer_h_avx2_generic_uint8_t;
     }
@@ -988,6 +1075,12 @@ ResamplerH FilteredResizeH::GetResampler(int CPU, int pixelsize, int bits_per_pi
   }
   else if (pixelsize == 2) {
 #ifdef INTEL_INTRINSICS
+    if ((CPU & CPUF_AVX512BW) && (CPU & CPUF_AVX512VL)) {
+      if (bits_per_pixel < 16)
+        return resizer_h_avx512_generic_uint16_t<true>;
+      else
+        return resizer_h_avx512_generic_uint16_t<false>;
+    }
     if (CPU & CPUF_AVX2) {
       if (bits_per_pixel < 16)
         return resizer_h_avx2_generic_uint16_t<true>;
@@ -1008,6 +1101,9 @@ ResamplerH FilteredResizeH::GetResampler(int CPU, int pixelsize, int bits_per_pi
   }
   else { //if (pixelsize == 4)
 #ifdef INTEL_INTRINSICS
+    if ((CPU & CPUF_AVX512BW) && (CPU & CPUF_AVX512VL)) {
+      return resizer_h_avx512_generic_float;
+    }
     if (CPU & CPUF_AVX2) {
       return resizer_h_avx2_generic_float;
     }
@@ -1021,8 +1117,6 @@ ResamplerH FilteredResizeH::GetResampler(int CPU, int pixelsize, int bits_per_pi
 
 FilteredResizeH::~FilteredResizeH(void)
 {
-  if (resampling_program_luma) { delete resampling_program_luma; }
-  if (resampling_program_chroma) { delete resampling_program_chroma; }
 }
 
 /***************************************
@@ -1033,8 +1127,7 @@ FilteredResizeV::FilteredResizeV(PClip _child, double subrange_top, double subra
   int target_height, ResamplingFunction* func, 
   bool preserve_center, int chroma_placement,
   IScriptEnvironment* env)
-  : GenericVideoFilter(_child),
-  resampling_program_luma(0), resampling_program_chroma(0)
+  : GenericVideoFilter(_child)
 {
   if (target_height <= 0)
     env->ThrowError("Resize: Height must be greater than 0.");
@@ -1065,26 +1158,28 @@ FilteredResizeV::FilteredResizeV(PClip _child, double subrange_top, double subra
   GetCenterShiftForResizers(center_pos_v_luma, center_pos_v_chroma, preserve_center, chroma_placement, vi, false /* for vertical */);
   // 3.7.4- parameter, old Avisynth behavior: 0.5, 0.5
 
+  const int filter_size_alignment = GetFilterSizeAlignment(cpu, pixelsize);
+
   // Create resampling program and pitch table
-  resampling_program_luma = func->GetResamplingProgram(vi.height, subrange_top, subrange_height, target_height, bits_per_pixel, 
-    center_pos_v_luma, center_pos_v_luma, // for resizing it's the same for source and dest
-    env);
-  resampler_luma = GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_luma, env);
+  resampling_program_luma = GetSharedResamplingProgram(func, vi.height, subrange_top, subrange_height, target_height, bits_per_pixel, 
+    center_pos_v_luma, // for resizing it's the same for source and dest
+    filter_size_alignment, true, env);
+  resampler_luma = GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_luma.get());
 
   if (vi.IsPlanar() && !grey && !isRGBPfamily) {
     const int shift = vi.GetPlaneHeightSubsampling(PLANAR_U);
     const int div = 1 << shift;
 
-    resampling_program_chroma = func->GetResamplingProgram(
+    resampling_program_chroma = GetSharedResamplingProgram(func,
       vi.height >> shift,
       subrange_top / div,
       subrange_height / div,
       target_height >> shift,
       bits_per_pixel,
-      center_pos_v_chroma, center_pos_v_chroma, // for resizing it's the same for source and dest
-      env);
+      center_pos_v_chroma, // for resizing it's the same for source and dest
+      filter_size_alignment, true, env);
 
-    resampler_chroma = GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_chroma, env);
+    resampler_chroma = GetResampler(cpu, pixelsize, bits_per_pixel, resampling_program_chroma.get());
   }
 
   // Change target video info size
@@ -1104,7 +1199,7 @@ PVideoFrame __stdcall FilteredResizeV::GetFrame(int n, IScriptEnvironment* env)
 
   // Do resizing
   int work_width = vi.IsPlanar() ? vi.width : vi.BytesFromPixels(vi.width) / pixelsize; // packed RGB: or vi.width * vi.NumComponent()
-  resampler_luma(dstp, srcp, dst_pitch, src_pitch, resampling_program_luma, work_width, vi.height, bits_per_pixel);
+  resampler_luma(dstp, srcp, dst_pitch, src_pitch, resampling_program_luma.get(), work_width, vi.height, bits_per_pixel);
   if (isRGBPfamily)
   {
     src_pitch = src->GetPitch(PLANAR_B);
@@ -1112,14 +1207,14 @@ PVideoFrame __stdcall FilteredResizeV::GetFrame(int n, IScriptEnvironment* env)
     srcp = src->GetReadPtr(PLANAR_B);
     dstp = dst->GetWritePtr(PLANAR_B);
     
-    resampler_luma(dstp, srcp, dst_pitch, src_pitch, resampling_program_luma, work_width, vi.height, bits_per_pixel);
+    resampler_luma(dstp, srcp, dst_pitch, src_pitch, resampling_program_luma.get(), work_width, vi.height, bits_per_pixel);
     
     src_pitch = src->GetPitch(PLANAR_R);
     dst_pitch = dst->GetPitch(PLANAR_R);
     srcp = src->GetReadPtr(PLANAR_R);
     dstp = dst->GetWritePtr(PLANAR_R);
 
-    resampler_luma(dstp, srcp, dst_pitch, src_pitch, resampling_program_luma, work_width, vi.height, bits_per_pixel);
+    resampler_luma(dstp, srcp, dst_pitch, src_pitch, resampling_program_luma.get(), work_width, vi.height, bits_per_pixel);
   }
   else if (!grey && vi.IsPlanar()) {
     int width = vi.width >> vi.GetPlaneWidthSubsampling(PLANAR_U);
@@ -1131,7 +1226,7 @@ PVideoFrame __stdcall FilteredResizeV::GetFrame(int n, IScriptEnvironment* env)
     srcp = src->GetReadPtr(PLANAR_U);
     dstp = dst->GetWritePtr(PLANAR_U);
 
-    resampler_chroma(dstp, srcp, dst_pitch, src_pitch, resampling_program_chroma, width, height, bits_per_pixel);
+    resampler_chroma(dstp, srcp, dst_pitch, src_pitch, resampling_program_chroma.get(), width, height, bits_per_pixel);
 
     // Plane V resizing
     src_pitch = src->GetPitch(PLANAR_V);
@@ -1139,7 +1234,7 @@ PVideoFrame __stdcall FilteredResizeV::GetFrame(int n, IScriptEnvironment* env)
     srcp = src->GetReadPtr(PLANAR_V);
     dstp = dst->GetWritePtr(PLANAR_V);
 
-    resampler_chroma(dstp, srcp, dst_pitch, src_pitch, resampling_program_chroma, width, height, bits_per_pixel);
+    resampler_chroma(dstp, srcp, dst_pitch, src_pitch, resampling_program_chroma.get(), width, height, bits_per_pixel);
   }
 
   if (vi.IsYUVA() || vi.IsPlanarRGBA()) {
@@ -1147,16 +1242,22 @@ PVideoFrame __stdcall FilteredResizeV::GetFrame(int n, IScriptEnvironment* env)
     dst_pitch = dst->GetPitch(PLANAR_A);
     srcp = src->GetReadPtr(PLANAR_A);
     dstp = dst->GetWritePtr(PLANAR_A);
-    resampler_luma(dstp, srcp, dst_pitch, src_pitch, resampling_program_luma, work_width, vi.height, bits_per_pixel);
+    resampler_luma(dstp, srcp, dst_pitch, src_pitch, resampling_program_luma.get(), work_width, vi.height, bits_per_pixel);
   }
 
   return dst;
 }
 
-ResamplerV FilteredResizeV::GetResampler(int CPU, int pixelsize, int bits_per_pixel, ResamplingProgram* program, IScriptEnvironment* env)
+int FilteredResizeV::GetFilterSizeAlignment(int CPU, int pixelsize)
 {
+  AVS_UNUSED(CPU);
+  AVS_UNUSED(pixelsize);
+  return 8;
+}
 
-  resize_prepare_coeffs(program, env, 8); 
+ResamplerV FilteredResizeV::GetResampler(int CPU, int pixelsize, int bits_per_pixel, ResamplingProgram* program)
+{
+  // program is already prepared by resize_prepare_coeffs with GetFilterSizeAlignment
   // for SIMD friendliness and more: consolidate the kernel_size vs filter_size at the end.
   // See comments at FilteredResizeH::GetResampler
 
@@ -1175,6 +1276,8 @@ ResamplerV FilteredResizeV::GetResampler(int CPU, int pixelsize, int bits_per_pi
     if (pixelsize == 1)
     {
 #ifdef INTEL_INTRINSICS
+      if ((CPU & CPUF_AVX512BW) && (CPU & CPUF_AVX512VL))
+        return resize_v_avx512_planar_uint8_t;
       if (CPU & CPUF_AVX2)
         return resize_v_avx2_planar_uint8_t;
       if (CPU & CPUF_SSE2)
@@ -1190,6 +1293,12 @@ ResamplerV FilteredResizeV::GetResampler(int CPU, int pixelsize, int bits_per_pi
     else if (pixelsize == 2)
     {
 #ifdef INTEL_INTRINSICS
+      if ((CPU & CPUF_AVX512BW) && (CPU & CPUF_AVX512VL)) {
+        if (bits_per_pixel < 16)
+          return resize_v_avx512_planar_uint16_t<true>;
+        else
+          return resize_v_avx512_planar_uint16_t<false>;
+      }
       if (CPU & CPUF_AVX2) {
         if (bits_per_pixel < 16)
           return resize_v_avx2_planar_uint16_t<true>;
@@ -1212,6 +1321,9 @@ ResamplerV FilteredResizeV::GetResampler(int CPU, int pixelsize, int bits_per_pi
     else // pixelsize== 4
     {
 #ifdef INTEL_INTRINSICS
+      if ((CPU & CPUF_AVX512BW) && (CPU & CPUF_AVX512VL)) {
+        return resize_v_avx512_planar_float;
+      }
       if (CPU & CPUF_AVX2) {
         return resize_v_avx2_planar_float;
       }
@@ -1226,8 +1338,224 @@ ResamplerV FilteredResizeV::GetResampler(int CPU, int pixelsize, int bits_per_pi
 
 FilteredResizeV::~FilteredResizeV(void)
 {
-  if (resampling_program_luma) { delete resampling_program_luma; }
-  if (resampling_program_chroma) { delete resampling_program_chroma; }
+}
+
+
+/***************************************
+ ***** Filtered Resize - 2D ************
+ ***************************************/
+
+// Size of the intermediate rows of a band, kept well inside the L2 cache
+constexpr int RESIZE_2D_BAND_BYTES = 256 * 1024;
+
+FilteredResize2D::FilteredResize2D(PClip _child, double subrange_left, double subrange_top, double subrange_width, double subrange_height,
+  int target_width, int target_height, bool h_first, ResamplingFunction* func,
+  bool preserve_center, int chroma_placement, IScriptEnvironment* env)
+  : GenericVideoFilter(_child), h_first(h_first), luma(), chroma()
+{
+  if (target_width <= 0)
+    env->ThrowError("Resize: Width must be greater than 0.");
+  if (target_height <= 0)
+    env->ThrowError("Resize: Height must be greater than 0.");
+
+  pixelsize = vi.ComponentSize();
+  bits_per_pixel = vi.BitsPerComponent();
+  grey = vi.IsY();
+  bool isRGBPfamily = vi.IsPlanarRGB() || vi.IsPlanarRGBA();
+
+  if (!grey && !isRGBPfamily) {
+    const int mask_w = (1 << vi.GetPlaneWidthSubsampling(PLANAR_U)) - 1;
+    if (target_width & mask_w)
+      env->ThrowError("Resize: Planar destination width must be a multiple of %d.", mask_w + 1);
+    const int mask_h = (1 << vi.GetPlaneHeightSubsampling(PLANAR_U)) - 1;
+    if (target_height & mask_h)
+      env->ThrowError("Resize: Planar destination height must be a multiple of %d.", mask_h + 1);
+  }
+
+  double center_pos_h_luma, center_pos_h_chroma;
+  double center_pos_v_luma, center_pos_v_chroma;
+  GetCenterShiftForResizers(center_pos_h_luma, center_pos_h_chroma, preserve_center, chroma_placement, vi, true /* for horizontal */);
+  GetCenterShiftForResizers(center_pos_v_luma, center_pos_v_chroma, preserve_center, chroma_placement, vi, false /* for vertical */);
+
+  InitPlane(luma, func, vi.width, vi.height, target_width, target_height,
+    subrange_left, subrange_top, subrange_width, subrange_height,
+    center_pos_h_luma, center_pos_v_luma, env);
+
+  if (!grey && !isRGBPfamily) {
+    const int shift_w = vi.GetPlaneWidthSubsampling(PLANAR_U);
+    const int shift_h = vi.GetPlaneHeightSubsampling(PLANAR_U);
+    const int div_w = 1 << shift_w;
+    const int div_h = 1 << shift_h;
+
+    InitPlane(chroma, func, vi.width >> shift_w, vi.height >> shift_h, target_width >> shift_w, target_height >> shift_h,
+      subrange_left / div_w, subrange_top / div_h, subrange_width / div_w, subrange_height / div_h,
+      center_pos_h_chroma, center_pos_v_chroma, env);
+  }
+
+  vi.width = target_width;
+  vi.height = target_height;
+}
+
+void FilteredResize2D::InitPlane(Plane& p, ResamplingFunction* func, int src_width, int src_height, int dst_width, int dst_height,
+  double subrange_left, double subrange_top, double subrange_width, double subrange_height,
+  double center_pos_h, double center_pos_v, IScriptEnvironment* env)
+{
+#ifdef INTEL_INTRINSICS
+  int cpu = env->GetCPUFlags();
+#else
+  int cpu = 0;
+#endif
+
+  p.src_width = src_width;
+  p.src_height = src_height;
+  p.dst_width = dst_width;
+  p.dst_height = dst_height;
+
+  // the very same programs and resamplers FilteredResizeH and FilteredResizeV would use,
+  // except that the first pass writes the intermediate buffer, it should stay in the cache
+  p.program_h = GetSharedResamplingProgram(func, src_width, subrange_left, subrange_width, dst_width, bits_per_pixel,
+    center_pos_h, FilteredResizeH::GetFilterSizeAlignment(cpu, pixelsize), !h_first, env);
+  p.resampler_h = FilteredResizeH::GetResampler(cpu, pixelsize, bits_per_pixel, p.program_h.get());
+  p.program_v = GetSharedResamplingProgram(func, src_height, subrange_top, subrange_height, dst_height, bits_per_pixel,
+    center_pos_v, FilteredResizeV::GetFilterSizeAlignment(cpu, pixelsize), true, env);
+  p.resampler_v = FilteredResizeV::GetResampler(cpu, pixelsize, bits_per_pixel, p.program_v.get());
+
+  const ResamplingProgram* v = p.program_v.get();
+
+  // Intermediate rows are already resized horizontally when H goes first
+  p.temp_pitch = AlignNumber((h_first ? dst_width : src_width) * pixelsize, FRAME_ALIGN);
+  const int budget_rows = max(RESIZE_2D_BAND_BYTES / p.temp_pitch, 1);
+  // H first: a band of destination rows needs about band_rows * src/dst + kernel source rows
+  int band_rows = h_first ?
+    (int)((budget_rows - v->filter_size_real) * (double)dst_height / src_height) :
+    budget_rows;
+  band_rows = min(max(band_rows, 8), dst_height);
+
+  int max_window = 0;
+  for (int y = 0; y < dst_height; y += band_rows) {
+    Band b;
+    b.dst_first = y;
+    b.dst_count = min(band_rows, dst_height - y);
+
+    // offsets are not strictly monotonic at the edges
+    int src_first = v->pixel_offset[y];
+    int src_end = 0;
+    for (int i = y; i < y + b.dst_count; i++) {
+      src_first = min(src_first, v->pixel_offset[i]);
+      src_end = max(src_end, v->pixel_offset[i] + v->filter_size_real);
+    }
+    b.src_first = src_first;
+    b.src_count = src_end - src_first;
+    max_window = max(max_window, b.src_count);
+
+    // slice of the prepared vertical program, padded like resize_prepare_coeffs does
+    const int count_aligned = AlignNumber(b.dst_count, ALIGN_RESIZER_TARGET_SIZE);
+    ResamplingProgram* bp = new ResamplingProgram(v->filter_size, b.src_count, count_aligned,
+      v->crop_start, v->crop_size, bits_per_pixel, env);
+    bp->target_size = b.dst_count;
+    bp->filter_size_real = v->filter_size_real;
+    bp->filter_size_alignment = v->filter_size_alignment;
+    bp->streaming_stores = h_first;
+    for (int i = 0; i < count_aligned; i++) {
+      bp->pixel_offset[i] = i < b.dst_count ? v->pixel_offset[y + i] - src_first : 0;
+      bp->kernel_sizes[i] = v->filter_size_real;
+    }
+    const size_t coeffs = (size_t)b.dst_count * v->filter_size;
+    const size_t coeffs_aligned = (size_t)count_aligned * v->filter_size;
+    if (bits_per_pixel == 32) {
+      std::copy_n(v->pixel_coefficient_float + (size_t)y * v->filter_size, coeffs, bp->pixel_coefficient_float);
+      std::fill(bp->pixel_coefficient_float + coeffs, bp->pixel_coefficient_float + coeffs_aligned, 0.0f);
+    }
+    else {
+      std::copy_n(v->pixel_coefficient + (size_t)y * v->filter_size, coeffs, bp->pixel_coefficient);
+      std::fill(bp->pixel_coefficient + coeffs, bp->pixel_coefficient + coeffs_aligned, (short)0);
+    }
+    b.program = bp;
+    p.bands.push_back(b);
+  }
+
+  // H first: the source rows of consecutive bands overlap, they are resized
+  // horizontally only once. Twice the largest window, so that the rows still
+  // needed are moved back to the start of the buffer only every other band or so.
+  p.temp_rows = h_first ? max_window * 2 : band_rows;
+}
+
+void FilteredResize2D::ResizePlane(const Plane& p, BYTE* dstp, const BYTE* srcp, int dst_pitch, int src_pitch, BYTE* temp)
+{
+  const int temp_pitch = p.temp_pitch;
+
+  if (!h_first) {
+    for (const Band& b : p.bands) {
+      p.resampler_v(temp, srcp + (size_t)b.src_first * src_pitch, temp_pitch, src_pitch, b.program, p.src_width, b.dst_count, bits_per_pixel);
+      p.resampler_h(dstp + (size_t)b.dst_first * dst_pitch, temp, dst_pitch, temp_pitch, p.program_h.get(), p.dst_width, b.dst_count, bits_per_pixel);
+    }
+    return;
+  }
+
+  // source rows [have_first, have_end) are ready in temp, source row 'base' is at its top
+  int base = 0;
+  int have_first = 0;
+  int have_end = 0;
+  for (const Band& b : p.bands) {
+    const int src_first = b.src_first;
+    const int src_end = b.src_first + b.src_count;
+
+    if (src_first < have_first || src_first >= have_end) {
+      base = have_first = have_end = src_first;
+    }
+    else if (src_end - base > p.temp_rows) {
+      // keep the overlapping rows, move them to the top
+      memmove(temp, temp + (size_t)(src_first - base) * temp_pitch, (size_t)(have_end - src_first) * temp_pitch);
+      base = have_first = src_first;
+    }
+
+    if (have_end < src_end) {
+      p.resampler_h(temp + (size_t)(have_end - base) * temp_pitch, srcp + (size_t)have_end * src_pitch, temp_pitch, src_pitch,
+        p.program_h.get(), p.dst_width, src_end - have_end, bits_per_pixel);
+      have_end = src_end;
+    }
+
+    p.resampler_v(dstp + (size_t)b.dst_first * dst_pitch, temp + (size_t)(src_first - base) * temp_pitch, dst_pitch, temp_pitch,
+      b.program, p.dst_width, b.dst_count, bits_per_pixel);
+  }
+}
+
+PVideoFrame __stdcall FilteredResize2D::GetFrame(int n, IScriptEnvironment* env)
+{
+  PVideoFrame src = child->GetFrame(n, env);
+  PVideoFrame dst = env->NewVideoFrameP(vi, &src);
+
+  const bool isRGBPfamily = vi.IsPlanarRGB() || vi.IsPlanarRGBA();
+  const bool has_chroma = !grey && !isRGBPfamily;
+
+  size_t temp_size = (size_t)luma.temp_pitch * luma.temp_rows;
+  if (has_chroma)
+    temp_size = max(temp_size, (size_t)chroma.temp_pitch * chroma.temp_rows);
+  BYTE* temp = static_cast<BYTE*>(env->Allocate(temp_size, FRAME_ALIGN, AVS_POOLED_ALLOC));
+  if (!temp)
+    env->ThrowError("Could not reserve memory in a resampler.");
+
+  int planes_y[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+  int planes_r[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
+  int* planes = isRGBPfamily ? planes_r : planes_y;
+  const int num_planes = vi.NumComponents();
+
+  for (int i = 0; i < num_planes; i++) {
+    const int plane = planes[i];
+    const Plane& p = (has_chroma && (plane == PLANAR_U || plane == PLANAR_V)) ? chroma : luma;
+    ResizePlane(p, dst->GetWritePtr(plane), src->GetReadPtr(plane), dst->GetPitch(plane), src->GetPitch(plane), temp);
+  }
+
+  env->Free(temp);
+  return dst;
+}
+
+FilteredResize2D::~FilteredResize2D(void)
+{
+  for (Plane* p : { &luma, &chroma }) {
+    for (Band& b : p->bands)
+      delete b.program;
+  }
 }
 
 
@@ -1333,7 +1661,17 @@ PClip FilteredResize::CreateResize(PClip clip, int target_width, int target_heig
   // 3 - force H and V
   const bool force_H = force == 1 || force == 3;
   const bool force_V = force == 2 || force == 3;
-  if (area_FirstH < area_FirstV)
+  const bool do_H = force_H || subrange_left != 0 || subrange_width != target_width || subrange_width != vi.width;
+  const bool do_V = force_V || subrange_top != 0 || subrange_height != target_height || subrange_height != vi.height;
+  // Both directions in one filter, without a full size intermediate frame. Only for
+  // vertical downscales: there each band needs fewer intermediate rows than it writes,
+  // while upscales were measured equal or slower than the two-filter chain.
+  if (do_H && do_V && vi.IsPlanar() && target_height < subrange_height)
+  {
+    result = new FilteredResize2D(clip, subrange_left, subrange_top, subrange_width, subrange_height, target_width, target_height,
+      !(area_FirstH < area_FirstV), f, preserve_center, chroma_placement, env);
+  }
+  else if (area_FirstH < area_FirstV)
   {
     result = CreateResizeV(clip, subrange_top, subrange_height, target_height, force_V, f, preserve_center, chroma_placement, env);
     result = CreateResizeH(result, subrange_left, subrange_width, target_width, force_H, f, preserve_center, chroma_placement, env);
@@ -37,9 +37,15 @@
 
 #include <avisynth.h>
 #include "resample_functions.h"
+#include <memory>
 
 void resize_prepare_coeffs(ResamplingProgram* p, IScriptEnvironment* env, int alignFilterSize8or16);
 
+// Program made by func and prepared by resize_prepare_coeffs. Programs are shared
+// process-wide by all filters resizing with the same kernel, geometry and bit depth.
+std::shared_ptr<ResamplingProgram> GetSharedResamplingProgram(ResamplingFunction* func, int source_size, double crop_start, double crop_size,
+  int target_size, int bits_per_pixel, double center_pos, int filter_size_alignment, bool streaming_stores, IScriptEnvironment* env);
+
 // Resizer function pointer
 typedef void (*ResamplerV)(BYTE* dst, const BYTE* src, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int target_height, int bits_per_pixel);
 typedef void (*ResamplerH)(BYTE* dst, const BYTE* src, int dst_pitch, int src_pitch, ResamplingProgram* program, int width, int target_height, int bits_per_pixel);
@@ -60,16 +66,18 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
-  static ResamplerH GetResampler(int CPU, int pixelsize, int bits_per_pixel, ResamplingProgram* program, IScriptEnvironment* env);
+  static int GetFilterSizeAlignment(int CPU, int pixelsize);
+  static ResamplerH GetResampler(int CPU, int pixelsize, int bits_per_pixel, ResamplingProgram* program);
 
 private:
   // Resampling
-  ResamplingProgram* resampling_program_luma;
-  ResamplingProgram* resampling_program_chroma;
+  std::shared_ptr<ResamplingProgram> resampling_program_luma;
+  std::shared_ptr<ResamplingProgram> resampling_program_chroma;
 
   int temp_1_pitch, temp_2_pitch;
 
@@ -102,25 +110,83 @@ public:
   PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
 
   int __stdcall SetCacheHints(int cachehints, int frame_range) override {
-    AVS_UNUSED(frame_range);
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
     return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
   }
 
-  static ResamplerV GetResampler(int CPU, int pixelsize, int bits_per_pixel, ResamplingProgram* program, IScriptEnvironment* env);
+  static int GetFilterSizeAlignment(int CPU, int pixelsize);
+  static ResamplerV GetResampler(int CPU, int pixelsize, int bits_per_pixel, ResamplingProgram* program);
 
 private:
   bool grey;
   int pixelsize; // AVS16
   int bits_per_pixel;
 
-  ResamplingProgram* resampling_program_luma;
-  ResamplingProgram* resampling_program_chroma;
+  std::shared_ptr<ResamplingProgram> resampling_program_luma;
+  std::shared_ptr<ResamplingProgram> resampling_program_chroma;
 
   ResamplerV resampler_luma;
   ResamplerV resampler_chroma;
 };
 
 
+/**
+  * Class to resize in both directions in one pass, planar formats only.
+  * Same programs and resamplers as a FilteredResizeH + FilteredResizeV chain, with
+  * identical results, but the frame is done in bands of rows through a small
+  * intermediate buffer instead of a full size intermediate frame.
+  * Helper for resample functions
+ **/
+class FilteredResize2D : public GenericVideoFilter
+{
+public:
+  FilteredResize2D(PClip _child, double subrange_left, double subrange_top, double subrange_width, double subrange_height,
+    int target_width, int target_height, bool h_first, ResamplingFunction* func,
+    bool preserve_center, int chroma_placement, IScriptEnvironment* env);
+  virtual ~FilteredResize2D(void);
+  PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override;
+
+  int __stdcall SetCacheHints(int cachehints, int frame_range) override {
+    if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+      return child->SetCacheHints(cachehints, frame_range);
+    return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
+  }
+
+private:
+  // A band of destination rows, done by one vertical resampler call.
+  // Its program is a slice of the full vertical one, offsets relative to src_first.
+  struct Band {
+    int dst_first, dst_count;
+    int src_first, src_count;
+    ResamplingProgram* program;
+  };
+
+  struct Plane {
+    int src_width, src_height, dst_width, dst_height;
+    std::shared_ptr<ResamplingProgram> program_h;
+    std::shared_ptr<ResamplingProgram> program_v;
+    ResamplerH resampler_h;
+    ResamplerV resampler_v;
+    std::vector<Band> bands;
+    int temp_pitch, temp_rows;
+  };
+
+  void InitPlane(Plane& p, ResamplingFunction* func, int src_width, int src_height, int dst_width, int dst_height,
+    double subrange_left, double subrange_top, double subrange_width, double subrange_height,
+    double center_pos_h, double center_pos_v, IScriptEnvironment* env);
+  void ResizePlane(const Plane& p, BYTE* dstp, const BYTE* srcp, int dst_pitch, int src_pitch, BYTE* temp);
+
+  bool h_first;
+  bool grey;
+  int pixelsize;
+  int bits_per_pixel;
+
+  Plane luma;
+  Plane chroma;
+};
+
+
 /*** Resample factory methods ***/
 
 class FilteredResize
@@ -38,6 +38,7 @@
 #include <algorithm>
 #include <avs/minmax.h>
 #include <avs/alignment.h>
+#include <cstdio>
 
 
 /*******************************************
@@ -326,6 +327,18 @@ double UserDefined2Filter::f(double x)
  **** Resampling Patterns  ****
  *****************************/
 
+std::string ResamplingFunction::MakeCacheKey(const char* name, std::initializer_list<double> params)
+{
+  // %a is exact, parameters differing only in the last bit still make different programs
+  std::string key = name;
+  char buf[32];
+  for (double param : params) {
+    snprintf(buf, sizeof(buf), ",%a", param);
+    key += buf;
+  }
+  return key;
+}
+
 ResamplingProgram* ResamplingFunction::GetResamplingProgram(int source_size, double crop_start, double crop_size, int target_size, int bits_per_pixel, 
   double center_pos_src, double center_pos_dst,
   IScriptEnvironment* env)
@@ -38,6 +38,8 @@
 #include <avisynth.h>
 #include "avs/alignment.h"
 #include <vector>
+#include <string>
+#include <initializer_list>
 #include <stdint.h>
 
 // Original value: 65536
@@ -81,6 +83,10 @@ struct ResamplingProgram {
   // in H resizers danger zone starts from here.
   // When reading aligned_filter_size elements from (src+offset) no longer fits image scanline dimensions
 
+  // SIMD resizers may write the target with non-temporal stores, bypassing the cache.
+  // Cleared when the target is a small buffer which is read back right away.
+  bool streaming_stores;
+
 
   ResamplingProgram(int filter_size, int source_size, int target_size, double crop_start, double crop_size, int bits_per_pixel, IScriptEnvironment* env)
     : Env(env), source_size(source_size), target_size(target_size), crop_start(crop_start), crop_size(crop_size), filter_size(filter_size), filter_size_real(filter_size),
@@ -89,30 +95,32 @@ struct ResamplingProgram {
     overread_possible = false;
     source_overread_offset = -1;
     source_overread_beyond_targetx = -1;
+    streaming_stores = true;
 
     // align target_size to 8 units to allow safe 8 pixels/cycle in H resizers
     filter_size_alignment = 1;
     // resize_prepare_coeff can override and realign the size of coefficient table
+    // Not from Env: programs are shared and may outlive the environment which made them.
     if (bits_per_pixel < 32)
-      pixel_coefficient = (short*)Env->Allocate(sizeof(short) * target_size * filter_size, 64, AVS_NORMAL_ALLOC);
+      pixel_coefficient = (short*)avs_malloc(sizeof(short) * target_size * filter_size, 64);
     else
-      pixel_coefficient_float = (float*)Env->Allocate(sizeof(float) * target_size * filter_size, 64, AVS_NORMAL_ALLOC);
+      pixel_coefficient_float = (float*)avs_malloc(sizeof(float) * target_size * filter_size, 64);
 
     pixel_offset.resize(target_size);
     kernel_sizes.resize(target_size);
 
     if ((pixel_coefficient == nullptr && bits_per_pixel < 32) ||
         (pixel_coefficient_float == nullptr && bits_per_pixel == 32)) {
-      Env->Free(pixel_coefficient);
-      Env->Free(pixel_coefficient_float);
+      avs_free(pixel_coefficient);
+      avs_free(pixel_coefficient_float);
       Env->ThrowError("ResamplingProgram: Could not reserve memory.");
     }
 
   };
 
   ~ResamplingProgram() {
-    Env->Free(pixel_coefficient);
-    Env->Free(pixel_coefficient_float);
+    avs_free(pixel_coefficient);
+    avs_free(pixel_coefficient_float);
   };
 };
 
@@ -138,8 +146,14 @@ public:
   virtual ResamplingProgram* GetResamplingProgram(int source_size, double crop_start, double crop_size, int target_size, int bits_per_pixel, 
     double center_pos_src, double center_pos_dst,
     IScriptEnvironment* env);
+  // Kernel name and parameters, programs with the same key are shared (see GetSharedResamplingProgram).
+  // Empty key: never shared
+  virtual std::string CacheKey() { return std::string(); }
   virtual ~ResamplingFunction() = default;
   // virtual bool CheckValidity(int source_size, double crop_size, int target_size);
+
+protected:
+  static std::string MakeCacheKey(const char* name, std::initializer_list<double> params = {});
 };
 
 class PointFilter : public ResamplingFunction
@@ -150,6 +164,7 @@ class PointFilter : public ResamplingFunction
 public:
   double f(double x);
   double support() { return 0; }  
+  std::string CacheKey() override { return MakeCacheKey("point"); }
   // Pre 3.7.4 : 0.0001. Comment: 0.0 crashes it. 
   // 3.7.4- this 0 is specially handled in GetResamplingProgram
 };
@@ -163,6 +178,7 @@ class TriangleFilter : public ResamplingFunction
 public:
   double f(double x);
   double support() { return 1.0; }
+  std::string CacheKey() override { return MakeCacheKey("bilinear"); }
 };
 
 
@@ -175,6 +191,7 @@ public:
   MitchellNetravaliFilter(double b = 1. / 3., double c = 1. / 3.);
   double f(double x);
   double support() { return 2.0; }
+  std::string CacheKey() override { return MakeCacheKey("bicubic", { p0, p2, p3, q0, q1, q2, q3 }); }
 
 private:
   double p0,p2,p3,q0,q1,q2,q3;
@@ -189,6 +206,7 @@ public:
   LanczosFilter(int _taps = 3);
 	double f(double x);
 	double support() { return taps; };
+  std::string CacheKey() override { return MakeCacheKey("lanczos", { taps }); }
 
 private:
 	double sinc(double value);
@@ -204,6 +222,7 @@ public:
   BlackmanFilter(int _taps = 4);
 	double f(double x);
 	double support() { return taps; };
+  std::string CacheKey() override { return MakeCacheKey("blackman", { taps }); }
 
 private:
   double taps, rtaps;
@@ -218,6 +237,7 @@ class Spline16Filter : public ResamplingFunction
 public:
 	double f(double x);
 	double support() { return 2.0; };
+  std::string CacheKey() override { return MakeCacheKey("spline16"); }
 
 private:
 };
@@ -231,6 +251,7 @@ class Spline36Filter : public ResamplingFunction
 public:
 	double f(double x);
 	double support() { return 3.0; };
+  std::string CacheKey() override { return MakeCacheKey("spline36"); }
 
 private:
 };
@@ -244,6 +265,7 @@ class Spline64Filter : public ResamplingFunction
 public:
 	double f(double x);
 	double support() { return 4.0; };
+  std::string CacheKey() override { return MakeCacheKey("spline64"); }
 
 private:
 };
@@ -258,6 +280,7 @@ public:
   GaussianFilter(double p = 30.0, double _b = 2.0, double _s = 4.0);
   double f(double x);
   double support() { return s; }; // <3.7.4 was fixed at 4.0
+  std::string CacheKey() override { return MakeCacheKey("gauss", { param, b, s }); }
 
 private:
   double param;
@@ -274,6 +297,7 @@ public:
   SincFilter(int _taps = 4);
 	double f(double x);
 	double support() { return taps; };
+  std::string CacheKey() override { return MakeCacheKey("sinc", { taps }); }
 
 private:
   double taps;
@@ -286,6 +310,7 @@ public:
   SinPowerFilter(double p = 2.5);
   double f(double x);
   double support() { return 2.0; }; // 2 very important, 4 cause bugs
+  std::string CacheKey() override { return MakeCacheKey("sinpow", { param }); }
 
 private:
   double param;
@@ -300,6 +325,7 @@ public:
   SincLin2Filter(int _taps = 15);
   double f(double x);
   double support() { return taps; };
+  std::string CacheKey() override { return MakeCacheKey("sinclin2", { taps }); }
 
 private:
   double sinc(double value);
@@ -315,6 +341,7 @@ public:
 	UserDefined2Filter(double _b, double _c, double _s);
 	double f(double x);
 	double support() { return s; }
+  std::string CacheKey() override { return MakeCacheKey("userdefined2", { a, b, c, s }); }
 
 private:
 	double sinc(double value);
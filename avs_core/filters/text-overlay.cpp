@@ -2384,7 +2384,7 @@ PVideoFrame FilterInfo::GetFrame(int n, IScriptEnvironment* env)
         "Frames per second: %7.4f (%u/%u)\n"                  //  51=31+20
         "FieldBased (Separated) Video: %s\n"                  //  35=32+3
         "Parity: %s\n"                                        //  35=9+26
-        "Video Pitch: %5u bytes.\n"                           //  25
+        "Video Pitch: %5d bytes.\n"                           //  25
         "Has Audio: %s\n"                                     //  15=12+3
 //        "123456789012345678901234567890123456789012345678901234567890\n"         // test
 , n, vii.num_frames
@@ -71,41 +71,27 @@ extern const AVSFunction Transform_filters[] = {
 
 PVideoFrame FlipVertical::GetFrame(int n, IScriptEnvironment* env) {
   PVideoFrame src = child->GetFrame(n, env);
-  PVideoFrame dst = env->NewVideoFrameP(vi, &src);
-  const BYTE* srcp = src->GetReadPtr();
-  BYTE* dstp = dst->GetWritePtr();
-  int row_size = src->GetRowSize();
-  int src_pitch = src->GetPitch();
-  int dst_pitch = dst->GetPitch();
-  env->BitBlt(dstp, dst_pitch, srcp + (vi.height-1) * src_pitch, -src_pitch, row_size, vi.height);
+  // No copy: the result is a view on the source frame which starts at its last line and has
+  // negative pitch. Such frames are read-only, MakeWritable makes a normal copy when needed.
+  // subframe is preserving frame properties
+  const int pitch = src->GetPitch();
+  const int rel_offset = (vi.height - 1) * pitch;
 
   bool isRGBPfamily = vi.IsPlanarRGB() || vi.IsPlanarRGBA();
   int planeUB = isRGBPfamily ? PLANAR_B : PLANAR_U;
-  int planeVR = isRGBPfamily ? PLANAR_R : PLANAR_V;
 
-  if (src->GetPitch(planeUB)) {
-    srcp = src->GetReadPtr(planeUB);
-    dstp = dst->GetWritePtr(planeUB);
-    row_size = src->GetRowSize(planeUB);
-    src_pitch = src->GetPitch(planeUB);
-    dst_pitch = dst->GetPitch(planeUB);
-    env->BitBlt(dstp, dst_pitch, srcp + (src->GetHeight(planeUB)-1) * src_pitch, -src_pitch, row_size, src->GetHeight(planeUB));
+  if (!src->GetPitch(planeUB))
+    return env->Subframe(src, rel_offset, -pitch, src->GetRowSize(), vi.height);
 
-    srcp = src->GetReadPtr(planeVR);
-    dstp = dst->GetWritePtr(planeVR);
-    env->BitBlt(dstp, dst_pitch, srcp + (src->GetHeight(planeVR)-1) * src_pitch, -src_pitch, row_size, src->GetHeight(planeVR));
+  const int pitchUV = src->GetPitch(planeUB);
+  const int rel_offsetUV = (src->GetHeight(planeUB) - 1) * pitchUV;
 
-    if (vi.IsYUVA() || vi.IsPlanarRGBA())
-    {
-      srcp = src->GetReadPtr(PLANAR_A);
-      dstp = dst->GetWritePtr(PLANAR_A);
-      row_size = src->GetRowSize(PLANAR_A);
-      src_pitch = src->GetPitch(PLANAR_A);
-      dst_pitch = dst->GetPitch(PLANAR_A);
-      env->BitBlt(dstp, dst_pitch, srcp + (src->GetHeight(PLANAR_A)-1) * src_pitch, -src_pitch, row_size, src->GetHeight(PLANAR_A));
-    }
-  }
-  return dst;
+  if (vi.IsYUVA() || vi.IsPlanarRGBA())
+    return env->SubframePlanarA(src, rel_offset, -pitch, src->GetRowSize(), vi.height,
+      rel_offsetUV, rel_offsetUV, -pitchUV, (vi.height - 1) * src->GetPitch(PLANAR_A));
+
+  return env->SubframePlanar(src, rel_offset, -pitch, src->GetRowSize(), vi.height,
+    rel_offsetUV, rel_offsetUV, -pitchUV);
 }
 
 AVSValue __cdecl FlipVertical::Create(AVSValue args, void*, IScriptEnvironment* env)
@@ -376,10 +362,11 @@ PVideoFrame Crop::GetFrame(int n, IScriptEnvironment* env_)
 }
 
 int __stdcall Crop::SetCacheHints(int cachehints, int frame_range) {
-  AVS_UNUSED(frame_range);
   switch (cachehints) {
   case CACHE_GET_MTMODE:
     return MT_NICE_FILTER;
+  case CACHE_GET_FRAME_DEPENDENCIES: // only frame n of child is used
+    return child->SetCacheHints(cachehints, frame_range);
   case CACHE_GET_DEV_TYPE:
     return GetDeviceTypes(child) & (DEV_TYPE_CPU | DEV_TYPE_CUDA);
   }
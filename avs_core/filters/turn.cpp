@@ -434,7 +434,8 @@ void Turn::SetTurnFunction(int direction, IScriptEnvironment* env)
 
 int __stdcall Turn::SetCacheHints(int cachehints, int frame_range)
 {
-  AVS_UNUSED(frame_range);
+  if (cachehints == CACHE_GET_FRAME_DEPENDENCIES) // only frame n of child is used
+    return child->SetCacheHints(cachehints, frame_range);
   return cachehints == CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
 }
 
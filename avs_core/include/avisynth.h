@@ -53,6 +53,12 @@
 //           - New propGetDataTypeHint (VSAPI4: mapGetDataTypeHint)
 //           - New propSetDataH, like propSetData but with optional data type hint (byte/string)
 //             (VSAPI4: mapSetData, our propSetData became VSAPI4: mapSetData3)
+// 202510xx  V12
+//           New NewVideoFrameFromPlanes: frame made of planes of other frames, shared without copy
+//           VideoFrame planes may be in different frame buffers, GetOffset is relative to
+//           the buffer of the plane.
+//           Frames may have negative pitch (e.g. FlipVertical output, a view on its source frame
+//           starting at the last line). Such frames are not writable, MakeWritable copies them.
 
 // http://avisynth.nl
 
@@ -123,7 +129,7 @@ enum AvsVersion {
   AVISYNTH_CLASSIC_INTERFACE_VERSION_25 = 3,
   AVISYNTH_CLASSIC_INTERFACE_VERSION_26BETA = 5,
   AVISYNTH_CLASSIC_INTERFACE_VERSION = 6,
-  AVISYNTH_INTERFACE_VERSION = 11,
+  AVISYNTH_INTERFACE_VERSION = 12,
   AVISYNTHPLUS_INTERFACE_BUGFIX_VERSION = 0 // reset to zero whenever the normal interface version bumps
 };
 
@@ -1007,6 +1013,8 @@ class VideoFrameBuffer {
   friend class VideoFrame;
   friend class Cache;
   friend class ScriptEnvironment;
+  friend class VFBStorage;
+  friend class FrameBufferFreeList;
   volatile long refcount;
 
   // AVS+CUDA extension, does not break plugins if appended here
@@ -1094,6 +1102,10 @@ class VideoFrame {
   // this one is changable by AmendPixelType in rare cases
   int pixel_type; // V10 - Copy from VideoInfo
 
+  // V12: planes shared from the buffers of other frames by NewVideoFrameFromPlanes.
+  // Index 0: Y/G, 1: U/B, 2: V/R, 3: A. nullptr: the plane is in vfb.
+  VideoFrameBuffer* plane_vfb[4];
+
   friend class PVideoFrame;
   void AddRef();
   void Release();
@@ -1113,6 +1125,7 @@ public:
   int GetHeight(int plane = DEFAULT_PLANE) const AVS_BakedCode( return AVS_LinkCall(GetHeight)(plane) )
 
   // generally you shouldn't use these three
+  // V12: a plane may be shared from another frame, then GetOffset is not relative to GetFrameBuffer()
   VideoFrameBuffer* GetFrameBuffer() const AVS_BakedCode( return AVS_LinkCall(GetFrameBuffer)() )
   int GetOffset(int plane = DEFAULT_PLANE) const AVS_BakedCode( return AVS_LinkCall(GetOffset)(plane) )
 
@@ -1148,6 +1161,18 @@ public:
 #ifdef BUILDING_AVSCORE
 public:
   void DESTRUCTOR();  /* Damn compiler won't allow taking the address of reserved constructs, make a dummy interlude */
+
+  // The buffer holding the plane, GetOffset(plane) is relative to it
+  VideoFrameBuffer* GetPlaneFrameBuffer(int plane) const;
+  bool HasSharedPlanes() const;
+  bool HasNegativePitch() const;
+  // Moves the plane into plane_buffer, the caller has set its offset already
+  void SharePlane(int plane, VideoFrameBuffer* plane_buffer);
+private:
+  static int PlaneIndex(int plane);
+  static void ReleaseFrameBuffer(VideoFrameBuffer* vfb);
+  bool IsFirstShare(int index) const;
+  void InheritSharedPlanes(VideoFrame* dst, int plane_count) const;
 #endif
 
 // Ensure VideoFrame cannot be publicly assigned
@@ -1238,6 +1263,15 @@ enum CachePolicyHint {
   CACHE_IS_MTGUARD_REQ,
   CACHE_IS_MTGUARD_ANS,
 
+  // Temporal access declaration for the Prefetcher.
+  // On CACHE_GET_FRAME_DEPENDENCIES (frame_range = n) a filter calls
+  // child->SetCacheHints(CACHE_WILL_NEED_FRAME, m) for every child frame m it will request
+  // for its frame n, then returns 1. Unanswered (0): unknown, stride prediction is used.
+  // Filters that are not cached (CACHE_DONT_CACHE_ME) should answer CACHE_WILL_NEED_FRAME
+  // the same way, passing the request through to their children.
+  CACHE_GET_FRAME_DEPENDENCIES,
+  CACHE_WILL_NEED_FRAME,
+
   CACHE_AVSPLUS_CUDA_CONSTANTS = 600,
 
   CACHE_GET_DEV_TYPE,          // Device types a filter can return
@@ -1537,6 +1571,16 @@ enum AvsEnvProperty {
 
   AEP_SUPPRESS_THREAD = 921,
   AEP_GETFRAME_RECURSIVE = 922,
+
+  // frame buffer free list statistics, summed over all devices
+  AEP_FRAMEPOOL_HITS = 931,
+  AEP_FRAMEPOOL_MISSES = 932,
+  AEP_FRAMEPOOL_STEALS = 933,
+
+  // AVS_POOLED_ALLOC buffer pool statistics
+  AEP_BUFFERPOOL_HITS = 941,
+  AEP_BUFFERPOOL_MISSES = 942,
+  AEP_BUFFERPOOL_RETAINED = 943,
 };
 
 // IScriptEnvironment::Allocate()
@@ -1713,6 +1757,12 @@ public:
   virtual int __stdcall propGetDataTypeHint(const AVSMap* map, const char* key, int index, int* error) = 0; // returns AVSPropDataTypeHint
   virtual int __stdcall propSetDataH(AVSMap* map, const char* key, const char* d, int length, int type, int append) = 0;
 
+  // V12
+  // New frame made of planes of other frames, without copying them. One entry per plane of vi
+  // (Y,U,V,A or G,B,R,A order): src_planes[i] of src_frames[i]. An empty src_frames[i] gets a new plane.
+  // Sizes must match vi. Frame properties are copied from prop_src if given.
+  virtual PVideoFrame __stdcall NewVideoFrameFromPlanes(const VideoInfo& vi, const PVideoFrame* src_frames, const int* src_planes, const PVideoFrame* prop_src) = 0;
+
 }; // end class IScriptEnvironment. Order is important. Avoid overloads with the same name.
 
 
@@ -1975,6 +2025,9 @@ public:
 
   virtual PVideoFrame __stdcall GetFrame(PClip c, int n, const PDevice& device) = 0;
 
+  // V12
+  virtual PVideoFrame __stdcall NewVideoFrameFromPlanes(const VideoInfo& vi, const PVideoFrame* src_frames, const int* src_planes, const PVideoFrame* prop_src) = 0;
+
 };
 
 // support interface conversion
@@ -506,6 +506,10 @@ enum {
   AVS_CACHE_IS_MTGUARD_REQ = 512,
   AVS_CACHE_IS_MTGUARD_ANS = 513,
 
+  // Temporal access declaration for the Prefetcher, see CACHE_GET_FRAME_DEPENDENCIES in avisynth.h
+  AVS_CACHE_GET_FRAME_DEPENDENCIES = 514,
+  AVS_CACHE_WILL_NEED_FRAME = 515,
+
   AVS_CACHE_AVSPLUS_CUDA_CONSTANTS = 600,
 
   AVS_CACHE_GET_DEV_TYPE = 601,          // Device types a filter can return
@@ -569,7 +573,15 @@ enum {
   AVS_AEP_PLANE_ALIGN = 903,
 
   AVS_AEP_SUPPRESS_THREAD = 921,
-  AVS_AEP_GETFRAME_RECURSIVE = 922
+  AVS_AEP_GETFRAME_RECURSIVE = 922,
+
+  AVS_AEP_FRAMEPOOL_HITS = 931,
+  AVS_AEP_FRAMEPOOL_MISSES = 932,
+  AVS_AEP_FRAMEPOOL_STEALS = 933,
+
+  AVS_AEP_BUFFERPOOL_HITS = 941,
+  AVS_AEP_BUFFERPOOL_MISSES = 942,
+  AVS_AEP_BUFFERPOOL_RETAINED = 943
 };
 
 // enum AvsAllocType for avs_allocate